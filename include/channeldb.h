@@ -0,0 +1,47 @@
+/****************************************************************************
+*
+* FERIT
+*
+* -----------------------------------------------------
+* Konstrukcijski zadatak kolegij: Digitalna videotehnika
+* -----------------------------------------------------
+*
+* channeldb.h
+*
+* Purpose: Channel database over every multiplex of network, in LCN order with tune parameters
+*
+* Made on 18.10.2026.
+*****************************************************************************/
+
+#ifndef CHANNELDB_H
+#define CHANNELDB_H
+
+#include <stdint.h>
+#include "nit.h"
+
+#define CHANNEL_DB_MAX_ENTRIES	(NIT_MAX_SERVICES)
+
+// One chanell, everything needed to tune to it is resolved when database is built
+typedef struct CHANNEL_DB_ENTRY{
+	uint16_t lcn;				// NIT_LCN_NONE sorts last
+	uint16_t serviceId;
+	uint16_t transportStreamId;
+	uint16_t originalNetworkId;
+	uint8_t serviceType;
+	uint8_t deliverySystem;		// NIT_DELIVERY_T or NIT_DELIVERY_T2
+	uint8_t bandwidth;			// MHz
+	uint32_t frequency;			// Hz
+}CHANNEL_DB_ENTRY;
+
+// Rebuild from services and transports currently known by NIT, returns number of chanells
+int ChannelDb_Rebuild();
+int ChannelDb_Count();
+// Copy entry at position in LCN order, returns 0 on success
+int ChannelDb_Get(int index, CHANNEL_DB_ENTRY *entry);
+// Position of service on transport stream, -1 if it is not there
+int ChannelDb_Find(uint16_t transportStreamId, uint16_t serviceId);
+// Position step places away from index with wrap around, index -1 starts from either end
+int ChannelDb_Next(int index, int step);
+void ChannelDb_Print();
+
+#endif
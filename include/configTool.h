@@ -24,6 +24,7 @@
 #include<stdio.h>
 #include<stdlib.h>
 #include"globals.h"
+#include"psicache.h"
 
 int loadConfigFile(char *configFileName);
 
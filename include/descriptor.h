@@ -0,0 +1,130 @@
+/****************************************************************************
+*
+* FERIT
+*
+* -----------------------------------------------------
+* Konstrukcijski zadatak kolegij: Digitalna videotehnika
+* -----------------------------------------------------
+*
+* descriptor.h
+*
+* Purpose: Parsing PMT descriptor loops into one contiguous block per PMT
+*
+* Made on 18.10.2026.
+*****************************************************************************/
+
+#ifndef DESCRIPTOR_H
+#define DESCRIPTOR_H
+
+#include <stdint.h>
+
+/* Descriptor tags */
+#define DESCRIPTOR_TAG_REGISTRATION		(0x05)
+#define DESCRIPTOR_TAG_CA				(0x09)
+#define DESCRIPTOR_TAG_ISO_639			(0x0A)
+#define DESCRIPTOR_TAG_VBI_TELETEXT		(0x46)
+#define DESCRIPTOR_TAG_STREAM_ID		(0x52)
+#define DESCRIPTOR_TAG_TELETEXT			(0x56)
+#define DESCRIPTOR_TAG_SUBTITLING		(0x59)
+#define DESCRIPTOR_TAG_AC3				(0x6A)
+#define DESCRIPTOR_TAG_EAC3				(0x7A)
+#define DESCRIPTOR_TAG_SERVICE			(0x48)
+#define DESCRIPTOR_TAG_NETWORK_NAME		(0x40)
+#define DESCRIPTOR_TAG_SERVICE_LIST		(0x41)
+#define DESCRIPTOR_TAG_SHORT_EVENT		(0x4D)
+#define DESCRIPTOR_TAG_TERRESTRIAL		(0x5A)
+#define DESCRIPTOR_TAG_EXTENSION		(0x7F)
+#define DESCRIPTOR_TAG_LOGICAL_CHANNEL	(0x83)	/* EACEM / NorDig, private to network */
+
+/* descriptor_tag_extension of DESCRIPTOR_TAG_EXTENSION */
+#define DESCRIPTOR_EXTENSION_T2_DELIVERY	(0x04)
+
+/* Kind of elementary stream, decided from stream_type and descriptors */
+#define ES_KIND_OTHER		(0)
+#define ES_KIND_VIDEO		(1)
+#define ES_KIND_AUDIO_MPEG	(2)
+#define ES_KIND_AUDIO_AAC	(3)
+#define ES_KIND_AUDIO_AC3	(4)
+#define ES_KIND_AUDIO_EAC3	(5)
+#define ES_KIND_TELETEXT	(6)
+#define ES_KIND_SUBTITLE	(7)
+
+#define ES_COMPONENT_TAG_NONE	(0xFF)
+
+typedef struct DESCRIPTOR_LANGUAGE{
+	char language[4];			// ISO 639-2 code, zero terminated
+	uint8_t audioType;
+}DESCRIPTOR_LANGUAGE;
+
+typedef struct DESCRIPTOR_TELETEXT{
+	char language[4];
+	uint8_t type;				// 1 initial page, 2 subtitle page, ...
+	uint8_t magazine;
+	uint8_t page;
+}DESCRIPTOR_TELETEXT;
+
+typedef struct DESCRIPTOR_SUBTITLE{
+	char language[4];
+	uint8_t type;
+	uint16_t compositionPage;
+	uint16_t ancillaryPage;
+}DESCRIPTOR_SUBTITLE;
+
+typedef struct DESCRIPTOR_CA{
+	uint16_t systemId;
+	uint16_t pid;
+}DESCRIPTOR_CA;
+
+// One elementary stream, its entries are ranges in block arrays
+typedef struct PMT_ES_INFO{
+	uint16_t elementaryPid;
+	uint8_t streamType;
+	uint8_t kind;
+	uint8_t componentTag;		// stream_identifier_descriptor, ES_COMPONENT_TAG_NONE if missing
+	uint8_t ac3ComponentType;	// from AC-3/E-AC-3 descriptor, 0 if missing
+	uint8_t languageCount;
+	uint8_t teletextCount;
+	uint8_t subtitleCount;
+	uint8_t caCount;
+	uint16_t languageFirst;
+	uint16_t teletextFirst;
+	uint16_t subtitleFirst;
+	uint16_t caFirst;
+	uint32_t registration;		// format_identifier, 0 if missing
+}PMT_ES_INFO;
+
+/*
+ * Block layout, one malloc per PMT, arrays are reached by byte offsets from block start:
+ *   PMT_DESCRIPTORS | PMT_ES_INFO[esCount] | DESCRIPTOR_CA[] | DESCRIPTOR_LANGUAGE[] | DESCRIPTOR_TELETEXT[] | DESCRIPTOR_SUBTITLE[]
+ * First programCaCount CA entries come from program_info loop.
+ */
+typedef struct PMT_DESCRIPTORS{
+	uint32_t size;				// whole block in bytes
+	uint16_t esCount;
+	uint16_t programCaCount;
+	uint32_t programRegistration;
+	uint32_t esOffset;
+	uint32_t caOffset;
+	uint32_t languageOffset;
+	uint32_t teletextOffset;
+	uint32_t subtitleOffset;
+}PMT_DESCRIPTORS;
+
+// Parse program_info and every ES_info loop of PMT section, returns NULL on broken section
+PMT_DESCRIPTORS *Descriptor_Parse_Pmt(const uint8_t *section);
+// Size of block Descriptor_Parse_Pmt would return, 0 on broken section
+uint32_t Descriptor_Pmt_Size(const uint8_t *section);
+// Parse into caller memory of Descriptor_Pmt_Size bytes
+PMT_DESCRIPTORS *Descriptor_Parse_Pmt_Into(const uint8_t *section, void *block, uint32_t size);
+
+PMT_ES_INFO *Descriptor_Es(const PMT_DESCRIPTORS *descriptors, int index);
+DESCRIPTOR_CA *Descriptor_Ca(const PMT_DESCRIPTORS *descriptors, int index);
+DESCRIPTOR_LANGUAGE *Descriptor_Language(const PMT_DESCRIPTORS *descriptors, int index);
+DESCRIPTOR_TELETEXT *Descriptor_Teletext(const PMT_DESCRIPTORS *descriptors, int index);
+DESCRIPTOR_SUBTITLE *Descriptor_Subtitle(const PMT_DESCRIPTORS *descriptors, int index);
+const char *Descriptor_Kind_Name(uint8_t kind);
+// Copy DVB text (EN 300 468 annex A) as zero terminated string, table selector and control codes are dropped
+void Descriptor_Text(char *text, int size, const uint8_t *data, int length);
+void Descriptor_Print(const PMT_DESCRIPTORS *descriptors);
+
+#endif
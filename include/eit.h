@@ -0,0 +1,68 @@
+/****************************************************************************
+*
+* FERIT
+*
+* -----------------------------------------------------
+* Konstrukcijski zadatak kolegij: Digitalna videotehnika
+* -----------------------------------------------------
+*
+* eit.h
+*
+* Purpose: Collecting EIT present/following and schedule sections into EPG store
+*
+* Made on 18.10.2026.
+*****************************************************************************/
+
+#ifndef EIT_H
+#define EIT_H
+
+#include <stdint.h>
+#include "section.h"
+
+#define EIT_PID						(0x12)
+#define EIT_TABLE_PF_ACTUAL			(0x4E)
+#define EIT_TABLE_PF_OTHER			(0x4F)
+#define EIT_TABLE_SCHEDULE_FIRST	(0x50)	/* 0x50 - 0x5F actual, 0x60 - 0x6F other */
+#define EIT_TABLE_SCHEDULE_LAST		(0x6F)
+#define EIT_FILTER_MATCH			(0x40)	/* one filter takes table_id 0x40 - 0x7F, parser keeps EIT */
+#define EIT_FILTER_MASK				(0xC0)
+
+#define EIT_MAX_SUBTABLES			(1024)	/* table_id x service, power of 2 */
+#define EIT_QUEUE_BYTES				(256 * 1024)	/* copies of new sections waiting for parser */
+
+#define EIT_QUEUE_FULL				(-2)	/* Eit_Queue_Section: section not taken, it comes again */
+
+/*
+ * Sections are checked and copied in demux callback, so schedule flood never holds demux buffers.
+ * Sub table (table_id, service, transport stream) remembers sections already queued, repeats stop in callback.
+ * Parser runs in PSI monitor thread and drains queue into EPG store.
+ */
+
+// Sections of one sub table, SECTION_SUBTABLE extension is service_id
+typedef struct EIT_SUBTABLE{
+	SECTION_SUBTABLE sections;
+	uint16_t transportStreamId;
+	uint16_t originalNetworkId;
+	int used;
+}EIT_SUBTABLE;
+
+typedef struct EIT_STATS{
+	uint32_t queued;
+	uint32_t repeats;
+	uint32_t dropped;			// queue full, not marked, taken on next repetition
+	uint32_t parsed;
+	uint32_t events;
+	uint32_t queueHighWater;	// bytes
+	int subtables;
+}EIT_STATS;
+
+// Drop sub tables and queued sections, EPG store is left as it is
+void Eit_Reset();
+// Callback side, returns SECTION_NEW when section was queued, SECTION_REPEAT, SECTION_NEXT,
+// SECTION_INVALID or EIT_QUEUE_FULL
+int Eit_Queue_Section(const uint8_t *buffer, uint32_t length);
+// Parse every queued section into EPG store, returns number of parsed sections
+int Eit_Process_Queue();
+void Eit_Get_Stats(EIT_STATS *stats);
+
+#endif
@@ -0,0 +1,77 @@
+/****************************************************************************
+*
+* FERIT
+*
+* -----------------------------------------------------
+* Konstrukcijski zadatak kolegij: Digitalna videotehnika
+* -----------------------------------------------------
+*
+* epg.h
+*
+* Purpose: In-memory EPG store, time sorted events per service within a byte budget
+*
+* Made on 18.10.2026.
+*****************************************************************************/
+
+#ifndef EPG_H
+#define EPG_H
+
+#include <stdint.h>
+
+#define EPG_MAX_SERVICES		(256)
+#define EPG_DEFAULT_BUDGET		(1024 * 1024)	/* bytes, when config gives none */
+#define EPG_MIN_BUDGET			(16 * 1024)
+#define EPG_NAME_LENGTH			(64)
+#define EPG_TEXT_LENGTH			(256)
+
+#define EPG_PRESENT				(0x01)	/* Epg_Now_Next found present event */
+#define EPG_FOLLOWING			(0x02)	/* Epg_Now_Next found following event */
+
+/*
+ * Events of one service are kept as parallel arrays sorted by start time, events never overlap.
+ * Names and texts are offsets into one interned string pool, same title repeated all week is stored once.
+ * Arrays of a service are one allocation, EPG_EVENT_BYTES per event.
+ */
+#define EPG_EVENT_BYTES			(4 + 4 + 4 + 4 + 2 + 1)
+
+typedef struct EPG_SERVICE{
+	uint16_t originalNetworkId;
+	uint16_t transportStreamId;
+	uint16_t serviceId;
+	int count;
+	int capacity;
+	uint32_t *start;			// UTC seconds since 1.1.1970
+	uint32_t *duration;			// seconds
+	uint32_t *name;				// string pool offset
+	uint32_t *text;
+	uint16_t *eventId;
+	uint8_t *runningStatus;
+}EPG_SERVICE;
+
+// Event copied out of store
+typedef struct EPG_EVENT{
+	uint16_t eventId;
+	uint32_t start;
+	uint32_t duration;
+	uint8_t runningStatus;
+	char name[EPG_NAME_LENGTH];
+	char text[EPG_TEXT_LENGTH];
+}EPG_EVENT;
+
+// Bytes store may hold, oldest events are evicted over it, 0 is EPG_DEFAULT_BUDGET
+void Epg_Set_Budget(uint32_t budget);
+// Drop every event and string
+void Epg_Reset();
+// Insert event, events it overlaps are replaced, returns 0 on success
+int Epg_Add_Event(uint16_t originalNetworkId, uint16_t transportStreamId, uint16_t serviceId, EPG_EVENT *event);
+// Present and following event at time now, returns EPG_PRESENT | EPG_FOLLOWING for events found
+int Epg_Now_Next(uint16_t originalNetworkId, uint16_t transportStreamId, uint16_t serviceId, uint32_t now,
+	EPG_EVENT *present, EPG_EVENT *following);
+// Events running in [from, to), returns number of copied events
+int Epg_Range(uint16_t originalNetworkId, uint16_t transportStreamId, uint16_t serviceId, uint32_t from, uint32_t to,
+	EPG_EVENT *events, int maxCount);
+// Bytes held by store, arrays and string pool with their spare capacity
+uint32_t Epg_Used_Bytes();
+void Epg_Print_Stats();
+
+#endif
@@ -49,6 +49,9 @@ struct chanelStatus{
 	int numberOfPrograms;
 	int startProgramNumber;
 	int endProgamNumber;
+	uint32_t frequency;			// Hz, transport stream tuner is locked to
+	int bandwidth;				// MHz
+	int module;					// DVB_T or DVB_T2
 }chanelStatus;
 
 
@@ -71,11 +74,12 @@ extern struct config{
 	char *vtype;
 	int rating;
 	int password;
+	char *cacheFile;
+	int epgBudget;				// KB, 0 is default
+	int zapSoak;				// scripted zaps after startup, 0 is off
+	int zapDwell;				// ms on each chanell during soak, 0 is default
 }config;
 
-extern pthread_cond_t statusCondition;
-extern pthread_mutex_t statusMutex;
-
 extern pthread_t thread_PlayStream;
 extern pthread_t thread_Graphic;
 extern pthread_t thread_ParsePat;
@@ -83,7 +87,6 @@ extern pthread_t thread_ParsePmt;
 
 extern PAT_TABLE pat;
 extern PMT_TABLE *pmt;
-extern int parserProgramIndex;
 
 extern uint32_t playerHandle;
 extern uint32_t sourceHandle;
@@ -93,9 +96,7 @@ extern uint32_t filterHandelArray[8];
 extern	uint32_t audioStreamHandle;
 extern	uint32_t videoStreamHandle;
 
-extern int patFlag;
-extern int pmtFlag;
-extern int allPmtflag;
+extern int allPmtFlag;
 
 extern IDirectFBSurface *primary;
 extern IDirectFB *dfbInterface;
@@ -34,6 +34,7 @@ if (err != DFB_OK)                                          \
 
 
 void *GraphicThread();
+void GraphicNotify();
 void DrawLogo();
 void DrawVolumeStatus();
 void DrawChanell();
@@ -0,0 +1,74 @@
+/****************************************************************************
+*
+* FERIT
+*
+* -----------------------------------------------------
+* Konstrukcijski zadatak kolegij: Digitalna videotehnika
+* -----------------------------------------------------
+*
+* nit.h
+*
+* Purpose: Parsing NIT actual/other to transports with tune parameters and services with LCN
+*
+* Made on 18.10.2026.
+*****************************************************************************/
+
+#ifndef NIT_H
+#define NIT_H
+
+#include <stdint.h>
+
+#define NIT_PID					(0x10)
+#define NIT_TABLE_ACTUAL		(0x40)
+#define NIT_TABLE_OTHER			(0x41)
+#define NIT_TABLE_MASK			(0xFE)	/* one filter takes actual and other */
+
+#define NIT_MAX_TRANSPORTS		(64)
+#define NIT_MAX_SERVICES		(256)
+#define NIT_MAX_SUBTABLES		(16)	/* actual plus other networks, at most 32 for owner mask */
+#define NIT_NAME_LENGTH			(32)
+
+#define NIT_DELIVERY_NONE		(0)		/* transport has no delivery descriptor we can tune */
+#define NIT_DELIVERY_T			(1)
+#define NIT_DELIVERY_T2			(2)
+
+#define NIT_LCN_NONE			(0)		/* service has no logical_channel_number */
+
+// One transport stream of network and how to tune it
+typedef struct NIT_TRANSPORT{
+	uint16_t networkId;			// network whose NIT describes transport, actual one when both do
+	uint16_t originalNetworkId;
+	uint16_t transportStreamId;
+	uint8_t tableId;			// NIT_TABLE_ACTUAL or NIT_TABLE_OTHER
+	uint32_t owners;			// bit per sub table that lists transport
+	uint8_t deliverySystem;
+	uint32_t frequency;			// Hz
+	uint8_t bandwidth;			// MHz
+}NIT_TRANSPORT;
+
+// Service listed by NIT, from service_list and logical_channel descriptors
+typedef struct NIT_SERVICE{
+	uint16_t networkId;
+	uint16_t originalNetworkId;
+	uint16_t transportStreamId;
+	uint16_t serviceId;
+	uint8_t tableId;
+	uint32_t owners;			// bit per sub table that lists service
+	uint8_t serviceType;		// 0 when service is not in service_list
+	uint8_t visible;
+	uint16_t lcn;				// NIT_LCN_NONE when not assigned
+}NIT_SERVICE;
+
+// Drop every transport, service and version
+void Nit_Reset();
+// Classify section without parsing it, SECTION_NEW, SECTION_REPEAT, SECTION_NEXT or SECTION_INVALID
+// Section of new sub table is SECTION_REPEAT once every sub table slot is taken
+int Nit_Section_Check(const uint8_t *buffer, uint32_t length);
+// Parse section once per version, returns SECTION_COMPLETE when its sub table got every section
+int Nit_Add_Section(const uint8_t *buffer, uint32_t length);
+// Copy records, return number of copied entries
+int Nit_Copy_Transports(NIT_TRANSPORT *transports, int maxCount);
+int Nit_Copy_Services(NIT_SERVICE *services, int maxCount);
+void Nit_Print();
+
+#endif
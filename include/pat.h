@@ -16,9 +16,16 @@
 * @E-mail luka97kruljac@gmail.com
 *****************************************************************************/
 
+#ifndef PAT_H
 #define PAT_H
 
 #include "tdp_api.h"
+#include "section.h"
+#include "psimem.h"
+
+#define PAT_HEADER_LENGTH		(8)		/* up to program loop */
+#define PAT_MIN_SECTION_LENGTH	(9)		/* header after section_length plus CRC */
+#define PAT_MAX_SECTION_LENGTH	(1021)
 
 typedef struct PROGRAM{
 	uint16_t program_number;
@@ -41,12 +48,23 @@ typedef struct PAT_TABLE{
 	
 	int programCounter;
 
-	PROGRAM *program;
+	PROGRAM *program;		// carved from arena, valid until next parse into this table
+	PSI_ARENA arena;
 }PAT_TABLE;
 
 void *ParsePat();
-void parseBufferToPat(uint8_t *buffer, PAT_TABLE *pat);
+// Parse one section of length bytes, returns number of programs or -1 on broken section
+int parseBufferToPat(uint8_t *buffer, uint32_t length, PAT_TABLE *pat);
+void parseTableToPat(SECTION_TABLE *table, PAT_TABLE *pat);
 void printPatTable(PAT_TABLE *pat);
-int32_t mySecFilterCallback(uint8_t *buffer);
+int32_t mySecFilterCallback(uint32_t filterHandle, uint8_t *buffer, uint32_t length, void *user);
+
+// Global pat is written only through these once other threads run, readers use Pat_Get_Transport_Stream_Id
+// Exchange table with global pat, arena of old one goes to table
+void Pat_Swap(PAT_TABLE *table);
+// Drop global pat, for example after retune
+void Pat_Clear();
+// Transport stream id of global pat, returns 0 when PAT is known
+int Pat_Get_Transport_Stream_Id(uint16_t *transportStreamId);
 
 #endif
\ No newline at end of file
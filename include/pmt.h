@@ -19,12 +19,19 @@
 #ifndef PMT_H
 #define PMT_H
 
+#include <time.h>
 #include "tdp_api.h"
+#include "section.h"
+#include "descriptor.h"
+#include "psimem.h"
 
 #define AUDIO_ST 	(1)
 #define VIDEO_ST	(2)
 
 typedef struct PROGRAM_MAP{
+	uint16_t programNumber;
+	uint16_t pmtPid;
+	uint8_t pmtVersion;
 	uint32_t videoPID;
 	uint32_t audioPID;
 	tStreamType videoType;
@@ -49,7 +56,7 @@ typedef struct STREAM{
 	uint8_t reserved2;
 	uint16_t ES_info_lenght;
 
-	uint16_t descriptor;
+	uint16_t descriptor;		// tag of first ES descriptor, whole loop is in PMT_TABLE descriptor block
 }STREAM;
 
 typedef struct PMT_TABLE{
@@ -69,19 +76,47 @@ typedef struct PMT_TABLE{
 	uint16_t program_info_lenght;
 	uint32_t CRC;
 	
-	void *descriptor;
+	PMT_DESCRIPTORS *descriptor;	// program_info and ES_info loops, one block in table arena
 	
 	uint8_t streamCounter;
-	STREAM *stream;
+	STREAM *stream;				// carved from arena like descriptor, valid until next parse into this table
+	PSI_ARENA arena;
 }PMT_TABLE;
 
+#define PMT_HEADER_LENGTH		(12)	/* up to program_info loop */
+#define PMT_MIN_SECTION_LENGTH	(13)	/* header after section_length plus CRC */
+#define PMT_MAX_SECTION_LENGTH	(1021)
+
+#define PMT_DEADLINE_MS		(1000)	/* per attempt, PMT repetition limit is 0.5 s */
+#define PMT_MAX_ATTEMPTS	(3)
+
+#define PMT_REQUEST_IDLE	(0)
+#define PMT_REQUEST_ARMED	(1)
+#define PMT_REQUEST_DONE	(2)
+#define PMT_REQUEST_FAILED	(3)
+
+// State of one PMT acquisition, passed as user context to its section filter
+typedef struct PMT_REQUEST{
+	int programIndex;
+	uint16_t programNumber;
+	PMT_TABLE *pmt;
+	uint32_t filterHandle;
+	int state;
+	int attempts;
+	struct timespec armedAt;
+	struct timespec deadline;
+	long acquireMs;
+	SECTION_TABLE sections;
+}PMT_REQUEST;
+
 void *ParsePmt();
-int32_t myPMTSecFilterCallback(uint8_t *buffer);
-void parseBufferToPmt(uint8_t *buffer, PMT_TABLE *pmt);
+int32_t myPMTSecFilterCallback(uint32_t filterHandle, uint8_t *buffer, uint32_t length, void *user);
+// Parse one section of length bytes, returns -1 on broken section
+int parseBufferToPmt(uint8_t *buffer, uint32_t length, PMT_TABLE *pmt);
 void printPmtTable(PMT_TABLE *pmt);
 
 
-void PMT_to_ProgramMap(PMT_TABLE pmt, int index);
+void PMT_to_ProgramMap(PMT_TABLE *pmt, PROGRAM_MAP *map);
 tStreamType getAudioType(int type);
 tStreamType getVideoType(int type);
 
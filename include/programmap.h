@@ -1,29 +1,39 @@
-/*
+/****************************************************************************
+*
+* FERIT
+*
+* -----------------------------------------------------
+* Konstrukcijski zadatak kolegij: Digitalna videotehnika
+* -----------------------------------------------------
+*
+* programmap.h
+*
+* Purpose: Channel list used for playback, built from PMTs or loaded from PSI cache
+*
+* Made on 18.6.2020.
+*
+* @Author Luka Kruljac
+* @E-mail luka97kruljac@gmail.com
+*****************************************************************************/
+
 #ifndef PROGRAMMAP_H
 #define PROGRAMMAP_H
 
 #include <stdint.h>
-
-
-#define AUDIO_ST 	(1)
-#define VIDEO_ST	(2)
-
-typedef struct PROGRAM_MAP{
-	uint32_t videoPID;
-	uint32_t audioPID;
-	t_StreamType videoType;
-	t_StreamType audioType;
-}PROGRAM_MAP;
-
-//TODO
-//return 
-//  0 - invalid type
-//  1 - audio type
-//  2 - video type
-//  3 - titlovi
-int getTypeOfStreamType(uint8_t type);
-
-
+#include "pmt.h"
+
+// Replace channel list, map is copied
+void ProgramMap_Set(PROGRAM_MAP *map, int count);
+// Drop channel list of transport stream left by retune, list is empty until next ProgramMap_Set
+// Hardcoded list is never used again, its PIDs belong to transport stream tuned at startup
+void ProgramMap_Clear();
+// Copy channel entry, returns 0 on success, hardcoded list is used until first ProgramMap_Set or ProgramMap_Clear
+int ProgramMap_Get(int chanell, PROGRAM_MAP *entry);
+int ProgramMap_Count();
+// Copy whole channel list, returns number of copied entries
+int ProgramMap_Copy(PROGRAM_MAP *map, int maxCount);
+// Index of program in channel list, -1 if it is not there
+int ProgramMap_Find(uint16_t programNumber);
+void Print_ProgramMap();
 
 #endif
-*/
\ No newline at end of file
@@ -0,0 +1,59 @@
+/****************************************************************************
+*
+* FERIT
+*
+* -----------------------------------------------------
+* Konstrukcijski zadatak kolegij: Digitalna videotehnika
+* -----------------------------------------------------
+*
+* psicache.h
+*
+* Purpose: Persistent PAT/PMT channel cache, lets last chanell play right after tuner lock
+*
+* Made on 18.10.2026.
+*****************************************************************************/
+
+#ifndef PSICACHE_H
+#define PSICACHE_H
+
+#include <stdint.h>
+#include "pat.h"
+#include "pmt.h"
+
+#define PSI_CACHE_DEFAULT_FILE	"psi.cache"
+#define PSI_CACHE_MAGIC			(0x50534943)	/* "PSIC" */
+#define PSI_CACHE_FORMAT		(1)
+#define PSI_CACHE_MAX_PROGRAMS	(64)
+#define PSI_VERSION_UNKNOWN		(0xFF)	/* pmtVersion of entry whose PMT is not parsed yet */
+
+/*
+ * File layout, all fields big endian:
+ *   header   16 bytes: magic, format, PAT version, TS id, frequency, program count, last chanell, reserved
+ *   program  14 bytes each: program number, PMT PID, PMT version, flags, video PID, audio PID,
+ *                           video type, audio type, content rank, reserved
+ *   CRC-32/MPEG-2 over everything before it
+ */
+#define PSI_CACHE_HEADER_SIZE	(16)
+#define PSI_CACHE_PROGRAM_SIZE	(14)
+#define PSI_CACHE_CRC_SIZE		(4)
+
+typedef struct PSI_CACHE{
+	uint32_t frequency;
+	uint16_t transportStreamId;
+	uint8_t patVersion;
+	int lastChanell;
+	int programCount;
+	PROGRAM_MAP program[PSI_CACHE_MAX_PROGRAMS];
+}PSI_CACHE;
+
+// Load cache for frequency and publish its channel list, returns 0 when cache is usable
+int PsiCache_Load(uint32_t frequency);
+// Copy cached entry of program, returns 0 when program is in cache
+int PsiCache_Find_Program(uint16_t programNumber, PROGRAM_MAP *entry);
+// Compare fresh tables with cache, returns 1 when cache was patched, 0 when it was up to date and -1 on error
+int PsiCache_Update(uint32_t frequency, PAT_TABLE *pat, PROGRAM_MAP *map, int count);
+int PsiCache_Valid();
+void PsiCache_Set_Last_Chanell(int chanell);
+int PsiCache_Last_Chanell();
+
+#endif
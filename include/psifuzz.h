@@ -0,0 +1,34 @@
+/****************************************************************************
+*
+* FERIT
+*
+* -----------------------------------------------------
+* Konstrukcijski zadatak kolegij: Digitalna videotehnika
+* -----------------------------------------------------
+*
+* psifuzz.h
+*
+* Purpose: Fuzzing entry points of PAT and PMT parsers, host tools only
+*
+* Made on 18.10.2026.
+*****************************************************************************/
+
+#ifndef PSIFUZZ_H
+#define PSIFUZZ_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define PSI_FUZZ_MAX_SIZE	(4096 + 3)	/* longest section demux can hand over */
+
+/*
+ * Input is copied into buffer of exactly size bytes, so sanitizer catches any read past it.
+ * Parsed table is checked against input, broken invariant aborts.
+ * Build with -DPSI_FUZZ_PAT or -DPSI_FUZZ_PMT to get libFuzzer entry for that parser.
+ */
+int PsiFuzz_Pat(const uint8_t *data, size_t size);
+int PsiFuzz_Pmt(const uint8_t *data, size_t size);
+// Release tables fuzzing parsed into
+void PsiFuzz_Free();
+
+#endif
@@ -0,0 +1,51 @@
+/****************************************************************************
+*
+* FERIT
+*
+* -----------------------------------------------------
+* Konstrukcijski zadatak kolegij: Digitalna videotehnika
+* -----------------------------------------------------
+*
+* psimem.h
+*
+* Purpose: Per table arenas for parsed PSI and live byte counter of them
+*
+* Made on 18.10.2026.
+*****************************************************************************/
+
+#ifndef PSIMEM_H
+#define PSIMEM_H
+
+#include <stdint.h>
+
+/*
+ * Ownership rules
+ *   - Every parsed table (PAT_TABLE, PMT_TABLE) owns exactly one arena, all of its
+ *     variable parts (program list, stream list, descriptor block) are carved from it.
+ *   - Parsing into a table resets its arena, pointers from previous parse are invalid after that.
+ *     Arena keeps its memory, so reparsing a table of same or smaller size does not allocate.
+ *   - Nothing carved from arena is freed on its own, only PsiMem_Arena_Free releases memory.
+ *   - Copying a table by value moves the arena, only one of the copies may be used or freed after.
+ *   - Zeroed arena is valid and empty, tables in globals or from calloc need no init call.
+ */
+typedef struct PSI_ARENA{
+	uint8_t *base;
+	uint32_t capacity;
+	uint32_t used;
+}PSI_ARENA;
+
+void PsiMem_Arena_Init(PSI_ARENA *arena);
+// Reset arena and make sure size bytes can be carved from it, returns -1 when out of memory
+int PsiMem_Arena_Reserve(PSI_ARENA *arena, uint32_t size);
+// Carve from reserved memory, returns NULL when reservation is exceeded
+void *PsiMem_Arena_Alloc(PSI_ARENA *arena, uint32_t size);
+// Size Alloc takes from arena for size bytes, for summing reservations
+uint32_t PsiMem_Arena_Size(uint32_t size);
+void PsiMem_Arena_Reset(PSI_ARENA *arena);
+void PsiMem_Arena_Free(PSI_ARENA *arena);
+
+// Bytes held by all arenas right now
+uint32_t PsiMem_Live_Bytes();
+void PsiMem_Print_Stats();
+
+#endif
@@ -0,0 +1,71 @@
+/****************************************************************************
+*
+* FERIT
+*
+* -----------------------------------------------------
+* Konstrukcijski zadatak kolegij: Digitalna videotehnika
+* -----------------------------------------------------
+*
+* psimonitor.h
+*
+* Purpose: Background PAT/PMT monitoring, changed tables are applied to channel list and player
+*
+* Made on 18.10.2026.
+*****************************************************************************/
+
+#ifndef PSIMONITOR_H
+#define PSIMONITOR_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include "psicache.h"
+#include "section.h"
+
+#define PSI_MONITOR_QUEUE_SIZE			(8)
+#define PSI_MONITOR_FETCH_TIMEOUT_MS	(2000)
+#define PSI_MONITOR_HEALTH_PERIOD_MS	(10000)	/* stream health is checked this often */
+
+#define PSI_MONITOR_TABLE_PAT	(0)		/* PAT, always armed */
+#define PSI_MONITOR_TABLE_PMT	(1)		/* PMT of chanell on air, follows zapping */
+#define PSI_MONITOR_TABLE_FETCH	(2)		/* PMT of program new in PAT or moved to other PID */
+#define PSI_MONITOR_TABLE_SDT	(3)		/* SDT actual and other, sub tables are tracked by sdt module */
+#define PSI_MONITOR_TABLE_NIT	(4)		/* NIT actual and other, feeds channel database */
+#define PSI_MONITOR_TABLE_EIT	(5)		/* EIT p/f and schedule, sections queue in eit module */
+#define PSI_MONITOR_TABLE_COUNT	(6)
+
+// One monitored table, passed as user context to its section filter
+typedef struct PSI_MONITOR_TABLE{
+	int type;
+	uint32_t filterHandle;
+	uint32_t generation;		// incremented on every arm, sections of old filter are dropped
+	uint16_t pid;
+	uint16_t programNumber;
+	SECTION_TABLE assembler;	// written only by monitor thread, callback only checks it
+	struct timespec deadline;	// FETCH only
+	uint32_t sections;
+	uint32_t changes;
+}PSI_MONITOR_TABLE;
+
+// Retained section waiting for monitor thread
+typedef struct PSI_MONITOR_SECTION{
+	PSI_MONITOR_TABLE *table;
+	uint32_t generation;
+	uint8_t *buffer;
+	uint32_t length;
+}PSI_MONITOR_SECTION;
+
+// Program whose PMT has to be fetched
+typedef struct PSI_MONITOR_FETCH{
+	uint16_t programNumber;
+	uint16_t pid;
+}PSI_MONITOR_FETCH;
+
+int PsiMonitor_Start();
+void PsiMonitor_Stop();
+// Called after zapping, PMT filter moves to the new chanell
+void PsiMonitor_Chanell_Changed();
+// Call before start, after retune: PMT of program is fetched first and it is zapped to when it arrives
+void PsiMonitor_Want_Program(uint16_t programNumber);
+void PsiMonitor_Print_Stats();
+
+#endif
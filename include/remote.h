@@ -37,6 +37,8 @@ int32_t inputFileDesc;
 
 void *listenRemote();
 int32_t getKeys(int32_t count, uint8_t* buf, int32_t* eventsRead);
+// readUs is time key was read from remote, 0 for keys from elsewhere
+int processKey(struct input_event *eventBuf, uint64_t readUs);
 
 
 
@@ -0,0 +1,56 @@
+/****************************************************************************
+*
+* FERIT
+*
+* -----------------------------------------------------
+* Konstrukcijski zadatak kolegij: Digitalna videotehnika
+* -----------------------------------------------------
+*
+* sdt.h
+*
+* Purpose: Parsing SDT actual/other to service table indexed by service_id
+*
+* Made on 18.10.2026.
+*****************************************************************************/
+
+#ifndef SDT_H
+#define SDT_H
+
+#include <stdint.h>
+
+#define SDT_PID					(0x11)
+#define SDT_TABLE_ACTUAL		(0x42)
+#define SDT_TABLE_OTHER			(0x46)
+#define SDT_TABLE_MASK			(0xFB)	/* one filter takes actual and other */
+
+#define SDT_MAX_SERVICES		(256)
+#define SDT_MAX_SUBTABLES		(32)	/* actual plus other transport streams */
+#define SDT_NAME_LENGTH			(32)
+
+typedef struct SDT_SERVICE{
+	uint16_t originalNetworkId;
+	uint16_t transportStreamId;
+	uint16_t serviceId;
+	uint8_t serviceType;
+	uint8_t runningStatus;
+	uint8_t freeCaMode;
+	uint8_t tableId;			// SDT_TABLE_ACTUAL or SDT_TABLE_OTHER
+	char name[SDT_NAME_LENGTH];
+	char provider[SDT_NAME_LENGTH];
+}SDT_SERVICE;
+
+// Drop every service and version, for example after retune
+void Sdt_Reset();
+// Classify section without parsing it, SECTION_NEW, SECTION_REPEAT, SECTION_NEXT or SECTION_INVALID
+// Section of new sub table is SECTION_REPEAT once every sub table slot is taken
+int Sdt_Section_Check(const uint8_t *buffer, uint32_t length);
+// Parse section once per version, returns SECTION_COMPLETE when its sub table got every section
+int Sdt_Add_Section(const uint8_t *buffer, uint32_t length);
+// Lookup in service table, never waits on demux, returns 0 when found
+int Sdt_Find(uint16_t transportStreamId, uint16_t serviceId, SDT_SERVICE *service);
+// Lookup of service in transport stream we are tuned to
+int Sdt_Find_Actual(uint16_t serviceId, SDT_SERVICE *service);
+int Sdt_Service_Count();
+void Sdt_Print();
+
+#endif
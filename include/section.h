@@ -0,0 +1,82 @@
+/****************************************************************************
+*
+* FERIT
+*
+* -----------------------------------------------------
+* Konstrukcijski zadatak kolegij: Digitalna videotehnika
+* -----------------------------------------------------
+*
+* section.h
+*
+* Purpose: Collecting all sections of one table version, repeated sections are dropped by CRC
+*
+* Made on 18.10.2026.
+*****************************************************************************/
+
+#ifndef SECTION_H
+#define SECTION_H
+
+#include <stdint.h>
+
+#define SECTION_MIN_LENGTH		(12)	/* long header and CRC */
+
+/* Results of Section_Table_Check and Section_Table_Add */
+#define SECTION_INVALID			(-1)	/* other table, other extension or broken header */
+#define SECTION_NEW				(0)		/* section is not held yet */
+#define SECTION_REPEAT			(1)		/* exact copy of section already held */
+#define SECTION_NEXT			(2)		/* current_next_indicator is 0, table is not valid yet */
+#define SECTION_COMPLETE		(3)		/* section completed the table, only Section_Table_Add */
+
+typedef struct SECTION_SLOT{
+	uint8_t *data;
+	uint32_t length;
+	uint32_t crc;
+}SECTION_SLOT;
+
+// All sections of one table (table_id + table_id_extension)
+typedef struct SECTION_TABLE{
+	uint8_t tableId;
+	int tableIdExtension;		// -1 accepts any extension
+	int knownVersion;			// version already handed to parser, -1 when none
+	int version;				// version being collected, -1 when none
+	int sectionCount;			// last_section_number + 1
+	int receivedCount;
+	int complete;
+	SECTION_SLOT *slot;
+
+	uint32_t sections;			// sections offered to Section_Table_Add
+	uint32_t repeats;			// dropped as exact repeats
+	uint32_t completed;			// complete tables handed to parser
+}SECTION_TABLE;
+
+// Version and sections seen of one sub table (table_id + table_id_extension)
+// For tables parsed section by section, where one PID carries many sub tables (SDT, NIT)
+typedef struct SECTION_SUBTABLE{
+	uint8_t tableId;
+	uint16_t tableIdExtension;
+	int version;				// -1 when nothing is received
+	int lastSection;
+	int complete;
+	uint8_t received[32];		// bit per section_number
+}SECTION_SUBTABLE;
+
+// knownVersion is version parsed before, its sections count as repeats, -1 when there is none
+void Section_Table_Init(SECTION_TABLE *table, uint8_t tableId, int tableIdExtension, int knownVersion);
+void Section_Table_Free(SECTION_TABLE *table);
+// Classify section without storing it
+int Section_Table_Check(SECTION_TABLE *table, uint8_t *buffer, uint32_t length);
+// Store copy of section, returns SECTION_COMPLETE once per table version
+int Section_Table_Add(SECTION_TABLE *table, uint8_t *buffer, uint32_t length);
+int Section_Table_Count(SECTION_TABLE *table);
+uint8_t *Section_Table_Get(SECTION_TABLE *table, int sectionNumber, uint32_t *length);
+
+// Header of buffer must be checked by caller, these only track version and section_number
+void Section_Subtable_Init(SECTION_SUBTABLE *subtable, uint8_t tableId, uint16_t tableIdExtension);
+// SECTION_REPEAT when section of current version was marked, SECTION_NEW otherwise
+int Section_Subtable_Check(SECTION_SUBTABLE *subtable, const uint8_t *buffer);
+// Restart sub table when section brings other version, returns 1 when earlier version is replaced
+int Section_Subtable_Version(SECTION_SUBTABLE *subtable, const uint8_t *buffer);
+// Mark section as parsed, returns SECTION_COMPLETE once per version, when every section is marked
+int Section_Subtable_Mark(SECTION_SUBTABLE *subtable, const uint8_t *buffer);
+
+#endif
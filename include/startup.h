@@ -0,0 +1,40 @@
+/****************************************************************************
+*
+* FERIT
+*
+* -----------------------------------------------------
+* Konstrukcijski zadatak kolegij: Digitalna videotehnika
+* -----------------------------------------------------
+*
+* startup.h
+*
+* Purpose: Startup phases, waiting on them without spinning and printing boot timeline
+*
+* Made on 18.10.2026.
+*****************************************************************************/
+
+#ifndef STARTUP_H
+#define STARTUP_H
+
+#include <stdint.h>
+#include <time.h>
+
+#define STARTUP_WAIT_FOREVER	(-1)
+
+typedef enum STARTUP_PHASE{
+	STARTUP_INIT = 0,		// config loaded, threads started
+	STARTUP_TUNED,			// tuner locked to frequency
+	STARTUP_PLAYER_READY,	// player initialized and source open
+	STARTUP_PAT,			// PAT received
+	STARTUP_PMTS,			// PMT acquisition finished
+	STARTUP_PLAYING,		// first channel streams created
+	STARTUP_PHASE_COUNT
+}STARTUP_PHASE;
+
+void Startup_Init();
+void Startup_Set_Phase(STARTUP_PHASE phase);
+int Startup_Phase_Reached(STARTUP_PHASE phase);
+int Startup_Wait_Phase(STARTUP_PHASE phase, int timeoutMs);
+void Startup_Print_Timeline();
+
+#endif
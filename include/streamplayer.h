@@ -29,6 +29,7 @@
 
 #include "globals.h"
 #include "pat.h"
+#include "graphic.h"
 
 
 
@@ -44,7 +45,7 @@ inline void textColor(int32_t attr, int32_t fg, int32_t bg);
                                 }
 
 int32_t myPrivateTunerStatusCallback(t_LockStatus status);
-int32_t mySecFilterCallback(uint8_t *buffer);
+int32_t mySecFilterCallback(uint32_t filterHandle, uint8_t *buffer, uint32_t length, void *user);
 
 int32_t myStreamFilterCallback(uint8_t *buffer);
 
@@ -52,5 +53,8 @@ void* PlayStream();
 void PlayStreamDeintalization();
 
 void changePlayStreamOnChanell();
+// Walk channel database in LCN order, chanell on other multiplex is tuned first
+void zapChannelStep(int step);
+void updatePlayStreamOnChanell(PROGRAM_MAP *chanell);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,60 @@
+/****************************************************************************
+*
+* FERIT
+*
+* -----------------------------------------------------
+* Konstrukcijski zadatak kolegij: Digitalna videotehnika
+* -----------------------------------------------------
+*
+* zapper.h
+*
+* Purpose: Chanell switching with stream attributes prepared ahead, only streams that change are touched
+*
+* Made on 18.10.2026.
+*****************************************************************************/
+
+#ifndef ZAPPER_H
+#define ZAPPER_H
+
+#include <stdint.h>
+#include "pmt.h"
+
+/* On air video and audio plus both streams of chanell before and after it, player holds the rest */
+#define ZAPPER_PREPARED_SLOTS	(6)
+
+/* Phases of one zap, times in microseconds, CLOCK_MONOTONIC */
+typedef struct ZAP_TIMINGS{
+	uint16_t programNumber;
+	int videoKept;			/* same video PID and type was already running */
+	int audioKept;
+	int videoPrepared;		/* video started from attributes prepared before the zap */
+	int audioPrepared;
+	uint32_t stopUs;		/* removing streams that change */
+	uint32_t prepareUs;		/* preparing attributes the cache did not have */
+	uint32_t videoStartUs;
+	uint32_t audioStartUs;
+	uint32_t totalUs;
+}ZAP_TIMINGS;
+
+typedef struct ZAP_STATS{
+	uint32_t zaps;
+	uint32_t streamStarts;
+	uint32_t preparedStarts;	/* starts whose attributes were ready before the zap */
+	uint32_t streamsKept;
+	uint32_t totalMaxUs;
+	uint64_t totalSumUs;
+}ZAP_STATS;
+
+// Play chanell, streams already running stay, video starts before audio, returns 0 when all streams started
+// timings may be NULL
+int Zapper_Switch(const PROGRAM_MAP *chanell, ZAP_TIMINGS *timings);
+// Prepare streams of chanells next to chanell in channel list, call it after zap is done
+void Zapper_Prepare_Neighbours(int chanell);
+// Remove running streams, prepared attributes are kept
+void Zapper_Stop();
+// Remove running streams and drop prepared attributes, PIDs of old transport stream mean nothing after retune
+void Zapper_Reset();
+int Zapper_Get_Last(ZAP_TIMINGS *timings);
+void Zapper_Get_Stats(ZAP_STATS *stats);
+
+#endif
@@ -0,0 +1,27 @@
+/****************************************************************************
+*
+* FERIT
+*
+* -----------------------------------------------------
+* Konstrukcijski zadatak kolegij: Digitalna videotehnika
+* -----------------------------------------------------
+*
+* zapsoak.h
+*
+* Purpose: Scripted zapping soak, acceptance benchmark for changes on player path
+*
+* Made on 18.10.2026.
+*****************************************************************************/
+
+#ifndef ZAPSOAK_H
+#define ZAPSOAK_H
+
+#define ZAP_SOAK_DEFAULT_DWELL_MS	(500)
+#define ZAP_SOAK_TIMEOUT_MS			(15000)	/* zap to other multiplex waits for lock, PAT and PMT */
+#define ZAP_SOAK_RSS_PERIOD			(100)	/* zaps between memory samples */
+
+// Run count zaps in own thread, keys go through processKey as if they came from remote
+// Each chanell is kept dwellMs after its banner, 0 is default
+int ZapSoak_Start(int count, int dwellMs);
+
+#endif
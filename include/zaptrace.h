@@ -0,0 +1,82 @@
+/****************************************************************************
+*
+* FERIT
+*
+* -----------------------------------------------------
+* Konstrukcijski zadatak kolegij: Digitalna videotehnika
+* -----------------------------------------------------
+*
+* zaptrace.h
+*
+* Purpose: End to end zap latency, stages from remote key event to first chanell banner on screen
+*
+* Made on 18.10.2026.
+*****************************************************************************/
+
+#ifndef ZAPTRACE_H
+#define ZAPTRACE_H
+
+#include <stdint.h>
+#include <sys/time.h>
+
+#define ZAP_TRACE_HISTORY		(1024)	/* latest zaps kept for percentiles */
+
+/* Stages in order they normally happen, times are kept relative to key event */
+typedef enum ZAP_STAGE{
+	ZAP_STAGE_KEY_EVENT		= 0,	/* kernel timestamp of input_event */
+	ZAP_STAGE_KEY_READ		= 1,	/* read() of remote device returned the event */
+	ZAP_STAGE_PROCESS_KEY	= 2,	/* processKey started, key handled before it is waited for */
+	ZAP_STAGE_AUDIO_REMOVE	= 3,	/* Player_Stream_Remove of old audio returned */
+	ZAP_STAGE_VIDEO_REMOVE	= 4,
+	ZAP_STAGE_VIDEO_CREATE	= 5,	/* Player_Stream_Create of new video returned */
+	ZAP_STAGE_AUDIO_CREATE	= 6,
+	ZAP_STAGE_STREAMS_DONE	= 7,	/* zapper finished, streams of new chanell run */
+	ZAP_STAGE_OSD_FLIP		= 8,	/* first flip of chanell banner, zap is complete */
+	ZAP_STAGE_COUNT			= 9
+}ZAP_STAGE;
+
+typedef struct ZAP_TRACE{
+	uint32_t sequence;
+	uint32_t stageMask;					/* bit per stage reached, kept streams skip their stages */
+	uint32_t stageUs[ZAP_STAGE_COUNT];	/* since key event */
+	int failed;							/* some stream did not start */
+}ZAP_TRACE;
+
+typedef struct ZAP_TRACE_REPORT{
+	uint32_t zaps;						/* zaps started by key */
+	uint32_t completed;					/* banner reached screen */
+	uint32_t failed;					/* completed, but some stream did not start */
+	uint32_t unfinished;				/* next zap came before banner */
+	uint32_t samples;					/* completed zaps in history */
+	uint32_t stageCount[ZAP_STAGE_COUNT];
+	uint32_t p50Us[ZAP_STAGE_COUNT];
+	uint32_t p95Us[ZAP_STAGE_COUNT];
+	uint32_t p99Us[ZAP_STAGE_COUNT];
+	uint32_t maxUs[ZAP_STAGE_COUNT];
+}ZAP_TRACE_REPORT;
+
+// Must be called from main before any other thread is started
+void ZapTrace_Init();
+// Tell whether input_event timestamps are CLOCK_MONOTONIC, kernel default is wall clock
+void ZapTrace_Set_Event_Clock(int monotonic);
+// Current time on input_event clock, for keys that do not come from remote
+void ZapTrace_Event_Time(struct timeval *eventTime);
+// Key changes chanell, following stages belong to it, zap in progress is cut
+// Zap is timed from eventTime, or from now when it is NULL, readUs and processUs of 0 are not recorded
+// Returns sequence number of zap
+uint32_t ZapTrace_Begin(const struct timeval *eventTime, uint64_t readUs, uint64_t processUs);
+// Record stage of zap in progress, only first time stage is reached counts
+void ZapTrace_Mark(ZAP_STAGE stage);
+void ZapTrace_Fail();
+// Sequence number of latest zap started by key, 0 before the first one
+uint32_t ZapTrace_Current();
+// Sleep until zap is complete, returns 0 when it is, -1 on timeout or when it was cut by next key
+int ZapTrace_Wait(uint32_t sequence, uint32_t timeoutMs, ZAP_TRACE *trace);
+void ZapTrace_Get_Report(ZAP_TRACE_REPORT *report);
+void ZapTrace_Print_Report(const char *title, const ZAP_TRACE_REPORT *report);
+const char *ZapTrace_Stage_Name(ZAP_STAGE stage);
+// Nearest rank percentile, values are sorted in place
+uint32_t ZapTrace_Percentile(uint32_t *values, uint32_t count, uint32_t percent);
+uint64_t ZapTrace_Now_Us();
+
+#endif
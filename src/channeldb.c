@@ -0,0 +1,181 @@
+/****************************************************************************
+*
+* FERIT
+*
+* -----------------------------------------------------
+* Konstrukcijski zadatak kolegij: Digitalna videotehnika
+* -----------------------------------------------------
+*
+* channeldb.c
+*
+* Purpose: Channel database over every multiplex of network, in LCN order with tune parameters
+*
+* Made on 18.10.2026.
+*****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "channeldb.h"
+
+static pthread_mutex_t channelDbMutex = PTHREAD_MUTEX_INITIALIZER;
+static CHANNEL_DB_ENTRY entries[CHANNEL_DB_MAX_ENTRIES];
+static int entryCount = 0;
+
+// Services worth a place in channel list, type 0 is service known only by its LCN
+static int isPlayable(uint8_t serviceType){
+	switch(serviceType){
+		case 0x00:	/* not in service_list */
+		case 0x01:	/* digital television */
+		case 0x02:	/* digital radio */
+		case 0x0A:	/* advanced codec radio */
+		case 0x11:	/* MPEG-2 HD television */
+		case 0x16:	/* advanced codec SD television */
+		case 0x19:	/* advanced codec HD television */
+		case 0x1F:	/* HEVC television */
+			return 1;
+		default:
+			return 0;
+	}
+}
+
+// LCN order, services without LCN go last, ties are broken by transport and service id
+static int compareEntries(const void *first, const void *second){
+	const CHANNEL_DB_ENTRY *a = (const CHANNEL_DB_ENTRY*)first;
+	const CHANNEL_DB_ENTRY *b = (const CHANNEL_DB_ENTRY*)second;
+	uint32_t lcnA = (a->lcn == NIT_LCN_NONE) ? 0x10000 : a->lcn;
+	uint32_t lcnB = (b->lcn == NIT_LCN_NONE) ? 0x10000 : b->lcn;
+
+	if(lcnA != lcnB){
+		return (lcnA < lcnB) ? -1 : 1;
+	}
+	if(a->transportStreamId != b->transportStreamId){
+		return (a->transportStreamId < b->transportStreamId) ? -1 : 1;
+	}
+	return (int)a->serviceId - (int)b->serviceId;
+}
+
+int ChannelDb_Rebuild(){
+	NIT_TRANSPORT *transports;
+	NIT_SERVICE *services;
+	CHANNEL_DB_ENTRY *built;
+	int transportCount;
+	int serviceCount;
+	int count = 0;
+	int i, j;
+
+	transports = malloc(NIT_MAX_TRANSPORTS * sizeof(NIT_TRANSPORT));
+	services = malloc(NIT_MAX_SERVICES * sizeof(NIT_SERVICE));
+	built = malloc(CHANNEL_DB_MAX_ENTRIES * sizeof(CHANNEL_DB_ENTRY));
+	if(transports == NULL || services == NULL || built == NULL){
+		printf("ChannelDb_Rebuild: out of memory\n");
+		free(transports);
+		free(services);
+		free(built);
+		return -1;
+	}
+	transportCount = Nit_Copy_Transports(transports, NIT_MAX_TRANSPORTS);
+	serviceCount = Nit_Copy_Services(services, NIT_MAX_SERVICES);
+
+	for(i = 0; i < serviceCount && count < CHANNEL_DB_MAX_ENTRIES; i++){
+		if(!services[i].visible || !isPlayable(services[i].serviceType)){
+			continue;
+		}
+		for(j = 0; j < transportCount; j++){
+			if(transports[j].transportStreamId == services[i].transportStreamId
+				&& transports[j].originalNetworkId == services[i].originalNetworkId){
+				break;
+			}
+		}
+		/* Chanell we cannot tune to is left out */
+		if(j == transportCount || transports[j].deliverySystem == NIT_DELIVERY_NONE || transports[j].frequency == 0){
+			continue;
+		}
+		built[count].lcn = services[i].lcn;
+		built[count].serviceId = services[i].serviceId;
+		built[count].transportStreamId = services[i].transportStreamId;
+		built[count].originalNetworkId = services[i].originalNetworkId;
+		built[count].serviceType = services[i].serviceType;
+		built[count].deliverySystem = transports[j].deliverySystem;
+		built[count].bandwidth = transports[j].bandwidth;
+		built[count].frequency = transports[j].frequency;
+		count++;
+	}
+	qsort(built, count, sizeof(CHANNEL_DB_ENTRY), compareEntries);
+
+	pthread_mutex_lock(&channelDbMutex);
+	memcpy(entries, built, count * sizeof(CHANNEL_DB_ENTRY));
+	entryCount = count;
+	pthread_mutex_unlock(&channelDbMutex);
+
+	free(transports);
+	free(services);
+	free(built);
+	return count;
+}
+
+int ChannelDb_Count(){
+	int count;
+	pthread_mutex_lock(&channelDbMutex);
+	count = entryCount;
+	pthread_mutex_unlock(&channelDbMutex);
+	return count;
+}
+
+int ChannelDb_Get(int index, CHANNEL_DB_ENTRY *entry){
+	int result = -1;
+
+	pthread_mutex_lock(&channelDbMutex);
+	if(index >= 0 && index < entryCount){
+		*entry = entries[index];
+		result = 0;
+	}
+	pthread_mutex_unlock(&channelDbMutex);
+
+	return result;
+}
+
+int ChannelDb_Find(uint16_t transportStreamId, uint16_t serviceId){
+	int result = -1;
+	int i;
+
+	pthread_mutex_lock(&channelDbMutex);
+	for(i = 0; i < entryCount; i++){
+		if(entries[i].serviceId == serviceId && entries[i].transportStreamId == transportStreamId){
+			result = i;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&channelDbMutex);
+
+	return result;
+}
+
+int ChannelDb_Next(int index, int step){
+	int count = ChannelDb_Count();
+
+	if(count == 0){
+		return -1;
+	}
+	if(index < 0 || index >= count){
+		return (step >= 0) ? 0 : count - 1;
+	}
+	index = (index + step) % count;
+	return (index < 0) ? index + count : index;
+}
+
+// Printing channel database for testing
+void ChannelDb_Print(){
+	int i;
+
+	pthread_mutex_lock(&channelDbMutex);
+	printf("\n\t\tCHANNEL DATABASE: %d chanells\n", entryCount);
+	for(i = 0; i < entryCount; i++){
+		printf("\t\t\tLCN %4d: service %5d ts %5d type 0x%02x, %s %u Hz %d MHz\n", entries[i].lcn,
+			entries[i].serviceId, entries[i].transportStreamId, entries[i].serviceType,
+			entries[i].deliverySystem == NIT_DELIVERY_T2 ? "DVB-T2" : "DVB-T",
+			entries[i].frequency, entries[i].bandwidth);
+	}
+	pthread_mutex_unlock(&channelDbMutex);
+}
@@ -33,7 +33,7 @@ int loadConfigFile(char *configFileName){
 	char *line = NULL;
     size_t len = 0;
     ssize_t read;
-	char buffer[25];
+	char buffer[256];
 	while ((read = getline(&line, &len, configFile)) != -1) {
 		if(sscanf(line, "frequency:%d", &(config.freq))){
 			continue;
@@ -65,6 +65,19 @@ int loadConfigFile(char *configFileName){
 		if(sscanf(line, "password:%d", &(config.password))){
 			continue;
 		}
+		if(sscanf(line, "cachefile:%255s", buffer)){
+			config.cacheFile = strdup(buffer);
+			continue;
+		}
+		if(sscanf(line, "epgbudget:%d", &(config.epgBudget))){
+			continue;
+		}
+		if(sscanf(line, "zapsoak:%d", &(config.zapSoak))){
+			continue;
+		}
+		if(sscanf(line, "zapdwell:%d", &(config.zapDwell))){
+			continue;
+		}
     }
 	printf("Loaded config data:\n");
 	printf("\tFREQ: %d\n", config.freq);
@@ -76,6 +89,11 @@ int loadConfigFile(char *configFileName){
 	printf("\tVideo type: %s\n", config.vtype);
 	printf("\tRATING: %d\n", config.rating);
 	printf("\tPASSWORD: %d\n", config.password);
+	printf("\tCACHE FILE: %s\n", config.cacheFile != NULL ? config.cacheFile : PSI_CACHE_DEFAULT_FILE);
+	printf("\tEPG BUDGET: %d KB\n", config.epgBudget);
+	if(config.zapSoak > 0){
+		printf("\tZAP SOAK: %d zaps, %d ms dwell\n", config.zapSoak, config.zapDwell);
+	}
 	
 	fclose(configFile);
     if (line){
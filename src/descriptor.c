@@ -0,0 +1,420 @@
+/****************************************************************************
+*
+* FERIT
+*
+* -----------------------------------------------------
+* Konstrukcijski zadatak kolegij: Digitalna videotehnika
+* -----------------------------------------------------
+*
+* descriptor.c
+*
+* Purpose: Parsing PMT descriptor loops into one contiguous block per PMT
+*
+* Made on 18.10.2026.
+*****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "descriptor.h"
+
+#define PMT_TABLE_ID			(0x02)
+#define PMT_MAX_SECTION_LENGTH	(1021)
+#define PMT_FIXED_LENGTH		(13)	/* header after section_length plus CRC */
+
+#define FORMAT_AC3				(0x41432D33)	/* "AC-3" */
+#define FORMAT_EAC3				(0x45414333)	/* "EAC3" */
+
+// Entry counts of whole PMT, in second pass used as write cursors
+typedef struct DESCRIPTOR_TOTALS{
+	uint32_t es;
+	uint32_t ca;
+	uint32_t languages;
+	uint32_t teletext;
+	uint32_t subtitles;
+}DESCRIPTOR_TOTALS;
+
+static uint32_t alignUp(uint32_t value){
+	return (value + 3) & ~3u;
+}
+
+static void copyLanguage(char *language, const uint8_t *code){
+	memcpy(language, code, 3);
+	language[3] = '\0';
+}
+
+static uint8_t kindOfStreamType(uint8_t streamType){
+	switch(streamType){
+		case 0x01:
+		case 0x02:
+		case 0x10:
+		case 0x1B:
+		case 0x24:
+			return ES_KIND_VIDEO;
+		case 0x03:
+		case 0x04:
+			return ES_KIND_AUDIO_MPEG;
+		case 0x0F:
+		case 0x11:
+			return ES_KIND_AUDIO_AAC;
+		case 0x81:
+			return ES_KIND_AUDIO_AC3;
+		case 0x87:
+			return ES_KIND_AUDIO_EAC3;
+		default:
+			return ES_KIND_OTHER;
+	}
+}
+
+// Walk one descriptor loop, es is NULL for program_info loop
+// With block NULL entries are only counted, otherwise they are written at totals cursors
+static void walkLoop(const uint8_t *loop, int length, PMT_DESCRIPTORS *block, PMT_ES_INFO *es, DESCRIPTOR_TOTALS *totals){
+	int position = 0;
+	int i;
+
+	while(position + 2 <= length){
+		uint8_t tag = loop[position];
+		int descriptorLength = loop[position + 1];
+		const uint8_t *data = &loop[position + 2];
+
+		/* Descriptor runs past its loop, rest of loop is garbage */
+		if(position + 2 + descriptorLength > length){
+			break;
+		}
+		position += 2 + descriptorLength;
+
+		if(tag == DESCRIPTOR_TAG_CA && descriptorLength >= 4){
+			if(es != NULL && es->caCount == 0xFF){
+				continue;
+			}
+			if(block != NULL){
+				DESCRIPTOR_CA *ca = Descriptor_Ca(block, totals->ca);
+				ca->systemId = (data[0] << 8) | data[1];
+				ca->pid = ((data[2] & 0x1F) << 8) | data[3];
+			}
+			totals->ca++;
+			if(es != NULL){
+				es->caCount++;
+			}
+			else if(block != NULL){
+				block->programCaCount++;
+			}
+			continue;
+		}
+
+		if(tag == DESCRIPTOR_TAG_REGISTRATION && descriptorLength >= 4){
+			uint32_t format = ((uint32_t)data[0] << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
+			if(es == NULL){
+				if(block != NULL){
+					block->programRegistration = format;
+				}
+				continue;
+			}
+			es->registration = format;
+			if(es->kind == ES_KIND_OTHER && format == FORMAT_AC3){
+				es->kind = ES_KIND_AUDIO_AC3;
+			}
+			else if(es->kind == ES_KIND_OTHER && format == FORMAT_EAC3){
+				es->kind = ES_KIND_AUDIO_EAC3;
+			}
+			continue;
+		}
+
+		/* Rest is stream level only */
+		if(es == NULL){
+			continue;
+		}
+
+		switch(tag){
+			case DESCRIPTOR_TAG_ISO_639:
+				for(i = 0; i + 4 <= descriptorLength && es->languageCount < 0xFF; i += 4){
+					if(block != NULL){
+						DESCRIPTOR_LANGUAGE *language = Descriptor_Language(block, totals->languages);
+						copyLanguage(language->language, &data[i]);
+						language->audioType = data[i + 3];
+					}
+					totals->languages++;
+					es->languageCount++;
+				}
+				break;
+
+			case DESCRIPTOR_TAG_TELETEXT:
+			case DESCRIPTOR_TAG_VBI_TELETEXT:
+				for(i = 0; i + 5 <= descriptorLength && es->teletextCount < 0xFF; i += 5){
+					if(block != NULL){
+						DESCRIPTOR_TELETEXT *teletext = Descriptor_Teletext(block, totals->teletext);
+						copyLanguage(teletext->language, &data[i]);
+						teletext->type = data[i + 3] >> 3;
+						teletext->magazine = data[i + 3] & 0x07;
+						teletext->page = data[i + 4];
+					}
+					totals->teletext++;
+					es->teletextCount++;
+				}
+				if(es->streamType == 0x06){
+					es->kind = ES_KIND_TELETEXT;
+				}
+				break;
+
+			case DESCRIPTOR_TAG_SUBTITLING:
+				for(i = 0; i + 8 <= descriptorLength && es->subtitleCount < 0xFF; i += 8){
+					if(block != NULL){
+						DESCRIPTOR_SUBTITLE *subtitle = Descriptor_Subtitle(block, totals->subtitles);
+						copyLanguage(subtitle->language, &data[i]);
+						subtitle->type = data[i + 3];
+						subtitle->compositionPage = (data[i + 4] << 8) | data[i + 5];
+						subtitle->ancillaryPage = (data[i + 6] << 8) | data[i + 7];
+					}
+					totals->subtitles++;
+					es->subtitleCount++;
+				}
+				if(es->streamType == 0x06){
+					es->kind = ES_KIND_SUBTITLE;
+				}
+				break;
+
+			case DESCRIPTOR_TAG_STREAM_ID:
+				if(descriptorLength >= 1){
+					es->componentTag = data[0];
+				}
+				break;
+
+			case DESCRIPTOR_TAG_AC3:
+			case DESCRIPTOR_TAG_EAC3:
+				/* component_type_flag is first bit of both descriptors */
+				if(descriptorLength >= 2 && (data[0] & 0x80)){
+					es->ac3ComponentType = data[1];
+				}
+				if(es->streamType == 0x06){
+					es->kind = (tag == DESCRIPTOR_TAG_AC3) ? ES_KIND_AUDIO_AC3 : ES_KIND_AUDIO_EAC3;
+				}
+				break;
+
+			default:
+				break;
+		}
+	}
+}
+
+// Walk whole PMT section, returns -1 on broken section
+static int walkSection(const uint8_t *section, PMT_DESCRIPTORS *block, DESCRIPTOR_TOTALS *totals){
+	int sectionLength;
+	int programInfoLength;
+	int position;
+	int end;
+	PMT_ES_INFO scratch;
+
+	if(section == NULL || section[0] != PMT_TABLE_ID){
+		return -1;
+	}
+	sectionLength = ((section[1] & 0x0F) << 8) | section[2];
+	if(sectionLength < PMT_FIXED_LENGTH || sectionLength > PMT_MAX_SECTION_LENGTH){
+		return -1;
+	}
+	end = 3 + sectionLength - 4;
+
+	programInfoLength = ((section[10] & 0x0F) << 8) | section[11];
+	if(12 + programInfoLength > end){
+		return -1;
+	}
+	walkLoop(&section[12], programInfoLength, block, NULL, totals);
+
+	position = 12 + programInfoLength;
+	while(position + 5 <= end){
+		int esInfoLength = ((section[position + 3] & 0x0F) << 8) | section[position + 4];
+		PMT_ES_INFO *es = (block != NULL) ? Descriptor_Es(block, totals->es) : &scratch;
+
+		if(position + 5 + esInfoLength > end){
+			return -1;
+		}
+
+		memset(es, 0, sizeof(PMT_ES_INFO));
+		es->streamType = section[position];
+		es->elementaryPid = ((section[position + 1] & 0x1F) << 8) | section[position + 2];
+		es->kind = kindOfStreamType(es->streamType);
+		es->componentTag = ES_COMPONENT_TAG_NONE;
+		es->caFirst = totals->ca;
+		es->languageFirst = totals->languages;
+		es->teletextFirst = totals->teletext;
+		es->subtitleFirst = totals->subtitles;
+
+		walkLoop(&section[position + 5], esInfoLength, block, es, totals);
+
+		totals->es++;
+		position += 5 + esInfoLength;
+	}
+	return 0;
+}
+
+// Lay out arrays after header, returns size of whole block
+static uint32_t layoutBlock(PMT_DESCRIPTORS *layout, DESCRIPTOR_TOTALS *totals){
+	layout->esCount = totals->es;
+	layout->esOffset = alignUp(sizeof(PMT_DESCRIPTORS));
+	layout->caOffset = alignUp(layout->esOffset + totals->es * sizeof(PMT_ES_INFO));
+	layout->languageOffset = alignUp(layout->caOffset + totals->ca * sizeof(DESCRIPTOR_CA));
+	layout->teletextOffset = alignUp(layout->languageOffset + totals->languages * sizeof(DESCRIPTOR_LANGUAGE));
+	layout->subtitleOffset = alignUp(layout->teletextOffset + totals->teletext * sizeof(DESCRIPTOR_TELETEXT));
+	layout->size = alignUp(layout->subtitleOffset + totals->subtitles * sizeof(DESCRIPTOR_SUBTITLE));
+	return layout->size;
+}
+
+uint32_t Descriptor_Pmt_Size(const uint8_t *section){
+	DESCRIPTOR_TOTALS totals;
+	PMT_DESCRIPTORS layout;
+
+	memset(&totals, 0, sizeof(totals));
+	if(walkSection(section, NULL, &totals) != 0){
+		return 0;
+	}
+	return layoutBlock(&layout, &totals);
+}
+
+// First pass counts entries, second one writes them, block must be aligned for uint32_t
+PMT_DESCRIPTORS *Descriptor_Parse_Pmt_Into(const uint8_t *section, void *block, uint32_t size){
+	DESCRIPTOR_TOTALS totals;
+	PMT_DESCRIPTORS *descriptors = (PMT_DESCRIPTORS*)block;
+
+	if(block == NULL){
+		return NULL;
+	}
+	memset(&totals, 0, sizeof(totals));
+	if(walkSection(section, NULL, &totals) != 0){
+		return NULL;
+	}
+	memset(block, 0, sizeof(PMT_DESCRIPTORS));
+	if(layoutBlock(descriptors, &totals) > size){
+		printf("\nDescriptor_Parse_Pmt_Into: block of %u bytes too small\n", size);
+		return NULL;
+	}
+
+	memset(&totals, 0, sizeof(totals));
+	walkSection(section, descriptors, &totals);
+	return descriptors;
+}
+
+// Whole descriptor metadata of one PMT in one malloc, release with free
+PMT_DESCRIPTORS *Descriptor_Parse_Pmt(const uint8_t *section){
+	uint32_t size = Descriptor_Pmt_Size(section);
+	void *block;
+
+	if(size == 0){
+		return NULL;
+	}
+	block = malloc(size);
+	if(block == NULL){
+		printf("\nDescriptor_Parse_Pmt: out of memory\n");
+		return NULL;
+	}
+	if(Descriptor_Parse_Pmt_Into(section, block, size) == NULL){
+		free(block);
+		return NULL;
+	}
+	return (PMT_DESCRIPTORS*)block;
+}
+
+PMT_ES_INFO *Descriptor_Es(const PMT_DESCRIPTORS *descriptors, int index){
+	return (PMT_ES_INFO*)((uint8_t*)descriptors + descriptors->esOffset) + index;
+}
+
+DESCRIPTOR_CA *Descriptor_Ca(const PMT_DESCRIPTORS *descriptors, int index){
+	return (DESCRIPTOR_CA*)((uint8_t*)descriptors + descriptors->caOffset) + index;
+}
+
+DESCRIPTOR_LANGUAGE *Descriptor_Language(const PMT_DESCRIPTORS *descriptors, int index){
+	return (DESCRIPTOR_LANGUAGE*)((uint8_t*)descriptors + descriptors->languageOffset) + index;
+}
+
+DESCRIPTOR_TELETEXT *Descriptor_Teletext(const PMT_DESCRIPTORS *descriptors, int index){
+	return (DESCRIPTOR_TELETEXT*)((uint8_t*)descriptors + descriptors->teletextOffset) + index;
+}
+
+DESCRIPTOR_SUBTITLE *Descriptor_Subtitle(const PMT_DESCRIPTORS *descriptors, int index){
+	return (DESCRIPTOR_SUBTITLE*)((uint8_t*)descriptors + descriptors->subtitleOffset) + index;
+}
+
+const char *Descriptor_Kind_Name(uint8_t kind){
+	switch(kind){
+		case ES_KIND_VIDEO:			return "video";
+		case ES_KIND_AUDIO_MPEG:	return "MPEG audio";
+		case ES_KIND_AUDIO_AAC:		return "AAC";
+		case ES_KIND_AUDIO_AC3:		return "AC-3";
+		case ES_KIND_AUDIO_EAC3:	return "E-AC-3";
+		case ES_KIND_TELETEXT:		return "teletext";
+		case ES_KIND_SUBTITLE:		return "DVB subtitles";
+		default:					return "other";
+	}
+}
+
+void Descriptor_Text(char *text, int size, const uint8_t *data, int length){
+	int i = 0;
+	int out = 0;
+
+	if(size <= 0){
+		return;
+	}
+	/* First byte below 0x20 selects character table, 0x10 carries two more bytes */
+	if(length > 0 && data[0] < 0x20){
+		i = (data[0] == 0x10) ? 3 : (data[0] == 0x1F) ? 2 : 1;
+	}
+	for(; i < length && out < size - 1; i++){
+		if(data[i] == 0x8A){
+			text[out++] = ' ';
+		}
+		else if(data[i] >= 0x20 && (data[i] < 0x80 || data[i] > 0x9F)){
+			text[out++] = (char)data[i];
+		}
+	}
+	text[out] = '\0';
+}
+
+// Printing parsed descriptors for testing
+void Descriptor_Print(const PMT_DESCRIPTORS *descriptors){
+	int i, j;
+
+	if(descriptors == NULL){
+		printf("\t\tNo descriptors\n");
+		return;
+	}
+	printf("\t\tDescriptors: %u bytes, %d streams\n", descriptors->size, descriptors->esCount);
+	if(descriptors->programRegistration){
+		printf("\t\tProgram registration:\t0x%08x\n", descriptors->programRegistration);
+	}
+	for(i = 0; i < descriptors->programCaCount; i++){
+		DESCRIPTOR_CA *ca = Descriptor_Ca(descriptors, i);
+		printf("\t\tProgram CA:\tsystem 0x%04x pid %d\n", ca->systemId, ca->pid);
+	}
+
+	for(i = 0; i < descriptors->esCount; i++){
+		PMT_ES_INFO *es = Descriptor_Es(descriptors, i);
+
+		printf("\t\t\tPID %d type 0x%02x: %s", es->elementaryPid, es->streamType, Descriptor_Kind_Name(es->kind));
+		if(es->componentTag != ES_COMPONENT_TAG_NONE){
+			printf(", component tag %d", es->componentTag);
+		}
+		if(es->ac3ComponentType){
+			printf(", AC-3 component type 0x%02x", es->ac3ComponentType);
+		}
+		if(es->registration){
+			printf(", registration 0x%08x", es->registration);
+		}
+		printf("\n");
+		for(j = 0; j < es->languageCount; j++){
+			DESCRIPTOR_LANGUAGE *language = Descriptor_Language(descriptors, es->languageFirst + j);
+			printf("\t\t\t\tLanguage:\t%s (audio type %d)\n", language->language, language->audioType);
+		}
+		for(j = 0; j < es->teletextCount; j++){
+			DESCRIPTOR_TELETEXT *teletext = Descriptor_Teletext(descriptors, es->teletextFirst + j);
+			printf("\t\t\t\tTeletext:\t%s type %d page %d%02x\n", teletext->language, teletext->type,
+				teletext->magazine ? teletext->magazine : 8, teletext->page);
+		}
+		for(j = 0; j < es->subtitleCount; j++){
+			DESCRIPTOR_SUBTITLE *subtitle = Descriptor_Subtitle(descriptors, es->subtitleFirst + j);
+			printf("\t\t\t\tSubtitles:\t%s type 0x%02x composition %d ancillary %d\n", subtitle->language, subtitle->type,
+				subtitle->compositionPage, subtitle->ancillaryPage);
+		}
+		for(j = 0; j < es->caCount; j++){
+			DESCRIPTOR_CA *ca = Descriptor_Ca(descriptors, es->caFirst + j);
+			printf("\t\t\t\tCA:\tsystem 0x%04x pid %d\n", ca->systemId, ca->pid);
+		}
+	}
+}
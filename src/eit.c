@@ -0,0 +1,305 @@
+/****************************************************************************
+*
+* FERIT
+*
+* -----------------------------------------------------
+* Konstrukcijski zadatak kolegij: Digitalna videotehnika
+* -----------------------------------------------------
+*
+* eit.c
+*
+* Purpose: Collecting EIT present/following and schedule sections into EPG store
+*
+* Made on 18.10.2026.
+*****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include "eit.h"
+#include "epg.h"
+#include "descriptor.h"
+
+#define EIT_FIXED_LENGTH		(15)	/* header after section_length plus CRC */
+#define EIT_MAX_SECTION_LENGTH	(4093)
+#define EIT_EVENTS_START		(14)
+#define EIT_EVENT_HEADER		(12)
+#define EIT_SUBTABLE_LIMIT		(EIT_MAX_SUBTABLES * 3 / 4)	/* keeps probing short */
+#define EIT_RECORD_HEADER		(4)		/* section length in front of every queued copy */
+#define EIT_RECORD_WRAP			(0xFFFFFFFF)
+#define MJD_UNIX_EPOCH			(40587)	/* 1.1.1970 */
+
+static pthread_mutex_t eitMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static EIT_SUBTABLE subtables[EIT_MAX_SUBTABLES];
+static int subtableCount = 0;
+
+/* Byte ring of queued sections, records are 4 byte aligned */
+static uint8_t queue[EIT_QUEUE_BYTES];
+static uint32_t queueRead = 0;
+static uint32_t queueWrite = 0;
+static uint32_t queueUsed = 0;
+
+static EIT_STATS stats;
+
+static int isEit(uint8_t tableId){
+	return tableId == EIT_TABLE_PF_ACTUAL || tableId == EIT_TABLE_PF_OTHER
+		|| (tableId >= EIT_TABLE_SCHEDULE_FIRST && tableId <= EIT_TABLE_SCHEDULE_LAST);
+}
+
+// Section length when header is valid EIT, 0 otherwise
+static int checkHeader(const uint8_t *buffer, uint32_t length){
+	int sectionLength;
+
+	if(buffer == NULL || length < SECTION_MIN_LENGTH || !isEit(buffer[0])){
+		return 0;
+	}
+	sectionLength = ((buffer[1] & 0x0F) << 8) | buffer[2];
+	if(!(buffer[1] & 0x80) || sectionLength < EIT_FIXED_LENGTH || sectionLength > EIT_MAX_SECTION_LENGTH
+		|| (uint32_t)sectionLength + 3 > length){
+		return 0;
+	}
+	return sectionLength;
+}
+
+static EIT_SUBTABLE *findSubtable(const uint8_t *buffer){
+	uint16_t serviceId = (buffer[3] << 8) | buffer[4];
+	uint16_t transportStreamId = (buffer[8] << 8) | buffer[9];
+	uint16_t originalNetworkId = (buffer[10] << 8) | buffer[11];
+	uint32_t key = ((uint32_t)buffer[0] << 16 | serviceId) ^ ((uint32_t)transportStreamId << 8) ^ ((uint32_t)originalNetworkId * 40503u);
+	uint32_t slot = (key * 2654435761u) & (EIT_MAX_SUBTABLES - 1);
+
+	while(subtables[slot].used){
+		EIT_SUBTABLE *subtable = &subtables[slot];
+		if(subtable->sections.tableId == buffer[0] && subtable->sections.tableIdExtension == serviceId
+			&& subtable->transportStreamId == transportStreamId && subtable->originalNetworkId == originalNetworkId){
+			return subtable;
+		}
+		slot = (slot + 1) & (EIT_MAX_SUBTABLES - 1);
+	}
+	if(subtableCount >= EIT_SUBTABLE_LIMIT){
+		return NULL;
+	}
+	Section_Subtable_Init(&subtables[slot].sections, buffer[0], serviceId);
+	subtables[slot].transportStreamId = transportStreamId;
+	subtables[slot].originalNetworkId = originalNetworkId;
+	subtables[slot].used = 1;
+	subtableCount++;
+	return &subtables[slot];
+}
+
+// Copy section to ring, -1 when there is no room
+static int queuePut(const uint8_t *buffer, uint32_t length){
+	uint32_t need = EIT_RECORD_HEADER + ((length + 3) & ~3u);
+	uint32_t wrap = EIT_RECORD_WRAP;
+	uint32_t tail;
+
+	if(queueUsed == 0){
+		queueRead = 0;
+		queueWrite = 0;
+	}
+	tail = EIT_QUEUE_BYTES - queueWrite;
+
+	/* Record never wraps, rest of ring is skipped when it does not fit */
+	if(tail < need){
+		if(queueUsed + tail + need > EIT_QUEUE_BYTES){
+			return -1;
+		}
+		memcpy(&queue[queueWrite], &wrap, EIT_RECORD_HEADER);
+		queueUsed += tail;
+		queueWrite = 0;
+	}
+	else if(queueUsed + need > EIT_QUEUE_BYTES){
+		return -1;
+	}
+	memcpy(&queue[queueWrite], &length, EIT_RECORD_HEADER);
+	memcpy(&queue[queueWrite + EIT_RECORD_HEADER], buffer, length);
+	queueWrite = (queueWrite + need) % EIT_QUEUE_BYTES;
+	queueUsed += need;
+	if(queueUsed > stats.queueHighWater){
+		stats.queueHighWater = queueUsed;
+	}
+	return 0;
+}
+
+// Take oldest section from ring, returns its length, 0 when ring is empty
+static uint32_t queueGet(uint8_t *buffer){
+	uint32_t length;
+
+	if(queueUsed == 0){
+		return 0;
+	}
+	memcpy(&length, &queue[queueRead], EIT_RECORD_HEADER);
+	if(length == EIT_RECORD_WRAP){
+		queueUsed -= EIT_QUEUE_BYTES - queueRead;
+		queueRead = 0;
+		memcpy(&length, &queue[queueRead], EIT_RECORD_HEADER);
+	}
+	memcpy(buffer, &queue[queueRead + EIT_RECORD_HEADER], length);
+	queueRead = (queueRead + EIT_RECORD_HEADER + ((length + 3) & ~3u)) % EIT_QUEUE_BYTES;
+	queueUsed -= EIT_RECORD_HEADER + ((length + 3) & ~3u);
+	return length;
+}
+
+static int bcd(uint8_t value){
+	return (value >> 4) * 10 + (value & 0x0F);
+}
+
+// start_time is 16 bit MJD and 6 BCD digits of UTC, all ones is undefined
+static int decodeStart(const uint8_t *data, uint32_t *start){
+	uint32_t mjd = (data[0] << 8) | data[1];
+
+	if(mjd < MJD_UNIX_EPOCH || (data[0] & data[1] & data[2] & data[3] & data[4]) == 0xFF){
+		return -1;
+	}
+	*start = (mjd - MJD_UNIX_EPOCH) * 86400 + bcd(data[2]) * 3600 + bcd(data[3]) * 60 + bcd(data[4]);
+	return 0;
+}
+
+// Event name and short text from first short_event descriptor
+static void parseEventDescriptors(EPG_EVENT *event, const uint8_t *loop, int loopLength){
+	int i = 0;
+
+	while(i + 2 <= loopLength){
+		int descriptorLength = loop[i + 1];
+		const uint8_t *data = &loop[i + 2];
+
+		if(i + 2 + descriptorLength > loopLength){
+			break;
+		}
+		if(loop[i] == DESCRIPTOR_TAG_SHORT_EVENT && descriptorLength >= 5){
+			int nameLength = data[3];
+			int textLength;
+
+			if(4 + nameLength >= descriptorLength){
+				nameLength = descriptorLength - 4;
+				textLength = 0;
+			}
+			else{
+				textLength = data[4 + nameLength];
+				if(5 + nameLength + textLength > descriptorLength){
+					textLength = descriptorLength - 5 - nameLength;
+				}
+			}
+			Descriptor_Text(event->name, EPG_NAME_LENGTH, &data[4], nameLength);
+			if(textLength > 0){
+				Descriptor_Text(event->text, EPG_TEXT_LENGTH, &data[5 + nameLength], textLength);
+			}
+			return;
+		}
+		i += 2 + descriptorLength;
+	}
+}
+
+// Event loop of one section into EPG store, returns number of stored events
+static int parseSection(const uint8_t *buffer, int sectionLength){
+	uint16_t serviceId = (buffer[3] << 8) | buffer[4];
+	uint16_t transportStreamId = (buffer[8] << 8) | buffer[9];
+	uint16_t originalNetworkId = (buffer[10] << 8) | buffer[11];
+	int end = 3 + sectionLength - 4;
+	int position = EIT_EVENTS_START;
+	int events = 0;
+	EPG_EVENT event;
+
+	while(position + EIT_EVENT_HEADER <= end){
+		const uint8_t *data = &buffer[position];
+		int loopLength = ((data[10] & 0x0F) << 8) | data[11];
+
+		if(position + EIT_EVENT_HEADER + loopLength > end){
+			break;
+		}
+		event.eventId = (data[0] << 8) | data[1];
+		event.duration = bcd(data[7]) * 3600 + bcd(data[8]) * 60 + bcd(data[9]);
+		event.runningStatus = data[10] >> 5;
+		event.name[0] = '\0';
+		event.text[0] = '\0';
+		if(decodeStart(&data[2], &event.start) == 0){
+			parseEventDescriptors(&event, &data[EIT_EVENT_HEADER], loopLength);
+			if(Epg_Add_Event(originalNetworkId, transportStreamId, serviceId, &event) == 0){
+				events++;
+			}
+		}
+		position += EIT_EVENT_HEADER + loopLength;
+	}
+	return events;
+}
+
+void Eit_Reset(){
+	pthread_mutex_lock(&eitMutex);
+	memset(subtables, 0, sizeof(subtables));
+	subtableCount = 0;
+	queueRead = 0;
+	queueWrite = 0;
+	queueUsed = 0;
+	pthread_mutex_unlock(&eitMutex);
+}
+
+int Eit_Queue_Section(const uint8_t *buffer, uint32_t length){
+	EIT_SUBTABLE *subtable;
+	int sectionLength = checkHeader(buffer, length);
+
+	if(sectionLength == 0){
+		return SECTION_INVALID;
+	}
+	if(!(buffer[5] & 0x01)){
+		return SECTION_NEXT;
+	}
+
+	pthread_mutex_lock(&eitMutex);
+	/* Sub table table is full, section is queued on every repetition and parsed again */
+	subtable = findSubtable(buffer);
+	if(subtable != NULL){
+		Section_Subtable_Version(&subtable->sections, buffer);
+		if(Section_Subtable_Check(&subtable->sections, buffer) == SECTION_REPEAT){
+			stats.repeats++;
+			pthread_mutex_unlock(&eitMutex);
+			return SECTION_REPEAT;
+		}
+	}
+	if(queuePut(buffer, sectionLength + 3) != 0){
+		stats.dropped++;
+		pthread_mutex_unlock(&eitMutex);
+		return EIT_QUEUE_FULL;
+	}
+	/* Marked when queued, same section arriving before parser runs is a repeat */
+	if(subtable != NULL){
+		Section_Subtable_Mark(&subtable->sections, buffer);
+	}
+	stats.queued++;
+	pthread_mutex_unlock(&eitMutex);
+
+	return SECTION_NEW;
+}
+
+int Eit_Process_Queue(){
+	/* Only PSI monitor thread parses */
+	static uint8_t section[EIT_MAX_SECTION_LENGTH + 3];
+	uint32_t length;
+	int sections = 0;
+	int events = 0;
+
+	for(;;){
+		pthread_mutex_lock(&eitMutex);
+		length = queueGet(section);
+		pthread_mutex_unlock(&eitMutex);
+		if(length == 0){
+			break;
+		}
+		events += parseSection(section, length - 3);
+		sections++;
+	}
+
+	pthread_mutex_lock(&eitMutex);
+	stats.parsed += sections;
+	stats.events += events;
+	pthread_mutex_unlock(&eitMutex);
+
+	return sections;
+}
+
+void Eit_Get_Stats(EIT_STATS *copy){
+	pthread_mutex_lock(&eitMutex);
+	*copy = stats;
+	copy->subtables = subtableCount;
+	pthread_mutex_unlock(&eitMutex);
+}
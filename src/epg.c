@@ -0,0 +1,526 @@
+/****************************************************************************
+*
+* FERIT
+*
+* -----------------------------------------------------
+* Konstrukcijski zadatak kolegij: Digitalna videotehnika
+* -----------------------------------------------------
+*
+* epg.c
+*
+* Purpose: In-memory EPG store, time sorted events per service within a byte budget
+*
+* Made on 18.10.2026.
+*****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "epg.h"
+
+#define EPG_INDEX_BITS			(9)
+#define EPG_INDEX_SIZE			(1 << EPG_INDEX_BITS)	/* at least twice EPG_MAX_SERVICES */
+#define EPG_MIN_CAPACITY		(16)
+#define EPG_POOL_MIN_CAPACITY	(4096)
+#define EPG_MIN_STRING_SLOTS	(512)
+#define EPG_HEADROOM_SHARE		(8)		/* eviction goes 1/8 of budget below it, not on every insert */
+#define EPG_MAX_EVICT_PASSES	(8)
+
+static pthread_mutex_t epgMutex = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t budget = EPG_DEFAULT_BUDGET;
+
+static EPG_SERVICE services[EPG_MAX_SERVICES];
+static int serviceCount = 0;
+/* Open addressing on service key, slot holds service position + 1, 0 is empty */
+static uint16_t serviceIndex[EPG_INDEX_SIZE];
+
+/* Interned strings, offset 0 is the empty string */
+static char *pool = NULL;
+static uint32_t poolUsed = 0;
+static uint32_t poolCapacity = 0;
+/* Open addressing on string hash, slot holds pool offset, 0 is empty */
+static uint32_t *stringSlots = NULL;
+static uint32_t stringSlotCount = 0;
+static uint32_t stringCount = 0;
+
+static uint32_t eventBytes = 0;		/* capacity of every service, EPG_EVENT_BYTES each */
+static uint32_t inserted = 0;
+static uint32_t replaced = 0;
+static uint32_t evicted = 0;
+static uint32_t compactions = 0;
+
+static uint32_t serviceHash(uint16_t originalNetworkId, uint16_t transportStreamId, uint16_t serviceId){
+	uint32_t key = (((uint32_t)transportStreamId << 16) | serviceId) ^ ((uint32_t)originalNetworkId * 40503u);
+	return (key * 2654435761u) >> (32 - EPG_INDEX_BITS);
+}
+
+static EPG_SERVICE *findService(uint16_t originalNetworkId, uint16_t transportStreamId, uint16_t serviceId, int create){
+	uint32_t slot = serviceHash(originalNetworkId, transportStreamId, serviceId);
+	EPG_SERVICE *service;
+
+	while(serviceIndex[slot] != 0){
+		service = &services[serviceIndex[slot] - 1];
+		if(service->serviceId == serviceId && service->transportStreamId == transportStreamId
+			&& service->originalNetworkId == originalNetworkId){
+			return service;
+		}
+		slot = (slot + 1) & (EPG_INDEX_SIZE - 1);
+	}
+	if(!create || serviceCount == EPG_MAX_SERVICES){
+		return NULL;
+	}
+	service = &services[serviceCount];
+	memset(service, 0, sizeof(EPG_SERVICE));
+	service->originalNetworkId = originalNetworkId;
+	service->transportStreamId = transportStreamId;
+	service->serviceId = serviceId;
+	serviceIndex[slot] = ++serviceCount;
+	return service;
+}
+
+// Move arrays of service to one block of new capacity, 0 frees them
+static int resizeService(EPG_SERVICE *service, int capacity){
+	uint8_t *block = NULL;
+	EPG_SERVICE resized = *service;
+
+	if(capacity > 0){
+		block = malloc(capacity * EPG_EVENT_BYTES);
+		if(block == NULL){
+			return -1;
+		}
+		/* Widest arrays first, every array stays aligned */
+		resized.start = (uint32_t*)block;
+		resized.duration = resized.start + capacity;
+		resized.name = resized.duration + capacity;
+		resized.text = resized.name + capacity;
+		resized.eventId = (uint16_t*)(resized.text + capacity);
+		resized.runningStatus = (uint8_t*)(resized.eventId + capacity);
+	}
+	else{
+		resized.start = resized.duration = resized.name = resized.text = NULL;
+		resized.eventId = NULL;
+		resized.runningStatus = NULL;
+	}
+	if(service->count > 0){
+		memcpy(resized.start, service->start, service->count * sizeof(uint32_t));
+		memcpy(resized.duration, service->duration, service->count * sizeof(uint32_t));
+		memcpy(resized.name, service->name, service->count * sizeof(uint32_t));
+		memcpy(resized.text, service->text, service->count * sizeof(uint32_t));
+		memcpy(resized.eventId, service->eventId, service->count * sizeof(uint16_t));
+		memcpy(resized.runningStatus, service->runningStatus, service->count);
+	}
+	free(service->start);
+	eventBytes = eventBytes - service->capacity * EPG_EVENT_BYTES + capacity * EPG_EVENT_BYTES;
+	resized.capacity = capacity;
+	*service = resized;
+	return 0;
+}
+
+// Move count events of every array from position source to position destination
+static void moveEvents(EPG_SERVICE *service, int destination, int source, int count){
+	if(count <= 0 || destination == source){
+		return;
+	}
+	memmove(&service->start[destination], &service->start[source], count * sizeof(uint32_t));
+	memmove(&service->duration[destination], &service->duration[source], count * sizeof(uint32_t));
+	memmove(&service->name[destination], &service->name[source], count * sizeof(uint32_t));
+	memmove(&service->text[destination], &service->text[source], count * sizeof(uint32_t));
+	memmove(&service->eventId[destination], &service->eventId[source], count * sizeof(uint16_t));
+	memmove(&service->runningStatus[destination], &service->runningStatus[source], count);
+}
+
+// First event starting at time or later
+static int lowerBound(EPG_SERVICE *service, uint32_t time){
+	int low = 0;
+	int high = service->count;
+
+	while(low < high){
+		int middle = (low + high) / 2;
+		if(service->start[middle] < time){
+			low = middle + 1;
+		}
+		else{
+			high = middle;
+		}
+	}
+	return low;
+}
+
+// First event starting after time
+static int upperBound(EPG_SERVICE *service, uint32_t time){
+	int low = 0;
+	int high = service->count;
+
+	while(low < high){
+		int middle = (low + high) / 2;
+		if(service->start[middle] <= time){
+			low = middle + 1;
+		}
+		else{
+			high = middle;
+		}
+	}
+	return low;
+}
+
+static uint32_t stringHash(const char *string){
+	uint32_t hash = 2166136261u;
+
+	while(*string){
+		hash = (hash ^ (uint8_t)*string++) * 16777619u;
+	}
+	return hash;
+}
+
+static int growStringSlots(){
+	uint32_t count = (stringSlotCount == 0) ? EPG_MIN_STRING_SLOTS : stringSlotCount * 2;
+	uint32_t *slots = calloc(count, sizeof(uint32_t));
+	uint32_t i;
+
+	if(slots == NULL){
+		return -1;
+	}
+	for(i = 0; i < stringSlotCount; i++){
+		if(stringSlots[i] != 0){
+			uint32_t slot = stringHash(&pool[stringSlots[i]]) & (count - 1);
+			while(slots[slot] != 0){
+				slot = (slot + 1) & (count - 1);
+			}
+			slots[slot] = stringSlots[i];
+		}
+	}
+	free(stringSlots);
+	stringSlots = slots;
+	stringSlotCount = count;
+	return 0;
+}
+
+// Pool offset of string, it is added when it is not there yet, empty string on failure
+static uint32_t internString(const char *string){
+	uint32_t length;
+	uint32_t slot;
+
+	if(string == NULL || string[0] == '\0'){
+		return 0;
+	}
+	if((stringCount + 1) * 2 > stringSlotCount && growStringSlots() != 0){
+		return 0;
+	}
+
+	slot = stringHash(string) & (stringSlotCount - 1);
+	while(stringSlots[slot] != 0){
+		if(strcmp(&pool[stringSlots[slot]], string) == 0){
+			return stringSlots[slot];
+		}
+		slot = (slot + 1) & (stringSlotCount - 1);
+	}
+
+	length = strlen(string) + 1;
+	if(poolUsed + length + 1 > poolCapacity){
+		uint32_t capacity = (poolCapacity == 0) ? EPG_POOL_MIN_CAPACITY : poolCapacity * 2;
+		char *grown;
+
+		while(capacity < poolUsed + length + 1){
+			capacity *= 2;
+		}
+		grown = realloc(pool, capacity);
+		if(grown == NULL){
+			return 0;
+		}
+		pool = grown;
+		poolCapacity = capacity;
+	}
+	if(poolUsed == 0){
+		pool[0] = '\0';
+		poolUsed = 1;
+	}
+	memcpy(&pool[poolUsed], string, length);
+	stringSlots[slot] = poolUsed;
+	poolUsed += length;
+	stringCount++;
+	return stringSlots[slot];
+}
+
+static uint32_t usedBytes(){
+	return eventBytes + poolCapacity + stringSlotCount * sizeof(uint32_t);
+}
+
+static void copyString(char *destination, int size, uint32_t offset){
+	const char *source = (offset != 0 && pool != NULL) ? &pool[offset] : "";
+	strncpy(destination, source, size - 1);
+	destination[size - 1] = '\0';
+}
+
+static void copyEvent(EPG_SERVICE *service, int position, EPG_EVENT *event){
+	event->eventId = service->eventId[position];
+	event->start = service->start[position];
+	event->duration = service->duration[position];
+	event->runningStatus = service->runningStatus[position];
+	copyString(event->name, EPG_NAME_LENGTH, service->name[position]);
+	copyString(event->text, EPG_TEXT_LENGTH, service->text[position]);
+}
+
+// Drop at least count events with oldest start time over all services
+// Cut time is searched instead of events, cost does not depend on how many are dropped
+static void evictOldest(int count){
+	uint32_t low = 0xFFFFFFFF;
+	uint32_t high = 0;
+	int i;
+
+	for(i = 0; i < serviceCount; i++){
+		if(services[i].count > 0){
+			if(services[i].start[0] < low){
+				low = services[i].start[0];
+			}
+			if(services[i].start[services[i].count - 1] >= high){
+				high = services[i].start[services[i].count - 1] + 1;
+			}
+		}
+	}
+	if(high == 0){
+		return;
+	}
+	/* Smallest cut time with at least count events starting before it */
+	while(low < high){
+		uint32_t middle = low + (high - low) / 2;
+		int before = 0;
+
+		for(i = 0; i < serviceCount; i++){
+			before += lowerBound(&services[i], middle);
+		}
+		if(before >= count){
+			high = middle;
+		}
+		else{
+			low = middle + 1;
+		}
+	}
+	for(i = 0; i < serviceCount; i++){
+		int drop = lowerBound(&services[i], low);
+		moveEvents(&services[i], 0, drop, services[i].count - drop);
+		services[i].count -= drop;
+		evicted += drop;
+	}
+}
+
+// Rebuild string pool from live events only and give back spare array capacity
+static void compact(){
+	char *oldPool = pool;
+	uint32_t *oldSlots = stringSlots;
+	int i, j;
+
+	pool = NULL;
+	poolUsed = 0;
+	poolCapacity = 0;
+	stringSlots = NULL;
+	stringSlotCount = 0;
+	stringCount = 0;
+
+	for(i = 0; i < serviceCount; i++){
+		EPG_SERVICE *service = &services[i];
+		int capacity = service->count + service->count / 4;
+
+		for(j = 0; j < service->count; j++){
+			service->name[j] = (service->name[j] != 0) ? internString(&oldPool[service->name[j]]) : 0;
+			service->text[j] = (service->text[j] != 0) ? internString(&oldPool[service->text[j]]) : 0;
+		}
+		if(service->count == 0){
+			capacity = 0;
+		}
+		else if(capacity < EPG_MIN_CAPACITY){
+			capacity = EPG_MIN_CAPACITY;
+		}
+		if(capacity < service->capacity){
+			resizeService(service, capacity);
+		}
+	}
+	free(oldPool);
+	free(oldSlots);
+	compactions++;
+}
+
+// Evict share of events by which store is over target, compaction shows what it really freed
+static void enforceBudget(){
+	uint32_t target = budget - budget / EPG_HEADROOM_SHARE;
+	uint32_t used = usedBytes();
+	int passes;
+
+	for(passes = 0; used > target && passes < EPG_MAX_EVICT_PASSES; passes++){
+		uint64_t total = 0;
+		int i;
+
+		for(i = 0; i < serviceCount; i++){
+			total += services[i].count;
+		}
+		if(total > 0){
+			evictOldest((int)(total * (used - target) / used) + 1);
+		}
+		compact();
+		if(total == 0){
+			break;
+		}
+		used = usedBytes();
+	}
+}
+
+void Epg_Set_Budget(uint32_t bytes){
+	pthread_mutex_lock(&epgMutex);
+	if(bytes == 0){
+		budget = EPG_DEFAULT_BUDGET;
+	}
+	else{
+		budget = (bytes < EPG_MIN_BUDGET) ? EPG_MIN_BUDGET : bytes;
+	}
+	enforceBudget();
+	pthread_mutex_unlock(&epgMutex);
+}
+
+void Epg_Reset(){
+	int i;
+
+	pthread_mutex_lock(&epgMutex);
+	for(i = 0; i < serviceCount; i++){
+		free(services[i].start);
+	}
+	serviceCount = 0;
+	memset(serviceIndex, 0, sizeof(serviceIndex));
+	free(pool);
+	free(stringSlots);
+	pool = NULL;
+	poolUsed = 0;
+	poolCapacity = 0;
+	stringSlots = NULL;
+	stringSlotCount = 0;
+	stringCount = 0;
+	eventBytes = 0;
+	pthread_mutex_unlock(&epgMutex);
+}
+
+int Epg_Add_Event(uint16_t originalNetworkId, uint16_t transportStreamId, uint16_t serviceId, EPG_EVENT *event){
+	EPG_SERVICE *service;
+	uint32_t end = event->start + (event->duration > 0 ? event->duration : 1);
+	int low;
+	int high;
+
+	pthread_mutex_lock(&epgMutex);
+	service = findService(originalNetworkId, transportStreamId, serviceId, 1);
+	if(service == NULL){
+		pthread_mutex_unlock(&epgMutex);
+		return -1;
+	}
+
+	/* Events overlapping new one are replaced by it, schedule stays free of overlaps */
+	low = lowerBound(service, event->start);
+	if(low > 0 && service->start[low - 1] + service->duration[low - 1] > event->start){
+		low--;
+	}
+	high = low;
+	while(high < service->count && service->start[high] < end){
+		high++;
+	}
+
+	if(high > low){
+		replaced += high - low;
+		moveEvents(service, low + 1, high, service->count - high);
+		service->count -= high - low - 1;
+	}
+	else{
+		if(service->count == service->capacity
+			&& resizeService(service, service->capacity < EPG_MIN_CAPACITY ? EPG_MIN_CAPACITY : service->capacity * 2) != 0){
+			pthread_mutex_unlock(&epgMutex);
+			return -1;
+		}
+		moveEvents(service, low + 1, low, service->count - low);
+		service->count++;
+	}
+	service->start[low] = event->start;
+	service->duration[low] = event->duration;
+	service->eventId[low] = event->eventId;
+	service->runningStatus[low] = event->runningStatus;
+	service->name[low] = internString(event->name);
+	service->text[low] = internString(event->text);
+	inserted++;
+
+	if(usedBytes() > budget){
+		enforceBudget();
+	}
+	pthread_mutex_unlock(&epgMutex);
+
+	return 0;
+}
+
+int Epg_Now_Next(uint16_t originalNetworkId, uint16_t transportStreamId, uint16_t serviceId, uint32_t now,
+	EPG_EVENT *present, EPG_EVENT *following){
+	EPG_SERVICE *service;
+	int position;
+	int result = 0;
+
+	pthread_mutex_lock(&epgMutex);
+	service = findService(originalNetworkId, transportStreamId, serviceId, 0);
+	if(service != NULL){
+		position = upperBound(service, now) - 1;
+		if(position >= 0 && service->start[position] + service->duration[position] > now){
+			if(present != NULL){
+				copyEvent(service, position, present);
+			}
+			result |= EPG_PRESENT;
+		}
+		if(position + 1 < service->count){
+			if(following != NULL){
+				copyEvent(service, position + 1, following);
+			}
+			result |= EPG_FOLLOWING;
+		}
+	}
+	pthread_mutex_unlock(&epgMutex);
+
+	return result;
+}
+
+int Epg_Range(uint16_t originalNetworkId, uint16_t transportStreamId, uint16_t serviceId, uint32_t from, uint32_t to,
+	EPG_EVENT *events, int maxCount){
+	EPG_SERVICE *service;
+	int position;
+	int count = 0;
+
+	pthread_mutex_lock(&epgMutex);
+	service = findService(originalNetworkId, transportStreamId, serviceId, 0);
+	if(service != NULL){
+		/* Events do not overlap, only the one before from can still be running */
+		position = upperBound(service, from) - 1;
+		if(position < 0 || service->start[position] + service->duration[position] <= from){
+			position++;
+		}
+		for(; position < service->count && service->start[position] < to && count < maxCount; position++){
+			copyEvent(service, position, &events[count++]);
+		}
+	}
+	pthread_mutex_unlock(&epgMutex);
+
+	return count;
+}
+
+uint32_t Epg_Used_Bytes(){
+	uint32_t used;
+	pthread_mutex_lock(&epgMutex);
+	used = usedBytes();
+	pthread_mutex_unlock(&epgMutex);
+	return used;
+}
+
+void Epg_Print_Stats(){
+	int events = 0;
+	int i;
+
+	pthread_mutex_lock(&epgMutex);
+	for(i = 0; i < serviceCount; i++){
+		events += services[i].count;
+	}
+	printf("\n\t\tEPG STORE:\n");
+	printf("\t\t\t%d events of %d services, %u strings in %u of %u pool bytes\n",
+		events, serviceCount, stringCount, poolUsed, poolCapacity);
+	printf("\t\t\tused %u of %u bytes, inserted %u, replaced %u, evicted %u, compactions %u\n",
+		usedBytes(), budget, inserted, replaced, evicted, compactions);
+	pthread_mutex_unlock(&epgMutex);
+}
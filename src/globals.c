@@ -118,9 +118,6 @@ PROGRAM_MAP program_mapHC[8] = {
 
 struct config config;
 
-pthread_cond_t statusCondition = PTHREAD_COND_INITIALIZER;
-pthread_mutex_t statusMutex = PTHREAD_MUTEX_INITIALIZER;
-
 pthread_t thread_PlayStream;
 pthread_t thread_Graphic;
 pthread_t thread_ParsePat;
@@ -128,7 +125,6 @@ pthread_t thread_ParsePmt;
 
 PAT_TABLE pat;
 PMT_TABLE *pmt = NULL;
-int parserProgramIndex = 0;
 
 uint32_t playerHandle = 0;
 uint32_t sourceHandle = 0;
@@ -139,8 +135,6 @@ uint32_t filterHandelArray[8] = {0};
 uint32_t audioStreamHandle = 0;
 uint32_t videoStreamHandle = 0;
 
-int patFlag = 0;
-int pmtFlag = 0;
 int allPmtFlag = 0;
 IDirectFBSurface *primary = NULL;
 IDirectFB *dfbInterface = NULL;
@@ -20,6 +20,20 @@
 #include <stdio.h>
 #include <directfb.h>
 #include "globals.h"
+#include "programmap.h"
+#include "sdt.h"
+#include "channeldb.h"
+#include "zaptrace.h"
+
+static pthread_mutex_t graphicMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t graphicCondition = PTHREAD_COND_INITIALIZER;
+
+// Wake graphic thread after one of draw flags is set
+void GraphicNotify(){
+	pthread_mutex_lock(&graphicMutex);
+	pthread_cond_signal(&graphicCondition);
+	pthread_mutex_unlock(&graphicMutex);
+}
 
 void *GraphicThread(){
 	
@@ -70,6 +84,13 @@ void *GraphicThread(){
 	clearScreen();
 
 	while(1){
+		/* Sleep until someone sets a draw flag */
+		pthread_mutex_lock(&graphicMutex);
+		while(!drawVolumeFlag && !drawCurrentChanellFlag && !drawForbidenContentFlag){
+			pthread_cond_wait(&graphicCondition, &graphicMutex);
+		}
+		pthread_mutex_unlock(&graphicMutex);
+
 		if(drawVolumeFlag){
 			DrawVolumeStatus();
 			drawVolumeFlag = 0;
@@ -236,7 +257,31 @@ void DrawChanell(){
 	
 	clearScreen();
 
-	char String[25];
+	char String[25 + SDT_NAME_LENGTH];
+	PROGRAM_MAP chanell;
+	SDT_SERVICE service;
+	CHANNEL_DB_ENTRY entry;
+	uint16_t transportStreamId;
+	int number = chanelStatus.currentProgram;
+	int stringWidth = 0;
+
+	/* Name comes from SDT cache and number from channel database, banner never waits for demux */
+	if(ProgramMap_Get(chanelStatus.currentProgram, &chanell) == 0){
+		if(Pat_Get_Transport_Stream_Id(&transportStreamId) == 0 && ChannelDb_Get(ChannelDb_Find(transportStreamId, chanell.programNumber), &entry) == 0
+			&& entry.lcn != NIT_LCN_NONE){
+			number = entry.lcn;
+		}
+		if(Sdt_Find_Actual(chanell.programNumber, &service) == 0 && service.name[0] != '\0'){
+			sprintf(String, "%d %s", number, service.name);
+		}
+		else{
+			sprintf(String, "%d", number);
+		}
+	}
+	else{
+		sprintf(String, "%d", number);
+	}
+	DFBCHECK(fontInterface->GetStringWidth(fontInterface, String, -1, &stringWidth));
 
 	DFBCHECK(primary->SetColor(/*surface to draw on*/ primary,
 							/*red*/ 0xFF,
@@ -247,12 +292,11 @@ void DrawChanell(){
 	DFBCHECK(primary->FillRectangle(/*surface to draw on*/ primary,
 									/*upper left x coordinate*/ 10,
 									/*upper left y coordinate*/ 20,
-									/*rectangle width*/ 40,
+									/*rectangle width*/ (stringWidth + 10 > 40) ? stringWidth + 10 : 40,
 									/*rectangle height*/ 50));
 	
 	
 	
-	sprintf(String, "%d", chanelStatus.currentProgram);
 	/* draw the text */
 	
 	DFBCHECK(primary->SetColor(/*surface to draw on*/ primary,
@@ -273,6 +317,8 @@ void DrawChanell(){
 	DFBCHECK(primary->Flip(primary,
 							/*region to be updated, NULL for the whole surface*/NULL,
 							/*flip flags*/0));
+	/* Banner of new chanell is on screen, zap started by key ends here */
+	ZapTrace_Mark(ZAP_STAGE_OSD_FLIP);
 
 	
     
@@ -27,6 +27,7 @@
 #include <fcntl.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <string.h>
 #include <stdint.h>
 #include <errno.h>
 #include <pthread.h>
@@ -37,6 +38,12 @@
 #include "pat.h"
 #include "pmt.h"
 #include "graphic.h"
+#include "startup.h"
+#include "psicache.h"
+#include "psimonitor.h"
+#include "epg.h"
+#include "zaptrace.h"
+#include "zapsoak.h"
 
 int main(int32_t argc, char** argv){
 	
@@ -49,6 +56,11 @@ int main(int32_t argc, char** argv){
 	char* configFileName;
 	configFileName = strdup(argv[1]);
 
+	// Startup phases replace busy waiting on global flags
+	// Every thread reports its phase, main sleeps until the phase it needs is reached
+	Startup_Init();
+	ZapTrace_Init();
+
 
 	//Start graphic
 	//Enable overlayer drawing
@@ -72,6 +84,17 @@ int main(int32_t argc, char** argv){
 	chanelStatus.currentProgram = 0;
 	chanelStatus.startProgramNumber = 0;
 	chanelStatus.endProgamNumber = 7;
+	chanelStatus.frequency = (uint32_t)config.freq * 1000000;
+	chanelStatus.bandwidth = config.bandwidth;
+	Epg_Set_Budget((uint32_t)config.epgBudget * 1024);
+	chanelStatus.module = (config.module != NULL && strcmp(config.module, "DVB-T2") == 0) ? DVB_T2 : DVB_T;
+
+	// Load PSI cache for the tuned frequency
+	// When present it replaces hardcoded channel list, PlayStream starts last chanell right after lock
+	// and PAT/PMT parsed later only validate it
+	if(PsiCache_Load(chanelStatus.frequency) == 0){
+		chanelStatus.currentProgram = PsiCache_Last_Chanell();
+	}
 
 	
 	//	Start Stream
@@ -91,22 +114,17 @@ int main(int32_t argc, char** argv){
 
 
 	// Wait for player initialization
-	// In PlayStream thread hanndler for player is initialized with value 0
-	// When PlayStream thread set up stream, player handler will bi change to value other than 0
+	// When PlayStream thread initialized player and opened source, demux filters can be set
 	// This is sign to start parsing PAT
-	while(playerHandle == 0){
-
-	}
+	Startup_Wait_Phase(STARTUP_PLAYER_READY, STARTUP_WAIT_FOREVER);
 	//	Parse PAT
 	printf("Parse PAT thread called!\n");
 	pthread_create(&thread_ParsePat, NULL, ParsePat, NULL);
 	
 	
 	//	Wait for PAT parser
-	//  When PAT is parsed, there is flag that will be changed to 1, so if patFlag != 0, main go on 
-	while(patFlag == 0){
-
-	}
+	//  When PAT is parsed, PAT phase is reached and main go on
+	Startup_Wait_Phase(STARTUP_PAT, STARTUP_WAIT_FOREVER);
 	// Now pat is parsed, ParsePat thread is no needed anymore
 	pthread_join(thread_ParsePat, NULL);
 	
@@ -116,11 +134,19 @@ int main(int32_t argc, char** argv){
 	pthread_create(&thread_ParsePmt, NULL, ParsePmt, NULL);
 	
 	// Wait for all pmt to be parsed
-	while(allPmtFlag == 0){
-
-	}
+	Startup_Wait_Phase(STARTUP_PMTS, STARTUP_WAIT_FOREVER);
 	// Finish ParsePmt thread
 	pthread_join(thread_ParsePmt, NULL);
+	Startup_Print_Timeline();
+
+	// Keep PAT and PMT of chanell on air under watch
+	// Only tables whose version or CRC changed are parsed again, player gets only what changed
+	PsiMonitor_Start();
+
+	// Scripted zapping soak, latency percentiles and memory growth are printed when it ends
+	if(config.zapSoak > 0){
+		ZapSoak_Start(config.zapSoak, config.zapDwell);
+	}
 	
 
 	
@@ -0,0 +1,410 @@
+/****************************************************************************
+*
+* FERIT
+*
+* -----------------------------------------------------
+* Konstrukcijski zadatak kolegij: Digitalna videotehnika
+* -----------------------------------------------------
+*
+* nit.c
+*
+* Purpose: Parsing NIT actual/other to transports with tune parameters and services with LCN
+*
+* Made on 18.10.2026.
+*****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include "nit.h"
+#include "section.h"
+#include "descriptor.h"
+
+#define NIT_FIXED_LENGTH		(13)	/* header after section_length, both loop lengths and CRC */
+#define NIT_MAX_SECTION_LENGTH	(1021)
+#define NIT_DESCRIPTORS_START	(8)
+
+static pthread_mutex_t nitMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Few multiplexes per network, records are searched linearly and only when NIT version changes */
+static NIT_TRANSPORT transports[NIT_MAX_TRANSPORTS];
+static int transportCount = 0;
+static NIT_SERVICE services[NIT_MAX_SERVICES];
+static int serviceCount = 0;
+
+static SECTION_SUBTABLE subtables[NIT_MAX_SUBTABLES];
+static int subtableCount = 0;
+static uint32_t subtablesDropped = 0;	/* sections of sub tables that did not fit */
+static char networkName[NIT_NAME_LENGTH];
+
+/* bandwidth field of terrestrial_delivery_system_descriptor, MHz */
+static const uint8_t terrestrialBandwidth[4] = {8, 7, 6, 5};
+/* bandwidth field of T2_delivery_system_descriptor, 1.7 MHz is rounded up */
+static const uint8_t t2Bandwidth[6] = {8, 7, 6, 5, 10, 2};
+
+static uint32_t readUint32(const uint8_t *data){
+	return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | data[3];
+}
+
+// Owner that record is reported under, sub table of actual network wins
+static void chooseOwner(uint32_t owners, uint8_t *tableId, uint16_t *networkId){
+	int i;
+	int chosen = -1;
+
+	for(i = 0; i < subtableCount; i++){
+		if(!(owners & (1u << i))){
+			continue;
+		}
+		if(chosen < 0 || (subtables[i].tableId == NIT_TABLE_ACTUAL && subtables[chosen].tableId != NIT_TABLE_ACTUAL)){
+			chosen = i;
+		}
+	}
+	if(chosen >= 0){
+		*tableId = subtables[chosen].tableId;
+		*networkId = subtables[chosen].tableIdExtension;
+	}
+}
+
+// Records of sub table version that is replaced, record listed by other sub table too is kept for it
+static void removeRecords(int owner){
+	uint32_t bit = 1u << owner;
+	int i;
+	int kept = 0;
+
+	for(i = 0; i < transportCount; i++){
+		transports[i].owners &= ~bit;
+		if(transports[i].owners == 0){
+			continue;
+		}
+		chooseOwner(transports[i].owners, &transports[i].tableId, &transports[i].networkId);
+		transports[kept++] = transports[i];
+	}
+	transportCount = kept;
+
+	kept = 0;
+	for(i = 0; i < serviceCount; i++){
+		services[i].owners &= ~bit;
+		if(services[i].owners == 0){
+			continue;
+		}
+		chooseOwner(services[i].owners, &services[i].tableId, &services[i].networkId);
+		services[kept++] = services[i];
+	}
+	serviceCount = kept;
+}
+
+// Entry of transport, new one is added, NULL when table is full
+static NIT_TRANSPORT *storeTransport(uint16_t originalNetworkId, uint16_t transportStreamId){
+	int i;
+
+	for(i = 0; i < transportCount; i++){
+		if(transports[i].originalNetworkId == originalNetworkId && transports[i].transportStreamId == transportStreamId){
+			return &transports[i];
+		}
+	}
+	if(transportCount == NIT_MAX_TRANSPORTS){
+		return NULL;
+	}
+	memset(&transports[transportCount], 0, sizeof(NIT_TRANSPORT));
+	transports[transportCount].originalNetworkId = originalNetworkId;
+	transports[transportCount].transportStreamId = transportStreamId;
+	return &transports[transportCount++];
+}
+
+// Entry of service on transport, new one is visible and has no LCN, NULL when table is full
+static NIT_SERVICE *storeService(NIT_TRANSPORT *transport, uint16_t serviceId){
+	int i;
+
+	for(i = 0; i < serviceCount; i++){
+		if(services[i].serviceId == serviceId && services[i].transportStreamId == transport->transportStreamId
+			&& services[i].originalNetworkId == transport->originalNetworkId){
+			return &services[i];
+		}
+	}
+	if(serviceCount == NIT_MAX_SERVICES){
+		return NULL;
+	}
+	memset(&services[serviceCount], 0, sizeof(NIT_SERVICE));
+	services[serviceCount].originalNetworkId = transport->originalNetworkId;
+	services[serviceCount].transportStreamId = transport->transportStreamId;
+	services[serviceCount].serviceId = serviceId;
+	services[serviceCount].visible = 1;
+	services[serviceCount].lcn = NIT_LCN_NONE;
+	return &services[serviceCount++];
+}
+
+static SECTION_SUBTABLE *findSubtable(uint8_t tableId, uint16_t networkId, int create){
+	int i;
+
+	for(i = 0; i < subtableCount; i++){
+		if(subtables[i].tableId == tableId && subtables[i].tableIdExtension == networkId){
+			return &subtables[i];
+		}
+	}
+	if(!create || subtableCount == NIT_MAX_SUBTABLES){
+		return NULL;
+	}
+	Section_Subtable_Init(&subtables[subtableCount], tableId, networkId);
+	return &subtables[subtableCount++];
+}
+
+// Section length when header is valid NIT, 0 otherwise
+static int checkHeader(const uint8_t *buffer, uint32_t length){
+	int sectionLength;
+
+	if(buffer == NULL || length < SECTION_MIN_LENGTH){
+		return 0;
+	}
+	if(buffer[0] != NIT_TABLE_ACTUAL && buffer[0] != NIT_TABLE_OTHER){
+		return 0;
+	}
+	sectionLength = ((buffer[1] & 0x0F) << 8) | buffer[2];
+	if(!(buffer[1] & 0x80) || sectionLength < NIT_FIXED_LENGTH || sectionLength > NIT_MAX_SECTION_LENGTH
+		|| (uint32_t)sectionLength + 3 > length){
+		return 0;
+	}
+	return sectionLength;
+}
+
+// Services of one service_list or logical_channel descriptor listed by owner sub table
+static void parseServiceLoop(NIT_TRANSPORT *transport, int owner, uint8_t tag, const uint8_t *data, int length){
+	int entrySize = (tag == DESCRIPTOR_TAG_SERVICE_LIST) ? 3 : 4;
+	int i;
+
+	for(i = 0; i + entrySize <= length; i += entrySize){
+		NIT_SERVICE *service = storeService(transport, (data[i] << 8) | data[i + 1]);
+
+		if(service == NULL){
+			printf("NIT: service table full, service %d dropped\n", (data[i] << 8) | data[i + 1]);
+			return;
+		}
+		service->owners |= 1u << owner;
+		chooseOwner(service->owners, &service->tableId, &service->networkId);
+		if(tag == DESCRIPTOR_TAG_SERVICE_LIST){
+			service->serviceType = data[i + 2];
+		}
+		else{
+			service->visible = data[i + 2] >> 7;
+			service->lcn = ((data[i + 2] & 0x03) << 8) | data[i + 3];
+		}
+	}
+}
+
+// Transport descriptors, delivery system gives tune parameters, service loops give services
+static void parseTransportDescriptors(NIT_TRANSPORT *transport, int owner, const uint8_t *loop, int loopLength){
+	int i = 0;
+
+	while(i + 2 <= loopLength){
+		int descriptorLength = loop[i + 1];
+		const uint8_t *data = &loop[i + 2];
+
+		if(i + 2 + descriptorLength > loopLength){
+			break;
+		}
+		switch(loop[i]){
+			case DESCRIPTOR_TAG_TERRESTRIAL:
+				if(descriptorLength >= 5){
+					/* centre_frequency is in 10 Hz units */
+					transport->frequency = readUint32(data) * 10;
+					transport->bandwidth = ((data[4] >> 5) < 4) ? terrestrialBandwidth[data[4] >> 5] : 0;
+					if(transport->deliverySystem == NIT_DELIVERY_NONE){
+						transport->deliverySystem = NIT_DELIVERY_T;
+					}
+				}
+				break;
+			case DESCRIPTOR_TAG_EXTENSION:
+				if(descriptorLength >= 4 && data[0] == DESCRIPTOR_EXTENSION_T2_DELIVERY){
+					transport->deliverySystem = NIT_DELIVERY_T2;
+					if(descriptorLength >= 6 && ((data[4] >> 2) & 0x0F) < 6){
+						transport->bandwidth = t2Bandwidth[(data[4] >> 2) & 0x0F];
+					}
+					/* Without terrestrial descriptor frequency of first cell is used, TFS has no single one */
+					if(transport->frequency == 0 && descriptorLength >= 12 && !(data[5] & 0x01)){
+						transport->frequency = readUint32(&data[8]) * 10;
+					}
+				}
+				break;
+			case DESCRIPTOR_TAG_SERVICE_LIST:
+			case DESCRIPTOR_TAG_LOGICAL_CHANNEL:
+				/* logical_channel is private, it is taken from every network as most receivers do */
+				parseServiceLoop(transport, owner, loop[i], data, descriptorLength);
+				break;
+			default:
+				break;
+		}
+		i += 2 + descriptorLength;
+	}
+}
+
+// Network name of actual network
+static void parseNetworkDescriptors(const uint8_t *loop, int loopLength){
+	int i = 0;
+
+	while(i + 2 <= loopLength){
+		int descriptorLength = loop[i + 1];
+
+		if(i + 2 + descriptorLength > loopLength){
+			break;
+		}
+		if(loop[i] == DESCRIPTOR_TAG_NETWORK_NAME){
+			Descriptor_Text(networkName, NIT_NAME_LENGTH, &loop[i + 2], descriptorLength);
+		}
+		i += 2 + descriptorLength;
+	}
+}
+
+// Transport stream loop of one section, transports already known are updated in place
+static void parseSection(const uint8_t *buffer, int sectionLength, int owner){
+	int end = 3 + sectionLength - 4;
+	int position = NIT_DESCRIPTORS_START;
+	int loopLength;
+	int loopEnd;
+
+	loopLength = ((buffer[position] & 0x0F) << 8) | buffer[position + 1];
+	position += 2;
+	if(position + loopLength + 2 > end){
+		return;
+	}
+	if(buffer[0] == NIT_TABLE_ACTUAL){
+		parseNetworkDescriptors(&buffer[position], loopLength);
+	}
+	position += loopLength;
+
+	loopLength = ((buffer[position] & 0x0F) << 8) | buffer[position + 1];
+	position += 2;
+	loopEnd = (position + loopLength > end) ? end : position + loopLength;
+
+	while(position + 6 <= loopEnd){
+		uint16_t transportStreamId = (buffer[position] << 8) | buffer[position + 1];
+		uint16_t originalNetworkId = (buffer[position + 2] << 8) | buffer[position + 3];
+		int descriptorsLength = ((buffer[position + 4] & 0x0F) << 8) | buffer[position + 5];
+		NIT_TRANSPORT *transport;
+
+		if(position + 6 + descriptorsLength > loopEnd){
+			break;
+		}
+		transport = storeTransport(originalNetworkId, transportStreamId);
+		if(transport == NULL){
+			printf("NIT: transport table full, transport %d dropped\n", transportStreamId);
+			break;
+		}
+		transport->owners |= 1u << owner;
+		chooseOwner(transport->owners, &transport->tableId, &transport->networkId);
+		parseTransportDescriptors(transport, owner, &buffer[position + 6], descriptorsLength);
+		position += 6 + descriptorsLength;
+	}
+}
+
+void Nit_Reset(){
+	pthread_mutex_lock(&nitMutex);
+	transportCount = 0;
+	serviceCount = 0;
+	subtableCount = 0;
+	subtablesDropped = 0;
+	networkName[0] = '\0';
+	pthread_mutex_unlock(&nitMutex);
+}
+
+int Nit_Section_Check(const uint8_t *buffer, uint32_t length){
+	SECTION_SUBTABLE *subtable;
+	int result = SECTION_NEW;
+
+	if(checkHeader(buffer, length) == 0){
+		return SECTION_INVALID;
+	}
+	if(!(buffer[5] & 0x01)){
+		return SECTION_NEXT;
+	}
+
+	pthread_mutex_lock(&nitMutex);
+	subtable = findSubtable(buffer[0], (buffer[3] << 8) | buffer[4], 0);
+	if(subtable != NULL){
+		result = Section_Subtable_Check(subtable, buffer);
+	}
+	else if(subtableCount == NIT_MAX_SUBTABLES){
+		/* No room for new sub table, queueing its sections again and again would never store them */
+		subtablesDropped++;
+		result = SECTION_REPEAT;
+	}
+	pthread_mutex_unlock(&nitMutex);
+
+	return result;
+}
+
+int Nit_Add_Section(const uint8_t *buffer, uint32_t length){
+	SECTION_SUBTABLE *subtable;
+	int sectionLength = checkHeader(buffer, length);
+	int result;
+
+	if(sectionLength == 0){
+		return SECTION_INVALID;
+	}
+	if(!(buffer[5] & 0x01)){
+		return SECTION_NEXT;
+	}
+
+	pthread_mutex_lock(&nitMutex);
+	subtable = findSubtable(buffer[0], (buffer[3] << 8) | buffer[4], 1);
+	if(subtable == NULL){
+		pthread_mutex_unlock(&nitMutex);
+		return SECTION_INVALID;
+	}
+	/* New version replaces every transport and service of sub table */
+	if(Section_Subtable_Version(subtable, buffer)){
+		removeRecords(subtable - subtables);
+	}
+	if(Section_Subtable_Check(subtable, buffer) == SECTION_REPEAT){
+		pthread_mutex_unlock(&nitMutex);
+		return SECTION_REPEAT;
+	}
+
+	parseSection(buffer, sectionLength, subtable - subtables);
+	result = Section_Subtable_Mark(subtable, buffer);
+	pthread_mutex_unlock(&nitMutex);
+
+	return result;
+}
+
+int Nit_Copy_Transports(NIT_TRANSPORT *copy, int maxCount){
+	int count;
+
+	pthread_mutex_lock(&nitMutex);
+	count = (transportCount < maxCount) ? transportCount : maxCount;
+	memcpy(copy, transports, count * sizeof(NIT_TRANSPORT));
+	pthread_mutex_unlock(&nitMutex);
+
+	return count;
+}
+
+int Nit_Copy_Services(NIT_SERVICE *copy, int maxCount){
+	int count;
+
+	pthread_mutex_lock(&nitMutex);
+	count = (serviceCount < maxCount) ? serviceCount : maxCount;
+	memcpy(copy, services, count * sizeof(NIT_SERVICE));
+	pthread_mutex_unlock(&nitMutex);
+
+	return count;
+}
+
+// Printing network for testing
+void Nit_Print(){
+	int i;
+
+	pthread_mutex_lock(&nitMutex);
+	printf("\n\t\tNIT: network \"%s\", %d transports, %d services in %d sub tables, %u sections of sub tables without room\n",
+		networkName, transportCount, serviceCount, subtableCount, subtablesDropped);
+	for(i = 0; i < transportCount; i++){
+		printf("\t\t\t%s network %5d ts %5d onid %5d: %s %u Hz, %d MHz\n",
+			transports[i].tableId == NIT_TABLE_ACTUAL ? "actual" : "other ",
+			transports[i].networkId, transports[i].transportStreamId, transports[i].originalNetworkId,
+			transports[i].deliverySystem == NIT_DELIVERY_T2 ? "DVB-T2" :
+			transports[i].deliverySystem == NIT_DELIVERY_T ? "DVB-T" : "-",
+			transports[i].frequency, transports[i].bandwidth);
+	}
+	for(i = 0; i < serviceCount; i++){
+		printf("\t\t\tts %5d service %5d type 0x%02x LCN %4d%s\n", services[i].transportStreamId,
+			services[i].serviceId, services[i].serviceType, services[i].lcn, services[i].visible ? "" : " (hidden)");
+	}
+	pthread_mutex_unlock(&nitMutex);
+}
@@ -21,240 +21,359 @@
 #include "globals.h"
 #include "streamplayer.h"
 #include "programmap.h"
+#include "startup.h"
+#include "psicache.h"
 
-// Main function of ParsePmt thread
-
-void *ParsePmt(){
-	printf("\nNow parsing pmts in separated thread...\n");
-	int result;
-    pmt = malloc(pat.programCounter * sizeof(PMT_TABLE));
-    program_map = malloc(pat.programCounter * sizeof(PROGRAM_MAP));
-
-	uint32_t patFilterHandle;
-    int programIndex;
-    
-    //For each PID in pat table, parse PMT, skip first PID(16)
-    for(programIndex=1; programIndex<pat.programCounter; programIndex++){
-		        
-		parserProgramIndex = programIndex;
-        pmtFlag = 0;
-        printf("\n\tProgram index: %d\n", programIndex);
-		pthread_mutex_lock(&statusMutex);
-        /* Set filter to demux */
-		printf("\nTrying to filter progroma with pid: \t%d\n", pat.program[programIndex].pid);
-        //result = Demux_Set_Filter(playerHandle, (uint32_t) 100, 0x02, &patFilterHandle);
-        result = Demux_Set_Filter(playerHandle, (uint32_t) pat.program[programIndex].pid, 0x02, &patFilterHandle);
-		ASSERT_TDP_RESULT(result, "Demux_Set_Filter-PMT set");
-        /* Register section filter callback */
-        result = Demux_Register_Section_Filter_Callback(myPMTSecFilterCallback);
-        ASSERT_TDP_RESULT(result, "Demux_Register_Stream_Filter_Callback-PMT set");
-
-      
-        //wait to finish pmt
-        while(pmtFlag == 0){
-			//printf("Ovdje sam\n");
-        };
-
-			
-
-        /* Unegister section filter callback */
-        result = Demux_Unregister_Section_Filter_Callback(myPMTSecFilterCallback);
-        ASSERT_TDP_RESULT(result, "Demux_Register_Stream_Filter_Callback-PMT done");
-        /* Free filter */
-        result = Demux_Free_Filter(playerHandle, patFilterHandle);
-        ASSERT_TDP_RESULT(result, "Demux_Free_Filter-PMT done");
-
-   		pthread_mutex_unlock(&statusMutex);
-
-        //PMT_to_ProgramMap(pmt[programIndex], programIndex);
+static pthread_mutex_t pmtMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pmtCondition;
+static int pmtConditionInit = 0;
 
-    }
-    allPmtFlag = 1;
-    Print_ProgramMap();
+static long elapsedMs(struct timespec *from, struct timespec *to){
+    return (to->tv_sec - from->tv_sec) * 1000 + (to->tv_nsec - from->tv_nsec) / 1000000;
 }
 
-int32_t myPMTSecFilterCallback(uint8_t *buffer)
-{
-    printf("\n\nSection arrived!!!\n\n");
-	parseBufferToPmt(buffer, &pmt[parserProgramIndex]);
-    printf("\n#######\nPMT number: %d\n#######\n", parserProgramIndex);
-    printPmtTable(&pmt[parserProgramIndex]);
-    pmtFlag = 1;
-	return 0;
+static void addMs(struct timespec *time, long ms){
+    time->tv_sec += ms / 1000;
+    time->tv_nsec += (ms % 1000) * 1000000;
+    if(time->tv_nsec >= 1000000000){
+        time->tv_sec++;
+        time->tv_nsec -= 1000000000;
+    }
 }
 
+// Arm filter for one PMT request, returns 0 when filter is set
+static int armPmtRequest(PMT_REQUEST *request){
+    int result;
+    uint32_t handle;
+    t_DemuxFilterParams params;
+
+    pthread_mutex_lock(&pmtMutex);
+    request->state = PMT_REQUEST_ARMED;
+    request->attempts++;
+    clock_gettime(CLOCK_MONOTONIC, &request->armedAt);
+    request->deadline = request->armedAt;
+    addMs(&request->deadline, PMT_DEADLINE_MS);
+    pthread_mutex_unlock(&pmtMutex);
+
+    /* Demux matches program_number, PMTs of other programs on shared PID never wake us */
+    Demux_Filter_Params_Init(&params, (uint32_t) pat.program[request->programIndex].pid, 0x02);
+    Demux_Filter_Params_Extension(&params, request->programNumber);
+    result = Demux_Set_Filter_Ex(playerHandle, &params, &handle);
+    if(result == NO_ERROR){
+        request->filterHandle = handle;
+        /* Filter carries the request it fills, no global routing state */
+        result = Demux_Register_Filter_Callback(handle, myPMTSecFilterCallback, request);
+        if(result != NO_ERROR){
+            Demux_Free_Filter(playerHandle, handle);
+            request->filterHandle = 0;
+        }
+    }
 
-
-// Printing parsed data for testing
-void printPmtTable(PMT_TABLE *pmt){
-    printf("\nPMT:\n");
-    printf("Table id:\t%d\n", pmt->table_id);
-    printf("Section syntax indicator:\t%d\n", pmt->section_syntax_indicator);
-    printf("Reserved1:\t%d\n", pmt->reserved1);
-    printf("Section lenght:\t%d\n", pmt->section_lenght);
-    printf("Program number:\t%d\n", pmt->program_number);
-    printf("Reserved2:\t%d\n", pmt->reserved2);
-    printf("Version number:\t%d\n", pmt->version_number);
-    printf("Current next indicator:\t%d\n", pmt->current_next_indicator);
-    printf("Section number\t%d\n", pmt->section_number);
-    printf("Last section number:\t%d\n", pmt->last_section_number);
-    printf("Reserved3:\t%d\n", pmt->reserved3);
-    printf("PCR PID:\t%d\n", pmt->PCR_PID);
-    printf("Reserved4:\t%d\n", pmt->reserved4);
-    printf("Prorgram info lenght:\t%d\n", pmt->program_info_lenght);
-    printf("CRC:\t%d\n", pmt->CRC);
-
-    printf("Number of streams:\t%d\n", pmt->streamCounter);
-
-    int i;
-    for(i=0; i<pmt->streamCounter; i++){
-        printf("\n\t\t#########\n\t\tSTREAM number: %d\n\t\t#########\n\n", i);
-        printf("\t\t\tElemntaryPID:\t%d\n", pmt->stream[i].elementary_PID);
-        printf("\t\t\tStream_type:\t%d\n", pmt->stream[i].stream_type);
-        printf("\t\t\tReservd:\t%d\n", pmt->stream[i].reserved);
-        printf("\t\t\tES inof lenght:\t%d\n", pmt->stream[i].ES_info_lenght);
-        printf("\t\t\tReserved2:\t%d\n", pmt->stream[i].reserved2);
-        printf("\t\t\tDescriptor:\t%d\n", pmt->stream[i].descriptor);
+    if(result != NO_ERROR){
+        pthread_mutex_lock(&pmtMutex);
+        request->state = PMT_REQUEST_IDLE;
+        request->attempts--;
+        pthread_mutex_unlock(&pmtMutex);
+        return -1;
     }
-    printf("End of PMT table\n");
-    
-    
+    return 0;
 }
 
-// Parsing buffer to struct PMT, shifting and addition bits 
-void parseBufferToPmt(uint8_t *buffer, PMT_TABLE *pmt){
-    
-    
-    
-    pmt->table_id = buffer[0];
-    
-    pmt->section_syntax_indicator = (buffer[1] & 0b10000000) >> 7;
-    
-    pmt->reserved1 = (buffer[1] & 0b01100000) >> 5;
-    
-    pmt->section_lenght = (buffer[1] & 0b00001111);
-    pmt->section_lenght <<=8;
-    pmt->section_lenght += buffer[2];
-
-    pmt->program_number = buffer[3];
-    pmt->program_number <<=8;
-    pmt->program_number += buffer[4];
+// Build channel list from acquired PMTs and validate it against the PSI cache
+// Program that failed to deliver its PMT keeps its cached entry, so one slow PID does not drop a channel
+static void updateChannelList(PMT_REQUEST *requests, int requestCount){
+    PROGRAM_MAP *map;
+    PROGRAM_MAP cached;
+    int count = 0;
+    int i;
 
-    pmt->reserved2 = (buffer[5] & 0b11000000) >> 6;
+    map = calloc(requestCount, sizeof(PROGRAM_MAP));
+    if(map == NULL){
+        printf("\nParsePmt: out of memory, channel list not updated\n");
+        return;
+    }
 
-    pmt->version_number = (buffer[5] & 0b00111110) >> 1;
+    for(i = 0; i < requestCount; i++){
+        int haveCached = (PsiCache_Find_Program(requests[i].programNumber, &cached) == 0);
+
+        if(requests[i].state == PMT_REQUEST_DONE){
+            PMT_to_ProgramMap(requests[i].pmt, &map[count]);
+            map[count].pmtPid = pat.program[requests[i].programIndex].pid;
+            /* PMT carries no rating, keep the one we already know */
+            if(haveCached){
+                map[count].contentRank = cached.contentRank;
+            }
+            else if(count < (int)(sizeof(program_mapHC) / sizeof(program_mapHC[0]))){
+                map[count].contentRank = program_mapHC[count].contentRank;
+            }
+            count++;
+        }
+        else if(haveCached){
+            map[count++] = cached;
+        }
+    }
 
-    pmt->current_next_indicator =  (buffer[5] & 0b00000001);
+    PsiCache_Update(chanelStatus.frequency, &pat, map, count);
+    free(map);
+}
 
-    pmt->section_number = buffer[6];
+// Main function of ParsePmt thread
+// Every PMT PID is armed at once, as many as there are free demux filters,
+// sections are collected as they arrive and each PID has its own deadline
+void *ParsePmt(){
+	printf("\nNow parsing pmts in separated thread...\n");
+    pmt = calloc(pat.programCounter, sizeof(PMT_TABLE));
 
-    pmt->last_section_number = buffer[7];
+    PMT_REQUEST *requests = calloc(pat.programCounter, sizeof(PMT_REQUEST));
+    int requestCount = 0;
+    int pending = 0;
+    int armed = 0;
+    int i;
+    struct timespec start, now, wakeUp;
 
-    pmt->reserved3 = (buffer[8] & 0b11100000) >> 5;
+    if(pmt == NULL || requests == NULL){
+        printf("\nParsePmt: out of memory\n");
+        free(requests);
+        Startup_Set_Phase(STARTUP_PMTS);
+        return NULL;
+    }
 
-    pmt->PCR_PID = (buffer[8] & 0b00011111);
-    pmt->PCR_PID <<=8;
-    pmt->PCR_PID += buffer[9];
+    if(!pmtConditionInit){
+        pthread_condattr_t attr;
+        pthread_condattr_init(&attr);
+        pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+        pthread_cond_init(&pmtCondition, &attr);
+        pthread_condattr_destroy(&attr);
+        pmtConditionInit = 1;
+    }
 
-    pmt->reserved4 = (buffer[10] & 0b11110000) >> 4;
+    //For each program in pat table make request, program number 0 is NIT PID
+    for(i = 0; i < pat.programCounter; i++){
+        if(pat.program[i].program_number == 0){
+            continue;
+        }
+        requests[requestCount].programIndex = i;
+        requests[requestCount].programNumber = pat.program[i].program_number;
+        requests[requestCount].pmt = &pmt[i];
+        requests[requestCount].state = PMT_REQUEST_IDLE;
+        Section_Table_Init(&requests[requestCount].sections, 0x02, pat.program[i].program_number, -1);
+        requestCount++;
+    }
+    pending = requestCount;
 
-    pmt->program_info_lenght = (buffer[10] & 0b00001111);
-    pmt->program_info_lenght <<=8;
-    pmt->program_info_lenght += buffer[11];
+    clock_gettime(CLOCK_MONOTONIC, &start);
 
-    
-    int loopBitSize = pmt->section_lenght - 9 - 4; //if descriptor is size 0
-    int streamMaxNumber = loopBitSize/5;
-    pmt->stream = malloc(sizeof(STREAM)*streamMaxNumber);
-    
-    int streamIndexBit = 0;
-    pmt->streamCounter = 0;
-    while(streamIndexBit < loopBitSize){
+    while(pending > 0){
+        /* Arm idle requests while demux has free filters */
+        for(i = 0; i < requestCount; i++){
+            if(requests[i].state != PMT_REQUEST_IDLE){
+                continue;
+            }
+            if(armPmtRequest(&requests[i]) != 0){
+                break;
+            }
+            armed++;
+            printf("\nPMT pid %d armed (attempt %d)\n", pat.program[requests[i].programIndex].pid, requests[i].attempts);
+        }
 
-        pmt->stream[pmt->streamCounter].stream_type = buffer[12 + pmt->program_info_lenght + streamIndexBit];
-        
-        pmt->stream[pmt->streamCounter].elementary_PID = (((buffer[13 + pmt->program_info_lenght + streamIndexBit] << 8) + (buffer[14 + pmt->program_info_lenght + streamIndexBit])) & 0x1FFF); //13 bits
+        if(armed == 0){
+            printf("\nParsePmt: no free demux filter, %d PMTs not acquired\n", pending);
+            break;
+        }
 
-        pmt->stream[pmt->streamCounter].ES_info_lenght = (((buffer[15 + pmt->program_info_lenght + streamIndexBit] << 8) + (buffer[16 + pmt->program_info_lenght + streamIndexBit])) & 0x0FFF);  //12 bits
+        /* Sleep until a PMT arrives or the earliest deadline passes */
+        pthread_mutex_lock(&pmtMutex);
+        for(;;){
+            int finished = 0;
+            int haveDeadline = 0;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            for(i = 0; i < requestCount; i++){
+                if(requests[i].state == PMT_REQUEST_DONE && requests[i].filterHandle){
+                    finished = 1;
+                }
+                else if(requests[i].state == PMT_REQUEST_ARMED){
+                    if(elapsedMs(&requests[i].deadline, &now) >= 0){
+                        finished = 1;
+                    }
+                    else if(!haveDeadline || elapsedMs(&requests[i].deadline, &wakeUp) > 0){
+                        wakeUp = requests[i].deadline;
+                        haveDeadline = 1;
+                    }
+                }
+            }
+            if(finished || !haveDeadline){
+                break;
+            }
+            pthread_cond_timedwait(&pmtCondition, &pmtMutex, &wakeUp);
+        }
+        pthread_mutex_unlock(&pmtMutex);
+
+        /* Free filters of finished and expired requests, demux is not called under pmtMutex */
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        for(i = 0; i < requestCount; i++){
+            int state;
+
+            if(requests[i].filterHandle == 0){
+                continue;
+            }
+            pthread_mutex_lock(&pmtMutex);
+            state = requests[i].state;
+            if(state == PMT_REQUEST_ARMED && elapsedMs(&requests[i].deadline, &now) >= 0){
+                /* Deadline passed, stop callback from filling this slot */
+                state = (requests[i].attempts < PMT_MAX_ATTEMPTS) ? PMT_REQUEST_IDLE : PMT_REQUEST_FAILED;
+                requests[i].state = state;
+                printf("\nPMT pid %d timed out after %d ms\n", pat.program[requests[i].programIndex].pid, PMT_DEADLINE_MS);
+            }
+            pthread_mutex_unlock(&pmtMutex);
+
+            if(state == PMT_REQUEST_ARMED){
+                continue;
+            }
+            Demux_Free_Filter(playerHandle, requests[i].filterHandle);
+            requests[i].filterHandle = 0;
+            armed--;
+            if(state != PMT_REQUEST_IDLE){
+                pending--;
+            }
+        }
+    }
 
-        pmt->stream[pmt->streamCounter].descriptor =  buffer[17 + pmt->program_info_lenght + streamIndexBit];
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    printf("\n\t\tPMT acquisition: %d of %d in %ld ms\n", requestCount - pending, requestCount, elapsedMs(&start, &now));
+    for(i = 0; i < requestCount; i++){
+        printf("\t\t\tProgram %d pid %d: %s, %ld ms, %d attempt(s)\n",
+            requests[i].programNumber,
+            pat.program[requests[i].programIndex].pid,
+            requests[i].state == PMT_REQUEST_DONE ? "ok" : "failed",
+            requests[i].state == PMT_REQUEST_DONE ? requests[i].acquireMs : -1L,
+            requests[i].attempts);
+    }
+    updateChannelList(requests, requestCount);
+    for(i = 0; i < requestCount; i++){
+        Section_Table_Free(&requests[i].sections);
+    }
+    free(requests);
 
-        streamIndexBit = 5 + pmt->stream[pmt->streamCounter].ES_info_lenght;
-        pmt->streamCounter++;
+    /* Channel list holds everything we need, filters are gone so no callback touches tables anymore */
+    for(i = 0; i < pat.programCounter; i++){
+        PsiMem_Arena_Free(&pmt[i].arena);
     }
+    free(pmt);
+    pmt = NULL;
 
-    
+    allPmtFlag = 1;
+    Print_ProgramMap();
+    Startup_Set_Phase(STARTUP_PMTS);
+    return NULL;
+}
 
-   /*
-    int varA = pmt->program_info_lenght;
-    int varB;
-    int sum_varB = 0;
-    int N = 0;
-    while((sum_varB + (5*N)) < ((pmt->section_lenght) - varA - 13))
-    {
-	    varB = (uint16_t)(((*(buffer+15+varA+sum_varB) << 8) + *(buffer+16+varA+sum_varB)) & 0x0FFF);  //es_info_length
-	    sum_varB += varB;  //es_info_length
-	    N++;
+// Section callback of one PMT filter, user is the PMT_REQUEST being served
+int32_t myPMTSecFilterCallback(uint32_t filterHandle, uint8_t *buffer, uint32_t length, void *user)
+{
+    PMT_REQUEST *request = (PMT_REQUEST*)user;
+    struct timespec now;
+    uint8_t *section;
+    uint32_t sectionLength;
+
+    pthread_mutex_lock(&pmtMutex);
+    if(request->state != PMT_REQUEST_ARMED){
+        pthread_mutex_unlock(&pmtMutex);
+        return 0;
     }
+    /* Assembler takes only our program number, PMT PID can be shared by several programs */
+    if(Section_Table_Add(&request->sections, buffer, length) != SECTION_COMPLETE){
+        pthread_mutex_unlock(&pmtMutex);
+        return 0;
+    }
+    /* PMT of one program is always carried in section 0, broken one waits for deadline and next attempt */
+    section = Section_Table_Get(&request->sections, 0, &sectionLength);
+    if(parseBufferToPmt(section, sectionLength, request->pmt) != 0){
+        pthread_mutex_unlock(&pmtMutex);
+        return 0;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    request->acquireMs = elapsedMs(&request->armedAt, &now);
+    request->state = PMT_REQUEST_DONE;
+    pthread_cond_signal(&pmtCondition);
+    pthread_mutex_unlock(&pmtMutex);
+
+    printf("\n#######\nPMT program number: %d\n#######\n", request->pmt->program_number);
+    printPmtTable(request->pmt);
+	return 0;
+}
 
-    pmt->stream = (struct streams*)malloc(N * sizeof(STREAM));
-    pmt->streamCounter = N;
-    sum_varB = 0;
-    int j;
-    for(j=0; j<N; j++)  //poznat N iz prethodne
-    {
-        varB = (uint16_t)(((*(buffer+15+varA+sum_varB) << 8) + *(buffer+16+varA+sum_varB)) & 0x0FFF);  //es_info_length
-        sum_varB += varB;  //es_info_length
 
-        pmt->stream[j].stream_type = (uint8_t)((*(buffer+12+varA+sum_varB) << 0)  & 0xFF);
-        pmt->stream[j].elementary_PID = (uint16_t)(((*(buffer+13+varA+sum_varB) << 8) + *(buffer+14+varA+sum_varB)) & 0x1FFF);
-        pmt->stream[j].ES_info_lenght = varB;
-    }
-    */
-   pmt->CRC = buffer[12 + pmt->program_info_lenght + streamIndexBit];
 
+// Audio type of stream kind decided from descriptors, 0 when kind is not audio
+static tStreamType getAudioTypeOfKind(PMT_ES_INFO *es){
+    switch(es->kind){
+        case ES_KIND_AUDIO_AC3:
+            return AUDIO_TYPE_DOLBY_AC3;
+        case ES_KIND_AUDIO_EAC3:
+            return AUDIO_TYPE_DOLBY_PLUS;
+        case ES_KIND_AUDIO_MPEG:
+        case ES_KIND_AUDIO_AAC:
+            return getAudioType(es->streamType);
+        default:
+            return 0;
+    }
 }
 
-// Parsing whole PMT to applicaion needed struct
-void PMT_to_ProgramMap(PMT_TABLE pmt, int index){
+// Parsing whole PMT to applicaion needed struct, first audio and first video stream are taken
+void PMT_to_ProgramMap(PMT_TABLE *pmt, PROGRAM_MAP *map){
 	
     int i;
-    for(i=0; i<pmt.streamCounter; i++){
-        printf("StreamType:\t%d\n", pmt.stream[i].stream_type );
-        
-        switch( pmt.stream[i].stream_type ){
-            case 2:
-                program_map[index].audioPID = pmt.stream[i].elementary_PID;
-                program_map[index].audioType = AUDIO_TYPE_MPEG_AUDIO;
-                break;
-
-            case 3:
-                program_map[index].videoPID = pmt.stream[i].elementary_PID;
-                program_map[index].videoType = VIDEO_TYPE_MPEG2;
-                break;
-            
-            
+    int haveAudio = 0;
+    int haveVideo = 0;
+
+    map->programNumber = pmt->program_number;
+    map->pmtVersion = pmt->version_number;
+
+    /* Descriptors tell private streams apart, AC-3 in stream type 0x06 is audio */
+    if(pmt->descriptor != NULL){
+        for(i = 0; i < pmt->descriptor->esCount; i++){
+            PMT_ES_INFO *es = Descriptor_Es(pmt->descriptor, i);
+            tStreamType audioType = getAudioTypeOfKind(es);
+
+            if(es->kind == ES_KIND_VIDEO && !haveVideo){
+                map->videoPID = es->elementaryPid;
+                map->videoType = getVideoType(es->streamType);
+                haveVideo = 1;
+            }
+            else if(audioType && !haveAudio){
+                map->audioPID = es->elementaryPid;
+                map->audioType = audioType;
+                haveAudio = 1;
+            }
         }
-        
-        /*
-        switch(getTypeOfStreamType(pmt.stream[i].stream_type)){
+        map->radioFlag = !haveVideo;
+        return;
+    }
+
+    for(i=0; i<pmt->streamCounter; i++){
+        switch(getTypeOfStreamType(pmt->stream[i].stream_type)){
 
             case AUDIO_ST:
-                program_map[index].audioPID = pmt.stream[i].elementary_PID;
-                program_map[index].audioPID = getAudioType(pmt.stream[i].stream_type);
+                if(!haveAudio){
+                    map->audioPID = pmt->stream[i].elementary_PID;
+                    map->audioType = getAudioType(pmt->stream[i].stream_type);
+                    haveAudio = 1;
+                }
                 break;
             
             case VIDEO_ST:
-                program_map[index].videoPID = pmt.stream[i].elementary_PID;
-                program_map[index].audioType = getVideoType(pmt.stream[i].stream_type);
+                if(!haveVideo){
+                    map->videoPID = pmt->stream[i].elementary_PID;
+                    map->videoType = getVideoType(pmt->stream[i].stream_type);
+                    haveVideo = 1;
+                }
                 break;
             
             default:
-                printf("########\tstream_type %u ignored!!\n", pmt.stream[i].stream_type);
                 break;
         }
-        */
     }
+    map->radioFlag = !haveVideo;
    
 }
 
@@ -299,7 +418,7 @@ tStreamType getVideoType(int type){
 			ret =     VIDEO_TYPE_MPEG4 ;
 			break;
 		case  0x1B:
-			ret = VIDEO_TYPE_MPEG4 ;
+			ret = VIDEO_TYPE_H264 ;
 			break;
 		case  0x24:
 			ret = 0;
@@ -333,27 +452,10 @@ int getTypeOfStreamType(uint8_t type){
         returnValue = AUDIO_ST;
     }
 	else{
-		printf("\n#########\t%d je nista od navedneog############\n");
+		printf("\n#########\t%d je nista od navedneog############\n", type);
 	}
     //TODO
     //rest
     return returnValue;
 
 }
-
-// Print program map, function used for testing
-void Print_ProgramMap(){
-	int i;
-	int size;
-	size = pat.programCounter;
-	printf("\n\t\tPROGRAM_MAP:\n");
-	for(i=0; i<size; i++){
-		printf("\n\t\t\tProgram index:\t %d", i);
-		printf("\n\t\t\tAudioPID:\t %d", program_mapHC[i].audioPID);
-		printf("\n\t\t\tAudiotype:\t %d", program_mapHC[i].audioType);
-		printf("\n\t\t\tVideoPID:\t %d", program_mapHC[i].videoPID);
-		printf("\n\t\t\tVideoType:\t %d", program_mapHC[i].videoType);
-		printf("\n###############\n");
-	}
-
-}
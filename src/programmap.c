@@ -1,42 +1,165 @@
-/*
-#include"programmap.h"
-#include"globals.h"
-
-//TODO
-//return 
-//  0 - invalid type
-//  1 - audio type
-//  2 - video type
-//  3 - titlovi
-int getTypeOfStreamType(uint8_t type){
-    
-    int returnValue = 0;
-    //video
-    if(type == 0x01
-        || type == 0x02 
-        || type == 0x10
-        || type == 0x1b
-        || type == 0x24)
-    {
-        returnValue = VIDEO_ST;
-    }
-    //audio
-    else if(type == 0x03
-        || type == 0x04 
-        || type == 0x0F
-        || type == 0x83
-        || type == 0x84
-        || type == 0x85)
-    {
-        returnValue = AUDIO_ST;
-    }
+/****************************************************************************
+*
+* FERIT
+*
+* -----------------------------------------------------
+* Konstrukcijski zadatak kolegij: Digitalna videotehnika
+* -----------------------------------------------------
+*
+* programmap.c
+*
+* Purpose: Channel list used for playback, built from PMTs or loaded from PSI cache
+*
+* Made on 18.6.2020.
+*
+* @Author Luka Kruljac
+* @E-mail luka97kruljac@gmail.com
+*****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "programmap.h"
+#include "globals.h"
+
+#define HC_PROGRAM_COUNT	(sizeof(program_mapHC) / sizeof(program_mapHC[0]))
+
+static pthread_mutex_t programMapMutex = PTHREAD_MUTEX_INITIALIZER;
+static int programMapCount = 0;
+/* Retune left transport stream whose PSI is not here yet, hardcoded list belongs to first one */
+static int programMapPending = 0;
+
+void ProgramMap_Set(PROGRAM_MAP *map, int count){
+	PROGRAM_MAP *newMap;
+	PROGRAM_MAP *oldMap;
+
+	if(map == NULL || count <= 0){
+		return;
+	}
+	newMap = malloc(count * sizeof(PROGRAM_MAP));
+	if(newMap == NULL){
+		printf("ProgramMap_Set: out of memory\n");
+		return;
+	}
+	memcpy(newMap, map, count * sizeof(PROGRAM_MAP));
+
+	pthread_mutex_lock(&programMapMutex);
+	oldMap = program_map;
+	program_map = newMap;
+	programMapCount = count;
+	programMapPending = 0;
+	chanelStatus.endProgamNumber = count - 1;
+	if(chanelStatus.currentProgram > chanelStatus.endProgamNumber){
+		chanelStatus.currentProgram = chanelStatus.startProgramNumber;
+	}
+	pthread_mutex_unlock(&programMapMutex);
+
+	free(oldMap);
+}
+
+void ProgramMap_Clear(){
+	PROGRAM_MAP *oldMap;
+
+	pthread_mutex_lock(&programMapMutex);
+	oldMap = program_map;
+	program_map = NULL;
+	programMapCount = 0;
+	programMapPending = 1;
+	chanelStatus.currentProgram = chanelStatus.startProgramNumber;
+	chanelStatus.endProgamNumber = chanelStatus.startProgramNumber;
+	pthread_mutex_unlock(&programMapMutex);
+
+	free(oldMap);
+}
+
+int ProgramMap_Get(int chanell, PROGRAM_MAP *entry){
+	int result = -1;
+
+	pthread_mutex_lock(&programMapMutex);
+	if(program_map != NULL){
+		if(chanell >= 0 && chanell < programMapCount){
+			*entry = program_map[chanell];
+			result = 0;
+		}
+	}
+	else if(!programMapPending && chanell >= 0 && chanell < (int)HC_PROGRAM_COUNT){
+		*entry = program_mapHC[chanell];
+		result = 0;
+	}
+	pthread_mutex_unlock(&programMapMutex);
+
+	return result;
+}
+
+int ProgramMap_Count(){
+	int count;
+	pthread_mutex_lock(&programMapMutex);
+	if(program_map != NULL){
+		count = programMapCount;
+	}
 	else{
-		printf("\n#########\t%d je nista od navedneog############\n");
+		count = programMapPending ? 0 : (int)HC_PROGRAM_COUNT;
 	}
-    //TODO
-    //rest
-    return returnValue;
+	pthread_mutex_unlock(&programMapMutex);
+	return count;
+}
 
+int ProgramMap_Copy(PROGRAM_MAP *map, int maxCount){
+	int count;
+
+	pthread_mutex_lock(&programMapMutex);
+	if(program_map != NULL){
+		count = (programMapCount < maxCount) ? programMapCount : maxCount;
+		memcpy(map, program_map, count * sizeof(PROGRAM_MAP));
+	}
+	else if(programMapPending){
+		count = 0;
+	}
+	else{
+		count = ((int)HC_PROGRAM_COUNT < maxCount) ? (int)HC_PROGRAM_COUNT : maxCount;
+		memcpy(map, program_mapHC, count * sizeof(PROGRAM_MAP));
+	}
+	pthread_mutex_unlock(&programMapMutex);
+
+	return count;
 }
 
-*/
+int ProgramMap_Find(uint16_t programNumber){
+	int index = -1;
+	int i;
+
+	pthread_mutex_lock(&programMapMutex);
+	if(program_map != NULL){
+		for(i = 0; i < programMapCount; i++){
+			if(program_map[i].programNumber == programNumber){
+				index = i;
+				break;
+			}
+		}
+	}
+	pthread_mutex_unlock(&programMapMutex);
+
+	return index;
+}
+
+// Print program map, function used for testing
+void Print_ProgramMap(){
+	int i;
+	int size;
+	PROGRAM_MAP entry;
+	size = ProgramMap_Count();
+	printf("\n\t\tPROGRAM_MAP:\n");
+	for(i=0; i<size; i++){
+		if(ProgramMap_Get(i, &entry) != 0){
+			continue;
+		}
+		printf("\n\t\t\tProgram index:\t %d", i);
+		printf("\n\t\t\tProgram number:\t %d", entry.programNumber);
+		printf("\n\t\t\tAudioPID:\t %d", entry.audioPID);
+		printf("\n\t\t\tAudiotype:\t %d", entry.audioType);
+		printf("\n\t\t\tVideoPID:\t %d", entry.videoPID);
+		printf("\n\t\t\tVideoType:\t %d", entry.videoType);
+		printf("\n###############\n");
+	}
+
+}
@@ -0,0 +1,464 @@
+/****************************************************************************
+*
+* FERIT
+*
+* -----------------------------------------------------
+* Konstrukcijski zadatak kolegij: Digitalna videotehnika
+* -----------------------------------------------------
+*
+* psibench.c
+*
+* Purpose: Host benchmark and fuzzer of PAT and PMT parsers
+*
+* Made on 18.10.2026.
+*****************************************************************************/
+
+/*
+ * Usage: psibench [-fuzz iterations] [sections.bin]
+ *
+ * Every sample is parsed over and over and sections/s and ns/section are printed.
+ * Samples are PAT captured on board (PAT parsed.txt) and synthetic worst cases,
+ * longest PAT, PMT with most ES entries and PMT with longest descriptor loops.
+ * sections.bin holds recorded sections back to back, its PAT and PMT sections are measured too.
+ * With -fuzz, mutated samples go through PsiFuzz entries, build with -fsanitize=address for that.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include "pat.h"
+#include "pmt.h"
+#include "psifuzz.h"
+#include "crc32_mpeg2.h"
+
+#define BENCH_SECONDS			(0.25)
+#define BENCH_BATCH				(256)
+#define MAX_SAMPLES				(16)
+#define MAX_RECORDED_SECTIONS	(4096)
+
+typedef struct BENCH_SAMPLE{
+	const char *name;
+	uint8_t table;				// 0x00 PAT, 0x02 PMT
+	int count;					// sections in this sample
+	uint8_t **section;
+	uint32_t *length;
+}BENCH_SAMPLE;
+
+static BENCH_SAMPLE samples[MAX_SAMPLES];
+static int sampleCount = 0;
+
+/* PAT from PAT parsed.txt, transport stream 1008 version 17, CRC matches the printed one */
+static const uint16_t capturedPrograms[][2] = {
+	{0, 16}, {490, 100}, {491, 200}, {492, 1000}, {493, 1500}, {495, 2000}, {496, 2010}, {497, 2020}
+};
+#define CAPTURED_TSID		(1008)
+#define CAPTURED_VERSION	(17)
+#define CAPTURED_CRC		(0xAC4A9F7B)
+
+static double nowSeconds(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Start section with long syntax header, returns write position after it
+static int writeHeader(uint8_t *section, uint8_t tableId, uint16_t extension, uint8_t version){
+	section[0] = tableId;
+	section[3] = extension >> 8;
+	section[4] = extension & 0xFF;
+	section[5] = 0xC0 | ((version & 0x1F) << 1) | 0x01;
+	section[6] = 0;
+	section[7] = 0;
+	return 8;
+}
+
+// Fill section_length and CRC, position is where CRC goes, returns whole section length
+static uint32_t closeSection(uint8_t *section, int position){
+	uint32_t crc;
+	int sectionLength = position + 4 - 3;
+
+	section[1] = 0xB0 | ((sectionLength >> 8) & 0x0F);
+	section[2] = sectionLength & 0xFF;
+	crc = Crc32_Mpeg2(section, position);
+	section[position] = crc >> 24;
+	section[position + 1] = (crc >> 16) & 0xFF;
+	section[position + 2] = (crc >> 8) & 0xFF;
+	section[position + 3] = crc & 0xFF;
+	return position + 4;
+}
+
+static int addSample(const char *name, uint8_t table, int count){
+	BENCH_SAMPLE *sample;
+
+	if(sampleCount == MAX_SAMPLES){
+		return -1;
+	}
+	sample = &samples[sampleCount];
+	sample->section = calloc(count, sizeof(uint8_t*));
+	sample->length = calloc(count, sizeof(uint32_t));
+	if(sample->section == NULL || sample->length == NULL){
+		printf("psibench: out of memory\n");
+		free(sample->section);
+		free(sample->length);
+		return -1;
+	}
+	sample->name = name;
+	sample->table = table;
+	sample->count = count;
+	return sampleCount++;
+}
+
+// Own copy of section with exact size, so sanitizer sees its end
+static int setSection(BENCH_SAMPLE *sample, int index, const uint8_t *section, uint32_t length){
+	sample->section[index] = malloc(length);
+	if(sample->section[index] == NULL){
+		return -1;
+	}
+	memcpy(sample->section[index], section, length);
+	sample->length[index] = length;
+	return 0;
+}
+
+static void buildCapturedPat(){
+	uint8_t section[PAT_MAX_SECTION_LENGTH + 3];
+	uint32_t length;
+	int programs = sizeof(capturedPrograms) / sizeof(capturedPrograms[0]);
+	int position = writeHeader(section, 0x00, CAPTURED_TSID, CAPTURED_VERSION);
+	int index = addSample("PAT captured, 8 programs", 0x00, 1);
+	int i;
+
+	if(index < 0){
+		return;
+	}
+	for(i = 0; i < programs; i++){
+		section[position++] = capturedPrograms[i][0] >> 8;
+		section[position++] = capturedPrograms[i][0] & 0xFF;
+		section[position++] = 0xE0 | (capturedPrograms[i][1] >> 8);
+		section[position++] = capturedPrograms[i][1] & 0xFF;
+	}
+	length = closeSection(section, position);
+	if(Crc32_Mpeg2(section, length - 4) != CAPTURED_CRC){
+		printf("psibench: captured PAT does not match PAT parsed.txt\n");
+	}
+	setSection(&samples[index], 0, section, length);
+}
+
+static void buildLongestPat(){
+	uint8_t section[PAT_MAX_SECTION_LENGTH + 3];
+	int programs = (PAT_MAX_SECTION_LENGTH - PAT_MIN_SECTION_LENGTH) / 4;
+	int position = writeHeader(section, 0x00, 1, 0);
+	int index = addSample("PAT longest, 253 programs", 0x00, 1);
+	int i;
+
+	if(index < 0){
+		return;
+	}
+	for(i = 0; i < programs; i++){
+		section[position++] = (i + 1) >> 8;
+		section[position++] = (i + 1) & 0xFF;
+		section[position++] = 0xE0 | ((0x100 + i) >> 8);
+		section[position++] = (0x100 + i) & 0xFF;
+	}
+	setSection(&samples[index], 0, section, closeSection(section, position));
+}
+
+// PMT header up to program_info loop, returns write position
+static int writePmtHeader(uint8_t *section, uint16_t programNumber, uint16_t pcrPid){
+	int position = writeHeader(section, 0x02, programNumber, 1);
+
+	section[position++] = 0xE0 | (pcrPid >> 8);
+	section[position++] = pcrPid & 0xFF;
+	section[position++] = 0xF0;
+	section[position++] = 0x00;
+	return position;
+}
+
+static int writeStream(uint8_t *section, int position, uint8_t streamType, uint16_t pid, const uint8_t *info, int infoLength){
+	section[position++] = streamType;
+	section[position++] = 0xE0 | (pid >> 8);
+	section[position++] = pid & 0xFF;
+	section[position++] = 0xF0 | (infoLength >> 8);
+	section[position++] = infoLength & 0xFF;
+	if(infoLength > 0){
+		memcpy(&section[position], info, infoLength);
+	}
+	return position + infoLength;
+}
+
+// Video, two audio languages, AC-3, teletext and subtitles, as on air
+static void buildTypicalPmt(){
+	static const uint8_t audio[] = { 0x0A, 0x04, 'h', 'r', 'v', 0x00, 0x52, 0x01, 0x02 };
+	static const uint8_t audio2[] = { 0x0A, 0x04, 'e', 'n', 'g', 0x00 };
+	static const uint8_t ac3[] = { 0x6A, 0x02, 0x80, 0x44, 0x0A, 0x04, 'e', 'n', 'g', 0x00 };
+	static const uint8_t teletext[] = { 0x56, 0x0A, 'h', 'r', 'v', 0x09, 0x00, 'h', 'r', 'v', 0x11, 0x88 };
+	static const uint8_t subtitle[] = { 0x59, 0x08, 'h', 'r', 'v', 0x10, 0x00, 0x01, 0x00, 0x01 };
+	uint8_t section[PMT_MAX_SECTION_LENGTH + 3];
+	int position = writePmtHeader(section, 490, 101);
+	int index = addSample("PMT typical, 6 streams", 0x02, 1);
+
+	if(index < 0){
+		return;
+	}
+	position = writeStream(section, position, 0x1B, 101, NULL, 0);
+	position = writeStream(section, position, 0x03, 102, audio, sizeof(audio));
+	position = writeStream(section, position, 0x03, 103, audio2, sizeof(audio2));
+	position = writeStream(section, position, 0x06, 104, ac3, sizeof(ac3));
+	position = writeStream(section, position, 0x06, 105, teletext, sizeof(teletext));
+	position = writeStream(section, position, 0x06, 106, subtitle, sizeof(subtitle));
+	setSection(&samples[index], 0, section, closeSection(section, position));
+}
+
+// As many ES entries as section_length allows, no descriptors
+static void buildMostStreamsPmt(){
+	uint8_t section[PMT_MAX_SECTION_LENGTH + 3];
+	int position = writePmtHeader(section, 491, 0x100);
+	int streams = (PMT_MAX_SECTION_LENGTH - PMT_MIN_SECTION_LENGTH) / 5;
+	int index = addSample("PMT most streams, 201 ES", 0x02, 1);
+	int i;
+
+	if(index < 0){
+		return;
+	}
+	for(i = 0; i < streams; i++){
+		position = writeStream(section, position, (i & 1) ? 0x03 : 0x1B, 0x100 + i, NULL, 0);
+	}
+	setSection(&samples[index], 0, section, closeSection(section, position));
+}
+
+// Longest section, few streams with full ES_info loops of language, teletext and subtitle descriptors
+static void buildLongestDescriptorsPmt(){
+	uint8_t section[PMT_MAX_SECTION_LENGTH + 3];
+	uint8_t info[PMT_MAX_SECTION_LENGTH];
+	int position = writePmtHeader(section, 492, 0x200);
+	int index = addSample("PMT longest ES_info loops", 0x02, 1);
+	int stream;
+
+	if(index < 0){
+		return;
+	}
+	for(stream = 0; stream < 4; stream++){
+		int end = 3 + PMT_MAX_SECTION_LENGTH - 4;
+		int room = (end - position - 5) / (4 - stream);
+		int infoLength = 0;
+
+		/* Descriptors of 2 + 8 bytes until room of this stream is used */
+		while(infoLength + 10 <= room){
+			uint8_t tag = (stream == 1) ? DESCRIPTOR_TAG_TELETEXT : (stream == 2) ? DESCRIPTOR_TAG_SUBTITLING : DESCRIPTOR_TAG_ISO_639;
+			info[infoLength] = tag;
+			info[infoLength + 1] = 8;
+			memcpy(&info[infoLength + 2], "hrv\x01" "eng\x02", 8);
+			infoLength += 10;
+		}
+		position = writeStream(section, position, (stream == 0) ? 0x03 : 0x06, 0x200 + stream, info, infoLength);
+	}
+	setSection(&samples[index], 0, section, closeSection(section, position));
+}
+
+// Recorded PAT and PMT sections of file become two samples
+static int loadRecorded(const char *fileName){
+	static uint8_t section[4096 + 3];
+	FILE *file;
+	int patIndex, pmtIndex;
+	int total = 0;
+
+	file = fopen(fileName, "rb");
+	if(file == NULL){
+		printf("psibench: cannot open %s\n", fileName);
+		return -1;
+	}
+	patIndex = addSample("PAT recorded", 0x00, MAX_RECORDED_SECTIONS);
+	pmtIndex = addSample("PMT recorded", 0x02, MAX_RECORDED_SECTIONS);
+	if(patIndex < 0 || pmtIndex < 0){
+		fclose(file);
+		return -1;
+	}
+	samples[patIndex].count = 0;
+	samples[pmtIndex].count = 0;
+
+	while(fread(section, 1, 3, file) == 3){
+		uint32_t length = ((section[1] & 0x0F) << 8) | section[2];
+		BENCH_SAMPLE *sample;
+
+		if(fread(&section[3], 1, length, file) != length){
+			printf("psibench: truncated section %d\n", total);
+			break;
+		}
+		total++;
+		sample = (section[0] == 0x00) ? &samples[patIndex] : (section[0] == 0x02) ? &samples[pmtIndex] : NULL;
+		if(sample != NULL && sample->count < MAX_RECORDED_SECTIONS){
+			if(setSection(sample, sample->count, section, length + 3) == 0){
+				sample->count++;
+			}
+		}
+	}
+	fclose(file);
+	printf("Recorded sections: %d read, %d PAT, %d PMT\n", total, samples[patIndex].count, samples[pmtIndex].count);
+	return 0;
+}
+
+static int parseSection(BENCH_SAMPLE *sample, int index, PAT_TABLE *pat, PMT_TABLE *pmt){
+	if(sample->table == 0x00){
+		return parseBufferToPat(sample->section[index], sample->length[index], pat);
+	}
+	return parseBufferToPmt(sample->section[index], sample->length[index], pmt);
+}
+
+static void benchSample(BENCH_SAMPLE *sample, PAT_TABLE *pat, PMT_TABLE *pmt){
+	double start, elapsed;
+	uint32_t bytes = 0;
+	long sections = 0;
+	int broken = 0;
+	int i;
+
+	if(sample->count == 0){
+		return;
+	}
+	for(i = 0; i < sample->count; i++){
+		bytes += sample->length[i];
+		if(parseSection(sample, i, pat, pmt) < 0){
+			broken++;
+		}
+	}
+
+	start = nowSeconds();
+	do{
+		for(i = 0; i < BENCH_BATCH; i++){
+			parseSection(sample, (int)((sections + i) % sample->count), pat, pmt);
+		}
+		sections += BENCH_BATCH;
+		elapsed = nowSeconds() - start;
+	}while(elapsed < BENCH_SECONDS);
+
+	printf("%-28s %5u B %12.0f %10.1f", sample->name, bytes / sample->count, sections / elapsed, elapsed * 1e9 / sections);
+	if(broken){
+		printf("   %d broken", broken);
+	}
+	printf("\n");
+}
+
+// Flip, overwrite and cut samples, length fields get extreme values most often
+static void fuzzSamples(long iterations){
+	uint8_t input[PSI_FUZZ_MAX_SIZE];
+	int savedOut;
+	int nullOut;
+	long n;
+
+	/* Parsers report every broken section, keep that off the screen */
+	fflush(stdout);
+	savedOut = dup(STDOUT_FILENO);
+	nullOut = open("/dev/null", O_WRONLY);
+	if(savedOut >= 0 && nullOut >= 0){
+		dup2(nullOut, STDOUT_FILENO);
+	}
+
+	srand(1);
+	for(n = 0; n < iterations; n++){
+		BENCH_SAMPLE *sample = &samples[rand() % sampleCount];
+		int index;
+		uint32_t size;
+		int mutations = 1 + rand() % 4;
+		int m;
+
+		if(sample->count == 0){
+			continue;
+		}
+		index = rand() % sample->count;
+		size = sample->length[index];
+		memcpy(input, sample->section[index], size);
+
+		for(m = 0; m < mutations; m++){
+			switch(rand() % 5){
+				case 0:
+					input[rand() % size] ^= 1 << (rand() % 8);
+					break;
+				case 1:
+					input[rand() % size] = (uint8_t)rand();
+					break;
+				case 2:
+					/* section_length */
+					input[1] = (input[1] & 0xF0) | (rand() & 0x0F);
+					input[2] = (uint8_t)rand();
+					break;
+				case 3:
+					/* program_info_length or one of ES_info_length */
+					if(size > 12){
+						int position = (rand() & 1) ? 10 : 12 + rand() % (size - 12);
+						if(position + 1 < (int)size){
+							input[position] |= 0x0F;
+							input[position + 1] = (uint8_t)rand();
+						}
+					}
+					break;
+				default:
+					size = rand() % (size + 1);
+					break;
+			}
+			if(size == 0){
+				break;
+			}
+		}
+		PsiFuzz_Pat(input, size);
+		PsiFuzz_Pmt(input, size);
+	}
+
+	fflush(stdout);
+	if(savedOut >= 0 && nullOut >= 0){
+		dup2(savedOut, STDOUT_FILENO);
+	}
+	if(savedOut >= 0){
+		close(savedOut);
+	}
+	if(nullOut >= 0){
+		close(nullOut);
+	}
+	PsiFuzz_Free();
+	printf("Fuzz: %ld mutated sections through both parsers, no invariant broken\n", iterations);
+}
+
+int main(int argc, char **argv){
+	PAT_TABLE pat;
+	PMT_TABLE pmt;
+	long fuzzIterations = 0;
+	int i, j;
+
+	for(i = 1; i < argc; i++){
+		if(strcmp(argv[i], "-fuzz") == 0 && i + 1 < argc){
+			fuzzIterations = atol(argv[++i]);
+		}
+		else if(loadRecorded(argv[i]) != 0){
+			return 1;
+		}
+	}
+
+	Crc32_Mpeg2_Init();
+	buildCapturedPat();
+	buildLongestPat();
+	buildTypicalPmt();
+	buildMostStreamsPmt();
+	buildLongestDescriptorsPmt();
+
+	memset(&pat, 0, sizeof(pat));
+	memset(&pmt, 0, sizeof(pmt));
+	printf("\n%-28s %7s %12s %10s\n", "sample", "size", "sections/s", "ns/section");
+	for(i = 0; i < sampleCount; i++){
+		benchSample(&samples[i], &pat, &pmt);
+	}
+	PsiMem_Arena_Free(&pat.arena);
+	PsiMem_Arena_Free(&pmt.arena);
+
+	if(fuzzIterations > 0){
+		fuzzSamples(fuzzIterations);
+	}
+
+	for(i = 0; i < sampleCount; i++){
+		for(j = 0; j < samples[i].count; j++){
+			free(samples[i].section[j]);
+		}
+		free(samples[i].section);
+		free(samples[i].length);
+	}
+	return 0;
+}
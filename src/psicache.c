@@ -0,0 +1,313 @@
+/****************************************************************************
+*
+* FERIT
+*
+* -----------------------------------------------------
+* Konstrukcijski zadatak kolegij: Digitalna videotehnika
+* -----------------------------------------------------
+*
+* psicache.c
+*
+* Purpose: Persistent PAT/PMT channel cache, lets last chanell play right after tuner lock
+*
+* Made on 18.10.2026.
+*****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "psicache.h"
+#include "globals.h"
+#include "crc32_mpeg2.h"
+
+#define PSI_CACHE_FILE_MAX_SIZE	(PSI_CACHE_HEADER_SIZE + PSI_CACHE_MAX_PROGRAMS * PSI_CACHE_PROGRAM_SIZE + PSI_CACHE_CRC_SIZE)
+#define PSI_CACHE_FLAG_RADIO	(0x01)
+
+static pthread_mutex_t psiCacheMutex = PTHREAD_MUTEX_INITIALIZER;
+static PSI_CACHE psiCache;
+static int psiCacheValid = 0;
+
+static void put16(uint8_t *buffer, uint16_t value){
+	buffer[0] = value >> 8;
+	buffer[1] = value & 0xFF;
+}
+
+static void put32(uint8_t *buffer, uint32_t value){
+	buffer[0] = value >> 24;
+	buffer[1] = (value >> 16) & 0xFF;
+	buffer[2] = (value >> 8) & 0xFF;
+	buffer[3] = value & 0xFF;
+}
+
+static uint16_t get16(const uint8_t *buffer){
+	return (buffer[0] << 8) | buffer[1];
+}
+
+static uint32_t get32(const uint8_t *buffer){
+	return ((uint32_t)buffer[0] << 24) | (buffer[1] << 16) | (buffer[2] << 8) | buffer[3];
+}
+
+static const char *cacheFileName(){
+	return (config.cacheFile != NULL) ? config.cacheFile : PSI_CACHE_DEFAULT_FILE;
+}
+
+// Serialize cache to buffer, returns number of bytes written
+static int serializeCache(const PSI_CACHE *cache, uint8_t *buffer){
+	uint8_t *position;
+	uint32_t crc;
+	int i;
+
+	put32(&buffer[0], PSI_CACHE_MAGIC);
+	buffer[4] = PSI_CACHE_FORMAT;
+	buffer[5] = cache->patVersion;
+	put16(&buffer[6], cache->transportStreamId);
+	put32(&buffer[8], cache->frequency);
+	buffer[12] = cache->programCount;
+	buffer[13] = cache->lastChanell;
+	put16(&buffer[14], 0);
+
+	position = &buffer[PSI_CACHE_HEADER_SIZE];
+	for(i = 0; i < cache->programCount; i++){
+		const PROGRAM_MAP *program = &cache->program[i];
+		put16(&position[0], program->programNumber);
+		put16(&position[2], program->pmtPid);
+		position[4] = program->pmtVersion;
+		position[5] = program->radioFlag ? PSI_CACHE_FLAG_RADIO : 0;
+		put16(&position[6], program->videoPID);
+		put16(&position[8], program->audioPID);
+		position[10] = program->videoType;
+		position[11] = program->audioType;
+		position[12] = program->contentRank;
+		position[13] = 0;
+		position += PSI_CACHE_PROGRAM_SIZE;
+	}
+
+	crc = Crc32_Mpeg2(buffer, position - buffer);
+	put32(position, crc);
+	position += PSI_CACHE_CRC_SIZE;
+
+	return position - buffer;
+}
+
+// Parse cache file content, returns 0 when content is complete and CRC is correct
+static int deserializeCache(const uint8_t *buffer, int size, PSI_CACHE *cache){
+	const uint8_t *position;
+	int i;
+
+	if(size < PSI_CACHE_HEADER_SIZE + PSI_CACHE_CRC_SIZE){
+		return -1;
+	}
+	if(get32(&buffer[0]) != PSI_CACHE_MAGIC || buffer[4] != PSI_CACHE_FORMAT){
+		return -1;
+	}
+	cache->programCount = buffer[12];
+	if(cache->programCount > PSI_CACHE_MAX_PROGRAMS
+		|| size != PSI_CACHE_HEADER_SIZE + cache->programCount * PSI_CACHE_PROGRAM_SIZE + PSI_CACHE_CRC_SIZE){
+		return -1;
+	}
+	/* CRC over data followed by its CRC is zero */
+	if(Crc32_Mpeg2(buffer, size) != 0){
+		return -1;
+	}
+
+	cache->patVersion = buffer[5];
+	cache->transportStreamId = get16(&buffer[6]);
+	cache->frequency = get32(&buffer[8]);
+	cache->lastChanell = buffer[13];
+
+	position = &buffer[PSI_CACHE_HEADER_SIZE];
+	for(i = 0; i < cache->programCount; i++){
+		PROGRAM_MAP *program = &cache->program[i];
+		memset(program, 0, sizeof(PROGRAM_MAP));
+		program->programNumber = get16(&position[0]);
+		program->pmtPid = get16(&position[2]);
+		program->pmtVersion = position[4];
+		program->radioFlag = (position[5] & PSI_CACHE_FLAG_RADIO) ? 1 : 0;
+		program->videoPID = get16(&position[6]);
+		program->audioPID = get16(&position[8]);
+		program->videoType = position[10];
+		program->audioType = position[11];
+		program->contentRank = position[12];
+		position += PSI_CACHE_PROGRAM_SIZE;
+	}
+	if(cache->lastChanell >= cache->programCount){
+		cache->lastChanell = 0;
+	}
+
+	return 0;
+}
+
+// Write cache next to the old file and rename it over, a power cut leaves old or new file, never half of one
+static int saveCache(const PSI_CACHE *cache){
+	uint8_t buffer[PSI_CACHE_FILE_MAX_SIZE];
+	char tmpName[256];
+	FILE *file;
+	int size;
+
+	size = serializeCache(cache, buffer);
+	snprintf(tmpName, sizeof(tmpName), "%s.tmp", cacheFileName());
+
+	file = fopen(tmpName, "wb");
+	if(file == NULL){
+		printf("PSI cache: cannot open \"%s\" for writing\n", tmpName);
+		return -1;
+	}
+	if(fwrite(buffer, 1, size, file) != (size_t)size || fflush(file) != 0){
+		printf("PSI cache: write to \"%s\" failed\n", tmpName);
+		fclose(file);
+		remove(tmpName);
+		return -1;
+	}
+	fsync(fileno(file));
+	fclose(file);
+
+	if(rename(tmpName, cacheFileName()) != 0){
+		printf("PSI cache: cannot replace \"%s\"\n", cacheFileName());
+		remove(tmpName);
+		return -1;
+	}
+	return 0;
+}
+
+int PsiCache_Load(uint32_t frequency){
+	uint8_t buffer[PSI_CACHE_FILE_MAX_SIZE + 1];
+	PSI_CACHE cache;
+	FILE *file;
+	int size;
+
+	/* Cache in memory belongs to frequency tuned before, it is not valid for this one */
+	pthread_mutex_lock(&psiCacheMutex);
+	psiCacheValid = 0;
+	pthread_mutex_unlock(&psiCacheMutex);
+
+	file = fopen(cacheFileName(), "rb");
+	if(file == NULL){
+		printf("PSI cache: no cache file \"%s\", channel list comes from PSI\n", cacheFileName());
+		return -1;
+	}
+	size = fread(buffer, 1, sizeof(buffer), file);
+	fclose(file);
+
+	if(deserializeCache(buffer, size, &cache) != 0){
+		printf("PSI cache: \"%s\" is corrupted, ignored\n", cacheFileName());
+		return -1;
+	}
+	if(cache.frequency != frequency || cache.programCount == 0){
+		printf("PSI cache: cache is for %u Hz, tuning %u Hz, ignored\n", cache.frequency, frequency);
+		return -1;
+	}
+
+	pthread_mutex_lock(&psiCacheMutex);
+	psiCache = cache;
+	psiCacheValid = 1;
+	pthread_mutex_unlock(&psiCacheMutex);
+
+	ProgramMap_Set(cache.program, cache.programCount);
+	printf("PSI cache: %d programs of TS %u (PAT version %u), last chanell %d\n",
+		cache.programCount, cache.transportStreamId, cache.patVersion, cache.lastChanell);
+	return 0;
+}
+
+int PsiCache_Find_Program(uint16_t programNumber, PROGRAM_MAP *entry){
+	int result = -1;
+	int i;
+
+	pthread_mutex_lock(&psiCacheMutex);
+	if(psiCacheValid){
+		for(i = 0; i < psiCache.programCount; i++){
+			if(psiCache.program[i].programNumber == programNumber){
+				*entry = psiCache.program[i];
+				result = 0;
+				break;
+			}
+		}
+	}
+	pthread_mutex_unlock(&psiCacheMutex);
+
+	return result;
+}
+
+int PsiCache_Update(uint32_t frequency, PAT_TABLE *pat, PROGRAM_MAP *map, int count){
+	int changed = 0;
+	int result;
+	int i;
+
+	if(map == NULL || count <= 0){
+		return -1;
+	}
+	if(count > PSI_CACHE_MAX_PROGRAMS){
+		printf("PSI cache: %d programs, only first %d are cached\n", count, PSI_CACHE_MAX_PROGRAMS);
+		count = PSI_CACHE_MAX_PROGRAMS;
+	}
+
+	pthread_mutex_lock(&psiCacheMutex);
+	/* Tables are the same when the key is the same: frequency, TS id, PAT version and every PMT version */
+	if(!psiCacheValid
+		|| psiCache.frequency != frequency
+		|| psiCache.transportStreamId != pat->transport_stream_id
+		|| psiCache.patVersion != pat->version_number
+		|| psiCache.programCount != count){
+		changed = 1;
+	}
+	for(i = 0; i < count && !changed; i++){
+		if(psiCache.program[i].programNumber != map[i].programNumber
+			|| psiCache.program[i].pmtPid != map[i].pmtPid
+			|| psiCache.program[i].pmtVersion != map[i].pmtVersion){
+			changed = 1;
+		}
+	}
+
+	if(!changed){
+		pthread_mutex_unlock(&psiCacheMutex);
+		printf("PSI cache: tables unchanged, cache kept\n");
+		return 0;
+	}
+
+	if(!psiCacheValid){
+		psiCache.lastChanell = chanelStatus.currentProgram;
+	}
+	psiCache.frequency = frequency;
+	psiCache.transportStreamId = pat->transport_stream_id;
+	psiCache.patVersion = pat->version_number;
+	psiCache.programCount = count;
+	memcpy(psiCache.program, map, count * sizeof(PROGRAM_MAP));
+	if(psiCache.lastChanell >= count){
+		psiCache.lastChanell = 0;
+	}
+	psiCacheValid = 1;
+	result = saveCache(&psiCache);
+	pthread_mutex_unlock(&psiCacheMutex);
+
+	ProgramMap_Set(map, count);
+	printf("PSI cache: tables changed, cache %s\n", result == 0 ? "patched" : "not written");
+	return 1;
+}
+
+int PsiCache_Valid(){
+	int valid;
+	pthread_mutex_lock(&psiCacheMutex);
+	valid = psiCacheValid;
+	pthread_mutex_unlock(&psiCacheMutex);
+	return valid;
+}
+
+void PsiCache_Set_Last_Chanell(int chanell){
+	pthread_mutex_lock(&psiCacheMutex);
+	if(psiCacheValid && chanell != psiCache.lastChanell && chanell >= 0 && chanell < psiCache.programCount){
+		psiCache.lastChanell = chanell;
+		saveCache(&psiCache);
+	}
+	pthread_mutex_unlock(&psiCacheMutex);
+}
+
+int PsiCache_Last_Chanell(){
+	int chanell = 0;
+	pthread_mutex_lock(&psiCacheMutex);
+	if(psiCacheValid){
+		chanell = psiCache.lastChanell;
+	}
+	pthread_mutex_unlock(&psiCacheMutex);
+	return chanell;
+}
@@ -0,0 +1,136 @@
+/****************************************************************************
+*
+* FERIT
+*
+* -----------------------------------------------------
+* Konstrukcijski zadatak kolegij: Digitalna videotehnika
+* -----------------------------------------------------
+*
+* psifuzz.c
+*
+* Purpose: Fuzzing entry points of PAT and PMT parsers, host tools only
+*
+* Made on 18.10.2026.
+*****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pat.h"
+#include "pmt.h"
+#include "psifuzz.h"
+
+/* Tables live across inputs, reparse into used arena is tested too */
+static PAT_TABLE fuzzPat;
+static PMT_TABLE fuzzPmt;
+
+// Copy of input with nothing after it
+static uint8_t *copyInput(const uint8_t *data, size_t size){
+	uint8_t *copy = malloc(size > 0 ? size : 1);
+
+	if(copy != NULL && size > 0){
+		memcpy(copy, data, size);
+	}
+	return copy;
+}
+
+static void broken(const char *parser, const char *what){
+	fprintf(stderr, "PsiFuzz %s: %s\n", parser, what);
+	abort();
+}
+
+int PsiFuzz_Pat(const uint8_t *data, size_t size){
+	uint8_t *buffer;
+	int result;
+	int i;
+
+	if(size > PSI_FUZZ_MAX_SIZE){
+		return 0;
+	}
+	buffer = copyInput(data, size);
+	if(buffer == NULL){
+		return 0;
+	}
+
+	result = parseBufferToPat(buffer, (uint32_t)size, &fuzzPat);
+	if(result > 0){
+		if(PAT_HEADER_LENGTH + (size_t)result * 4 + 4 > size || result * 4 > fuzzPat.section_lenght){
+			broken("PAT", "program loop longer than section");
+		}
+		if(fuzzPat.program == NULL || fuzzPat.programCounter != result){
+			broken("PAT", "program list does not match result");
+		}
+		for(i = 0; i < result; i++){
+			if(fuzzPat.program[i].pid > 0x1FFF){
+				broken("PAT", "PID over 13 bits");
+			}
+		}
+	}
+	else if(fuzzPat.programCounter != 0){
+		broken("PAT", "broken section left programs");
+	}
+
+	free(buffer);
+	return 0;
+}
+
+int PsiFuzz_Pmt(const uint8_t *data, size_t size){
+	uint8_t *buffer;
+	int result;
+	int i;
+
+	if(size > PSI_FUZZ_MAX_SIZE){
+		return 0;
+	}
+	buffer = copyInput(data, size);
+	if(buffer == NULL){
+		return 0;
+	}
+
+	result = parseBufferToPmt(buffer, (uint32_t)size, &fuzzPmt);
+	if(result == 0){
+		if((size_t)fuzzPmt.section_lenght + 3 > size){
+			broken("PMT", "section longer than buffer accepted");
+		}
+		for(i = 0; i < fuzzPmt.streamCounter; i++){
+			if(fuzzPmt.stream[i].elementary_PID > 0x1FFF || fuzzPmt.stream[i].ES_info_lenght > fuzzPmt.section_lenght){
+				broken("PMT", "stream outside section");
+			}
+		}
+		/* Descriptor block walks same stream loop, counts must agree */
+		if(fuzzPmt.descriptor != NULL){
+			if(fuzzPmt.descriptor->esCount != fuzzPmt.streamCounter){
+				broken("PMT", "descriptor block and stream list differ");
+			}
+			for(i = 0; i < fuzzPmt.descriptor->esCount; i++){
+				PMT_ES_INFO *es = Descriptor_Es(fuzzPmt.descriptor, i);
+				if(es->elementaryPid != fuzzPmt.stream[i].elementary_PID){
+					broken("PMT", "descriptor block and stream list differ");
+				}
+			}
+		}
+	}
+	else if(fuzzPmt.streamCounter != 0 || fuzzPmt.stream != NULL || fuzzPmt.descriptor != NULL){
+		broken("PMT", "broken section left streams");
+	}
+
+	free(buffer);
+	return 0;
+}
+
+void PsiFuzz_Free(){
+	PsiMem_Arena_Free(&fuzzPat.arena);
+	PsiMem_Arena_Free(&fuzzPmt.arena);
+	memset(&fuzzPat, 0, sizeof(fuzzPat));
+	memset(&fuzzPmt, 0, sizeof(fuzzPmt));
+}
+
+#if defined(PSI_FUZZ_PAT)
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size){
+	return PsiFuzz_Pat(data, size);
+}
+#elif defined(PSI_FUZZ_PMT)
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size){
+	return PsiFuzz_Pmt(data, size);
+}
+#endif
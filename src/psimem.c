@@ -0,0 +1,116 @@
+/****************************************************************************
+*
+* FERIT
+*
+* -----------------------------------------------------
+* Konstrukcijski zadatak kolegij: Digitalna videotehnika
+* -----------------------------------------------------
+*
+* psimem.c
+*
+* Purpose: Per table arenas for parsed PSI and live byte counter of them
+*
+* Made on 18.10.2026.
+*****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "psimem.h"
+
+#define PSI_ARENA_ALIGN		(8)
+#define PSI_ARENA_GRANULE	(256)	/* capacity steps, small version changes do not regrow */
+
+static pthread_mutex_t psiMemMutex = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t liveBytes = 0;
+static uint32_t peakBytes = 0;
+static uint32_t liveArenas = 0;
+static uint32_t growCount = 0;
+
+static void countBytes(int32_t delta, int32_t arenas){
+	pthread_mutex_lock(&psiMemMutex);
+	liveBytes += delta;
+	liveArenas += arenas;
+	if(delta > 0){
+		growCount++;
+	}
+	if(liveBytes > peakBytes){
+		peakBytes = liveBytes;
+	}
+	pthread_mutex_unlock(&psiMemMutex);
+}
+
+void PsiMem_Arena_Init(PSI_ARENA *arena){
+	memset(arena, 0, sizeof(PSI_ARENA));
+}
+
+uint32_t PsiMem_Arena_Size(uint32_t size){
+	return (size + PSI_ARENA_ALIGN - 1) & ~(uint32_t)(PSI_ARENA_ALIGN - 1);
+}
+
+// Memory is replaced only when it has to grow, content is not kept since arena is reset anyway
+int PsiMem_Arena_Reserve(PSI_ARENA *arena, uint32_t size){
+	uint32_t capacity;
+	uint8_t *base;
+
+	arena->used = 0;
+	if(size <= arena->capacity){
+		return 0;
+	}
+
+	capacity = (size + PSI_ARENA_GRANULE - 1) & ~(uint32_t)(PSI_ARENA_GRANULE - 1);
+	base = malloc(capacity);
+	if(base == NULL){
+		printf("PsiMem_Arena_Reserve: out of memory for %u bytes\n", capacity);
+		return -1;
+	}
+	free(arena->base);
+	countBytes((int32_t)capacity - (int32_t)arena->capacity, arena->base == NULL ? 1 : 0);
+	arena->base = base;
+	arena->capacity = capacity;
+	return 0;
+}
+
+void *PsiMem_Arena_Alloc(PSI_ARENA *arena, uint32_t size){
+	void *memory;
+
+	if(size == 0){
+		return NULL;
+	}
+	size = PsiMem_Arena_Size(size);
+	if(arena->base == NULL || size > arena->capacity - arena->used){
+		printf("PsiMem_Arena_Alloc: %u bytes over reservation\n", size);
+		return NULL;
+	}
+	memory = arena->base + arena->used;
+	arena->used += size;
+	return memory;
+}
+
+void PsiMem_Arena_Reset(PSI_ARENA *arena){
+	arena->used = 0;
+}
+
+void PsiMem_Arena_Free(PSI_ARENA *arena){
+	if(arena->base != NULL){
+		countBytes(-(int32_t)arena->capacity, -1);
+	}
+	free(arena->base);
+	memset(arena, 0, sizeof(PSI_ARENA));
+}
+
+uint32_t PsiMem_Live_Bytes(){
+	uint32_t bytes;
+	pthread_mutex_lock(&psiMemMutex);
+	bytes = liveBytes;
+	pthread_mutex_unlock(&psiMemMutex);
+	return bytes;
+}
+
+void PsiMem_Print_Stats(){
+	pthread_mutex_lock(&psiMemMutex);
+	printf("\n\t\tPSI MEMORY:\n");
+	printf("\t\t\tlive %u bytes in %u arenas, peak %u bytes, %u grows\n", liveBytes, liveArenas, peakBytes, growCount);
+	pthread_mutex_unlock(&psiMemMutex);
+}
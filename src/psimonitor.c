@@ -0,0 +1,814 @@
+/****************************************************************************
+*
+* FERIT
+*
+* -----------------------------------------------------
+* Konstrukcijski zadatak kolegij: Digitalna videotehnika
+* -----------------------------------------------------
+*
+* psimonitor.c
+*
+* Purpose: Background PAT/PMT monitoring, changed tables are applied to channel list and player
+*
+* Made on 18.10.2026.
+*****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "psimonitor.h"
+#include "globals.h"
+#include "streamplayer.h"
+#include "programmap.h"
+#include "sdt.h"
+#include "nit.h"
+#include "channeldb.h"
+#include "eit.h"
+#include "epg.h"
+
+static pthread_t psiMonitorThread;
+static int psiMonitorRunning = 0;
+
+static pthread_mutex_t psiMonitorMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t psiMonitorCondition;
+static int psiMonitorConditionInit = 0;
+static int stopRequest = 0;
+static int chanellChanged = 0;
+static int eitPending = 0;
+
+static PSI_MONITOR_TABLE tables[PSI_MONITOR_TABLE_COUNT];
+static PSI_MONITOR_SECTION queue[PSI_MONITOR_QUEUE_SIZE];
+static int queueHead = 0;
+static int queueCount = 0;
+static uint32_t queueDropped = 0;
+
+/* Used only by monitor thread */
+static PSI_MONITOR_FETCH fetchList[PSI_CACHE_MAX_PROGRAMS];
+static int fetchCount = 0;
+/* Program to zap to once it is in channel list, 0 when there is none */
+static uint16_t wantedProgram = 0;
+
+/* Stream health counters at the last check, used only by monitor thread */
+static struct timespec healthDeadline;
+static uint32_t healthErrors[TS_MONITOR_INDICATOR_COUNT];
+static uint32_t healthPoolExhausted = 0;
+static uint32_t healthQueueDropped = 0;
+
+/* Tables parsed by monitor thread only, their arenas are reused on every change */
+static PAT_TABLE monitorPat;
+static PMT_TABLE monitorPmt;
+
+static const char *tableNames[PSI_MONITOR_TABLE_COUNT] = {
+	"PAT",
+	"PMT on air",
+	"PMT fetch",
+	"SDT",
+	"NIT",
+	"EIT"
+};
+
+static long elapsedMs(struct timespec *from, struct timespec *to){
+	return (to->tv_sec - from->tv_sec) * 1000 + (to->tv_nsec - from->tv_nsec) / 1000000;
+}
+
+static void addMs(struct timespec *time, long ms){
+	time->tv_sec += ms / 1000;
+	time->tv_nsec += (ms % 1000) * 1000000;
+	if(time->tv_nsec >= 1000000000){
+		time->tv_sec++;
+		time->tv_nsec -= 1000000000;
+	}
+}
+
+static uint32_t sectionCrc(uint8_t *buffer, uint32_t length){
+	return ((uint32_t)buffer[length - 4] << 24) | (buffer[length - 3] << 16) | (buffer[length - 2] << 8) | buffer[length - 1];
+}
+
+// Same section is already waiting in queue
+static int isQueued(PSI_MONITOR_TABLE *table, uint8_t *buffer, uint32_t length){
+	int i;
+	for(i = 0; i < queueCount; i++){
+		PSI_MONITOR_SECTION *queued = &queue[(queueHead + i) % PSI_MONITOR_QUEUE_SIZE];
+		if(queued->table == table && queued->generation == table->generation
+			&& queued->length == length && queued->buffer[6] == buffer[6]
+			&& sectionCrc(queued->buffer, queued->length) == sectionCrc(buffer, length)){
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// Classify section by table it belongs to, SDT and NIT carry many sub tables and have their own tracking
+static int checkSection(PSI_MONITOR_TABLE *table, uint8_t *buffer, uint32_t length){
+	if(table->type == PSI_MONITOR_TABLE_SDT){
+		return Sdt_Section_Check(buffer, length);
+	}
+	if(table->type == PSI_MONITOR_TABLE_NIT){
+		return Nit_Section_Check(buffer, length);
+	}
+	return Section_Table_Check(&table->assembler, buffer, length);
+}
+
+// Section callback of every monitored filter, runs on section dispatcher thread with section lock held
+// Repeats are dropped here by assembler check, new section is retained and handed to monitor thread
+static int32_t psiMonitorSectionCallback(uint32_t filterHandle, uint8_t *buffer, uint32_t length, void *user){
+	PSI_MONITOR_TABLE *table = (PSI_MONITOR_TABLE*)user;
+	int slot;
+
+	pthread_mutex_lock(&psiMonitorMutex);
+	table->sections++;
+	/* EIT is copied to its own queue, schedule flood holds neither demux buffers nor monitor queue */
+	if(table->type == PSI_MONITOR_TABLE_EIT){
+		if(table->filterHandle == filterHandle && Eit_Queue_Section(buffer, length) == SECTION_NEW){
+			eitPending = 1;
+			pthread_cond_signal(&psiMonitorCondition);
+		}
+		pthread_mutex_unlock(&psiMonitorMutex);
+		return 0;
+	}
+	if(table->filterHandle != filterHandle
+		|| checkSection(table, buffer, length) != SECTION_NEW
+		|| isQueued(table, buffer, length)){
+		pthread_mutex_unlock(&psiMonitorMutex);
+		return 0;
+	}
+
+	if(queueCount == PSI_MONITOR_QUEUE_SIZE || Demux_Section_Buffer_Retain(buffer) != NO_ERROR){
+		/* Section repeats, it is picked up again next time */
+		queueDropped++;
+		pthread_mutex_unlock(&psiMonitorMutex);
+		return 0;
+	}
+	slot = (queueHead + queueCount) % PSI_MONITOR_QUEUE_SIZE;
+	queue[slot].table = table;
+	queue[slot].generation = table->generation;
+	queue[slot].buffer = buffer;
+	queue[slot].length = length;
+	queueCount++;
+	pthread_cond_signal(&psiMonitorCondition);
+	pthread_mutex_unlock(&psiMonitorMutex);
+
+	return 0;
+}
+
+// Free table filter, sections already queued for it are dropped by generation check
+static void disarmTable(PSI_MONITOR_TABLE *table){
+	uint32_t handle;
+
+	pthread_mutex_lock(&psiMonitorMutex);
+	handle = table->filterHandle;
+	table->filterHandle = 0;
+	table->generation++;
+	pthread_mutex_unlock(&psiMonitorMutex);
+
+	/* Demux is never called under psiMonitorMutex, callback takes it under demux lock */
+	if(handle != 0){
+		Demux_Free_Filter(playerHandle, handle);
+	}
+}
+
+// Set filter from params and route its sections to table, table must be disarmed
+static int armFilter(PSI_MONITOR_TABLE *table, t_DemuxFilterParams *params){
+	uint32_t handle;
+
+	if(Demux_Set_Filter_Ex(playerHandle, params, &handle) != NO_ERROR){
+		printf("PSI monitor: no demux filter for %s pid %d\n", tableNames[table->type], params->PID);
+		return -1;
+	}
+	pthread_mutex_lock(&psiMonitorMutex);
+	table->filterHandle = handle;
+	pthread_mutex_unlock(&psiMonitorMutex);
+
+	if(Demux_Register_Filter_Callback(handle, psiMonitorSectionCallback, table) != NO_ERROR){
+		disarmTable(table);
+		return -1;
+	}
+	return 0;
+}
+
+// Set filter for table, knownVersion is -1 when version is not known
+// With known version demux passes only sections of other version, repeats never leave hardware
+static int armTable(PSI_MONITOR_TABLE *table, uint16_t pid, uint8_t tableId, uint16_t programNumber, int knownVersion){
+	t_DemuxFilterParams params;
+
+	disarmTable(table);
+
+	pthread_mutex_lock(&psiMonitorMutex);
+	table->pid = pid;
+	table->programNumber = programNumber;
+	Section_Table_Free(&table->assembler);
+	Section_Table_Init(&table->assembler, tableId, (tableId == 0x00) ? -1 : programNumber, knownVersion);
+	pthread_mutex_unlock(&psiMonitorMutex);
+
+	Demux_Filter_Params_Init(&params, pid, tableId);
+	if(tableId != 0x00){
+		Demux_Filter_Params_Extension(&params, programNumber);
+	}
+	if(knownVersion >= 0){
+		Demux_Filter_Params_Version_Changed(&params, knownVersion);
+	}
+	return armFilter(table, &params);
+}
+
+// SDT actual and other differ in one table_id bit, one filter takes both
+// Version is not filtered, every other transport stream has its own
+static int armSdt(PSI_MONITOR_TABLE *table){
+	t_DemuxFilterParams params;
+
+	disarmTable(table);
+	table->pid = SDT_PID;
+	Demux_Filter_Params_Init(&params, SDT_PID, SDT_TABLE_ACTUAL);
+	params.mask[DEMUX_FILTER_BYTE_TABLE_ID] = SDT_TABLE_MASK;
+	return armFilter(table, &params);
+}
+
+// NIT actual and other differ in lowest table_id bit
+static int armNit(PSI_MONITOR_TABLE *table){
+	t_DemuxFilterParams params;
+
+	disarmTable(table);
+	table->pid = NIT_PID;
+	Demux_Filter_Params_Init(&params, NIT_PID, NIT_TABLE_ACTUAL);
+	params.mask[DEMUX_FILTER_BYTE_TABLE_ID] = NIT_TABLE_MASK;
+	return armFilter(table, &params);
+}
+
+// One filter takes every table_id from 0x40 to 0x7F on EIT PID, p/f and all 32 schedule tables
+static int armEit(PSI_MONITOR_TABLE *table){
+	t_DemuxFilterParams params;
+
+	disarmTable(table);
+	table->pid = EIT_PID;
+	Demux_Filter_Params_Init(&params, EIT_PID, EIT_FILTER_MATCH);
+	params.mask[DEMUX_FILTER_BYTE_TABLE_ID] = EIT_FILTER_MASK;
+	return armFilter(table, &params);
+}
+
+// Table was parsed, filter is moved past the parsed version so demux wakes us only on the next change
+// Table that was moved or freed while it was processed is left alone
+static void rearmVersionFilter(PSI_MONITOR_TABLE *table){
+	if(table->filterHandle == 0 || !table->assembler.complete){
+		return;
+	}
+	armTable(table, table->pid, table->assembler.tableId, table->programNumber, table->assembler.knownVersion);
+}
+
+// Copy channel list built from PSI, hardcoded list does not count
+static int copyChannelList(PROGRAM_MAP *map){
+	int count = ProgramMap_Copy(map, PSI_CACHE_MAX_PROGRAMS);
+	if(count > 0 && map[0].programNumber == 0){
+		return 0;
+	}
+	return count;
+}
+
+static int findProgram(PROGRAM_MAP *map, int count, uint16_t programNumber){
+	int i;
+	for(i = 0; i < count; i++){
+		if(map[i].programNumber == programNumber){
+			return i;
+		}
+	}
+	return -1;
+}
+
+// Program number on air, 0 when it is not known
+static uint16_t onAirProgram(){
+	PROGRAM_MAP chanell;
+	if(ProgramMap_Get(chanelStatus.currentProgram, &chanell) != 0){
+		return 0;
+	}
+	return chanell.programNumber;
+}
+
+// Follow PMT of chanell on air
+static void armChanellPmt(){
+	PROGRAM_MAP chanell;
+
+	if(ProgramMap_Get(chanelStatus.currentProgram, &chanell) != 0 || chanell.pmtPid == 0){
+		/* Hardcoded list has no PMT PIDs, nothing to follow */
+		disarmTable(&tables[PSI_MONITOR_TABLE_PMT]);
+		return;
+	}
+	if(tables[PSI_MONITOR_TABLE_PMT].filterHandle != 0
+		&& tables[PSI_MONITOR_TABLE_PMT].pid == chanell.pmtPid
+		&& tables[PSI_MONITOR_TABLE_PMT].programNumber == chanell.programNumber){
+		return;
+	}
+	armTable(&tables[PSI_MONITOR_TABLE_PMT], chanell.pmtPid, 0x02, chanell.programNumber,
+		chanell.pmtVersion == PSI_VERSION_UNKNOWN ? -1 : chanell.pmtVersion);
+}
+
+// Wanted program goes to the front, it is the one user waits for
+static void queueFetch(uint16_t programNumber, uint16_t pid){
+	int i;
+	for(i = 0; i < fetchCount; i++){
+		if(fetchList[i].programNumber == programNumber){
+			fetchList[i].pid = pid;
+			return;
+		}
+	}
+	if(fetchCount == PSI_CACHE_MAX_PROGRAMS){
+		return;
+	}
+	if(programNumber == wantedProgram){
+		memmove(&fetchList[1], &fetchList[0], fetchCount * sizeof(PSI_MONITOR_FETCH));
+		i = 0;
+	}
+	fetchList[i].programNumber = programNumber;
+	fetchList[i].pid = pid;
+	fetchCount++;
+}
+
+static void removeFetch(uint16_t programNumber){
+	int i;
+	for(i = 0; i < fetchCount; i++){
+		if(fetchList[i].programNumber == programNumber){
+			memmove(&fetchList[i], &fetchList[i + 1], (fetchCount - i - 1) * sizeof(PSI_MONITOR_FETCH));
+			fetchCount--;
+			return;
+		}
+	}
+}
+
+// One PMT is fetched at a time on spare filter, it is given up after timeout
+static void checkFetch(){
+	PSI_MONITOR_TABLE *table = &tables[PSI_MONITOR_TABLE_FETCH];
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	if(table->filterHandle != 0){
+		if(elapsedMs(&table->deadline, &now) < 0){
+			return;
+		}
+		printf("PSI monitor: PMT of program %d not received, given up\n", table->programNumber);
+		removeFetch(table->programNumber);
+		disarmTable(table);
+	}
+	if(fetchCount > 0){
+		table->deadline = now;
+		addMs(&table->deadline, PSI_MONITOR_FETCH_TIMEOUT_MS);
+		/* On failure deadline is retry time */
+		armTable(table, fetchList[0].pid, 0x02, fetchList[0].programNumber, -1);
+	}
+}
+
+// Publish new channel list and patch cache, chanell on air keeps playing when its index moved
+static void publishChannelList(PROGRAM_MAP *map, int count){
+	uint16_t onAir = onAirProgram();
+	int changed;
+	int index;
+
+	changed = PsiCache_Update(chanelStatus.frequency, &pat, map, count);
+	/* After retune nothing is on air until wanted program is in the list, list loaded from cache may not change at all */
+	if(wantedProgram != 0){
+		index = ProgramMap_Find(wantedProgram);
+		if(index >= 0){
+			wantedProgram = 0;
+			chanelStatus.currentProgram = index;
+			changePlayStreamOnChanell(index);
+		}
+		return;
+	}
+	if(changed <= 0 || onAir == 0){
+		return;
+	}
+	index = ProgramMap_Find(onAir);
+	if(index >= 0){
+		chanelStatus.currentProgram = index;
+	}
+	else{
+		printf("PSI monitor: program %d on air was removed\n", onAir);
+		changePlayStreamOnChanell(chanelStatus.currentProgram);
+	}
+}
+
+static int inPat(PAT_TABLE *table, uint16_t programNumber){
+	int i;
+	for(i = 0; i < table->programCounter; i++){
+		if(table->program[i].program_number == programNumber){
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// Program to play when wanted one is gone, one with PMT in channel list plays at once, 0 when PAT is empty
+static uint16_t firstProgram(PAT_TABLE *table, PROGRAM_MAP *map, int count){
+	uint16_t first = 0;
+	int i;
+
+	for(i = 0; i < table->programCounter; i++){
+		if(table->program[i].program_number == 0){
+			continue;
+		}
+		if(findProgram(map, count, table->program[i].program_number) >= 0){
+			return table->program[i].program_number;
+		}
+		if(first == 0){
+			first = table->program[i].program_number;
+		}
+	}
+	return first;
+}
+
+// PAT changed, programs are added, removed or their PMT moved
+static void processPat(PSI_MONITOR_TABLE *table){
+	PROGRAM_MAP *map;
+	PROGRAM_MAP *newMap;
+	uint16_t onAir = onAirProgram();
+	int count;
+	int newCount = 0;
+	int index;
+	int i, j;
+
+	map = malloc(PSI_CACHE_MAX_PROGRAMS * sizeof(PROGRAM_MAP));
+	newMap = malloc(PSI_CACHE_MAX_PROGRAMS * sizeof(PROGRAM_MAP));
+	if(map == NULL || newMap == NULL){
+		free(map);
+		free(newMap);
+		return;
+	}
+
+	parseTableToPat(&table->assembler, &monitorPat);
+	count = copyChannelList(map);
+	printf("\nPSI monitor: PAT version %d -> %d\n", pat.version_number, monitorPat.version_number);
+	/* Wanted program is picked before fetches are queued, it has to go first */
+	if(wantedProgram != 0 && !inPat(&monitorPat, wantedProgram)){
+		printf("PSI monitor: wanted program %d is not in PAT", wantedProgram);
+		wantedProgram = firstProgram(&monitorPat, map, count);
+		printf(", program %d instead\n", wantedProgram);
+	}
+
+	for(i = 0; i < monitorPat.programCounter && newCount < PSI_CACHE_MAX_PROGRAMS; i++){
+		PROGRAM *program = &monitorPat.program[i];
+
+		if(program->program_number == 0){
+			continue;
+		}
+		index = findProgram(map, count, program->program_number);
+		if(index < 0){
+			printf("PSI monitor: program %d added, PMT pid %d\n", program->program_number, program->pid);
+			queueFetch(program->program_number, program->pid);
+			continue;
+		}
+		newMap[newCount] = map[index];
+		if(map[index].pmtPid != program->pid){
+			printf("PSI monitor: program %d PMT moved %d -> %d\n", program->program_number, map[index].pmtPid, program->pid);
+			newMap[newCount].pmtPid = program->pid;
+			newMap[newCount].pmtVersion = PSI_VERSION_UNKNOWN;
+			/* PMT filter of chanell on air follows the move by itself */
+			if(program->program_number != onAir){
+				queueFetch(program->program_number, program->pid);
+			}
+		}
+		newCount++;
+	}
+	for(i = 0; i < count; i++){
+		for(j = 0; j < monitorPat.programCounter; j++){
+			if(monitorPat.program[j].program_number == map[i].programNumber){
+				break;
+			}
+		}
+		if(j == monitorPat.programCounter){
+			printf("PSI monitor: program %d removed\n", map[i].programNumber);
+			removeFetch(map[i].programNumber);
+		}
+	}
+
+	/* New PAT goes live, arena of old one is parse target of next change */
+	Pat_Swap(&monitorPat);
+	publishChannelList(newMap, newCount);
+	armChanellPmt();
+
+	free(map);
+	free(newMap);
+}
+
+// PMT changed, channel list entry is replaced and chanell on air gets only streams that differ
+static void processPmt(PSI_MONITOR_TABLE *table){
+	PROGRAM_MAP fresh;
+	PROGRAM_MAP *map;
+	uint8_t *buffer;
+	uint32_t length;
+	int count;
+	int index;
+
+	map = malloc(PSI_CACHE_MAX_PROGRAMS * sizeof(PROGRAM_MAP));
+	if(map == NULL){
+		return;
+	}
+
+	memset(&fresh, 0, sizeof(PROGRAM_MAP));
+	/* PMT of one program is always carried in section 0 */
+	buffer = Section_Table_Get(&table->assembler, 0, &length);
+	if(parseBufferToPmt(buffer, length, &monitorPmt) != 0){
+		free(map);
+		return;
+	}
+	PMT_to_ProgramMap(&monitorPmt, &fresh);
+	fresh.pmtPid = table->pid;
+
+	count = copyChannelList(map);
+	index = findProgram(map, count, fresh.programNumber);
+	if(index >= 0){
+		PROGRAM_MAP *old = &map[index];
+		printf("\nPSI monitor: program %d PMT version %d -> %d", fresh.programNumber, old->pmtVersion, fresh.pmtVersion);
+		if(old->videoPID != fresh.videoPID || old->videoType != fresh.videoType){
+			printf(", video %d -> %d", old->videoPID, fresh.videoPID);
+		}
+		if(old->audioPID != fresh.audioPID || old->audioType != fresh.audioType){
+			printf(", audio %d -> %d", old->audioPID, fresh.audioPID);
+		}
+		printf("\n");
+		fresh.contentRank = old->contentRank;
+		map[index] = fresh;
+	}
+	else if(count < PSI_CACHE_MAX_PROGRAMS){
+		printf("\nPSI monitor: program %d PMT version %d fetched\n", fresh.programNumber, fresh.pmtVersion);
+		map[count++] = fresh;
+	}
+
+	if(table->type == PSI_MONITOR_TABLE_PMT){
+		updatePlayStreamOnChanell(&fresh);
+	}
+	publishChannelList(map, count);
+
+	if(table->type == PSI_MONITOR_TABLE_FETCH){
+		removeFetch(fresh.programNumber);
+		disarmTable(table);
+	}
+	free(map);
+}
+
+// Take current counters as baseline, errors before this point are not reported again
+static void resetHealth(){
+	t_TsMonitorReport report;
+	t_SectionPoolStats poolStats;
+
+	memset(&report, 0, sizeof(report));
+	memset(&poolStats, 0, sizeof(poolStats));
+	Demux_Get_Stream_Health(&report);
+	Demux_Get_Section_Pool_Stats(&poolStats);
+	memcpy(healthErrors, report.total, sizeof(healthErrors));
+	healthPoolExhausted = poolStats.exhausted;
+	healthQueueDropped = 0;
+	clock_gettime(CLOCK_MONOTONIC, &healthDeadline);
+	addMs(&healthDeadline, PSI_MONITOR_HEALTH_PERIOD_MS);
+}
+
+// Print stream errors since last check next to sections the box itself lost,
+// so broadcaster faults can be told apart from a receiver that cannot keep up
+static void checkHealth(){
+	t_TsMonitorReport report;
+	t_SectionPoolStats poolStats;
+	struct timespec now;
+	uint32_t dropped;
+	uint32_t errors;
+	int i;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	if(elapsedMs(&healthDeadline, &now) < 0){
+		return;
+	}
+	healthDeadline = now;
+	addMs(&healthDeadline, PSI_MONITOR_HEALTH_PERIOD_MS);
+
+	if(Demux_Get_Stream_Health(&report) != NO_ERROR || Demux_Get_Section_Pool_Stats(&poolStats) != NO_ERROR){
+		return;
+	}
+	for(i = 0; i < TS_MONITOR_INDICATOR_COUNT; i++){
+		errors = report.total[i] - healthErrors[i];
+		if(errors > 0){
+			printf("\nPSI monitor: stream %s +%u, %u in last %d s\n", Ts_Monitor_Indicator_Name(i), errors,
+				report.window[i], TS_MONITOR_WINDOW_SECONDS);
+		}
+		healthErrors[i] = report.total[i];
+	}
+
+	pthread_mutex_lock(&psiMonitorMutex);
+	dropped = queueDropped;
+	pthread_mutex_unlock(&psiMonitorMutex);
+	if(poolStats.exhausted != healthPoolExhausted || dropped != healthQueueDropped){
+		printf("\nPSI monitor: receiver dropped %u sections (pool exhausted), %u sections (queue full)\n",
+			poolStats.exhausted - healthPoolExhausted, dropped - healthQueueDropped);
+	}
+	healthPoolExhausted = poolStats.exhausted;
+	healthQueueDropped = dropped;
+}
+
+// Main function of PSI monitor thread
+static void *psiMonitorMain(){
+	PSI_MONITOR_SECTION section;
+	struct timespec wakeUp;
+	int haveSection;
+	int parseEit;
+	int rearm;
+	int stop;
+	int result;
+
+	/* PAT is not known after retune, every version is new */
+	armTable(&tables[PSI_MONITOR_TABLE_PAT], 0x0000, 0x00, 0, pat.programCounter > 0 ? pat.version_number : -1);
+	armChanellPmt();
+	armSdt(&tables[PSI_MONITOR_TABLE_SDT]);
+	armNit(&tables[PSI_MONITOR_TABLE_NIT]);
+	armEit(&tables[PSI_MONITOR_TABLE_EIT]);
+	resetHealth();
+
+	for(;;){
+		pthread_mutex_lock(&psiMonitorMutex);
+		while(!stopRequest && !chanellChanged && queueCount == 0 && !eitPending){
+			/* Wake up for health check or for fetch timeout, whichever comes first */
+			wakeUp = healthDeadline;
+			if(fetchCount > 0 && elapsedMs(&tables[PSI_MONITOR_TABLE_FETCH].deadline, &wakeUp) > 0){
+				wakeUp = tables[PSI_MONITOR_TABLE_FETCH].deadline;
+			}
+			if(pthread_cond_timedwait(&psiMonitorCondition, &psiMonitorMutex, &wakeUp) != 0){
+				break;
+			}
+		}
+		stop = stopRequest;
+		rearm = chanellChanged;
+		chanellChanged = 0;
+		parseEit = eitPending;
+		eitPending = 0;
+		haveSection = (queueCount > 0);
+		if(haveSection){
+			section = queue[queueHead];
+			queueHead = (queueHead + 1) % PSI_MONITOR_QUEUE_SIZE;
+			queueCount--;
+		}
+		pthread_mutex_unlock(&psiMonitorMutex);
+
+		if(stop){
+			if(haveSection){
+				Demux_Section_Buffer_Release(section.buffer);
+			}
+			break;
+		}
+		if(rearm){
+			armChanellPmt();
+		}
+		if(parseEit){
+			/* Sections queued while this runs set eitPending again */
+			result = Eit_Process_Queue();
+			pthread_mutex_lock(&psiMonitorMutex);
+			tables[PSI_MONITOR_TABLE_EIT].changes += result;
+			pthread_mutex_unlock(&psiMonitorMutex);
+		}
+		/* Generation is changed only by this thread */
+		if(haveSection && section.generation == section.table->generation && section.table->type == PSI_MONITOR_TABLE_SDT){
+			/* Services are parsed once per sub table version, banner reads them from sdt module */
+			if(Sdt_Add_Section(section.buffer, section.length) == SECTION_COMPLETE){
+				pthread_mutex_lock(&psiMonitorMutex);
+				section.table->changes++;
+				pthread_mutex_unlock(&psiMonitorMutex);
+			}
+		}
+		else if(haveSection && section.generation == section.table->generation && section.table->type == PSI_MONITOR_TABLE_NIT){
+			/* Channel database is rebuilt once per complete sub table, zapping reads it */
+			if(Nit_Add_Section(section.buffer, section.length) == SECTION_COMPLETE){
+				pthread_mutex_lock(&psiMonitorMutex);
+				section.table->changes++;
+				pthread_mutex_unlock(&psiMonitorMutex);
+				printf("\nPSI monitor: NIT changed, %d chanells in database\n", ChannelDb_Rebuild());
+			}
+		}
+		else if(haveSection && section.generation == section.table->generation){
+			pthread_mutex_lock(&psiMonitorMutex);
+			result = Section_Table_Add(&section.table->assembler, section.buffer, section.length);
+			if(result == SECTION_COMPLETE){
+				section.table->changes++;
+			}
+			pthread_mutex_unlock(&psiMonitorMutex);
+
+			/* Table is parsed once per version, callback only reads assembler */
+			if(result == SECTION_COMPLETE && section.table->type == PSI_MONITOR_TABLE_PAT){
+				processPat(section.table);
+			}
+			else if(result == SECTION_COMPLETE){
+				processPmt(section.table);
+			}
+			if(result == SECTION_COMPLETE){
+				rearmVersionFilter(section.table);
+			}
+		}
+		if(haveSection){
+			Demux_Section_Buffer_Release(section.buffer);
+		}
+		checkFetch();
+		checkHealth();
+	}
+
+	for(stop = 0; stop < PSI_MONITOR_TABLE_COUNT; stop++){
+		disarmTable(&tables[stop]);
+		Section_Table_Free(&tables[stop].assembler);
+	}
+	/* Queued EIT sections are already marked as seen, they would not come again */
+	Eit_Process_Queue();
+	pthread_mutex_lock(&psiMonitorMutex);
+	while(queueCount > 0){
+		Demux_Section_Buffer_Release(queue[queueHead].buffer);
+		queueHead = (queueHead + 1) % PSI_MONITOR_QUEUE_SIZE;
+		queueCount--;
+	}
+	pthread_mutex_unlock(&psiMonitorMutex);
+
+	return NULL;
+}
+
+int PsiMonitor_Start(){
+	int i;
+
+	if(psiMonitorRunning){
+		return 0;
+	}
+	if(!psiMonitorConditionInit){
+		pthread_condattr_t attr;
+		pthread_condattr_init(&attr);
+		pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+		pthread_cond_init(&psiMonitorCondition, &attr);
+		pthread_condattr_destroy(&attr);
+		psiMonitorConditionInit = 1;
+	}
+
+	memset(tables, 0, sizeof(tables));
+	for(i = 0; i < PSI_MONITOR_TABLE_COUNT; i++){
+		tables[i].type = i;
+	}
+	queueHead = 0;
+	queueCount = 0;
+	queueDropped = 0;
+	fetchCount = 0;
+	stopRequest = 0;
+	chanellChanged = 0;
+	eitPending = 0;
+
+	if(pthread_create(&psiMonitorThread, NULL, psiMonitorMain, NULL) != 0){
+		printf("PSI monitor: thread not started\n");
+		return -1;
+	}
+	psiMonitorRunning = 1;
+	return 0;
+}
+
+void PsiMonitor_Stop(){
+	if(!psiMonitorRunning){
+		return;
+	}
+	pthread_mutex_lock(&psiMonitorMutex);
+	stopRequest = 1;
+	pthread_cond_signal(&psiMonitorCondition);
+	pthread_mutex_unlock(&psiMonitorMutex);
+
+	pthread_join(psiMonitorThread, NULL);
+	psiMonitorRunning = 0;
+	PsiMem_Arena_Free(&monitorPat.arena);
+	PsiMem_Arena_Free(&monitorPmt.arena);
+	PsiMonitor_Print_Stats();
+	Epg_Print_Stats();
+}
+
+void PsiMonitor_Chanell_Changed(){
+	pthread_mutex_lock(&psiMonitorMutex);
+	chanellChanged = 1;
+	pthread_cond_signal(&psiMonitorCondition);
+	pthread_mutex_unlock(&psiMonitorMutex);
+}
+
+void PsiMonitor_Want_Program(uint16_t programNumber){
+	wantedProgram = programNumber;
+}
+
+void PsiMonitor_Print_Stats(){
+	int i;
+
+	pthread_mutex_lock(&psiMonitorMutex);
+	printf("\n\t\tPSI MONITOR:\n");
+	for(i = 0; i < PSI_MONITOR_TABLE_COUNT; i++){
+		if(i == PSI_MONITOR_TABLE_SDT){
+			printf("\t\t\t%-12s sections %u, sub tables parsed %u, services %d\n", tableNames[i], tables[i].sections,
+				tables[i].changes, Sdt_Service_Count());
+			continue;
+		}
+		if(i == PSI_MONITOR_TABLE_EIT){
+			EIT_STATS eit;
+			Eit_Get_Stats(&eit);
+			printf("\t\t\t%-12s sections %u, queued %u, repeats %u, queue full %u, parsed %u, events %u\n",
+				tableNames[i], tables[i].sections, eit.queued, eit.repeats, eit.dropped, eit.parsed, eit.events);
+			printf("\t\t\t%-12s %d sub tables, queue high-water %u of %u bytes\n", "", eit.subtables,
+				eit.queueHighWater, EIT_QUEUE_BYTES);
+			continue;
+		}
+		if(i == PSI_MONITOR_TABLE_NIT){
+			printf("\t\t\t%-12s sections %u, sub tables parsed %u, chanells %d\n", tableNames[i], tables[i].sections,
+				tables[i].changes, ChannelDb_Count());
+			continue;
+		}
+		printf("\t\t\t%-12s sections %u, new %u, parsed %u\n", tableNames[i], tables[i].sections,
+			tables[i].assembler.sections, tables[i].changes);
+	}
+	printf("\t\t\tdropped (queue full) %u\n", queueDropped);
+	pthread_mutex_unlock(&psiMonitorMutex);
+}
@@ -0,0 +1,327 @@
+/****************************************************************************
+*
+* FERIT
+*
+* -----------------------------------------------------
+* Konstrukcijski zadatak kolegij: Digitalna videotehnika
+* -----------------------------------------------------
+*
+* psiparse.c
+*
+* Purpose: Parsing PAT and PMT sections, no demux or board calls so host tools can link it
+*
+* Made on 18.10.2026.
+*****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "pat.h"
+#include "pmt.h"
+
+/*
+ * Parsers never read past length bytes of buffer.
+ * section_length is checked against length before anything after header is read,
+ * program_info_length and every ES_info_length must end before CRC of section.
+ */
+
+// Section length of PAT, 0 when it is broken or longer than buffer
+static int patSectionLength(const uint8_t *buffer, uint32_t length){
+	int sectionLenght;
+
+	if(buffer == NULL || length < PAT_HEADER_LENGTH + 4){
+		return 0;
+	}
+	sectionLenght = ((buffer[1] & 0b00001111) << 8) + buffer[2];
+	if(sectionLenght < PAT_MIN_SECTION_LENGTH || sectionLenght > PAT_MAX_SECTION_LENGTH || (uint32_t)sectionLenght + 3 > length){
+		return 0;
+	}
+	return sectionLenght;
+}
+
+// Number of programs PAT section carries, 0 when section length is broken
+static int programsInSection(const uint8_t *buffer, uint32_t length){
+	int sectionLenght = patSectionLength(buffer, length);
+	if(sectionLenght == 0){
+		return 0;
+	}
+	return (sectionLenght - PAT_MIN_SECTION_LENGTH) / 4;
+}
+
+// Parse header of one section to pat and its programs to program list, returns number of programs or -1
+static int parseSectionToPat(const uint8_t *buffer, uint32_t length, PAT_TABLE *pat, PROGRAM *program) {
+	int sectionLenght = patSectionLength(buffer, length);
+	int crcPosition;
+
+	pat->programCounter = 0;
+	if(sectionLenght == 0){
+		return -1;
+	}
+	pat->table_id = buffer[0];
+
+	pat->section_syntax_indicator = (buffer[1] & 0b10000000) >> 7;
+
+	pat->reserved10 = (buffer[1] & 0b00110000) >> 4;
+
+	pat->section_lenght = sectionLenght;
+
+	pat->transport_stream_id = buffer[3];
+	pat->transport_stream_id <<= 8;
+	pat->transport_stream_id += buffer[4];
+
+
+	pat->reserved40 = (buffer[5] & 0b11000000) >> 6;
+
+	pat->version_number = (buffer[5] & 0b00111110) >> 1;
+
+	pat->current_next_indicator = (buffer[5] & 0b00000001);
+
+	pat->section_number = buffer[6];
+
+	pat->last_section_number = buffer[7];
+
+	pat->programCounter = (program != NULL) ? programsInSection(buffer, length) : 0;
+
+	int i;
+	for (i = 0; i < pat->programCounter; i++) {
+		program[i].program_number = buffer[8+(i*4)];
+		program[i].program_number <<= 8;
+		program[i].program_number += buffer[9+(i*4)];
+
+		program[i].reserved = (buffer[10 + (i*4)] & 0b11100000) >> 5;
+
+		program[i].pid = buffer[10 + (i*4)];
+		program[i].pid <<=8;
+		program[i].pid += buffer[11+(i*4)];
+		program[i].pid = (program[i].pid & 0x1FFF);
+	}
+
+	/* CRC closes section, program loop can leave bytes before it when length is not 9 + 4n */
+	crcPosition = 3 + sectionLenght - 4;
+	pat->CRC_32 = (uint32_t)buffer[crcPosition] << 24;
+	pat->CRC_32 += (buffer[crcPosition + 1] << 16);
+	pat->CRC_32 += (buffer[crcPosition + 2] << 8);
+	pat->CRC_32 += (buffer[crcPosition + 3]);
+
+	return pat->programCounter;
+}
+
+// Parse all sections of complete PAT, programs of every section are joined in one list
+// Whole list is one reservation of table arena, reparse reuses its memory
+void parseTableToPat(SECTION_TABLE *table, PAT_TABLE *pat){
+	PAT_TABLE part;
+	PROGRAM *program = NULL;
+	uint8_t *buffer;
+	uint32_t length;
+	int total = 0;
+	int count = 0;
+	int result;
+	int i;
+
+	for(i = 0; i < Section_Table_Count(table); i++){
+		buffer = Section_Table_Get(table, i, &length);
+		total += programsInSection(buffer, length);
+	}
+	if(PsiMem_Arena_Reserve(&pat->arena, total * sizeof(PROGRAM)) == 0){
+		program = PsiMem_Arena_Alloc(&pat->arena, total * sizeof(PROGRAM));
+	}
+
+	for(i = 0; i < Section_Table_Count(table); i++){
+		buffer = Section_Table_Get(table, i, &length);
+		result = parseSectionToPat(buffer, length, (i == 0) ? pat : &part, (program != NULL) ? &program[count] : NULL);
+		if(result > 0){
+			count += result;
+		}
+	}
+	pat->program = program;
+	pat->programCounter = count;
+}
+
+// Parse one section to pat, program list goes to table arena
+int parseBufferToPat(uint8_t *buffer, uint32_t length, PAT_TABLE *pat) {
+	PROGRAM *program = NULL;
+	int count = programsInSection(buffer, length);
+	int result;
+
+	if(PsiMem_Arena_Reserve(&pat->arena, count * sizeof(PROGRAM)) == 0){
+		program = PsiMem_Arena_Alloc(&pat->arena, count * sizeof(PROGRAM));
+	}
+	result = parseSectionToPat(buffer, length, pat, program);
+	pat->program = program;
+	return result;
+}
+
+
+void printPatTable(PAT_TABLE *pat){
+
+	printf("\nPAT_TABLE:\n");
+	printf("\n\tTable_id: %d", pat->table_id);
+	printf("\n\tSection syntax indicator: %d", pat->section_syntax_indicator);
+	printf("\n\tReserved10: %d", pat->reserved10);
+	printf("\n\tSection Lenght: %d", pat->section_lenght);
+	printf("\n\tTransport stream ID: %d", pat->transport_stream_id);
+	printf("\n\tReserved40: %d", pat->reserved40);
+	printf("\n\tVersion number: %d", pat->version_number);
+	printf("\n\tCurrent next indicator: %d", pat->current_next_indicator);
+	printf("\n\tSection number: %d", pat->section_number);
+	printf("\n\tLast section number: %d", pat->last_section_number);
+	printf("\n\tCRC: %d", pat->CRC_32);
+	int i;
+	for (i = 0; i < pat->programCounter; i++) {
+		printf("\n\t\t Program on index: %d", i);
+		printf("\n\t\t\tProgram number: %d", pat->program[i].program_number);
+		printf("\n\t\t\tReserved: %d", pat->program[i].reserved);
+		printf("\n\t\t\tPID: %d", pat->program[i].pid);
+	}
+
+	printf("\nEnd of PAT table\n");
+}
+
+// Printing parsed data for testing
+void printPmtTable(PMT_TABLE *pmt){
+    printf("\nPMT:\n");
+    printf("Table id:\t%d\n", pmt->table_id);
+    printf("Section syntax indicator:\t%d\n", pmt->section_syntax_indicator);
+    printf("Reserved1:\t%d\n", pmt->reserved1);
+    printf("Section lenght:\t%d\n", pmt->section_lenght);
+    printf("Program number:\t%d\n", pmt->program_number);
+    printf("Reserved2:\t%d\n", pmt->reserved2);
+    printf("Version number:\t%d\n", pmt->version_number);
+    printf("Current next indicator:\t%d\n", pmt->current_next_indicator);
+    printf("Section number\t%d\n", pmt->section_number);
+    printf("Last section number:\t%d\n", pmt->last_section_number);
+    printf("Reserved3:\t%d\n", pmt->reserved3);
+    printf("PCR PID:\t%d\n", pmt->PCR_PID);
+    printf("Reserved4:\t%d\n", pmt->reserved4);
+    printf("Prorgram info lenght:\t%d\n", pmt->program_info_lenght);
+    printf("CRC:\t%d\n", pmt->CRC);
+
+    printf("Number of streams:\t%d\n", pmt->streamCounter);
+
+    int i;
+    for(i=0; i<pmt->streamCounter; i++){
+        printf("\n\t\t#########\n\t\tSTREAM number: %d\n\t\t#########\n\n", i);
+        printf("\t\t\tElemntaryPID:\t%d\n", pmt->stream[i].elementary_PID);
+        printf("\t\t\tStream_type:\t%d\n", pmt->stream[i].stream_type);
+        printf("\t\t\tReservd:\t%d\n", pmt->stream[i].reserved);
+        printf("\t\t\tES inof lenght:\t%d\n", pmt->stream[i].ES_info_lenght);
+        printf("\t\t\tReserved2:\t%d\n", pmt->stream[i].reserved2);
+        printf("\t\t\tDescriptor:\t%d\n", pmt->stream[i].descriptor);
+    }
+    Descriptor_Print(pmt->descriptor);
+    printf("End of PMT table\n");
+
+
+}
+
+// Parsing buffer to struct PMT, shifting and addition bits
+// Returns -1 and leaves no streams when section_length or one of loop lengths does not fit
+int parseBufferToPmt(uint8_t *buffer, uint32_t length, PMT_TABLE *pmt){
+    int sectionEnd;
+
+    pmt->stream = NULL;
+    pmt->descriptor = NULL;
+    pmt->streamCounter = 0;
+    if(buffer == NULL || length < PMT_HEADER_LENGTH + 4){
+        return -1;
+    }
+
+    pmt->table_id = buffer[0];
+
+    pmt->section_syntax_indicator = (buffer[1] & 0b10000000) >> 7;
+
+    pmt->reserved1 = (buffer[1] & 0b01100000) >> 5;
+
+    pmt->section_lenght = (buffer[1] & 0b00001111);
+    pmt->section_lenght <<=8;
+    pmt->section_lenght += buffer[2];
+
+    if(pmt->section_lenght < PMT_MIN_SECTION_LENGTH || pmt->section_lenght > PMT_MAX_SECTION_LENGTH
+        || (uint32_t)pmt->section_lenght + 3 > length){
+        printf("\nparseBufferToPmt: section length %d does not fit %u byte buffer\n", pmt->section_lenght, length);
+        return -1;
+    }
+    /* CRC position, program and stream loops must end before it */
+    sectionEnd = 3 + pmt->section_lenght - 4;
+
+    pmt->program_number = buffer[3];
+    pmt->program_number <<=8;
+    pmt->program_number += buffer[4];
+
+    pmt->reserved2 = (buffer[5] & 0b11000000) >> 6;
+
+    pmt->version_number = (buffer[5] & 0b00111110) >> 1;
+
+    pmt->current_next_indicator =  (buffer[5] & 0b00000001);
+
+    pmt->section_number = buffer[6];
+
+    pmt->last_section_number = buffer[7];
+
+    pmt->reserved3 = (buffer[8] & 0b11100000) >> 5;
+
+    pmt->PCR_PID = (buffer[8] & 0b00011111);
+    pmt->PCR_PID <<=8;
+    pmt->PCR_PID += buffer[9];
+
+    pmt->reserved4 = (buffer[10] & 0b11110000) >> 4;
+
+    pmt->program_info_lenght = (buffer[10] & 0b00001111);
+    pmt->program_info_lenght <<=8;
+    pmt->program_info_lenght += buffer[11];
+
+    pmt->CRC = (uint32_t)buffer[sectionEnd] << 24;
+    pmt->CRC += (buffer[sectionEnd + 1] << 16);
+    pmt->CRC += (buffer[sectionEnd + 2] << 8);
+    pmt->CRC += buffer[sectionEnd + 3];
+
+    if(PMT_HEADER_LENGTH + pmt->program_info_lenght > sectionEnd){
+        printf("\nparseBufferToPmt: program info length %d overruns section\n", pmt->program_info_lenght);
+        return -1;
+    }
+
+    int streamStart = PMT_HEADER_LENGTH + pmt->program_info_lenght; //stream loop, after program descriptors
+    int streamMaxNumber = (sectionEnd - streamStart) / 5;
+    int position = streamStart;
+
+    /* Every ES_info_length must end inside stream loop before anything is taken */
+    while(position + 5 <= sectionEnd){
+        position += 5 + (((buffer[position + 3] << 8) + buffer[position + 4]) & 0x0FFF);
+    }
+    if(position > sectionEnd){
+        printf("\nparseBufferToPmt: ES info length overruns section of program %d\n", pmt->program_number);
+        return -1;
+    }
+
+    /* Streams and descriptor block are one reservation of table arena, previous parse is dropped */
+    uint32_t descriptorSize = Descriptor_Pmt_Size(buffer);
+    if(PsiMem_Arena_Reserve(&pmt->arena, PsiMem_Arena_Size(sizeof(STREAM)*streamMaxNumber) + PsiMem_Arena_Size(descriptorSize)) == 0){
+        pmt->stream = PsiMem_Arena_Alloc(&pmt->arena, sizeof(STREAM)*streamMaxNumber);
+        if(descriptorSize > 0){
+            pmt->descriptor = Descriptor_Parse_Pmt_Into(buffer, PsiMem_Arena_Alloc(&pmt->arena, descriptorSize), descriptorSize);
+        }
+    }
+    if(pmt->stream == NULL){
+        streamMaxNumber = 0;
+    }
+
+    position = streamStart;
+    while(position + 5 <= sectionEnd && pmt->streamCounter < streamMaxNumber){
+        STREAM *stream = &pmt->stream[pmt->streamCounter];
+
+        stream->stream_type = buffer[position];
+
+        stream->reserved = (buffer[position + 1] & 0b11100000) >> 5;
+
+        stream->elementary_PID = (((buffer[position + 1] << 8) + buffer[position + 2]) & 0x1FFF); //13 bits
+
+        stream->reserved2 = (buffer[position + 3] & 0b11110000) >> 4;
+
+        stream->ES_info_lenght = (((buffer[position + 3] << 8) + buffer[position + 4]) & 0x0FFF);  //12 bits
+
+        stream->descriptor = stream->ES_info_lenght ? buffer[position + 5] : 0;
+
+        position += 5 + stream->ES_info_lenght;
+        pmt->streamCounter++;
+    }
+    return 0;
+}
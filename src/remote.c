@@ -19,10 +19,18 @@
 #include"remote.h"
 #include"streamplayer.h"
 #include"graphic.h"
+#include"channeldb.h"
+#include"zaptrace.h"
 
 #define EXIT    (10)
 #define NOERROR (0)
 
+/* Remote thread and zap soak both feed keys, zaps they start must not interleave */
+static pthread_mutex_t keyMutex = PTHREAD_MUTEX_INITIALIZER;
+/* Times of key being handled, zap trace starts from them only when key changes chanell */
+static struct timeval keyEventTime;
+static uint64_t keyReadUs;
+static uint64_t keyProcessUs;
 
 
 void *listenRemote(){
@@ -43,6 +51,12 @@ void *listenRemote(){
     
     ioctl(inputFileDesc, EVIOCGNAME(sizeof(deviceName)), deviceName);
 	printf("RC device opened succesfully [%s]\n", deviceName);
+
+#ifdef EVIOCSCLOCKID
+    /* Key event timestamps on the clock zap stages are measured with */
+    int clockId = CLOCK_MONOTONIC;
+    ZapTrace_Set_Event_Clock(ioctl(inputFileDesc, EVIOCSCLOCKID, &clockId) == 0);
+#endif
     
     eventBuf = malloc(NUM_EVENTS * sizeof(struct input_event));
     if(!eventBuf)
@@ -59,9 +73,10 @@ void *listenRemote(){
 			printf("Error while reading input events !");
 			return;
 		}
+        uint64_t readUs = ZapTrace_Now_Us();
 
         int result;
-        result = processKey(eventBuf);
+        result = processKey(eventBuf, readUs);
 
         if(NOERROR == result){
 
@@ -106,7 +121,7 @@ int32_t getKeys(int32_t count, uint8_t* buf, int32_t* eventsRead)
 
 
 
-int processKey(struct input_event *eventBuf)
+static int dispatchKey(struct input_event *eventBuf)
 {
     printf("Key\t(%d)\t pressed..\tType:%d,\tValue:%d\n", eventBuf->code, eventBuf->type, eventBuf->value);
     int result;
@@ -129,6 +144,7 @@ int processKey(struct input_event *eventBuf)
             result = Player_Volume_Set(playerHandle, (uint32_t) ( MAX_VOLUME* ((float)volumeStatus.volume/100)));
             ASSERT_TDP_RESULT(result, "Volume set");
             drawVolumeFlag = 1;
+            GraphicNotify();
 
             break;
 
@@ -142,6 +158,7 @@ int processKey(struct input_event *eventBuf)
             result = Player_Volume_Set(playerHandle, (uint32_t) ( MAX_VOLUME* ((float)volumeStatus.volume/100)));
             ASSERT_TDP_RESULT(result, "Volume set");
             drawVolumeFlag = 1;
+            GraphicNotify();
             break;
 
         case 60://Mute/Unmute
@@ -161,14 +178,22 @@ int processKey(struct input_event *eventBuf)
                     result = Player_Volume_Set(playerHandle,  MUTE);
                     ASSERT_TDP_RESULT(result, "Volume set");
                 }	
-                drawVolumeFlag = 1;								
+                drawVolumeFlag = 1;
+                GraphicNotify();
             }
             printf("Volume:\t%d\n", volumeStatus.volume);
             break;
 
         case 61://Program down
-            if(eventBuf->type == 1 && eventBuf->value == 0)
+            if(eventBuf->type == 1 && eventBuf->value == 0 && ChannelDb_Count() > 0)
+            {
+                // NIT is known, walk LCN order over every multiplex
+                ZapTrace_Begin(&keyEventTime, keyReadUs, keyProcessUs);
+                zapChannelStep(-1);
+            }
+            else if(eventBuf->type == 1 && eventBuf->value == 0)
             {                
+                ZapTrace_Begin(&keyEventTime, keyReadUs, keyProcessUs);
                 if(chanelStatus.currentProgram == chanelStatus.startProgramNumber)
                 {
                     chanelStatus.currentProgram = chanelStatus.endProgamNumber;
@@ -183,8 +208,14 @@ int processKey(struct input_event *eventBuf)
             break;
 
         case 62://Program up
-            if(eventBuf->type == 1 && eventBuf->value == 0)
+            if(eventBuf->type == 1 && eventBuf->value == 0 && ChannelDb_Count() > 0)
+            {
+                ZapTrace_Begin(&keyEventTime, keyReadUs, keyProcessUs);
+                zapChannelStep(1);
+            }
+            else if(eventBuf->type == 1 && eventBuf->value == 0)
             {
+                ZapTrace_Begin(&keyEventTime, keyReadUs, keyProcessUs);
                 if(chanelStatus.currentProgram == chanelStatus.endProgamNumber){
                     chanelStatus.currentProgram = chanelStatus.startProgramNumber;
                 }
@@ -205,6 +236,7 @@ int processKey(struct input_event *eventBuf)
                     pwd = eventBuf->code; 
                 }
                 chanelStatus.currentProgram = eventBuf->code;
+                ZapTrace_Begin(&keyEventTime, keyReadUs, keyProcessUs);
                 changePlayStreamOnChanell(eventBuf->code);
                 break;
             }
@@ -215,3 +247,17 @@ int processKey(struct input_event *eventBuf)
     return retValue;
 }
 
+// One key at a time, zap trace is started only by key that changes chanell
+int processKey(struct input_event *eventBuf, uint64_t readUs)
+{
+    int result;
+
+    pthread_mutex_lock(&keyMutex);
+    keyEventTime = eventBuf->time;
+    keyReadUs = readUs;
+    keyProcessUs = ZapTrace_Now_Us();
+    result = dispatchKey(eventBuf);
+    pthread_mutex_unlock(&keyMutex);
+
+    return result;
+}
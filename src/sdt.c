@@ -0,0 +1,313 @@
+/****************************************************************************
+*
+* FERIT
+*
+* -----------------------------------------------------
+* Konstrukcijski zadatak kolegij: Digitalna videotehnika
+* -----------------------------------------------------
+*
+* sdt.c
+*
+* Purpose: Parsing SDT actual/other to service table indexed by service_id
+*
+* Made on 18.10.2026.
+*****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include "sdt.h"
+#include "section.h"
+#include "descriptor.h"
+
+#define SDT_INDEX_BITS			(9)
+#define SDT_INDEX_SIZE			(1 << SDT_INDEX_BITS)	/* at least twice SDT_MAX_SERVICES */
+#define SDT_FIXED_LENGTH		(12)	/* header after section_length plus CRC */
+#define SDT_MAX_SECTION_LENGTH	(1021)
+#define SDT_LOOP_START			(11)
+
+static pthread_mutex_t sdtMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static SDT_SERVICE services[SDT_MAX_SERVICES];
+static int serviceCount = 0;
+/* Open addressing on transport_stream_id + service_id, slot holds service position + 1, 0 is empty */
+static uint16_t serviceIndex[SDT_INDEX_SIZE];
+
+static SECTION_SUBTABLE subtables[SDT_MAX_SUBTABLES];
+static int subtableCount = 0;
+static uint32_t subtablesDropped = 0;	/* sections of sub tables that did not fit */
+static int actualTransportStreamId = -1;
+
+static uint32_t indexHash(uint16_t transportStreamId, uint16_t serviceId){
+	uint32_t key = ((uint32_t)transportStreamId << 16) | serviceId;
+	return (key * 2654435761u) >> (32 - SDT_INDEX_BITS);
+}
+
+// Slot of service, or empty slot where it belongs
+static uint32_t indexSlot(uint16_t transportStreamId, uint16_t serviceId){
+	uint32_t slot = indexHash(transportStreamId, serviceId);
+
+	while(serviceIndex[slot] != 0){
+		SDT_SERVICE *service = &services[serviceIndex[slot] - 1];
+		if(service->serviceId == serviceId && service->transportStreamId == transportStreamId){
+			break;
+		}
+		slot = (slot + 1) & (SDT_INDEX_SIZE - 1);
+	}
+	return slot;
+}
+
+static void rebuildIndex(){
+	int i;
+
+	memset(serviceIndex, 0, sizeof(serviceIndex));
+	for(i = 0; i < serviceCount; i++){
+		serviceIndex[indexSlot(services[i].transportStreamId, services[i].serviceId)] = i + 1;
+	}
+}
+
+// Services of sub table version that is replaced
+static void removeServices(uint8_t tableId, uint16_t transportStreamId){
+	int i;
+	int kept = 0;
+
+	for(i = 0; i < serviceCount; i++){
+		if(services[i].tableId == tableId && services[i].transportStreamId == transportStreamId){
+			continue;
+		}
+		services[kept++] = services[i];
+	}
+	if(kept != serviceCount){
+		serviceCount = kept;
+		rebuildIndex();
+	}
+}
+
+// Entry of service, new one is added, NULL when table is full
+static SDT_SERVICE *storeService(uint16_t transportStreamId, uint16_t serviceId){
+	uint32_t slot = indexSlot(transportStreamId, serviceId);
+
+	if(serviceIndex[slot] != 0){
+		return &services[serviceIndex[slot] - 1];
+	}
+	if(serviceCount == SDT_MAX_SERVICES){
+		return NULL;
+	}
+	memset(&services[serviceCount], 0, sizeof(SDT_SERVICE));
+	services[serviceCount].transportStreamId = transportStreamId;
+	services[serviceCount].serviceId = serviceId;
+	serviceIndex[slot] = ++serviceCount;
+	return &services[serviceCount - 1];
+}
+
+static SECTION_SUBTABLE *findSubtable(uint8_t tableId, uint16_t transportStreamId, int create){
+	int i;
+
+	for(i = 0; i < subtableCount; i++){
+		if(subtables[i].tableId == tableId && subtables[i].tableIdExtension == transportStreamId){
+			return &subtables[i];
+		}
+	}
+	if(!create || subtableCount == SDT_MAX_SUBTABLES){
+		return NULL;
+	}
+	Section_Subtable_Init(&subtables[subtableCount], tableId, transportStreamId);
+	return &subtables[subtableCount++];
+}
+
+// Section length when header is valid SDT, 0 otherwise
+static int checkHeader(const uint8_t *buffer, uint32_t length){
+	int sectionLength;
+
+	if(buffer == NULL || length < SECTION_MIN_LENGTH){
+		return 0;
+	}
+	if(buffer[0] != SDT_TABLE_ACTUAL && buffer[0] != SDT_TABLE_OTHER){
+		return 0;
+	}
+	sectionLength = ((buffer[1] & 0x0F) << 8) | buffer[2];
+	if(!(buffer[1] & 0x80) || sectionLength < SDT_FIXED_LENGTH || sectionLength > SDT_MAX_SECTION_LENGTH
+		|| (uint32_t)sectionLength + 3 > length){
+		return 0;
+	}
+	return sectionLength;
+}
+
+// Service loop of one section, services already known are updated in place
+static void parseServices(const uint8_t *buffer, int sectionLength){
+	uint16_t transportStreamId = (buffer[3] << 8) | buffer[4];
+	uint16_t originalNetworkId = (buffer[8] << 8) | buffer[9];
+	int end = 3 + sectionLength - 4;
+	int position = SDT_LOOP_START;
+
+	while(position + 5 <= end){
+		uint16_t serviceId = (buffer[position] << 8) | buffer[position + 1];
+		int loopLength = ((buffer[position + 3] & 0x0F) << 8) | buffer[position + 4];
+		const uint8_t *loop = &buffer[position + 5];
+		SDT_SERVICE *service;
+		int i = 0;
+
+		if(position + 5 + loopLength > end){
+			break;
+		}
+		service = storeService(transportStreamId, serviceId);
+		if(service == NULL){
+			printf("SDT: service table full, service %d dropped\n", serviceId);
+			break;
+		}
+		service->originalNetworkId = originalNetworkId;
+		service->tableId = buffer[0];
+		service->runningStatus = buffer[position + 3] >> 5;
+		service->freeCaMode = (buffer[position + 3] >> 4) & 0x01;
+
+		while(i + 2 <= loopLength){
+			int descriptorLength = loop[i + 1];
+			const uint8_t *data = &loop[i + 2];
+
+			if(i + 2 + descriptorLength > loopLength){
+				break;
+			}
+			if(loop[i] == DESCRIPTOR_TAG_SERVICE && descriptorLength >= 3){
+				int providerLength = data[1];
+				int nameLength;
+
+				service->serviceType = data[0];
+				if(2 + providerLength < descriptorLength){
+					Descriptor_Text(service->provider, SDT_NAME_LENGTH, &data[2], providerLength);
+					nameLength = data[2 + providerLength];
+					if(3 + providerLength + nameLength > descriptorLength){
+						nameLength = descriptorLength - 3 - providerLength;
+					}
+					Descriptor_Text(service->name, SDT_NAME_LENGTH, &data[3 + providerLength], nameLength);
+				}
+			}
+			i += 2 + descriptorLength;
+		}
+		position += 5 + loopLength;
+	}
+}
+
+void Sdt_Reset(){
+	pthread_mutex_lock(&sdtMutex);
+	serviceCount = 0;
+	subtableCount = 0;
+	subtablesDropped = 0;
+	actualTransportStreamId = -1;
+	memset(serviceIndex, 0, sizeof(serviceIndex));
+	pthread_mutex_unlock(&sdtMutex);
+}
+
+int Sdt_Section_Check(const uint8_t *buffer, uint32_t length){
+	SECTION_SUBTABLE *subtable;
+	int result = SECTION_NEW;
+
+	if(checkHeader(buffer, length) == 0){
+		return SECTION_INVALID;
+	}
+	if(!(buffer[5] & 0x01)){
+		return SECTION_NEXT;
+	}
+
+	pthread_mutex_lock(&sdtMutex);
+	subtable = findSubtable(buffer[0], (buffer[3] << 8) | buffer[4], 0);
+	if(subtable != NULL){
+		result = Section_Subtable_Check(subtable, buffer);
+	}
+	else if(subtableCount == SDT_MAX_SUBTABLES){
+		/* No room for new sub table, queueing its sections again and again would never store them */
+		subtablesDropped++;
+		result = SECTION_REPEAT;
+	}
+	pthread_mutex_unlock(&sdtMutex);
+
+	return result;
+}
+
+int Sdt_Add_Section(const uint8_t *buffer, uint32_t length){
+	SECTION_SUBTABLE *subtable;
+	int sectionLength = checkHeader(buffer, length);
+	int result;
+
+	if(sectionLength == 0){
+		return SECTION_INVALID;
+	}
+	if(!(buffer[5] & 0x01)){
+		return SECTION_NEXT;
+	}
+
+	pthread_mutex_lock(&sdtMutex);
+	subtable = findSubtable(buffer[0], (buffer[3] << 8) | buffer[4], 1);
+	if(subtable == NULL){
+		pthread_mutex_unlock(&sdtMutex);
+		return SECTION_INVALID;
+	}
+	/* New version replaces every service of sub table, not only those in changed sections */
+	if(Section_Subtable_Version(subtable, buffer)){
+		removeServices(subtable->tableId, subtable->tableIdExtension);
+	}
+	if(Section_Subtable_Check(subtable, buffer) == SECTION_REPEAT){
+		pthread_mutex_unlock(&sdtMutex);
+		return SECTION_REPEAT;
+	}
+
+	parseServices(buffer, sectionLength);
+	if(buffer[0] == SDT_TABLE_ACTUAL){
+		actualTransportStreamId = subtable->tableIdExtension;
+	}
+	result = Section_Subtable_Mark(subtable, buffer);
+	pthread_mutex_unlock(&sdtMutex);
+
+	return result;
+}
+
+int Sdt_Find(uint16_t transportStreamId, uint16_t serviceId, SDT_SERVICE *service){
+	uint32_t slot;
+	int result = -1;
+
+	pthread_mutex_lock(&sdtMutex);
+	slot = indexSlot(transportStreamId, serviceId);
+	if(serviceIndex[slot] != 0){
+		*service = services[serviceIndex[slot] - 1];
+		result = 0;
+	}
+	pthread_mutex_unlock(&sdtMutex);
+
+	return result;
+}
+
+int Sdt_Find_Actual(uint16_t serviceId, SDT_SERVICE *service){
+	int transportStreamId;
+
+	pthread_mutex_lock(&sdtMutex);
+	transportStreamId = actualTransportStreamId;
+	pthread_mutex_unlock(&sdtMutex);
+
+	if(transportStreamId < 0){
+		return -1;
+	}
+	return Sdt_Find((uint16_t)transportStreamId, serviceId, service);
+}
+
+int Sdt_Service_Count(){
+	int count;
+	pthread_mutex_lock(&sdtMutex);
+	count = serviceCount;
+	pthread_mutex_unlock(&sdtMutex);
+	return count;
+}
+
+// Printing service table for testing
+void Sdt_Print(){
+	int i;
+
+	pthread_mutex_lock(&sdtMutex);
+	printf("\n\t\tSDT: %d services in %d sub tables, %u sections of sub tables without room\n",
+		serviceCount, subtableCount, subtablesDropped);
+	for(i = 0; i < serviceCount; i++){
+		printf("\t\t\t%s ts %5d service %5d type 0x%02x: %s (%s)\n",
+			services[i].tableId == SDT_TABLE_ACTUAL ? "actual" : "other ",
+			services[i].transportStreamId, services[i].serviceId, services[i].serviceType,
+			services[i].name, services[i].provider);
+	}
+	pthread_mutex_unlock(&sdtMutex);
+}
@@ -0,0 +1,232 @@
+/****************************************************************************
+*
+* FERIT
+*
+* -----------------------------------------------------
+* Konstrukcijski zadatak kolegij: Digitalna videotehnika
+* -----------------------------------------------------
+*
+* section.c
+*
+* Purpose: Collecting all sections of one table version, repeated sections are dropped by CRC
+*
+* Made on 18.10.2026.
+*****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "section.h"
+
+// Header fields of one section
+typedef struct SECTION_HEADER{
+	int version;
+	int sectionNumber;
+	int lastSectionNumber;
+	uint32_t crc;
+}SECTION_HEADER;
+
+static void freeSlots(SECTION_TABLE *table){
+	int i;
+	if(table->slot != NULL){
+		for(i = 0; i < table->sectionCount; i++){
+			free(table->slot[i].data);
+		}
+		free(table->slot);
+	}
+	table->slot = NULL;
+	table->sectionCount = 0;
+	table->receivedCount = 0;
+	table->complete = 0;
+	table->version = -1;
+}
+
+// Check header of section against table, CRC field is used as identity of the section
+static int readHeader(SECTION_TABLE *table, uint8_t *buffer, uint32_t length, SECTION_HEADER *header){
+	uint32_t sectionLength;
+
+	if(buffer == NULL || length < SECTION_MIN_LENGTH){
+		return SECTION_INVALID;
+	}
+	sectionLength = ((buffer[1] & 0x0F) << 8) | buffer[2];
+	if(buffer[0] != table->tableId || !(buffer[1] & 0x80) || sectionLength + 3 != length){
+		return SECTION_INVALID;
+	}
+	if(table->tableIdExtension >= 0 && ((buffer[3] << 8) | buffer[4]) != table->tableIdExtension){
+		return SECTION_INVALID;
+	}
+	header->version = (buffer[5] & 0x3E) >> 1;
+	header->sectionNumber = buffer[6];
+	header->lastSectionNumber = buffer[7];
+	if(header->sectionNumber > header->lastSectionNumber){
+		return SECTION_INVALID;
+	}
+	header->crc = ((uint32_t)buffer[length - 4] << 24) | (buffer[length - 3] << 16) | (buffer[length - 2] << 8) | buffer[length - 1];
+	if(!(buffer[5] & 0x01)){
+		return SECTION_NEXT;
+	}
+	return SECTION_NEW;
+}
+
+// Section of table version that is held or was parsed before
+static int isRepeat(SECTION_TABLE *table, SECTION_HEADER *header){
+	SECTION_SLOT *slot;
+
+	if(table->version < 0){
+		return header->version == table->knownVersion;
+	}
+	if(table->version != header->version || table->sectionCount != header->lastSectionNumber + 1){
+		return 0;
+	}
+	slot = &table->slot[header->sectionNumber];
+	return slot->data != NULL && slot->crc == header->crc;
+}
+
+// Drop what was collected and prepare slots for new version
+static int startVersion(SECTION_TABLE *table, SECTION_HEADER *header){
+	freeSlots(table);
+	table->slot = calloc(header->lastSectionNumber + 1, sizeof(SECTION_SLOT));
+	if(table->slot == NULL){
+		return -1;
+	}
+	table->sectionCount = header->lastSectionNumber + 1;
+	table->version = header->version;
+	return 0;
+}
+
+void Section_Table_Init(SECTION_TABLE *table, uint8_t tableId, int tableIdExtension, int knownVersion){
+	memset(table, 0, sizeof(SECTION_TABLE));
+	table->tableId = tableId;
+	table->tableIdExtension = tableIdExtension;
+	table->knownVersion = knownVersion;
+	table->version = -1;
+}
+
+void Section_Table_Free(SECTION_TABLE *table){
+	freeSlots(table);
+}
+
+int Section_Table_Check(SECTION_TABLE *table, uint8_t *buffer, uint32_t length){
+	SECTION_HEADER header;
+	int result;
+
+	result = readHeader(table, buffer, length, &header);
+	if(result != SECTION_NEW){
+		return result;
+	}
+	return isRepeat(table, &header) ? SECTION_REPEAT : SECTION_NEW;
+}
+
+int Section_Table_Add(SECTION_TABLE *table, uint8_t *buffer, uint32_t length){
+	SECTION_HEADER header;
+	SECTION_SLOT *slot;
+	int result;
+
+	result = readHeader(table, buffer, length, &header);
+	if(result != SECTION_NEW){
+		return result;
+	}
+	table->sections++;
+	if(isRepeat(table, &header)){
+		table->repeats++;
+		return SECTION_REPEAT;
+	}
+
+	/* New version, or same version with other section count */
+	if(table->version != header.version || table->sectionCount != header.lastSectionNumber + 1){
+		if(startVersion(table, &header) != 0){
+			return SECTION_INVALID;
+		}
+	}
+	slot = &table->slot[header.sectionNumber];
+	if(slot->data != NULL){
+		/* Content changed without version change, collect the table again */
+		printf("Section table 0x%02x: section %d changed in version %d\n", table->tableId, header.sectionNumber, header.version);
+		if(startVersion(table, &header) != 0){
+			return SECTION_INVALID;
+		}
+		slot = &table->slot[header.sectionNumber];
+	}
+
+	slot->data = malloc(length);
+	if(slot->data == NULL){
+		return SECTION_INVALID;
+	}
+	memcpy(slot->data, buffer, length);
+	slot->length = length;
+	slot->crc = header.crc;
+	table->receivedCount++;
+
+	if(table->receivedCount < table->sectionCount){
+		return SECTION_NEW;
+	}
+	table->complete = 1;
+	table->knownVersion = header.version;
+	table->completed++;
+	return SECTION_COMPLETE;
+}
+
+int Section_Table_Count(SECTION_TABLE *table){
+	return table->complete ? table->sectionCount : 0;
+}
+
+uint8_t *Section_Table_Get(SECTION_TABLE *table, int sectionNumber, uint32_t *length){
+	if(!table->complete || sectionNumber < 0 || sectionNumber >= table->sectionCount){
+		return NULL;
+	}
+	if(length != NULL){
+		*length = table->slot[sectionNumber].length;
+	}
+	return table->slot[sectionNumber].data;
+}
+
+void Section_Subtable_Init(SECTION_SUBTABLE *subtable, uint8_t tableId, uint16_t tableIdExtension){
+	memset(subtable, 0, sizeof(SECTION_SUBTABLE));
+	subtable->tableId = tableId;
+	subtable->tableIdExtension = tableIdExtension;
+	subtable->version = -1;
+}
+
+int Section_Subtable_Check(SECTION_SUBTABLE *subtable, const uint8_t *buffer){
+	if(subtable->version == ((buffer[5] & 0x3E) >> 1) && (subtable->received[buffer[6] >> 3] & (1 << (buffer[6] & 7)))){
+		return SECTION_REPEAT;
+	}
+	return SECTION_NEW;
+}
+
+int Section_Subtable_Version(SECTION_SUBTABLE *subtable, const uint8_t *buffer){
+	int version = (buffer[5] & 0x3E) >> 1;
+	int replaced;
+
+	if(subtable->version == version){
+		return 0;
+	}
+	replaced = (subtable->version >= 0);
+	memset(subtable->received, 0, sizeof(subtable->received));
+	subtable->version = version;
+	subtable->lastSection = 0;
+	subtable->complete = 0;
+	return replaced;
+}
+
+int Section_Subtable_Mark(SECTION_SUBTABLE *subtable, const uint8_t *buffer){
+	int i;
+
+	if(Section_Subtable_Check(subtable, buffer) == SECTION_REPEAT){
+		return SECTION_REPEAT;
+	}
+	subtable->received[buffer[6] >> 3] |= 1 << (buffer[6] & 7);
+	if(buffer[7] > subtable->lastSection){
+		subtable->lastSection = buffer[7];
+	}
+	for(i = 0; i <= subtable->lastSection; i++){
+		if(!(subtable->received[i >> 3] & (1 << (i & 7)))){
+			return SECTION_NEW;
+		}
+	}
+	if(subtable->complete){
+		return SECTION_NEW;
+	}
+	subtable->complete = 1;
+	return SECTION_COMPLETE;
+}
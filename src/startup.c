@@ -0,0 +1,150 @@
+/****************************************************************************
+*
+* FERIT
+*
+* -----------------------------------------------------
+* Konstrukcijski zadatak kolegij: Digitalna videotehnika
+* -----------------------------------------------------
+*
+* startup.c
+*
+* Purpose: Startup phases, waiting on them without spinning and printing boot timeline
+*
+* Made on 18.10.2026.
+*****************************************************************************/
+
+#include <stdio.h>
+#include <pthread.h>
+#include "startup.h"
+
+static const char *phaseNames[STARTUP_PHASE_COUNT] = {
+	"init",
+	"tuned",
+	"player ready",
+	"PAT",
+	"PMTs",
+	"playing"
+};
+
+static pthread_mutex_t startupMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t startupCondition;
+static int startupInitDone = 0;
+
+static int phaseReached[STARTUP_PHASE_COUNT];
+static struct timespec phaseTime[STARTUP_PHASE_COUNT];
+
+static long elapsedMs(struct timespec *from, struct timespec *to){
+	return (to->tv_sec - from->tv_sec) * 1000 + (to->tv_nsec - from->tv_nsec) / 1000000;
+}
+
+// Must be called from main before any other thread is started
+void Startup_Init(){
+	pthread_condattr_t attr;
+	int i;
+
+	if(!startupInitDone){
+		pthread_condattr_init(&attr);
+		pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+		pthread_cond_init(&startupCondition, &attr);
+		pthread_condattr_destroy(&attr);
+		startupInitDone = 1;
+	}
+
+	pthread_mutex_lock(&startupMutex);
+	for(i = 0; i < STARTUP_PHASE_COUNT; i++){
+		phaseReached[i] = 0;
+	}
+	pthread_mutex_unlock(&startupMutex);
+
+	Startup_Set_Phase(STARTUP_INIT);
+}
+
+// Mark phase as reached and wake everyone waiting on it, first call keeps the timestamp
+void Startup_Set_Phase(STARTUP_PHASE phase){
+	if(phase >= STARTUP_PHASE_COUNT){
+		return;
+	}
+	pthread_mutex_lock(&startupMutex);
+	if(!phaseReached[phase]){
+		clock_gettime(CLOCK_MONOTONIC, &phaseTime[phase]);
+		phaseReached[phase] = 1;
+		pthread_cond_broadcast(&startupCondition);
+	}
+	pthread_mutex_unlock(&startupMutex);
+}
+
+int Startup_Phase_Reached(STARTUP_PHASE phase){
+	int reached;
+	if(phase >= STARTUP_PHASE_COUNT){
+		return 0;
+	}
+	pthread_mutex_lock(&startupMutex);
+	reached = phaseReached[phase];
+	pthread_mutex_unlock(&startupMutex);
+	return reached;
+}
+
+// Sleep until phase is reached, returns 0 when reached and -1 on timeout
+int Startup_Wait_Phase(STARTUP_PHASE phase, int timeoutMs){
+	struct timespec deadline;
+	int result = 0;
+
+	if(phase >= STARTUP_PHASE_COUNT){
+		return -1;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	if(timeoutMs >= 0){
+		deadline.tv_sec += timeoutMs / 1000;
+		deadline.tv_nsec += (timeoutMs % 1000) * 1000000;
+		if(deadline.tv_nsec >= 1000000000){
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000;
+		}
+	}
+
+	pthread_mutex_lock(&startupMutex);
+	while(!phaseReached[phase] && result == 0){
+		if(timeoutMs < 0){
+			pthread_cond_wait(&startupCondition, &startupMutex);
+		}
+		else{
+			result = pthread_cond_timedwait(&startupCondition, &startupMutex, &deadline);
+		}
+	}
+	result = phaseReached[phase] ? 0 : -1;
+	pthread_mutex_unlock(&startupMutex);
+
+	return result;
+}
+
+// Print reached phases in order of time, relative to init
+void Startup_Print_Timeline(){
+	int printed[STARTUP_PHASE_COUNT] = {0};
+	int i, j, next;
+
+	pthread_mutex_lock(&startupMutex);
+	printf("\n\t\tSTARTUP TIMELINE:\n");
+	for(i = 0; i < STARTUP_PHASE_COUNT; i++){
+		next = -1;
+		for(j = 0; j < STARTUP_PHASE_COUNT; j++){
+			if(!phaseReached[j] || printed[j]){
+				continue;
+			}
+			if(next < 0 || elapsedMs(&phaseTime[j], &phaseTime[next]) > 0){
+				next = j;
+			}
+		}
+		if(next < 0){
+			break;
+		}
+		printed[next] = 1;
+		printf("\t\t\t%6ld ms\t%s\n", elapsedMs(&phaseTime[STARTUP_INIT], &phaseTime[next]), phaseNames[next]);
+	}
+	for(j = 0; j < STARTUP_PHASE_COUNT; j++){
+		if(!phaseReached[j]){
+			printf("\t\t\t     -   \t%s (not reached)\n", phaseNames[j]);
+		}
+	}
+	pthread_mutex_unlock(&startupMutex);
+}
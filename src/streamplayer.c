@@ -16,34 +16,97 @@
 * @E-mail luka97kruljac@gmail.com
 *****************************************************************************/
 
+#include <string.h>
 #include "streamplayer.h"
+#include "startup.h"
+#include "psicache.h"
+#include "psimonitor.h"
+#include "channeldb.h"
+#include "sdt.h"
+#include "zapper.h"
+#include "zaptrace.h"
+
+#define TUNER_LOCK_TIMEOUT_MS	(10000)
+
+/* Zapping and PSI monitor both change streams, PMT update must not apply to chanell user zapped away from */
+static pthread_mutex_t playStreamMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Lock state reported by tuner callback, retune waits on it */
+static pthread_mutex_t tunerMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t tunerCondition;
+static int tunerConditionInit = 0;
+static int tunerLocked = 0;
+
+/* Chanell database entry picked by last step, remote thread only */
+static CHANNEL_DB_ENTRY stepEntry;
+static int stepEntryValid = 0;
+
+static void initTunerCondition(){
+    pthread_condattr_t attr;
+
+    if(tunerConditionInit){
+        return;
+    }
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&tunerCondition, &attr);
+    pthread_condattr_destroy(&attr);
+    tunerConditionInit = 1;
+}
+
+// Lock to frequency and sleep until callback reports lock, returns 0 when locked
+static int lockTuner(uint32_t frequency, int bandwidth, int module){
+    struct timespec deadline;
+    int locked;
+
+    pthread_mutex_lock(&tunerMutex);
+    tunerLocked = 0;
+    pthread_mutex_unlock(&tunerMutex);
+
+    if(Tuner_Lock_To_Frequency(frequency, bandwidth, module) != NO_ERROR){
+        return -1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += TUNER_LOCK_TIMEOUT_MS / 1000;
+    deadline.tv_nsec += (TUNER_LOCK_TIMEOUT_MS % 1000) * 1000000;
+    if(deadline.tv_nsec >= 1000000000){
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+    pthread_mutex_lock(&tunerMutex);
+    while(!tunerLocked){
+        if(pthread_cond_timedwait(&tunerCondition, &tunerMutex, &deadline) != 0){
+            break;
+        }
+    }
+    locked = tunerLocked;
+    pthread_mutex_unlock(&tunerMutex);
+
+    return locked ? 0 : -1;
+}
 
 void* PlayStream(){
 	
 	int32_t result;
 
-    struct timespec lockStatusWaitTime;
-    struct timeval now;
-    
-
     pmt = NULL;
-    gettimeofday(&now,NULL);
-    lockStatusWaitTime.tv_sec = now.tv_sec+10;
     
     /* Initialize tuner */
     result = Tuner_Init();
     ASSERT_TDP_RESULT(result, "Tuner_Init");
     
     /* Register tuner status callback */
+    initTunerCondition();
     result = Tuner_Register_Status_Callback(myPrivateTunerStatusCallback);
     ASSERT_TDP_RESULT(result, "Tuner_Register_Status_Callback");
     
     /* Lock to frequency */
-    result = Tuner_Lock_To_Frequency(818000000, 8, DVB_T);
+    result = Tuner_Lock_To_Frequency(chanelStatus.frequency, chanelStatus.bandwidth, chanelStatus.module);
     ASSERT_TDP_RESULT(result, "Tuner_Lock_To_Frequency");
     
-    pthread_mutex_lock(&statusMutex);
-    if(ETIMEDOUT == pthread_cond_timedwait(&statusCondition, &statusMutex, &lockStatusWaitTime))
+    /* Tuner status callback reports lock as startup phase */
+    if(Startup_Wait_Phase(STARTUP_TUNED, TUNER_LOCK_TIMEOUT_MS) != 0)
     {
         printf("\n\nLock timeout exceeded!\n\n");
         return -1;
@@ -58,18 +121,37 @@ void* PlayStream(){
     /* Open source (open data flow between tuner and demux) */
     result = Player_Source_Open(playerHandle, &sourceHandle);
     ASSERT_TDP_RESULT(result, "Player_Source_Open");
+    Startup_Set_Phase(STARTUP_PLAYER_READY);
    	
-	uint32_t audioPID = config.apid;
-	uint32_t videoPID = config.vpid; 	
+    PROGRAM_MAP cached;
+    if(PsiCache_Valid() && ProgramMap_Get(chanelStatus.currentProgram, &cached) == 0){
+        /* Channel list came from PSI cache, last chanell plays without waiting for PAT/PMT */
+        printf("Playing chanell %d from PSI cache\n", chanelStatus.currentProgram);
+        pthread_mutex_lock(&playStreamMutex);
+        Zapper_Switch(&cached, NULL);
+        pthread_mutex_unlock(&playStreamMutex);
+        drawCurrentChanellFlag = 1;
+        drawForbidenContentFlag = cached.contentRank > config.rating;
+        GraphicNotify();
+        Startup_Set_Phase(STARTUP_PLAYING);
+        Zapper_Prepare_Neighbours(chanelStatus.currentProgram);
+    }
+    else{
+	    PROGRAM_MAP configured;
 
-	tStreamType videoStreamType = VIDEO_TYPE_MPEG2;
-	tStreamType audioStreamType = AUDIO_TYPE_MPEG_AUDIO;
+	    memset(&configured, 0, sizeof(PROGRAM_MAP));
+	    configured.videoPID = config.vpid;
+	    configured.audioPID = config.apid;
+	    configured.videoType = VIDEO_TYPE_MPEG2;
+	    configured.audioType = AUDIO_TYPE_MPEG_AUDIO;
 
-	Player_Stream_Create(playerHandle, sourceHandle, videoPID, videoStreamType, &videoStreamHandle);
-	Player_Stream_Create(playerHandle, sourceHandle, audioPID, audioStreamType, &audioStreamHandle);
+	    pthread_mutex_lock(&playStreamMutex);
+	    Zapper_Switch(&configured, NULL);
+	    pthread_mutex_unlock(&playStreamMutex);
+	    Startup_Set_Phase(STARTUP_PLAYING);
+    }
 
     fflush(stdin);
-    pthread_mutex_unlock(&statusMutex);
 
     printf("Press any key to stop\n");
     getchar();
@@ -83,6 +165,52 @@ void* PlayStream(){
 void PlayStreamDeintalization(){
     
     int result;
+    int i;
+    ZAP_STATS zapStats;
+    ZAP_TRACE_REPORT zapReport;
+    t_SectionPoolStats poolStats;
+    t_SectionDispatchStats dispatchStats;
+    t_SectionBatchStats readStats;
+    t_TsMonitorReport health;
+
+    /* Monitor filters must go before player */
+    PsiMonitor_Stop();
+
+    /* Report section buffer usage of this session */
+    if(Demux_Get_Section_Pool_Stats(&poolStats) == NO_ERROR){
+        printf("Section pool: %u buffers, high-water %u, acquired %u, dropped %u\n",
+            poolStats.poolSize, poolStats.highWater, poolStats.acquired, poolStats.exhausted);
+    }
+    if(Demux_Get_Section_Dispatch_Stats(&dispatchStats) == NO_ERROR){
+        printf("Section dispatcher: dispatched %u, evicted %u, queue high-water %u, wait max %u us, callback max %u us\n",
+            dispatchStats.dispatched, dispatchStats.droppedOldest, dispatchStats.queueHighWater,
+            dispatchStats.latencyMaxUs, dispatchStats.callbackMaxUs);
+    }
+    if(Demux_Get_Section_Read_Stats(&readStats) == NO_ERROR){
+        printf("Section reads: %u events, %u reads, %u sections, up to %u per read, %u resyncs, %u read errors\n",
+            readStats.events, readStats.reads, readStats.sections, readStats.batchMax, readStats.resyncs, readStats.readErrors);
+    }
+    /* Report broadcast side errors seen during this session */
+    if(Demux_Get_Stream_Health(&health) == NO_ERROR){
+        printf("Stream health (%s):\n", health.packetLevel ? "packet level" : "sections only");
+        for(i = 0; i < TS_MONITOR_INDICATOR_COUNT; i++){
+            printf("\t%-24s %u\n", Ts_Monitor_Indicator_Name(i), health.total[i]);
+        }
+    }
+    PsiMem_Print_Stats();
+
+    Zapper_Get_Stats(&zapStats);
+    if(zapStats.zaps > 0){
+        printf("Zapper: %u zaps, %u of %u stream starts prepared, %u streams kept, total avg %llu us max %u us\n",
+            zapStats.zaps, zapStats.preparedStarts, zapStats.streamStarts, zapStats.streamsKept,
+            (unsigned long long)(zapStats.totalSumUs / zapStats.zaps), zapStats.totalMaxUs);
+    }
+    ZapTrace_Get_Report(&zapReport);
+    if(zapReport.zaps > 0){
+        ZapTrace_Print_Report("Zap latency", &zapReport);
+    }
+    /* Streams and prepared attributes go before player */
+    Zapper_Reset();
 
     /* Close previously opened source */
     result = Player_Source_Close(playerHandle, sourceHandle);
@@ -109,11 +237,16 @@ inline void textColor(int32_t attr, int32_t fg, int32_t bg)
 
 int32_t myPrivateTunerStatusCallback(t_LockStatus status)
 {
+    pthread_mutex_lock(&tunerMutex);
+    tunerLocked = (status == STATUS_LOCKED);
+    if(tunerConditionInit){
+        pthread_cond_broadcast(&tunerCondition);
+    }
+    pthread_mutex_unlock(&tunerMutex);
+
     if(status == STATUS_LOCKED)
     {
-        pthread_mutex_lock(&statusMutex);
-        pthread_cond_signal(&statusCondition);
-        pthread_mutex_unlock(&statusMutex);
+        Startup_Set_Phase(STARTUP_TUNED);
         printf("\n\n\tCALLBACK LOCKED\n\n");
     }
     else
@@ -124,28 +257,188 @@ int32_t myPrivateTunerStatusCallback(t_LockStatus status)
 }
 
 void changePlayStreamOnChanell(int ChanellNumber){
-   	
-    Player_Stream_Remove(playerHandle, sourceHandle, videoStreamHandle);
-	Player_Stream_Remove(playerHandle, sourceHandle, audioStreamHandle);
-
- 
-    uint32_t audioPID = program_mapHC[ChanellNumber].audioPID;
-    //uint32_t audioPID = 103;
-	//uint32_t videoPID = 201;
-    uint32_t videoPID = program_mapHC[ChanellNumber].videoPID;
-    //printf("Novi pidovi su %d i %d za kanal %d\n", audioPID, videoPID, chanelStatus.currentProgram);
-	//tStreamType videoStreamType = program_map[ChanellNumber].videoType;
-	//tStreamType audioStreamType = program_map[ChanellNumber].audioType;
+    PROGRAM_MAP chanell;
+
+    if(ProgramMap_Get(ChanellNumber, &chanell) != 0){
+        printf("Chanell %d is not in channel list\n", ChanellNumber);
+        return;
+    }
+
+    /* Graphics thread is woken after streams start, drawing must not delay first frame */
+    pthread_mutex_lock(&playStreamMutex);
+    Zapper_Switch(&chanell, NULL);
+    pthread_mutex_unlock(&playStreamMutex);
     
     drawCurrentChanellFlag = 1;
+    drawForbidenContentFlag = chanell.contentRank > config.rating;
+    GraphicNotify();
 
-    if(program_mapHC[ChanellNumber].radioFlag == 0){
-        Player_Stream_Create(playerHandle, sourceHandle, videoPID, VIDEO_TYPE_MPEG2, &videoStreamHandle);
+    /* Streams are running, remember chanell for next boot and follow its PMT */
+    PsiCache_Set_Last_Chanell(ChanellNumber);
+    PsiMonitor_Chanell_Changed();
+
+    /* Chanell up or down is the likely next zap */
+    Zapper_Prepare_Neighbours(ChanellNumber);
+}
+
+// PMT of chanell on air changed, only streams whose PID or type changed are recreated
+// Chanell entry comes from PSI monitor, it is ignored when user zapped away in the meantime
+void updatePlayStreamOnChanell(PROGRAM_MAP *chanell){
+    PROGRAM_MAP current;
+    ZAP_TIMINGS zap;
+
+    pthread_mutex_lock(&playStreamMutex);
+    if(ProgramMap_Get(chanelStatus.currentProgram, &current) != 0 || current.programNumber != chanell->programNumber){
+        pthread_mutex_unlock(&playStreamMutex);
+        return;
     }
-    Player_Stream_Create(playerHandle, sourceHandle, audioPID, AUDIO_TYPE_MPEG_AUDIO, &audioStreamHandle); 
-    
-    drawForbidenContentFlag = program_mapHC[ChanellNumber].contentRank > config.rating;
-    
+
+    Zapper_Switch(chanell, &zap);
+    if(!zap.videoKept){
+        printf("Video stream of program %d moved to pid %d\n", chanell->programNumber, chanell->videoPID);
+    }
+    if(!zap.audioKept){
+        printf("Audio stream of program %d moved to pid %d\n", chanell->programNumber, chanell->audioPID);
+    }
+
+    pthread_mutex_unlock(&playStreamMutex);
+}
+
+
+
+// Move player to other multiplex, channel list of new transport stream is built by PSI monitor
+// When lock fails tuner goes back to frequency it was on and chanell that was on air plays again
+static int retune(CHANNEL_DB_ENTRY *entry){
+    uint32_t frequency = entry->frequency;
+    int bandwidth = entry->bandwidth;
+    int module = (entry->deliverySystem == NIT_DELIVERY_T2) ? DVB_T2 : DVB_T;
+    int result = 0;
+
+    /* Monitor zaps by itself, it must be stopped before streams are taken */
+    PsiMonitor_Stop();
+
+    pthread_mutex_lock(&playStreamMutex);
+    Zapper_Stop();
+    Player_Source_Close(playerHandle, sourceHandle);
+
+    printf("Retune %u Hz -> %u Hz (%d MHz, %s)\n", chanelStatus.frequency, frequency, bandwidth, module == DVB_T2 ? "DVB-T2" : "DVB-T");
+    if(lockTuner(frequency, bandwidth, module) != 0){
+        printf("Lock to %u Hz failed, back to %u Hz\n", frequency, chanelStatus.frequency);
+        frequency = chanelStatus.frequency;
+        bandwidth = chanelStatus.bandwidth;
+        module = chanelStatus.module;
+        result = -1;
+        if(lockTuner(frequency, bandwidth, module) != 0){
+            printf("Lock to %u Hz failed\n", frequency);
+        }
+    }
+    Player_Source_Open(playerHandle, &sourceHandle);
+    pthread_mutex_unlock(&playStreamMutex);
+
+    if(frequency != chanelStatus.frequency){
+        /* Prepared streams carry PIDs of old transport stream */
+        Zapper_Reset();
+        /* Tables of old transport stream, PAT is parsed again by monitor */
+        chanelStatus.frequency = frequency;
+        chanelStatus.bandwidth = bandwidth;
+        chanelStatus.module = module;
+        Pat_Clear();
+        Sdt_Reset();
+        /* Without cache nothing is playable until PSI of new transport stream arrives */
+        if(PsiCache_Load(frequency) != 0){
+            ProgramMap_Clear();
+        }
+    }
+    if(result == 0){
+        PsiMonitor_Want_Program(entry->serviceId);
+    }
+    PsiMonitor_Start();
+    if(result != 0){
+        /* Back on old multiplex, its channel list still holds chanell that was on air */
+        changePlayStreamOnChanell(chanelStatus.currentProgram);
+    }
+
+    return result;
+}
+
+// Transport stream id is known once PAT is parsed, frequency in NIT may be rounded other way than config
+static int isCurrentTransport(CHANNEL_DB_ENTRY *entry){
+    uint16_t transportStreamId;
+
+    if(Pat_Get_Transport_Stream_Id(&transportStreamId) == 0){
+        return entry->transportStreamId == transportStreamId;
+    }
+    return entry->frequency == chanelStatus.frequency;
 }
 
+// Position of chanell on air in channel database
+// PAT and channel list are gone for a while after retune, entry picked by last step stands in for them
+static int currentDbIndex(){
+    PROGRAM_MAP current;
+    uint16_t transportStreamId;
+    int known;
+    int index = -1;
 
+    known = Pat_Get_Transport_Stream_Id(&transportStreamId) == 0
+        && ProgramMap_Get(chanelStatus.currentProgram, &current) == 0;
+    if(stepEntryValid){
+        index = ChannelDb_Find(stepEntry.transportStreamId, stepEntry.serviceId);
+        /* Chanell was changed by digit or by PSI monitor since last step */
+        if(known && (stepEntry.transportStreamId != transportStreamId || stepEntry.serviceId != current.programNumber)){
+            index = -1;
+        }
+    }
+    if(index < 0 && known){
+        index = ChannelDb_Find(transportStreamId, current.programNumber);
+    }
+    return index;
+}
+
+void zapChannelStep(int step){
+    CHANNEL_DB_ENTRY entry;
+    uint16_t transportStreamId;
+    int count = ChannelDb_Count();
+    int index;
+    int chanell;
+    int i;
+
+    if(count == 0){
+        return;
+    }
+    index = currentDbIndex();
+
+    for(i = 0; i < count; i++){
+        index = ChannelDb_Next(index, step);
+        if(ChannelDb_Get(index, &entry) != 0){
+            return;
+        }
+        if(!isCurrentTransport(&entry)){
+            printf("LCN %d: service %d on %u Hz\n", entry.lcn, entry.serviceId, entry.frequency);
+            if(retune(&entry) == 0){
+                stepEntry = entry;
+                stepEntryValid = 1;
+            }
+            return;
+        }
+        chanell = ProgramMap_Find(entry.serviceId);
+        if(chanell >= 0){
+            printf("LCN %d: service %d\n", entry.lcn, entry.serviceId);
+            stepEntry = entry;
+            stepEntryValid = 1;
+            chanelStatus.currentProgram = chanell;
+            changePlayStreamOnChanell(chanell);
+            return;
+        }
+        if(Pat_Get_Transport_Stream_Id(&transportStreamId) != 0){
+            /* PAT of this multiplex is not here yet, nothing has PMT, chanell is played when its PMT arrives */
+            printf("LCN %d: service %d, waiting for PSI\n", entry.lcn, entry.serviceId);
+            stepEntry = entry;
+            stepEntryValid = 1;
+            PsiMonitor_Stop();
+            PsiMonitor_Want_Program(entry.serviceId);
+            PsiMonitor_Start();
+            return;
+        }
+        /* Same multiplex, chanell whose PMT is not known yet is skipped */
+    }
+}
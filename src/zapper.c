@@ -0,0 +1,291 @@
+/****************************************************************************
+*
+* FERIT
+*
+* -----------------------------------------------------
+* Konstrukcijski zadatak kolegij: Digitalna videotehnika
+* -----------------------------------------------------
+*
+* zapper.c
+*
+* Purpose: Chanell switching with stream attributes prepared ahead, only streams that change are touched
+*
+* Made on 18.10.2026.
+*****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "zapper.h"
+#include "globals.h"
+#include "programmap.h"
+#include "tdp_api.h"
+#include "zaptrace.h"
+
+/* Attributes of one stream, prepared with player */
+typedef struct ZAP_PREPARED{
+	uint32_t handle;		/* 0 if slot is free */
+	uint32_t PID;
+	tStreamType type;
+	uint32_t lastUse;
+}ZAP_PREPARED;
+
+/* Zapping and PSI monitor both switch streams, state is what player is really playing */
+static pthread_mutex_t zapMutex = PTHREAD_MUTEX_INITIALIZER;
+static PROGRAM_MAP onAir;
+static int videoRunning = 0;
+static int audioRunning = 0;
+
+static ZAP_PREPARED prepared[ZAPPER_PREPARED_SLOTS];
+static uint32_t useCounter = 0;
+
+static ZAP_TIMINGS lastZap;
+static int lastZapValid = 0;
+static ZAP_STATS zapStats;
+
+static uint64_t nowUs(){
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+// Attributes of running streams are not evicted, chanell on air is neighbour of the next one
+static int isOnAir(const ZAP_PREPARED *slot){
+	if(videoRunning && slot->PID == onAir.videoPID && slot->type == onAir.videoType){
+		return 1;
+	}
+	return audioRunning && slot->PID == onAir.audioPID && slot->type == onAir.audioType;
+}
+
+static ZAP_PREPARED *findPrepared(uint32_t PID, tStreamType type){
+	int i;
+
+	for(i = 0; i < ZAPPER_PREPARED_SLOTS; i++){
+		if(prepared[i].handle != 0 && prepared[i].PID == PID && prepared[i].type == type){
+			prepared[i].lastUse = ++useCounter;
+			return &prepared[i];
+		}
+	}
+	return NULL;
+}
+
+// Prepare stream attributes unless they are cached, least recently used slot not on air makes room
+static ZAP_PREPARED *prepareStream(uint32_t PID, tStreamType type){
+	ZAP_PREPARED *slot = findPrepared(PID, type);
+	int i;
+
+	if(slot != NULL){
+		return slot;
+	}
+	for(i = 0; i < ZAPPER_PREPARED_SLOTS; i++){
+		if(prepared[i].handle == 0){
+			slot = &prepared[i];
+			break;
+		}
+		if(!isOnAir(&prepared[i]) && (slot == NULL || prepared[i].lastUse < slot->lastUse)){
+			slot = &prepared[i];
+		}
+	}
+	if(slot == NULL){
+		return NULL;
+	}
+	if(slot->handle != 0){
+		Player_Stream_Unprepare(playerHandle, slot->handle);
+		slot->handle = 0;
+	}
+	if(Player_Stream_Prepare(playerHandle, PID, type, &slot->handle) != NO_ERROR){
+		slot->handle = 0;
+		return NULL;
+	}
+	slot->PID = PID;
+	slot->type = type;
+	slot->lastUse = ++useCounter;
+	return slot;
+}
+
+// Start stream from prepared attributes, attributes missing from cache are prepared first and kept for next zap
+static int startStream(uint32_t PID, tStreamType type, uint32_t *streamHandle, int *wasPrepared, uint32_t *prepareUs){
+	ZAP_PREPARED *slot = findPrepared(PID, type);
+	uint64_t start;
+
+	*wasPrepared = (slot != NULL);
+	if(slot == NULL){
+		start = nowUs();
+		slot = prepareStream(PID, type);
+		*prepareUs += (uint32_t)(nowUs() - start);
+	}
+	if(slot != NULL && Player_Stream_Create_Prepared(playerHandle, sourceHandle, slot->handle, streamHandle) == NO_ERROR){
+		return 0;
+	}
+	/* Prepared path failed, stream is still worth playing */
+	*wasPrepared = 0;
+	return (Player_Stream_Create(playerHandle, sourceHandle, PID, type, streamHandle) == NO_ERROR) ? 0 : -1;
+}
+
+static const char *streamState(int kept, int started, int wasPrepared){
+	if(kept){
+		return "kept";
+	}
+	if(!started){
+		return "none";
+	}
+	return wasPrepared ? "prepared" : "cold";
+}
+
+int Zapper_Switch(const PROGRAM_MAP *chanell, ZAP_TIMINGS *timings){
+	ZAP_TIMINGS zap;
+	uint64_t start;
+	uint64_t phase;
+	int videoStarted = 0;
+	int audioStarted = 0;
+	int result = 0;
+
+	memset(&zap, 0, sizeof(ZAP_TIMINGS));
+	zap.programNumber = chanell->programNumber;
+
+	pthread_mutex_lock(&zapMutex);
+	start = nowUs();
+
+	/* Radio to radio keeps video side too, there is nothing to do there */
+	if(chanell->radioFlag){
+		zap.videoKept = !videoRunning;
+	}
+	else{
+		zap.videoKept = videoRunning && onAir.videoPID == chanell->videoPID && onAir.videoType == chanell->videoType;
+	}
+	zap.audioKept = audioRunning && onAir.audioPID == chanell->audioPID && onAir.audioType == chanell->audioType;
+
+	/* Old sound goes first, it must not play over picture of new chanell */
+	if(audioRunning && !zap.audioKept){
+		Player_Stream_Remove(playerHandle, sourceHandle, audioStreamHandle);
+		ZapTrace_Mark(ZAP_STAGE_AUDIO_REMOVE);
+		audioRunning = 0;
+	}
+	if(videoRunning && !zap.videoKept){
+		Player_Stream_Remove(playerHandle, sourceHandle, videoStreamHandle);
+		ZapTrace_Mark(ZAP_STAGE_VIDEO_REMOVE);
+		videoRunning = 0;
+	}
+	phase = nowUs();
+	zap.stopUs = (uint32_t)(phase - start);
+
+	/* Decoder waits for next I frame, video is started first so the wait overlaps audio start */
+	if(!chanell->radioFlag && !zap.videoKept){
+		videoStarted = (startStream(chanell->videoPID, chanell->videoType, &videoStreamHandle, &zap.videoPrepared, &zap.prepareUs) == 0);
+		videoRunning = videoStarted;
+		ZapTrace_Mark(ZAP_STAGE_VIDEO_CREATE);
+		if(!videoStarted){
+			result = -1;
+		}
+		zap.videoStartUs = (uint32_t)(nowUs() - phase);
+		phase = nowUs();
+	}
+	if(!zap.audioKept){
+		audioStarted = (startStream(chanell->audioPID, chanell->audioType, &audioStreamHandle, &zap.audioPrepared, &zap.prepareUs) == 0);
+		audioRunning = audioStarted;
+		ZapTrace_Mark(ZAP_STAGE_AUDIO_CREATE);
+		if(!audioStarted){
+			result = -1;
+		}
+		zap.audioStartUs = (uint32_t)(nowUs() - phase);
+	}
+	onAir = *chanell;
+	zap.totalUs = (uint32_t)(nowUs() - start);
+
+	lastZap = zap;
+	lastZapValid = 1;
+	zapStats.zaps++;
+	zapStats.streamStarts += videoStarted + audioStarted;
+	zapStats.preparedStarts += (videoStarted && zap.videoPrepared) + (audioStarted && zap.audioPrepared);
+	zapStats.streamsKept += (zap.videoKept && !chanell->radioFlag) + zap.audioKept;
+	zapStats.totalSumUs += zap.totalUs;
+	if(zap.totalUs > zapStats.totalMaxUs){
+		zapStats.totalMaxUs = zap.totalUs;
+	}
+	pthread_mutex_unlock(&zapMutex);
+
+	if(result != 0){
+		ZapTrace_Fail();
+	}
+	ZapTrace_Mark(ZAP_STAGE_STREAMS_DONE);
+
+	printf("Zap to program %d: stop %u us, video %s %u us, audio %s %u us, prepare %u us, total %u us\n",
+		zap.programNumber, zap.stopUs,
+		streamState(zap.videoKept && !chanell->radioFlag, videoStarted, zap.videoPrepared), zap.videoStartUs,
+		streamState(zap.audioKept, audioStarted, zap.audioPrepared), zap.audioStartUs,
+		zap.prepareUs, zap.totalUs);
+
+	if(timings != NULL){
+		*timings = zap;
+	}
+	return result;
+}
+
+void Zapper_Prepare_Neighbours(int chanell){
+	PROGRAM_MAP neighbour;
+	int count = ProgramMap_Count();
+	int step;
+
+	if(count < 2){
+		return;
+	}
+	pthread_mutex_lock(&zapMutex);
+	for(step = -1; step <= 1; step += 2){
+		if(ProgramMap_Get((chanell + step + count) % count, &neighbour) != 0){
+			continue;
+		}
+		if(!neighbour.radioFlag){
+			prepareStream(neighbour.videoPID, neighbour.videoType);
+		}
+		prepareStream(neighbour.audioPID, neighbour.audioType);
+	}
+	pthread_mutex_unlock(&zapMutex);
+}
+
+void Zapper_Stop(){
+	pthread_mutex_lock(&zapMutex);
+	if(audioRunning){
+		Player_Stream_Remove(playerHandle, sourceHandle, audioStreamHandle);
+		audioRunning = 0;
+	}
+	if(videoRunning){
+		Player_Stream_Remove(playerHandle, sourceHandle, videoStreamHandle);
+		videoRunning = 0;
+	}
+	memset(&onAir, 0, sizeof(PROGRAM_MAP));
+	pthread_mutex_unlock(&zapMutex);
+}
+
+void Zapper_Reset(){
+	int i;
+
+	Zapper_Stop();
+	pthread_mutex_lock(&zapMutex);
+	for(i = 0; i < ZAPPER_PREPARED_SLOTS; i++){
+		if(prepared[i].handle != 0){
+			Player_Stream_Unprepare(playerHandle, prepared[i].handle);
+		}
+	}
+	memset(prepared, 0, sizeof(prepared));
+	pthread_mutex_unlock(&zapMutex);
+}
+
+int Zapper_Get_Last(ZAP_TIMINGS *timings){
+	int result = -1;
+
+	pthread_mutex_lock(&zapMutex);
+	if(lastZapValid){
+		*timings = lastZap;
+		result = 0;
+	}
+	pthread_mutex_unlock(&zapMutex);
+	return result;
+}
+
+void Zapper_Get_Stats(ZAP_STATS *stats){
+	pthread_mutex_lock(&zapMutex);
+	*stats = zapStats;
+	pthread_mutex_unlock(&zapMutex);
+}
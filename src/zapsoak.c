@@ -0,0 +1,162 @@
+/****************************************************************************
+*
+* FERIT
+*
+* -----------------------------------------------------
+* Konstrukcijski zadatak kolegij: Digitalna videotehnika
+* -----------------------------------------------------
+*
+* zapsoak.c
+*
+* Purpose: Scripted zapping soak, acceptance benchmark for changes on player path
+*
+* Made on 18.10.2026.
+*****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "zapsoak.h"
+#include "zaptrace.h"
+#include "remote.h"
+
+#define REMOTE_KEY_PROGRAM_DOWN	(61)
+#define REMOTE_KEY_PROGRAM_UP	(62)
+
+/* Mostly up like a viewer browsing, every fourth key goes back so both prepared neighbours get used */
+static const uint16_t soakScript[] = {
+	REMOTE_KEY_PROGRAM_UP,
+	REMOTE_KEY_PROGRAM_UP,
+	REMOTE_KEY_PROGRAM_UP,
+	REMOTE_KEY_PROGRAM_DOWN
+};
+
+static int soakCount;
+static int soakDwellMs;
+
+// Resident set of process in KB, 0 if it cannot be read
+static long residentKb(){
+	FILE *statm = fopen("/proc/self/statm", "r");
+	long size = 0;
+	long resident = 0;
+
+	if(statm == NULL){
+		return 0;
+	}
+	if(fscanf(statm, "%ld %ld", &size, &resident) != 2){
+		resident = 0;
+	}
+	fclose(statm);
+	return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static void printLatency(const char *name, uint32_t *values, uint32_t count){
+	uint32_t p50 = ZapTrace_Percentile(values, count, 50);
+	uint32_t p95 = ZapTrace_Percentile(values, count, 95);
+	uint32_t p99 = ZapTrace_Percentile(values, count, 99);
+
+	printf("\t%-16s p50 %8u us, p95 %8u us, p99 %8u us, max %8u us\n", name, p50, p95, p99,
+		(count > 0) ? values[count - 1] : 0);
+}
+
+static void *soakThread(void *arg){
+	struct input_event key;
+	ZAP_TRACE trace;
+	ZAP_TRACE_REPORT report;
+	uint32_t *streamsUs;
+	uint32_t *bannerUs;
+	uint32_t samples = 0;
+	uint32_t streamFailures = 0;
+	uint32_t noZap = 0;
+	uint32_t timeouts = 0;
+	uint32_t before;
+	uint32_t zap;
+	long rssStart;
+	long rssMax;
+	long rss;
+	int i;
+
+	streamsUs = malloc(soakCount * sizeof(uint32_t));
+	bannerUs = malloc(soakCount * sizeof(uint32_t));
+	if(streamsUs == NULL || bannerUs == NULL){
+		printf("Zap soak: no memory for %d samples\n", soakCount);
+		free(streamsUs);
+		free(bannerUs);
+		return NULL;
+	}
+
+	rssStart = residentKb();
+	rssMax = rssStart;
+	printf("Zap soak: %d zaps, %d ms on each chanell, RSS %ld KB\n", soakCount, soakDwellMs, rssStart);
+
+	for(i = 0; i < soakCount; i++){
+		memset(&key, 0, sizeof(struct input_event));
+		key.type = EV_KEY;
+		key.code = soakScript[i % (sizeof(soakScript) / sizeof(soakScript[0]))];
+		key.value = 0;	/* release, processKey acts on it */
+
+		/* processKey serializes with remote, zapping remote key in between cuts zap being measured */
+		before = ZapTrace_Current();
+		ZapTrace_Event_Time(&key.time);
+		processKey(&key, 0);
+		zap = ZapTrace_Current();
+
+		if(zap == before){
+			noZap++;
+		}
+		else if(ZapTrace_Wait(zap, ZAP_SOAK_TIMEOUT_MS, &trace) != 0){
+			timeouts++;
+		}
+		else{
+			if(trace.failed){
+				streamFailures++;
+			}
+			streamsUs[samples] = trace.stageUs[ZAP_STAGE_STREAMS_DONE];
+			bannerUs[samples] = trace.stageUs[ZAP_STAGE_OSD_FLIP];
+			samples++;
+		}
+
+		if((i + 1) % ZAP_SOAK_RSS_PERIOD == 0){
+			rss = residentKb();
+			if(rss > rssMax){
+				rssMax = rss;
+			}
+			printf("Zap soak: %d of %d zaps, %u timed out, RSS %ld KB\n", i + 1, soakCount, timeouts, rss);
+		}
+		usleep(soakDwellMs * 1000);
+	}
+
+	rss = residentKb();
+	if(rss > rssMax){
+		rssMax = rss;
+	}
+	printf("Zap soak done: %d keys, %u zaps complete, %u with failed streams, %u timed out, %u keys did not zap\n",
+		soakCount, samples, streamFailures, timeouts, noZap);
+	printLatency("key to streams", streamsUs, samples);
+	printLatency("key to banner", bannerUs, samples);
+	printf("\tRSS start %ld KB, end %ld KB, max %ld KB, growth %ld KB\n", rssStart, rss, rssMax, rss - rssStart);
+	ZapTrace_Get_Report(&report);
+	ZapTrace_Print_Report("Zap stages", &report);
+
+	free(streamsUs);
+	free(bannerUs);
+	return NULL;
+}
+
+int ZapSoak_Start(int count, int dwellMs){
+	pthread_t thread;
+
+	if(count <= 0){
+		return -1;
+	}
+	soakCount = count;
+	soakDwellMs = (dwellMs > 0) ? dwellMs : ZAP_SOAK_DEFAULT_DWELL_MS;
+	if(pthread_create(&thread, NULL, soakThread, NULL) != 0){
+		printf("Zap soak: thread not started\n");
+		return -1;
+	}
+	pthread_detach(thread);
+	return 0;
+}
@@ -0,0 +1,310 @@
+/****************************************************************************
+*
+* FERIT
+*
+* -----------------------------------------------------
+* Konstrukcijski zadatak kolegij: Digitalna videotehnika
+* -----------------------------------------------------
+*
+* zaptrace.c
+*
+* Purpose: End to end zap latency, stages from remote key event to first chanell banner on screen
+*
+* Made on 18.10.2026.
+*****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "zaptrace.h"
+
+#define KEY_EVENT_MAX_AGE_US	(10000000)	/* older event time means clock is not what we think */
+
+/* Nothing in progress, zap waits for banner */
+typedef enum TRACE_STATE{
+	TRACE_IDLE = 0,
+	TRACE_ZAP
+}TRACE_STATE;
+
+static const char *stageNames[ZAP_STAGE_COUNT] = {
+	"key event",
+	"key read",
+	"process key",
+	"audio remove",
+	"video remove",
+	"video create",
+	"audio create",
+	"streams done",
+	"osd flip"
+};
+
+static pthread_mutex_t traceMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t traceCondition;
+static int traceInitDone = 0;
+static int eventClockMonotonic = 0;
+
+static TRACE_STATE state = TRACE_IDLE;
+static ZAP_TRACE current;
+static uint64_t keyUs;
+static uint32_t sequence = 0;
+
+/* Last zap that ended, waiters look here */
+static ZAP_TRACE lastTrace;
+static uint32_t lastSequence = 0;
+static int lastComplete = 0;
+
+static ZAP_TRACE history[ZAP_TRACE_HISTORY];
+static uint32_t zaps = 0;
+static uint32_t completed = 0;
+static uint32_t failed = 0;
+static uint32_t unfinished = 0;
+
+/* Report works on copy of history, too big for stack of graphic or remote thread */
+static uint32_t reportValues[ZAP_TRACE_HISTORY];
+
+static uint64_t clockUs(clockid_t clock){
+	struct timespec now;
+
+	clock_gettime(clock, &now);
+	return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+uint64_t ZapTrace_Now_Us(){
+	return clockUs(CLOCK_MONOTONIC);
+}
+
+void ZapTrace_Init(){
+	pthread_condattr_t attr;
+
+	if(!traceInitDone){
+		pthread_condattr_init(&attr);
+		pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+		pthread_cond_init(&traceCondition, &attr);
+		pthread_condattr_destroy(&attr);
+		traceInitDone = 1;
+	}
+}
+
+void ZapTrace_Set_Event_Clock(int monotonic){
+	pthread_mutex_lock(&traceMutex);
+	eventClockMonotonic = monotonic;
+	pthread_mutex_unlock(&traceMutex);
+}
+
+void ZapTrace_Event_Time(struct timeval *eventTime){
+	uint64_t now;
+
+	pthread_mutex_lock(&traceMutex);
+	now = clockUs(eventClockMonotonic ? CLOCK_MONOTONIC : CLOCK_REALTIME);
+	pthread_mutex_unlock(&traceMutex);
+	eventTime->tv_sec = now / 1000000;
+	eventTime->tv_usec = now % 1000000;
+}
+
+// Caller holds traceMutex
+static void finishZap(int complete){
+	if(complete){
+		history[completed % ZAP_TRACE_HISTORY] = current;
+		completed++;
+		if(current.failed){
+			failed++;
+		}
+	}
+	else{
+		unfinished++;
+	}
+	lastTrace = current;
+	lastSequence = current.sequence;
+	lastComplete = complete;
+	state = TRACE_IDLE;
+	if(traceInitDone){
+		pthread_cond_broadcast(&traceCondition);
+	}
+}
+
+// Caller holds traceMutex
+static void setStage(ZAP_STAGE stage, uint64_t now){
+	current.stageUs[stage] = (now > keyUs) ? (uint32_t)(now - keyUs) : 0;
+	current.stageMask |= 1u << stage;
+}
+
+uint32_t ZapTrace_Begin(const struct timeval *eventTime, uint64_t readUs, uint64_t processUs){
+	uint64_t now = ZapTrace_Now_Us();
+	uint64_t eventUs;
+	uint32_t zap;
+
+	pthread_mutex_lock(&traceMutex);
+	if(state == TRACE_ZAP){
+		/* Banner of previous zap never came */
+		finishZap(0);
+	}
+	memset(&current, 0, sizeof(ZAP_TRACE));
+
+	keyUs = now;
+	if(eventTime != NULL){
+		eventUs = (uint64_t)eventTime->tv_sec * 1000000 + eventTime->tv_usec;
+		/* Wall clock event time is moved to monotonic clock, it is off by NTP steps made since */
+		if(!eventClockMonotonic){
+			eventUs -= clockUs(CLOCK_REALTIME) - now;
+		}
+		if(eventUs <= now && now - eventUs < KEY_EVENT_MAX_AGE_US){
+			keyUs = eventUs;
+		}
+	}
+	setStage(ZAP_STAGE_KEY_EVENT, keyUs);
+	if(readUs != 0){
+		setStage(ZAP_STAGE_KEY_READ, readUs);
+	}
+	if(processUs != 0){
+		setStage(ZAP_STAGE_PROCESS_KEY, processUs);
+	}
+	current.sequence = ++sequence;
+	zap = current.sequence;
+	zaps++;
+	state = TRACE_ZAP;
+	pthread_mutex_unlock(&traceMutex);
+	return zap;
+}
+
+void ZapTrace_Mark(ZAP_STAGE stage){
+	uint64_t now = ZapTrace_Now_Us();
+
+	if(stage >= ZAP_STAGE_COUNT){
+		return;
+	}
+	pthread_mutex_lock(&traceMutex);
+	/* Player stages outside of zap started by key (PMT update, startup) are not traced */
+	if(state != TRACE_ZAP || (current.stageMask & (1u << stage))){
+		pthread_mutex_unlock(&traceMutex);
+		return;
+	}
+	/* Banner drawn before streams are switched is for previous chanell */
+	if(stage == ZAP_STAGE_OSD_FLIP && !(current.stageMask & (1u << ZAP_STAGE_STREAMS_DONE))){
+		pthread_mutex_unlock(&traceMutex);
+		return;
+	}
+	setStage(stage, now);
+	if(stage == ZAP_STAGE_OSD_FLIP){
+		finishZap(1);
+	}
+	pthread_mutex_unlock(&traceMutex);
+}
+
+void ZapTrace_Fail(){
+	pthread_mutex_lock(&traceMutex);
+	if(state == TRACE_ZAP){
+		current.failed = 1;
+	}
+	pthread_mutex_unlock(&traceMutex);
+}
+
+uint32_t ZapTrace_Current(){
+	uint32_t zap;
+
+	pthread_mutex_lock(&traceMutex);
+	zap = sequence;
+	pthread_mutex_unlock(&traceMutex);
+	return zap;
+}
+
+int ZapTrace_Wait(uint32_t zap, uint32_t timeoutMs, ZAP_TRACE *trace){
+	struct timespec deadline;
+	int result = -1;
+
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	deadline.tv_sec += timeoutMs / 1000;
+	deadline.tv_nsec += (timeoutMs % 1000) * 1000000;
+	if(deadline.tv_nsec >= 1000000000){
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000;
+	}
+
+	pthread_mutex_lock(&traceMutex);
+	while((int32_t)(lastSequence - zap) < 0){
+		if(pthread_cond_timedwait(&traceCondition, &traceMutex, &deadline) != 0){
+			break;
+		}
+	}
+	if(lastSequence == zap && lastComplete){
+		*trace = lastTrace;
+		result = 0;
+	}
+	pthread_mutex_unlock(&traceMutex);
+	return result;
+}
+
+static int compareUs(const void *a, const void *b){
+	uint32_t first = *(const uint32_t *)a;
+	uint32_t second = *(const uint32_t *)b;
+
+	return (first > second) - (first < second);
+}
+
+uint32_t ZapTrace_Percentile(uint32_t *values, uint32_t count, uint32_t percent){
+	uint32_t rank;
+
+	if(count == 0){
+		return 0;
+	}
+	qsort(values, count, sizeof(uint32_t), compareUs);
+	rank = (uint32_t)(((uint64_t)count * percent + 99) / 100);
+	return values[(rank > 0) ? rank - 1 : 0];
+}
+
+void ZapTrace_Get_Report(ZAP_TRACE_REPORT *report){
+	uint32_t samples;
+	uint32_t count;
+	uint32_t i;
+	int stage;
+
+	memset(report, 0, sizeof(ZAP_TRACE_REPORT));
+	pthread_mutex_lock(&traceMutex);
+	report->zaps = zaps;
+	report->completed = completed;
+	report->failed = failed;
+	report->unfinished = unfinished;
+	samples = (completed < ZAP_TRACE_HISTORY) ? completed : ZAP_TRACE_HISTORY;
+	report->samples = samples;
+
+	for(stage = 0; stage < ZAP_STAGE_COUNT; stage++){
+		count = 0;
+		for(i = 0; i < samples; i++){
+			if(history[i].stageMask & (1u << stage)){
+				reportValues[count++] = history[i].stageUs[stage];
+			}
+		}
+		report->stageCount[stage] = count;
+		report->p50Us[stage] = ZapTrace_Percentile(reportValues, count, 50);
+		report->p95Us[stage] = ZapTrace_Percentile(reportValues, count, 95);
+		report->p99Us[stage] = ZapTrace_Percentile(reportValues, count, 99);
+		report->maxUs[stage] = (count > 0) ? reportValues[count - 1] : 0;
+	}
+	pthread_mutex_unlock(&traceMutex);
+}
+
+void ZapTrace_Print_Report(const char *title, const ZAP_TRACE_REPORT *report){
+	int stage;
+
+	printf("%s: %u zaps, %u complete, %u with failed streams, %u cut by next zap\n", title,
+		report->zaps, report->completed, report->failed, report->unfinished);
+	if(report->samples == 0){
+		return;
+	}
+	printf("\t%-14s %10s %10s %10s %10s   (last %u zaps, us from key event)\n", "stage", "p50", "p95", "p99", "max", report->samples);
+	for(stage = ZAP_STAGE_KEY_READ; stage < ZAP_STAGE_COUNT; stage++){
+		if(report->stageCount[stage] == 0){
+			continue;
+		}
+		printf("\t%-14s %10u %10u %10u %10u   %u\n", stageNames[stage], report->p50Us[stage], report->p95Us[stage],
+			report->p99Us[stage], report->maxUs[stage], report->stageCount[stage]);
+	}
+}
+
+const char *ZapTrace_Stage_Name(ZAP_STAGE stage){
+	if(stage >= ZAP_STAGE_COUNT){
+		return "unknown";
+	}
+	return stageNames[stage];
+}
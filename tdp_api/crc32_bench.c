@@ -0,0 +1,234 @@
+/********************************************************
+*
+* FILE NAME: $URL$  crc32_bench.c
+*            $Date$
+*            $Rev$
+*
+* DESCRIPTION
+*
+* Host side micro-benchmark for crc32_mpeg2 engines.
+* Prints MB/s per engine for typical section sizes and
+* cross-validates every engine against the legacy
+* p_writeChecksum algorithm. Optional argument is a file
+* with recorded sections stored back to back, each of them
+* is checked with every engine.
+*
+* Usage: crc32_bench [sections.bin]
+*
+*********************************************************/
+/********************************************************/
+/*                 Includes                             */
+/********************************************************/
+#include "crc32_mpeg2.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/********************************************************/
+/*                 Defines                              */
+/********************************************************/
+#define BENCH_TOTAL_BYTES   (64*1024*1024)
+#define SECTION_SIZE_INFO   3
+#define MY_SECTION_MAX_SIZE (4096+3)
+
+/********************************************************/
+/*                 Local Functions Declarations         */
+/********************************************************/
+static uint32_t legacyChecksum(const uint8_t *block, size_t length);
+static double nowSeconds(void);
+static int32_t crossValidate(const uint8_t *data, size_t length);
+static int32_t checkRecordedSections(const char *fileName);
+
+/********************************************************/
+/*                 Functions Definitions                */
+/********************************************************/
+
+/* Legacy per-byte CRC as it was in tdp_api.c p_writeChecksum */
+static uint32_t legacyChecksum(const uint8_t *block, size_t length)
+{
+    static uint32_t table[256];
+    static int tableDone = 0;
+    uint8_t const * const end = block + length;
+    uint32_t crc32 = 0xFFFFFFFF;
+
+    if (!tableDone)
+    {
+        int i, bit;
+        for (i = 0; i < 256; i++)
+        {
+            uint32_t coef32 = (uint32_t) i << 24;
+            for (bit = 0; bit < 8; bit++)
+                coef32 = (coef32 & 0x80000000) ? ((coef32 << 1) ^ 0x04C11DB7) : (coef32 << 1);
+            table[i] = coef32;
+        }
+        tableDone = 1;
+    }
+
+    for (; block < end; block++)
+        crc32 = (crc32 << 8) ^ table[((crc32 >> 24) ^ *block) & 0xFF];
+
+    return crc32;
+}
+
+static double nowSeconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Every available engine must match legacy result on every prefix length, whole and split */
+static int32_t crossValidate(const uint8_t *data, size_t length)
+{
+    size_t len;
+    int32_t engine;
+    int32_t errors = 0;
+
+    for (len = 0; len <= length; len++)
+    {
+        uint32_t expected = legacyChecksum(data, len);
+        for (engine = 0; engine < CRC32_ENGINE_COUNT; engine++)
+        {
+            if (!Crc32_Mpeg2_Engine_Available(engine))
+            {
+                continue;
+            }
+            if (Crc32_Mpeg2_Update(engine, CRC32_MPEG2_INIT, data, len) != expected)
+            {
+                printf("MISMATCH %s length %u\n", Crc32_Mpeg2_Engine_Name(engine), (unsigned)len);
+                errors++;
+            }
+            /* Continued CRC must not depend on where the block was split */
+            if (Crc32_Mpeg2_Update(engine, Crc32_Mpeg2_Update(engine, CRC32_MPEG2_INIT, data, len / 3),
+                                   data + len / 3, len - len / 3) != expected)
+            {
+                printf("MISMATCH %s length %u split at %u\n", Crc32_Mpeg2_Engine_Name(engine), (unsigned)len, (unsigned)(len / 3));
+                errors++;
+            }
+        }
+    }
+    return errors;
+}
+
+/* Walk file of back to back sections, every section must give CRC 0 */
+static int32_t checkRecordedSections(const char *fileName)
+{
+    FILE *file;
+    uint8_t section[MY_SECTION_MAX_SIZE];
+    uint32_t sectionCount = 0;
+    int32_t errors = 0;
+    int32_t engine;
+
+    file = fopen(fileName, "rb");
+    if (NULL == file)
+    {
+        printf("Cannot open %s\n", fileName);
+        return 1;
+    }
+
+    while (fread(section, 1, SECTION_SIZE_INFO, file) == SECTION_SIZE_INFO)
+    {
+        size_t sectionSize = (size_t)(section[2] | ((section[1] & 0x0F) << 8));
+
+        if (fread(&section[SECTION_SIZE_INFO], 1, sectionSize, file) != sectionSize)
+        {
+            printf("Truncated section %u\n", sectionCount);
+            break;
+        }
+        sectionCount++;
+
+        /* TDT carries no CRC */
+        if (section[0] == 0x70)
+        {
+            continue;
+        }
+
+        for (engine = 0; engine < CRC32_ENGINE_COUNT; engine++)
+        {
+            uint32_t crc;
+
+            if (!Crc32_Mpeg2_Engine_Available(engine))
+            {
+                continue;
+            }
+            crc = Crc32_Mpeg2_Update(engine, CRC32_MPEG2_INIT, section, sectionSize + SECTION_SIZE_INFO);
+            if (crc != legacyChecksum(section, sectionSize + SECTION_SIZE_INFO) || crc != 0)
+            {
+                printf("Section %u table 0x%02x: %s CRC 0x%08x\n", sectionCount, section[0], Crc32_Mpeg2_Engine_Name(engine), crc);
+                errors++;
+            }
+        }
+    }
+    fclose(file);
+
+    printf("Recorded sections: %u checked, %d errors\n", sectionCount, errors);
+    return errors;
+}
+
+int main(int argc, char **argv)
+{
+    static const size_t sizes[] = { 16, 188, 1024, MY_SECTION_MAX_SIZE };
+    uint8_t *data;
+    size_t i;
+    int32_t engine;
+    int32_t errors;
+
+    Crc32_Mpeg2_Init();
+    printf("Selected engine: %s\n", Crc32_Mpeg2_Engine_Name(Crc32_Mpeg2_Selected_Engine()));
+
+    data = malloc(MY_SECTION_MAX_SIZE);
+    if (NULL == data)
+    {
+        return 1;
+    }
+    srand(1);
+    for (i = 0; i < MY_SECTION_MAX_SIZE; i++)
+    {
+        data[i] = (uint8_t)rand();
+    }
+
+    errors = crossValidate(data, 1024);
+    printf("Cross-validation against legacy CRC: %s\n", errors ? "FAILED" : "OK");
+
+    printf("\n%-14s", "engine");
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        printf("%8u B", (unsigned)sizes[i]);
+    }
+    printf("   (MB/s)\n");
+
+    for (engine = -1; engine < CRC32_ENGINE_COUNT; engine++)
+    {
+        if (engine >= 0 && !Crc32_Mpeg2_Engine_Available(engine))
+        {
+            continue;
+        }
+        printf("%-14s", (engine < 0) ? "legacy" : Crc32_Mpeg2_Engine_Name(engine));
+        for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+        {
+            size_t iterations = BENCH_TOTAL_BYTES / sizes[i];
+            volatile uint32_t sink = 0;
+            double start, elapsed;
+            size_t n;
+
+            start = nowSeconds();
+            for (n = 0; n < iterations; n++)
+            {
+                sink ^= (engine < 0) ? legacyChecksum(data, sizes[i])
+                                     : Crc32_Mpeg2_Update(engine, CRC32_MPEG2_INIT, data, sizes[i]);
+            }
+            elapsed = nowSeconds() - start;
+            printf("%10.1f", (iterations * sizes[i]) / (elapsed * 1024.0 * 1024.0));
+        }
+        printf("\n");
+    }
+
+    if (argc > 1)
+    {
+        errors += checkRecordedSections(argv[1]);
+    }
+
+    free(data);
+    return errors ? 1 : 0;
+}
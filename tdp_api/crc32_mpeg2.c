@@ -0,0 +1,452 @@
+/********************************************************
+*
+* FILE NAME: $URL$  crc32_mpeg2.c
+*            $Date$
+*            $Rev$
+*
+* DESCRIPTION
+*
+* CRC-32/MPEG-2 engines with runtime selection. Slicing-by-8
+* is the portable fast path, ARMv8 CRC32 instructions are used
+* when the binary is built for and runs on such a core, and
+* PCLMULQDQ folding when an x86 host CPU reports it.
+*
+*********************************************************/
+/********************************************************/
+/*                 Includes                             */
+/********************************************************/
+#include "crc32_mpeg2.h"
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CRC32_HAVE_PCLMUL
+#endif
+
+/********************************************************/
+/*                 Defines                              */
+/********************************************************/
+#define CRC32_MAX_COEFFICIENTS 256
+#define CRC32_POLYNOMIAL           0x04C11DB7
+#define CRC32_SLICES               8
+#define CRC32_CHECK_VALUE          0x0376E6E7  /* CRC of "123456789" */
+#define CRC32_FOLD_MIN_LENGTH      32          /* shorter blocks are faster on tables */
+
+/********************************************************/
+/*                 Typedefs                             */
+/********************************************************/
+typedef uint32_t (*t_Crc32Function)(uint32_t crc, const uint8_t *data, size_t length);
+
+/********************************************************/
+/*                 Local File Variables                 */
+/********************************************************/
+static uint32_t crc32_table[CRC32_SLICES][CRC32_MAX_COEFFICIENTS];
+static pthread_once_t crc32InitOnce = PTHREAD_ONCE_INIT;
+static t_Crc32Engine crc32SelectedEngine = CRC32_ENGINE_BYTEWISE;
+static t_Crc32Function crc32Selected = NULL;
+static int32_t crc32EngineAvailable[CRC32_ENGINE_COUNT];
+#if defined(CRC32_HAVE_PCLMUL)
+/* x^n mod P pairs, high qword multiplies upper 64 bits of lane, low qword lower 64 bits */
+static uint64_t crc32Fold128[2];
+static uint64_t crc32Fold512[2];
+#endif
+
+static const char *crc32EngineNames[CRC32_ENGINE_COUNT] =
+{
+    "bytewise",
+    "slicing-by-8",
+    "armv8-crc32",
+    "pclmul-fold"
+};
+
+/********************************************************/
+/*                 Local Functions Declarations         */
+/********************************************************/
+static void p_crc32BuildTables(void);
+static void p_crc32Select(void);
+static uint32_t p_crc32Bytewise(uint32_t crc, const uint8_t *data, size_t length);
+static uint32_t p_crc32Slicing8(uint32_t crc, const uint8_t *data, size_t length);
+#if defined(__ARM_FEATURE_CRC32)
+static uint32_t p_crc32Armv8(uint32_t crc, const uint8_t *data, size_t length);
+#endif
+#if defined(CRC32_HAVE_PCLMUL)
+static uint32_t p_crc32XPowMod(uint32_t power);
+static uint32_t p_crc32Pclmul(uint32_t crc, const uint8_t *data, size_t length);
+#endif
+
+static const t_Crc32Function crc32Functions[CRC32_ENGINE_COUNT] =
+{
+    p_crc32Bytewise,
+    p_crc32Slicing8,
+#if defined(__ARM_FEATURE_CRC32)
+    p_crc32Armv8,
+#else
+    NULL,
+#endif
+#if defined(CRC32_HAVE_PCLMUL)
+    p_crc32Pclmul
+#else
+    NULL
+#endif
+};
+
+/********************************************************/
+/*                 Functions Definitions                */
+/********************************************************/
+
+/***********************************************************************
+* Function Name : p_crc32BuildTables
+*
+* Description   : Builds byte table and the seven slicing-by-8 tables
+*
+* Comment       : crc32_table[k][i] is the CRC of byte i followed by k
+*                 zero bytes.
+*
+**********************************************************************/
+static void p_crc32BuildTables(void)
+{
+    int loopCntCoef, loopCntBit, slice;
+
+    for (loopCntCoef = 0; loopCntCoef < CRC32_MAX_COEFFICIENTS; loopCntCoef++)
+    {
+        uint32_t coef32 = (uint32_t) loopCntCoef << 24;
+
+        for (loopCntBit = 0; loopCntBit < 8; loopCntBit++)
+            if (coef32 & 0x80000000)
+                coef32 = ((coef32 << 1) ^ CRC32_POLYNOMIAL);
+            else
+                coef32 <<= 1;
+
+        crc32_table[0][loopCntCoef] = coef32;
+    }
+
+    for (slice = 1; slice < CRC32_SLICES; slice++)
+    {
+        for (loopCntCoef = 0; loopCntCoef < CRC32_MAX_COEFFICIENTS; loopCntCoef++)
+        {
+            uint32_t prev = crc32_table[slice - 1][loopCntCoef];
+            crc32_table[slice][loopCntCoef] = (prev << 8) ^ crc32_table[0][prev >> 24];
+        }
+    }
+}
+
+/***********************************************************************
+* Function Name : p_crc32Bytewise
+*
+* Description   : Reference engine, same algorithm p_writeChecksum
+*                 always used
+*
+**********************************************************************/
+static uint32_t p_crc32Bytewise(uint32_t crc, const uint8_t *data, size_t length)
+{
+    uint8_t const * const end = data + length;
+
+    for (; data < end; data++)
+        crc = (crc << 8) ^ crc32_table[0][((crc >> 24) ^ *data) & 0x000000FF];
+
+    return crc;
+}
+
+/***********************************************************************
+* Function Name : p_crc32Slicing8
+*
+* Description   : Eight independent table lookups per eight bytes
+*
+* Comment       : Bytes are assembled explicitly so the loop is endian
+*                 and alignment neutral.
+*
+**********************************************************************/
+static uint32_t p_crc32Slicing8(uint32_t crc, const uint8_t *data, size_t length)
+{
+    while (length >= 8)
+    {
+        uint32_t one = crc ^ (((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) |
+                              ((uint32_t)data[2] << 8)  |  (uint32_t)data[3]);
+        uint32_t two =        (((uint32_t)data[4] << 24) | ((uint32_t)data[5] << 16) |
+                              ((uint32_t)data[6] << 8)  |  (uint32_t)data[7]);
+
+        crc = crc32_table[7][one >> 24]          ^
+              crc32_table[6][(one >> 16) & 0xFF] ^
+              crc32_table[5][(one >> 8) & 0xFF]  ^
+              crc32_table[4][one & 0xFF]         ^
+              crc32_table[3][two >> 24]          ^
+              crc32_table[2][(two >> 16) & 0xFF] ^
+              crc32_table[1][(two >> 8) & 0xFF]  ^
+              crc32_table[0][two & 0xFF];
+
+        data += 8;
+        length -= 8;
+    }
+
+    return p_crc32Bytewise(crc, data, length);
+}
+
+#if defined(__ARM_FEATURE_CRC32)
+/***********************************************************************
+* Function Name : p_crc32Armv8
+*
+* Description   : CRC32 instructions on bit mirrored data
+*
+* Comment       : ARMv8 CRC32 instructions implement the reflected form
+*                 of polynomial 0x04C11DB7. Mirroring every input byte
+*                 and the CRC register turns that into the MPEG-2 form.
+*
+**********************************************************************/
+static uint32_t p_crc32Armv8(uint32_t crc, const uint8_t *data, size_t length)
+{
+    crc = __rbit(crc);
+
+    while (length >= 8)
+    {
+        uint64_t word;
+
+        memcpy(&word, data, sizeof(word));
+        crc = __crc32d(crc, __rbitll(__revll(word)));
+        data += 8;
+        length -= 8;
+    }
+
+    while (length--)
+    {
+        crc = __crc32b(crc, (uint8_t)(__rbit(*data++) >> 24));
+    }
+
+    return __rbit(crc);
+}
+#endif
+
+#if defined(CRC32_HAVE_PCLMUL)
+/***********************************************************************
+* Function Name : p_crc32XPowMod
+*
+* Description   : Remainder of x^power divided by the polynomial
+*
+**********************************************************************/
+static uint32_t p_crc32XPowMod(uint32_t power)
+{
+    uint32_t remainder = 1;
+
+    while (power--)
+    {
+        remainder = (remainder & 0x80000000) ? ((remainder << 1) ^ CRC32_POLYNOMIAL) : (remainder << 1);
+    }
+    return remainder;
+}
+
+/***********************************************************************
+* Function Name : p_crc32Pclmul
+*
+* Description   : Carry-less multiply folding of 16 byte blocks
+*
+* Comment       : Blocks are byte reversed so the first byte is the
+*                 highest term, which is the MPEG-2 (not reflected)
+*                 bit order. Four lanes are folded 64 bytes ahead
+*                 while data lasts, then into one lane and 16 bytes
+*                 ahead. Folding keeps the value congruent modulo P,
+*                 so the last lane and the tail are reduced with the
+*                 slicing-by-8 tables starting from CRC 0.
+*
+**********************************************************************/
+__attribute__((target("pclmul,ssse3")))
+static uint32_t p_crc32Pclmul(uint32_t crc, const uint8_t *data, size_t length)
+{
+    const __m128i reverse = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const __m128i fold128 = _mm_set_epi64x((long long)crc32Fold128[1], (long long)crc32Fold128[0]);
+    const __m128i fold512 = _mm_set_epi64x((long long)crc32Fold512[1], (long long)crc32Fold512[0]);
+    __m128i lane[4];
+    uint8_t last[16];
+    int i;
+
+    if (length < CRC32_FOLD_MIN_LENGTH)
+    {
+        return p_crc32Slicing8(crc, data, length);
+    }
+
+#define CRC32_LOAD(offset)  _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + (offset))), reverse)
+#define CRC32_FOLD(value, constant) \
+    _mm_xor_si128(_mm_clmulepi64_si128((value), (constant), 0x11), _mm_clmulepi64_si128((value), (constant), 0x00))
+
+    if (length >= 64)
+    {
+        for (i = 0; i < 4; i++)
+        {
+            lane[i] = CRC32_LOAD(16 * i);
+        }
+        lane[0] = _mm_xor_si128(lane[0], _mm_set_epi32((int)crc, 0, 0, 0));
+        data += 64;
+        length -= 64;
+
+        while (length >= 64)
+        {
+            for (i = 0; i < 4; i++)
+            {
+                lane[i] = _mm_xor_si128(CRC32_FOLD(lane[i], fold512), CRC32_LOAD(16 * i));
+            }
+            data += 64;
+            length -= 64;
+        }
+        for (i = 1; i < 4; i++)
+        {
+            lane[0] = _mm_xor_si128(CRC32_FOLD(lane[0], fold128), lane[i]);
+        }
+    }
+    else
+    {
+        lane[0] = _mm_xor_si128(CRC32_LOAD(0), _mm_set_epi32((int)crc, 0, 0, 0));
+        data += 16;
+        length -= 16;
+    }
+
+    while (length >= 16)
+    {
+        lane[0] = _mm_xor_si128(CRC32_FOLD(lane[0], fold128), CRC32_LOAD(0));
+        data += 16;
+        length -= 16;
+    }
+
+#undef CRC32_FOLD
+#undef CRC32_LOAD
+
+    _mm_storeu_si128((__m128i*)last, _mm_shuffle_epi8(lane[0], reverse));
+    crc = p_crc32Slicing8(0, last, sizeof(last));
+    return p_crc32Slicing8(crc, data, length);
+}
+#endif
+
+/***********************************************************************
+* Function Name : p_crc32Select
+*
+* Description   : Probes engines and selects the fastest one that
+*                 passes the known answer test
+*
+**********************************************************************/
+static void p_crc32Select(void)
+{
+    static const uint8_t check[] = "123456789";
+    int32_t engine;
+
+    p_crc32BuildTables();
+
+    crc32EngineAvailable[CRC32_ENGINE_BYTEWISE] = 1;
+    crc32EngineAvailable[CRC32_ENGINE_SLICING8] = 1;
+    crc32EngineAvailable[CRC32_ENGINE_ARMV8] = 0;
+    crc32EngineAvailable[CRC32_ENGINE_PCLMUL] = 0;
+
+#if defined(__ARM_FEATURE_CRC32)
+#if defined(__aarch64__)
+    crc32EngineAvailable[CRC32_ENGINE_ARMV8] = (getauxval(AT_HWCAP) & HWCAP_CRC32) ? 1 : 0;
+#else
+    crc32EngineAvailable[CRC32_ENGINE_ARMV8] = (getauxval(AT_HWCAP2) & HWCAP2_CRC32) ? 1 : 0;
+#endif
+#endif
+
+#if defined(CRC32_HAVE_PCLMUL)
+    /* Lane H*x^64 + L moved n bits ahead is H*(x^(n+64) mod P) + L*(x^n mod P) */
+    crc32Fold128[1] = p_crc32XPowMod(128 + 64);
+    crc32Fold128[0] = p_crc32XPowMod(128);
+    crc32Fold512[1] = p_crc32XPowMod(512 + 64);
+    crc32Fold512[0] = p_crc32XPowMod(512);
+    __builtin_cpu_init();
+    crc32EngineAvailable[CRC32_ENGINE_PCLMUL] = (__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("ssse3")) ? 1 : 0;
+#endif
+
+    crc32SelectedEngine = CRC32_ENGINE_BYTEWISE;
+    for (engine = 0; engine < CRC32_ENGINE_COUNT; engine++)
+    {
+        if (!crc32EngineAvailable[engine] || NULL == crc32Functions[engine])
+        {
+            crc32EngineAvailable[engine] = 0;
+            continue;
+        }
+        if (crc32Functions[engine](CRC32_MPEG2_INIT, check, sizeof(check) - 1) != CRC32_CHECK_VALUE)
+        {
+            printf("\n%s: %s engine failed self test, disabled\n", __FUNCTION__, crc32EngineNames[engine]);
+            crc32EngineAvailable[engine] = 0;
+            continue;
+        }
+        crc32SelectedEngine = (t_Crc32Engine)engine;
+    }
+
+    crc32Selected = crc32Functions[crc32SelectedEngine];
+}
+
+/***********************************************************************
+* Function Name : Crc32_Mpeg2_Init
+*
+**********************************************************************/
+void Crc32_Mpeg2_Init(void)
+{
+    pthread_once(&crc32InitOnce, p_crc32Select);
+}
+
+/***********************************************************************
+* Function Name : Crc32_Mpeg2
+*
+**********************************************************************/
+uint32_t Crc32_Mpeg2(const uint8_t *data, size_t length)
+{
+    if (NULL == crc32Selected)
+    {
+        Crc32_Mpeg2_Init();
+    }
+    return crc32Selected(CRC32_MPEG2_INIT, data, length);
+}
+
+/***********************************************************************
+* Function Name : Crc32_Mpeg2_Update
+*
+**********************************************************************/
+uint32_t Crc32_Mpeg2_Update(t_Crc32Engine engine, uint32_t crc, const uint8_t *data, size_t length)
+{
+    Crc32_Mpeg2_Init();
+    if (engine >= CRC32_ENGINE_COUNT || !crc32EngineAvailable[engine])
+    {
+        return 0;
+    }
+    return crc32Functions[engine](crc, data, length);
+}
+
+/***********************************************************************
+* Function Name : Crc32_Mpeg2_Engine_Available
+*
+**********************************************************************/
+int32_t Crc32_Mpeg2_Engine_Available(t_Crc32Engine engine)
+{
+    Crc32_Mpeg2_Init();
+    if (engine >= CRC32_ENGINE_COUNT)
+    {
+        return 0;
+    }
+    return crc32EngineAvailable[engine];
+}
+
+/***********************************************************************
+* Function Name : Crc32_Mpeg2_Selected_Engine
+*
+**********************************************************************/
+t_Crc32Engine Crc32_Mpeg2_Selected_Engine(void)
+{
+    Crc32_Mpeg2_Init();
+    return crc32SelectedEngine;
+}
+
+/***********************************************************************
+* Function Name : Crc32_Mpeg2_Engine_Name
+*
+**********************************************************************/
+const char* Crc32_Mpeg2_Engine_Name(t_Crc32Engine engine)
+{
+    if (engine >= CRC32_ENGINE_COUNT)
+    {
+        return "unknown";
+    }
+    return crc32EngineNames[engine];
+}
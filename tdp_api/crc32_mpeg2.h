@@ -0,0 +1,84 @@
+/**
+ * @file crc32_mpeg2.h
+ *
+ * @brief CRC-32/MPEG-2 engines used for PSI section validation
+ *
+ * Polynomial 0x04C11DB7, initial value 0xFFFFFFFF, no reflection and no
+ * final xor. Running the CRC over a whole section including its CRC_32
+ * field yields 0 for an intact section.
+ */
+
+#ifndef CRC32_MPEG2_H_
+#define CRC32_MPEG2_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define CRC32_MPEG2_INIT        0xFFFFFFFF
+
+/**
+ * @brief CRC engine identifiers
+ */
+typedef enum t_Crc32Engine
+{
+    CRC32_ENGINE_BYTEWISE = 0,  /* one table lookup per byte, reference */
+    CRC32_ENGINE_SLICING8 = 1,  /* eight tables, eight bytes per step */
+    CRC32_ENGINE_ARMV8    = 2,  /* ARMv8 CRC32 instructions, bit mirrored */
+    CRC32_ENGINE_PCLMUL   = 3,  /* x86 carry-less multiply folding, 64 bytes per step */
+    CRC32_ENGINE_COUNT    = 4
+}t_Crc32Engine;
+
+/****************************************************************************
+* @brief    Build tables, probe the CPU and select the fastest engine
+*
+* @note     Every candidate engine is checked against a known answer before
+*           it can be selected. Safe to call more than once.
+*
+*****************************************************************************/
+void Crc32_Mpeg2_Init(void);
+
+/****************************************************************************
+* @brief    Calculate CRC over a block with the selected engine
+*
+* @param    [in] data - data block
+* @param    [in] length - block length in bytes
+*
+* @return   CRC value, 0 for a complete section with valid CRC_32 field
+*
+*****************************************************************************/
+uint32_t Crc32_Mpeg2(const uint8_t *data, size_t length);
+
+/****************************************************************************
+* @brief    Continue CRC calculation with a specific engine
+*
+* @param    [in] engine - engine identifier
+* @param    [in] crc - CRC of previous data, CRC32_MPEG2_INIT at start
+* @param    [in] data - data block
+* @param    [in] length - block length in bytes
+*
+* @return   Updated CRC value, 0 if engine is not available
+*
+*****************************************************************************/
+uint32_t Crc32_Mpeg2_Update(t_Crc32Engine engine, uint32_t crc, const uint8_t *data, size_t length);
+
+/****************************************************************************
+* @brief    Check whether engine can run on this CPU
+*
+* @return   1 - available, 0 - not available
+*
+*****************************************************************************/
+int32_t Crc32_Mpeg2_Engine_Available(t_Crc32Engine engine);
+
+/****************************************************************************
+* @brief    Get engine selected by Crc32_Mpeg2_Init
+*
+*****************************************************************************/
+t_Crc32Engine Crc32_Mpeg2_Selected_Engine(void);
+
+/****************************************************************************
+* @brief    Get printable engine name
+*
+*****************************************************************************/
+const char* Crc32_Mpeg2_Engine_Name(t_Crc32Engine engine);
+
+#endif //CRC32_MPEG2_H_
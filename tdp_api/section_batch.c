@@ -0,0 +1,252 @@
+/********************************************************
+*
+* FILE NAME: $URL$  section_batch.c
+*            $Date$
+*            $Rev$
+*
+* DESCRIPTION
+*
+* Walk over sections read from a section filter buffer in
+* one piece. Every header is checked before its length is
+* trusted. Header that cannot be right, or section failing
+* CRC, starts a search for the next offset holding a
+* believable section whose CRC checks out, so one bad
+* length costs the bytes up to the next section and not
+* the whole buffer.
+*
+* Default buffer class goes by the widest table the filter
+* lets through, table_id bits outside mask may take any
+* value.
+*
+*********************************************************/
+/********************************************************/
+/*                 Includes                             */
+/********************************************************/
+#include "section_batch.h"
+#include "crc32_mpeg2.h"
+
+/********************************************************/
+/*                 Defines                              */
+/********************************************************/
+#define TABLE_ID_TDT                    0x70
+#define TABLE_ID_STUFFING               0xFF
+#define SECTION_LENGTH_MAX              4093    /* private sections, PSI stays under 1021 */
+#define SECTION_LENGTH_MIN_SYNTAX       9       /* long header and CRC_32 */
+#define SECTION_LENGTH_TDT              5
+#define TABLE_ID_NIT_FIRST              0x40
+#define TABLE_ID_BAT_LAST               0x4A
+#define TABLE_ID_EIT_FIRST              0x4E
+#define TABLE_ID_EIT_LAST               0x6F
+
+/********************************************************/
+/*                 Local File Variables                 */
+/********************************************************/
+static const uint32_t sectionBufferClassSizes[SECTION_BUFFER_CLASS_COUNT] =
+{
+    SECTION_BATCH_SIZE_LARGE,
+    SECTION_BATCH_SIZE_SMALL,
+    SECTION_BATCH_SIZE_MEDIUM,
+    SECTION_BATCH_SIZE_LARGE
+};
+
+static const char *sectionBufferClassNames[SECTION_BUFFER_CLASS_COUNT] =
+{
+    "auto",
+    "small",
+    "medium",
+    "large"
+};
+
+/********************************************************/
+/*                 Local Functions Declarations         */
+/********************************************************/
+static uint32_t p_batchSectionSize(const uint8_t *section);
+static int32_t p_batchHeaderOk(const uint8_t *section, uint8_t tableID, uint8_t tableMask);
+static int32_t p_batchCrcOk(const uint8_t *section, uint32_t size);
+static uint32_t p_batchResync(const uint8_t *data, uint32_t start, uint32_t length, uint8_t tableID, uint8_t tableMask);
+
+/********************************************************/
+/*                 Functions Definitions                */
+/********************************************************/
+
+/* Whole section size with table_id and section_length bytes */
+static uint32_t p_batchSectionSize(const uint8_t *section)
+{
+    return SECTION_BATCH_HEADER_SIZE + (((section[1] & 0x0F) << 8) | section[2]);
+}
+
+/***********************************************************************
+* Function Name : p_batchHeaderOk
+*
+* Description   : Checks header could start a section of this filter
+*
+* Returns       : 1 - believable, 0 - boundary is lost
+*
+**********************************************************************/
+static int32_t p_batchHeaderOk(const uint8_t *section, uint8_t tableID, uint8_t tableMask)
+{
+    uint32_t sectionLength = p_batchSectionSize(section) - SECTION_BATCH_HEADER_SIZE;
+
+    if (section[0] == TABLE_ID_STUFFING || (section[0] & tableMask) != (tableID & tableMask))
+    {
+        return 0;
+    }
+    if (sectionLength > SECTION_LENGTH_MAX)
+    {
+        return 0;
+    }
+    if (section[0] == TABLE_ID_TDT)
+    {
+        return sectionLength == SECTION_LENGTH_TDT;
+    }
+    if ((section[1] & 0x80) && sectionLength < SECTION_LENGTH_MIN_SYNTAX)
+    {
+        return 0;
+    }
+    return 1;
+}
+
+/* TDT carries no CRC_32, every other table the demux filters does */
+static int32_t p_batchCrcOk(const uint8_t *section, uint32_t size)
+{
+    if (section[0] == TABLE_ID_TDT)
+    {
+        return 1;
+    }
+    return Crc32_Mpeg2(section, size) == 0;
+}
+
+/***********************************************************************
+* Function Name : p_batchResync
+*
+* Description   : Finds next offset holding a believable section
+*
+* Comment       : Complete candidate must pass CRC, candidate running
+*                 past the end is taken as section still being written
+*                 and checked once it is complete.
+*
+* Returns       : Offset of the candidate, or of the last bytes too
+*                 short to hold a header
+*
+**********************************************************************/
+static uint32_t p_batchResync(const uint8_t *data, uint32_t start, uint32_t length, uint8_t tableID, uint8_t tableMask)
+{
+    uint32_t offset;
+
+    for (offset = start; length - offset >= SECTION_BATCH_HEADER_SIZE; offset++)
+    {
+        uint32_t size;
+
+        if (!p_batchHeaderOk(&data[offset], tableID, tableMask))
+        {
+            continue;
+        }
+        size = p_batchSectionSize(&data[offset]);
+        if (size > length - offset || p_batchCrcOk(&data[offset], size))
+        {
+            return offset;
+        }
+    }
+    return offset;
+}
+
+/***********************************************************************
+* Function Name : Section_Batch_Walk
+*
+**********************************************************************/
+uint32_t Section_Batch_Walk(const uint8_t *data, uint32_t length, uint8_t tableID, uint8_t tableMask,
+                            Section_Batch_Handler handler, void *user, t_SectionBatchStats *stats)
+{
+    uint32_t offset = 0;
+    uint32_t found = 0;
+
+    while (length - offset >= SECTION_BATCH_HEADER_SIZE)
+    {
+        const uint8_t *section = &data[offset];
+        uint32_t size;
+
+        if (!p_batchHeaderOk(section, tableID, tableMask))
+        {
+            uint32_t next = p_batchResync(data, offset + 1, length, tableID, tableMask);
+
+            stats->resyncs++;
+            stats->skippedBytes += next - offset;
+            offset = next;
+            continue;
+        }
+
+        size = p_batchSectionSize(section);
+        if (size > length - offset)
+        {
+            break;
+        }
+        if (!p_batchCrcOk(section, size))
+        {
+            /* Broken payload or broken length, search from here tells them apart */
+            uint32_t next;
+
+            handler(section, size, 0, user);
+            next = p_batchResync(data, offset + 1, length, tableID, tableMask);
+            stats->resyncs++;
+            stats->skippedBytes += next - offset;
+            offset = next;
+            continue;
+        }
+        handler(section, size, 1, user);
+        found++;
+        offset += size;
+    }
+
+    stats->sections += found;
+    if (found > stats->batchMax)
+    {
+        stats->batchMax = found;
+    }
+    return offset;
+}
+
+/***********************************************************************
+* Function Name : Section_Batch_Default_Class
+*
+**********************************************************************/
+t_SectionBufferClass Section_Batch_Default_Class(uint8_t tableID, uint8_t tableMask)
+{
+    t_SectionBufferClass bufferClass = SECTION_BUFFER_SMALL;
+    uint32_t table;
+
+    /* Walk every table_id the filter passes, 256 compares once per filter */
+    for (table = 0; table < TABLE_ID_STUFFING; table++)
+    {
+        if ((table & tableMask) != (tableID & tableMask))
+        {
+            continue;
+        }
+        if (table >= TABLE_ID_EIT_FIRST && table <= TABLE_ID_EIT_LAST)
+        {
+            return SECTION_BUFFER_LARGE;
+        }
+        if (table >= TABLE_ID_NIT_FIRST && table <= TABLE_ID_BAT_LAST)
+        {
+            bufferClass = SECTION_BUFFER_MEDIUM;
+        }
+    }
+    return bufferClass;
+}
+
+uint32_t Section_Batch_Class_Size(t_SectionBufferClass bufferClass)
+{
+    if (bufferClass == SECTION_BUFFER_AUTO || bufferClass >= SECTION_BUFFER_CLASS_COUNT)
+    {
+        return SECTION_BATCH_SIZE_LARGE;
+    }
+    return sectionBufferClassSizes[bufferClass];
+}
+
+const char* Section_Batch_Class_Name(t_SectionBufferClass bufferClass)
+{
+    if (bufferClass >= SECTION_BUFFER_CLASS_COUNT)
+    {
+        return "unknown";
+    }
+    return sectionBufferClassNames[bufferClass];
+}
@@ -0,0 +1,105 @@
+/**
+ * @file section_batch.h
+ *
+ * @brief Walks sections packed back to back in a section filter buffer
+ *
+ * Demux section buffer holds every section the filter passed, each one
+ * starting with table_id and section_length. Whole buffer is taken with
+ * one read and walked in place. Header that cannot be right (table_id
+ * outside filter, section_length too big) or section that fails CRC
+ * makes the walk look for the next believable section instead of
+ * throwing the rest of the buffer away.
+ *
+ * Buffer size follows the table: PAT or PMT fits a couple of sections,
+ * EIT schedule needs room for a burst. Size classes keep the footprint
+ * of all filters at or below one large buffer each.
+ */
+
+#ifndef SECTION_BATCH_H_
+#define SECTION_BATCH_H_
+
+#include <stdint.h>
+
+#define SECTION_BATCH_HEADER_SIZE       3
+#define SECTION_BATCH_MAX_SECTION       (4096+3)    /* section_length 4096 with header */
+#define SECTION_BATCH_SIZE_SMALL        (SECTION_BATCH_MAX_SECTION*2)
+#define SECTION_BATCH_SIZE_MEDIUM       (SECTION_BATCH_MAX_SECTION*4)
+#define SECTION_BATCH_SIZE_LARGE        (SECTION_BATCH_MAX_SECTION*8)
+
+/**
+ * @brief Section buffer size classes
+ */
+typedef enum t_SectionBufferClass
+{
+    SECTION_BUFFER_AUTO     = 0,    /* chosen from table_id by Section_Batch_Default_Class */
+    SECTION_BUFFER_SMALL    = 1,    /* single section tables: PAT, CAT, PMT, TDT, TOT */
+    SECTION_BUFFER_MEDIUM   = 2,    /* multi section tables: NIT, SDT, BAT */
+    SECTION_BUFFER_LARGE    = 3,    /* EIT, filters on any table_id */
+    SECTION_BUFFER_CLASS_COUNT = 4
+}t_SectionBufferClass;
+
+/**
+ * @brief Read path counters
+ */
+typedef struct t_SectionBatchStats
+{
+    uint32_t events;        /* section events from demux */
+    uint32_t emptyEvents;   /* events finding buffer already drained by earlier batch */
+    uint32_t reads;         /* reads from section buffers */
+    uint32_t sections;      /* sections found by walks */
+    uint32_t batchMax;      /* most sections found in one read */
+    uint32_t resyncs;       /* times walk lost section boundary and searched for it */
+    uint32_t skippedBytes;  /* bytes dropped while searching */
+    uint32_t readErrors;    /* failed reads, buffer flushed */
+}t_SectionBatchStats;
+
+/**
+ * @brief Called for every section found, section is valid only during the call
+ *
+ * @param    [in] crcOk - 0 if section failed CRC check (always 1 for TDT, it has
+ *                        none), its length may be wrong too, walk does not trust it
+ */
+typedef void (*Section_Batch_Handler)(const uint8_t *section, uint32_t length, int32_t crcOk, void *user);
+
+/****************************************************************************
+* @brief    Hand every complete section of block to handler
+*
+* @param    [in] data - sections back to back, first one starts at data
+* @param    [in] length - block length in bytes
+* @param    [in] tableID - table_id the filter matches
+* @param    [in] tableMask - compared bits of tableID
+* @param    [out] stats - sections, resyncs and skipped bytes are added
+*
+* @return   Bytes used, data from there on is start of a section still
+*           being written (less than SECTION_BATCH_MAX_SECTION bytes)
+*
+*****************************************************************************/
+uint32_t Section_Batch_Walk(const uint8_t *data, uint32_t length, uint8_t tableID, uint8_t tableMask,
+                            Section_Batch_Handler handler, void *user, t_SectionBatchStats *stats);
+
+/****************************************************************************
+* @brief    Pick buffer class for tables filter lets through
+*
+* @param    [in] tableID - table_id the filter matches
+* @param    [in] tableMask - compared bits of tableID
+*
+* @return   Class of the largest table in the range, never SECTION_BUFFER_AUTO
+*
+*****************************************************************************/
+t_SectionBufferClass Section_Batch_Default_Class(uint8_t tableID, uint8_t tableMask);
+
+/****************************************************************************
+* @brief    Get buffer size of class
+*
+* @return   Size in bytes, SECTION_BATCH_SIZE_LARGE for unknown class
+*
+*****************************************************************************/
+uint32_t Section_Batch_Class_Size(t_SectionBufferClass bufferClass);
+
+/****************************************************************************
+* @brief    Get printable class name
+*
+*****************************************************************************/
+const char* Section_Batch_Class_Name(t_SectionBufferClass bufferClass);
+
+#endif //SECTION_BATCH_H_
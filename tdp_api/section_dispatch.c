@@ -0,0 +1,363 @@
+/********************************************************
+*
+* FILE NAME: $URL$  section_dispatch.c
+*            $Date$
+*            $Rev$
+*
+* DESCRIPTION
+*
+* Section dispatcher between demux and application
+* callbacks. Queue is a bounded ring where every cell
+* carries a sequence number: a cell is free for position
+* p when its sequence is p and holds a section for
+* position p when its sequence is p + 1. Posting and
+* taking claim a position with compare-and-swap and
+* publish the cell with a release store, no lock is taken
+* on either side. Dispatcher thread sleeps on a semaphore
+* posted once per queued section.
+*
+*********************************************************/
+/********************************************************/
+/*                 Includes                             */
+/********************************************************/
+#include "section_dispatch.h"
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+/********************************************************/
+/*                 Defines                              */
+/********************************************************/
+#define QUEUE_MASK                      (SECTION_DISPATCH_QUEUE_SIZE - 1)
+
+#define DISPATCH_LOAD(field)            __atomic_load_n(&(field), __ATOMIC_RELAXED)
+#define DISPATCH_STORE(field, value)    __atomic_store_n(&(field), (value), __ATOMIC_RELAXED)
+#define DISPATCH_COUNT(field)           __atomic_fetch_add(&(field), 1, __ATOMIC_RELAXED)
+
+#if (SECTION_DISPATCH_QUEUE_SIZE & QUEUE_MASK) != 0
+#error "SECTION_DISPATCH_QUEUE_SIZE must be power of 2"
+#endif
+
+/********************************************************/
+/*                 Local Functions Declarations         */
+/********************************************************/
+static uint64_t p_dispatchNowUs(void);
+static int32_t p_dispatchPush(t_SectionDispatcher *dispatcher, const t_SectionDispatchEntry *entry);
+static int32_t p_dispatchPop(t_SectionDispatcher *dispatcher, t_SectionDispatchEntry *entry);
+static void p_dispatchMax(uint32_t *field, uint32_t value);
+static void* p_dispatchThread(void *arg);
+
+/********************************************************/
+/*                 Functions Definitions                */
+/********************************************************/
+
+static uint64_t p_dispatchNowUs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* Raise counter to value, several posters may race, one of them wins */
+static void p_dispatchMax(uint32_t *field, uint32_t value)
+{
+    uint32_t current = __atomic_load_n(field, __ATOMIC_RELAXED);
+
+    while (value > current &&
+        !__atomic_compare_exchange_n(field, &current, value, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+    }
+}
+
+/***********************************************************************
+* Function Name : p_dispatchPush
+*
+* Description   : Claims next free cell and publishes entry in it
+*
+* Returns       : 0 - queued, -1 - queue full
+*
+**********************************************************************/
+static int32_t p_dispatchPush(t_SectionDispatcher *dispatcher, const t_SectionDispatchEntry *entry)
+{
+    uint32_t position = __atomic_load_n(&dispatcher->enqueuePosition, __ATOMIC_RELAXED);
+    t_SectionDispatchCell *cell;
+
+    for (;;)
+    {
+        int32_t difference;
+
+        cell = &dispatcher->cells[position & QUEUE_MASK];
+        difference = (int32_t)(__atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE) - position);
+        if (difference == 0)
+        {
+            if (__atomic_compare_exchange_n(&dispatcher->enqueuePosition, &position, position + 1, 1,
+                __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            {
+                break;
+            }
+        }
+        else if (difference < 0)
+        {
+            return -1;
+        }
+        else
+        {
+            position = __atomic_load_n(&dispatcher->enqueuePosition, __ATOMIC_RELAXED);
+        }
+    }
+
+    cell->entry = *entry;
+    __atomic_store_n(&cell->sequence, position + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/***********************************************************************
+* Function Name : p_dispatchPop
+*
+* Description   : Claims oldest queued cell and frees it for posters
+*
+* Returns       : 0 - entry taken, -1 - queue empty
+*
+**********************************************************************/
+static int32_t p_dispatchPop(t_SectionDispatcher *dispatcher, t_SectionDispatchEntry *entry)
+{
+    uint32_t position = __atomic_load_n(&dispatcher->dequeuePosition, __ATOMIC_RELAXED);
+    t_SectionDispatchCell *cell;
+
+    for (;;)
+    {
+        int32_t difference;
+
+        cell = &dispatcher->cells[position & QUEUE_MASK];
+        difference = (int32_t)(__atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE) - (position + 1));
+        if (difference == 0)
+        {
+            if (__atomic_compare_exchange_n(&dispatcher->dequeuePosition, &position, position + 1, 1,
+                __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            {
+                break;
+            }
+        }
+        else if (difference < 0)
+        {
+            return -1;
+        }
+        else
+        {
+            position = __atomic_load_n(&dispatcher->dequeuePosition, __ATOMIC_RELAXED);
+        }
+    }
+
+    *entry = cell->entry;
+    __atomic_store_n(&cell->sequence, position + SECTION_DISPATCH_QUEUE_SIZE, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/***********************************************************************
+* Function Name : p_dispatchThread
+*
+* Description   : Runs callbacks of queued sections in posting order
+*
+* Comment       : Evicted sections leave their semaphore post behind,
+*                 wake-up that finds queue empty is skipped.
+*
+**********************************************************************/
+static void* p_dispatchThread(void *arg)
+{
+    t_SectionDispatcher *dispatcher = (t_SectionDispatcher*)arg;
+    t_SectionDispatchEntry entry;
+
+    for (;;)
+    {
+        uint64_t start;
+        uint64_t end;
+
+        while (sem_wait(&dispatcher->ready) != 0 && errno == EINTR)
+        {
+        }
+        if (DISPATCH_LOAD(dispatcher->stop))
+        {
+            break;
+        }
+        if (p_dispatchPop(dispatcher, &entry) != 0)
+        {
+            continue;
+        }
+
+        start = p_dispatchNowUs();
+        if (dispatcher->handler(&entry) != 0)
+        {
+            DISPATCH_COUNT(dispatcher->stats.stale);
+        }
+        else
+        {
+            DISPATCH_COUNT(dispatcher->stats.dispatched);
+        }
+        end = p_dispatchNowUs();
+        dispatcher->release(entry.buffer);
+
+        p_dispatchMax(&dispatcher->stats.latencyMaxUs, (uint32_t)(start - entry.postedUs));
+        p_dispatchMax(&dispatcher->stats.callbackMaxUs, (uint32_t)(end - start));
+    }
+    return NULL;
+}
+
+/***********************************************************************
+* Function Name : Section_Dispatch_Start
+*
+**********************************************************************/
+int32_t Section_Dispatch_Start(t_SectionDispatcher *dispatcher, Section_Dispatch_Handler handler, Section_Dispatch_Release release)
+{
+    uint32_t policy = dispatcher->policy;
+    uint32_t i;
+
+    if (dispatcher->running)
+    {
+        return 0;
+    }
+
+    /* Policy outlives restarts, counters do not */
+    memset(dispatcher, 0, sizeof(t_SectionDispatcher));
+    dispatcher->policy = policy;
+    for (i = 0; i < SECTION_DISPATCH_QUEUE_SIZE; i++)
+    {
+        dispatcher->cells[i].sequence = i;
+    }
+    dispatcher->handler = handler;
+    dispatcher->release = release;
+
+    if (sem_init(&dispatcher->ready, 0, 0) != 0)
+    {
+        return -1;
+    }
+    if (pthread_create(&dispatcher->thread, NULL, p_dispatchThread, dispatcher) != 0)
+    {
+        sem_destroy(&dispatcher->ready);
+        return -1;
+    }
+    DISPATCH_STORE(dispatcher->running, 1);
+    return 0;
+}
+
+/***********************************************************************
+* Function Name : Section_Dispatch_Stop
+*
+* Comment       : Caller makes sure nothing posts any more, i.e. demux
+*                 event is unregistered or reader stopped.
+*
+**********************************************************************/
+void Section_Dispatch_Stop(t_SectionDispatcher *dispatcher)
+{
+    t_SectionDispatchEntry entry;
+
+    if (!dispatcher->running)
+    {
+        return;
+    }
+    DISPATCH_STORE(dispatcher->running, 0);
+    DISPATCH_STORE(dispatcher->stop, 1);
+    sem_post(&dispatcher->ready);
+    pthread_join(dispatcher->thread, NULL);
+
+    while (p_dispatchPop(dispatcher, &entry) == 0)
+    {
+        dispatcher->release(entry.buffer);
+        DISPATCH_COUNT(dispatcher->stats.droppedOldest);
+    }
+    sem_destroy(&dispatcher->ready);
+}
+
+/***********************************************************************
+* Function Name : Section_Dispatch_Post
+*
+* Comment       : Under drop oldest policy a full queue gives up its
+*                 oldest section, retried as long as other posters keep
+*                 taking the freed cell.
+*
+**********************************************************************/
+int32_t Section_Dispatch_Post(t_SectionDispatcher *dispatcher, uint32_t filterHandle, uint32_t tag, uint8_t *buffer, uint32_t length)
+{
+    t_SectionDispatchEntry entry;
+    uint32_t depth;
+
+    if (!DISPATCH_LOAD(dispatcher->running))
+    {
+        dispatcher->release(buffer);
+        DISPATCH_COUNT(dispatcher->stats.droppedNewest);
+        return -1;
+    }
+
+    entry.filterHandle = filterHandle;
+    entry.tag = tag;
+    entry.buffer = buffer;
+    entry.length = length;
+    entry.postedUs = p_dispatchNowUs();
+
+    while (p_dispatchPush(dispatcher, &entry) != 0)
+    {
+        if (DISPATCH_LOAD(dispatcher->policy) != SECTION_OVERFLOW_DROP_OLDEST || Section_Dispatch_Evict(dispatcher) != 0)
+        {
+            dispatcher->release(buffer);
+            DISPATCH_COUNT(dispatcher->stats.droppedNewest);
+            return -1;
+        }
+    }
+
+    DISPATCH_COUNT(dispatcher->stats.posted);
+    depth = __atomic_load_n(&dispatcher->enqueuePosition, __ATOMIC_RELAXED) -
+        __atomic_load_n(&dispatcher->dequeuePosition, __ATOMIC_RELAXED);
+    if (depth <= SECTION_DISPATCH_QUEUE_SIZE)
+    {
+        p_dispatchMax(&dispatcher->stats.queueHighWater, depth);
+    }
+    sem_post(&dispatcher->ready);
+    return 0;
+}
+
+/***********************************************************************
+* Function Name : Section_Dispatch_Evict
+*
+**********************************************************************/
+int32_t Section_Dispatch_Evict(t_SectionDispatcher *dispatcher)
+{
+    t_SectionDispatchEntry entry;
+
+    if (p_dispatchPop(dispatcher, &entry) != 0)
+    {
+        return -1;
+    }
+    dispatcher->release(entry.buffer);
+    DISPATCH_COUNT(dispatcher->stats.droppedOldest);
+    return 0;
+}
+
+void Section_Dispatch_Set_Policy(t_SectionDispatcher *dispatcher, t_SectionOverflowPolicy policy)
+{
+    DISPATCH_STORE(dispatcher->policy, (uint32_t)policy);
+}
+
+t_SectionOverflowPolicy Section_Dispatch_Get_Policy(const t_SectionDispatcher *dispatcher)
+{
+    return (t_SectionOverflowPolicy)DISPATCH_LOAD(dispatcher->policy);
+}
+
+void Section_Dispatch_Count_Drop(t_SectionDispatcher *dispatcher)
+{
+    DISPATCH_COUNT(dispatcher->stats.droppedNewest);
+}
+
+/***********************************************************************
+* Function Name : Section_Dispatch_Get_Stats
+*
+**********************************************************************/
+void Section_Dispatch_Get_Stats(const t_SectionDispatcher *dispatcher, t_SectionDispatchStats *stats)
+{
+    stats->posted = DISPATCH_LOAD(dispatcher->stats.posted);
+    stats->dispatched = DISPATCH_LOAD(dispatcher->stats.dispatched);
+    stats->stale = DISPATCH_LOAD(dispatcher->stats.stale);
+    stats->droppedNewest = DISPATCH_LOAD(dispatcher->stats.droppedNewest);
+    stats->droppedOldest = DISPATCH_LOAD(dispatcher->stats.droppedOldest);
+    stats->queueHighWater = DISPATCH_LOAD(dispatcher->stats.queueHighWater);
+    stats->latencyMaxUs = DISPATCH_LOAD(dispatcher->stats.latencyMaxUs);
+    stats->callbackMaxUs = DISPATCH_LOAD(dispatcher->stats.callbackMaxUs);
+}
@@ -0,0 +1,147 @@
+/**
+ * @file section_dispatch.h
+ *
+ * @brief Section dispatcher, hands sections from demux to callbacks
+ *
+ * Demux side (PE event callback, file replay reader) posts complete
+ * sections into a bounded lock-free queue and returns, dispatcher thread
+ * takes them out and runs application callbacks. Slow callbacks hold
+ * back only the dispatcher, never the demux read path.
+ *
+ * Queue is a ring of sequence numbered cells, any number of threads may
+ * post and evict, posting costs two atomic operations and a sem_post.
+ */
+
+#ifndef SECTION_DISPATCH_H_
+#define SECTION_DISPATCH_H_
+
+#include <stdint.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+#define SECTION_DISPATCH_QUEUE_SIZE     16      /* power of 2, as many as section pool buffers */
+
+/**
+ * @brief What to drop when a section finds queue or section pool full
+ */
+typedef enum t_SectionOverflowPolicy
+{
+    SECTION_OVERFLOW_DROP_NEWEST = 0,   /* incoming section is dropped, queued ones are kept */
+    SECTION_OVERFLOW_DROP_OLDEST = 1    /* oldest queued section makes room for incoming one */
+}t_SectionOverflowPolicy;
+
+/**
+ * @brief Dispatcher counters
+ */
+typedef struct t_SectionDispatchStats
+{
+    uint32_t posted;        /* sections queued by demux */
+    uint32_t dispatched;    /* sections handed to callbacks */
+    uint32_t stale;         /* sections whose filter was freed while they waited */
+    uint32_t droppedNewest; /* incoming sections dropped, queue or pool full */
+    uint32_t droppedOldest; /* queued sections evicted for newer ones */
+    uint32_t queueHighWater;/* maximum sections waiting at once */
+    uint32_t latencyMaxUs;  /* longest wait from post to callback */
+    uint32_t callbackMaxUs; /* longest callback */
+}t_SectionDispatchStats;
+
+/**
+ * @brief Section waiting for dispatch, queue owns one reference of buffer
+ */
+typedef struct t_SectionDispatchEntry
+{
+    uint32_t filterHandle;
+    uint32_t tag;           /* checked by handler, e.g. filter generation */
+    uint8_t *buffer;
+    uint32_t length;
+    uint64_t postedUs;      /* CLOCK_MONOTONIC */
+}t_SectionDispatchEntry;
+
+/**
+ * @brief Delivers entry to its filter callback, returns -1 if filter is gone
+ */
+typedef int32_t (*Section_Dispatch_Handler)(const t_SectionDispatchEntry *entry);
+
+/**
+ * @brief Gives buffer reference back to section pool
+ */
+typedef void (*Section_Dispatch_Release)(uint8_t *buffer);
+
+typedef struct t_SectionDispatchCell
+{
+    uint32_t sequence;
+    t_SectionDispatchEntry entry;
+}t_SectionDispatchCell;
+
+/**
+ * @brief Dispatcher instance
+ */
+typedef struct t_SectionDispatcher
+{
+    t_SectionDispatchCell cells[SECTION_DISPATCH_QUEUE_SIZE];
+    uint32_t enqueuePosition;
+    uint32_t dequeuePosition;
+    sem_t ready;                        /* one post per queued section */
+    pthread_t thread;
+    uint32_t running;
+    uint32_t stop;
+    uint32_t policy;                    /* t_SectionOverflowPolicy */
+    Section_Dispatch_Handler handler;
+    Section_Dispatch_Release release;
+    t_SectionDispatchStats stats;
+}t_SectionDispatcher;
+
+/****************************************************************************
+* @brief    Empty queue and start dispatcher thread
+*
+* @return   0 - no error, -1 - thread not started
+*
+*****************************************************************************/
+int32_t Section_Dispatch_Start(t_SectionDispatcher *dispatcher, Section_Dispatch_Handler handler, Section_Dispatch_Release release);
+
+/****************************************************************************
+* @brief    Stop dispatcher thread, sections still queued are released
+*
+* @note     Sections already taken by the thread finish their callback.
+*
+*****************************************************************************/
+void Section_Dispatch_Stop(t_SectionDispatcher *dispatcher);
+
+/****************************************************************************
+* @brief    Queue section for dispatch
+*
+* @param    [in] tag - handed back in entry, tells reused filter handles apart
+* @param    [in] buffer - section pool buffer, its reference goes to the queue
+*
+* @return   0 - queued, -1 - dropped and released (queue full, policy
+*           drop newest, or dispatcher not running)
+*
+*****************************************************************************/
+int32_t Section_Dispatch_Post(t_SectionDispatcher *dispatcher, uint32_t filterHandle, uint32_t tag, uint8_t *buffer, uint32_t length);
+
+/****************************************************************************
+* @brief    Drop the oldest queued section and release its buffer
+*
+* @return   0 - one section evicted, -1 - queue was empty
+*
+* @note     Used when section pool is exhausted under drop oldest policy.
+*
+*****************************************************************************/
+int32_t Section_Dispatch_Evict(t_SectionDispatcher *dispatcher);
+
+void Section_Dispatch_Set_Policy(t_SectionDispatcher *dispatcher, t_SectionOverflowPolicy policy);
+t_SectionOverflowPolicy Section_Dispatch_Get_Policy(const t_SectionDispatcher *dispatcher);
+
+/****************************************************************************
+* @brief    Count incoming section dropped outside the queue (pool exhausted)
+*
+*****************************************************************************/
+void Section_Dispatch_Count_Drop(t_SectionDispatcher *dispatcher);
+
+/****************************************************************************
+* @brief    Read counters, safe from any thread
+*
+*****************************************************************************/
+void Section_Dispatch_Get_Stats(const t_SectionDispatcher *dispatcher, t_SectionDispatchStats *stats);
+
+#endif //SECTION_DISPATCH_H_
@@ -13,8 +13,12 @@
 /*                 Includes                             */
 /********************************************************/
 #include "tdp_api.h"
+#include "crc32_mpeg2.h"
+#include "ts_monitor.h"
+#include "section_batch.h"
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include <sys/ioctl.h>
 #include <fcntl.h>
 #include <time.h>
@@ -55,18 +59,55 @@
 #define MY_SECTION_MAX_SIZE (4096+3)
 #define MY_SECTION_BUFFER_SIZE (MY_SECTION_MAX_SIZE*8)
 #define SECTION_SIZE_INFO                 3
-#define CRC32_MAX_COEFFICIENTS 256
-#define CRC32_POLYNOMIAL           0x04C11DB7
-#define MAX_FILTER_NUMBER 7 
+#define MAX_FILTER_NUMBER DEMUX_MAX_FILTERS
+#define SECTION_POOL_SIZE 16
 #define DVB_T2_ON
 //#define NuTune_Tuner
 
+#if DEMUX_FILTER_DEPTH > MV_PE_MAX_FILTER_LENGTH
+#error "DEMUX_FILTER_DEPTH is deeper than PE section filter"
+#endif
+
 /********************************************************/
 /*                 Macros                               */
 /********************************************************/
 /********************************************************/
 /*                 Typedefs                             */
 /********************************************************/
+typedef struct t_SectionBuffer
+{
+    uint8_t data[MY_SECTION_MAX_SIZE];
+    int32_t refCount;
+    struct t_SectionBuffer *next;
+}t_SectionBuffer;
+
+typedef struct t_DemuxFilter
+{
+    UINT32 hFilter;                             /* PE section filter, 0 if entry is free */
+    UINT32 hBuffer;                             /* stream buffer owned by this filter */
+    uint32_t PID;
+    uint32_t tableID;
+    uint32_t tableMask;                         /* compared bits of tableID, for finding lost section boundary */
+    Demux_Filter_Section_Callback callback;     /* per filter callback, NULL uses global one */
+    void *user;                                 /* context for per filter callback */
+    uint32_t generation;                        /* tells queued sections of a freed filter from its successor */
+    UINT8 carry[SECTION_BATCH_MAX_SECTION];     /* section still being written when buffer was read */
+    uint32_t carryFill;
+    uint32_t bufferClass;                       /* t_SectionBufferClass of hBuffer */
+    uint32_t bufferSize;
+    uint32_t fullnessHighWater;                 /* most bytes found in hBuffer by one event */
+    uint32_t reads;
+    uint32_t sections;
+}t_DemuxFilter;
+
+typedef struct t_PreparedStream
+{
+    MV_PE_STREAM_ATTRIB *pAttrib;               /* NULL if entry is free */
+    uint32_t hPrepared;
+    uint32_t PID;
+    tStreamType streamType;
+}t_PreparedStream;
+
 /********************************************************/
 /*                 Global Variables                     */
 /********************************************************/
@@ -80,8 +121,9 @@ HANDLE hPE = 0;
 UINT32 hSource = 0;
 UINT32 hStreamA = 0;
 UINT32 hStreamV = 0;
-UINT32 hFilter = 0;
-UINT32 hBuffer;
+t_DemuxFilter demuxFilters[MAX_FILTER_NUMBER];
+uint32_t demuxFilterCount = 0;
+uint32_t sectionEventRegistered = 0;
 
 sony_dvb_tuner_t tuner;
 sony_dvb_i2c_t tunerI2C ;
@@ -96,12 +138,37 @@ uint32_t HighLNBFreq = 10600;
 uint32_t InitDone = 0;
 int32_t tdt = 0;
 
+/* section_mutex serializes section callbacks, filter_mutex guards PE read path, filter table changes hold both */
 pthread_mutex_t section_mutex;
+pthread_mutex_t filter_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_mutex_t section_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
 pthread_t tune_check_thread;
 
 Tuner_Status_Callback TunerStatusCallback = NULL;
 Demux_Section_Filter_Callback DemuxSectionFilterCallback = NULL;
 
+t_SectionBuffer sectionPool[SECTION_POOL_SIZE];
+t_SectionBuffer *sectionPoolFree = NULL;
+uint32_t sectionPoolInitDone = 0;
+t_SectionPoolStats sectionPoolStats = {SECTION_POOL_SIZE, 0, 0, 0, 0, 0};
+
+/* Fed from m_sectionReceivedCallback under filter_mutex, PE keeps packets to itself */
+t_TsMonitor tsMonitor;
+
+/* Sections go from PE event context to callbacks through dispatcher thread */
+t_SectionDispatcher sectionDispatcher;
+uint32_t filterGeneration = 0;
+
+/* Stream attributes built before zap, video plane is made visible once per player */
+t_PreparedStream preparedStreams[PLAYER_MAX_PREPARED_STREAMS];
+uint32_t preparedGeneration = 0;
+pthread_mutex_t prepared_mutex = PTHREAD_MUTEX_INITIALIZER;
+uint32_t videoVisible = 0;
+
+/* Whole filter buffer is read here in one go and walked, under filter_mutex */
+UINT8 sectionBatchBuffer[SECTION_BATCH_MAX_SECTION + SECTION_BATCH_SIZE_LARGE];
+t_SectionBatchStats sectionBatchStats;
+
 /********************************************************/
 /*                 Local Functions Declarations         */
 /********************************************************/
@@ -109,6 +176,16 @@ uint32_t AttenuateFreq(uint32_t freg);
 uint32_t set_pinmux(int owner, int group, int value);
 void p_writeChecksum(uint8_t * const checksum, uint8_t const * block, size_t const length);
 int setPrimaryFilter(void);
+uint8_t* p_sectionBufferAcquire(void);
+t_SectionBuffer* p_sectionBufferLookup(uint8_t *buffer);
+t_DemuxFilter* p_demuxFilterLookup(uint32_t filterHandle);
+void p_demuxFilterRelease(t_DemuxFilter *filter);
+int32_t p_sectionDispatch(const t_SectionDispatchEntry *entry);
+void p_sectionRelease(uint8_t *buffer);
+void p_sectionQueue(const uint8_t *section, uint32_t length, int32_t crcOk, void *user);
+MV_PE_STREAM_ATTRIB* p_streamAttribAllocate(uint32_t PID, tStreamType streamType);
+t_Error p_streamStart(MV_PE_STREAM_ATTRIB *pAttrib, tStreamType streamType, uint32_t *streamHandle);
+t_PreparedStream* p_preparedLookup(uint32_t preparedHandle);
 
 #ifdef SATELITE
 void Tuner_NotificationCallback(MT_FE_MSG msg, void *p_tp_info);
@@ -468,13 +545,19 @@ uint32_t AttenuateFreq(uint32_t freg)
 }
 
 /***********************************************************************
-* Function Name : 
+* Function Name : m_sectionReceivedCallback
 *
-* Description   :
+* Description   : Reads everything filter's stream buffer holds and
+*                 queues the sections found in it for the dispatcher
 *
 * Side effects  : 
 *
-* Comment       : 
+* Comment       : Runs on PE event context, holds only filter_mutex and
+*                 never calls application code. One read takes every
+*                 section queued so far, events of sections already
+*                 taken find the buffer empty and return. Bad section
+*                 length costs the bytes up to the next section found
+*                 by Section_Batch_Walk, not the whole buffer.
 *
 * Parameters    :
 *
@@ -485,392 +568,725 @@ HRESULT m_sectionReceivedCallback(UINT32 EventCode, void *EventInfo, void *Conte
 {
 
     UINT32 hFilterCallback    = *((UINT32*)EventInfo);
-    UINT8 *pBuffer; 
-    UINT32 sectionSize,Fullness;
-    UINT32   checksum;
+    UINT32 Fullness;
+    UINT32 length;
+    UINT32 used;
+    t_DemuxFilter *filter;
     HRESULT hr;
-    pthread_mutex_lock(&section_mutex);
+    pthread_mutex_lock(&filter_mutex);
+    sectionBatchStats.events++;
+
+    /* Section belongs to the filter reported by PE, read it from that filter's buffer */
+    filter = p_demuxFilterLookup(hFilterCallback);
+    if(NULL == filter)
+    {
+        pthread_mutex_unlock(&filter_mutex);
+        return E_FAIL;
+    }
   
-    pBuffer =  malloc(MY_SECTION_BUFFER_SIZE);
-    hr = MV_PE_StreamBufGetFullness(hPE, hBuffer, &Fullness);
+    hr = MV_PE_StreamBufGetFullness(hPE, filter->hBuffer, &Fullness);
     if(hr != S_OK)
     {
-        if(pBuffer != NULL)
-        {
-            free(pBuffer);
-            pBuffer = NULL;
-        }
-        pthread_mutex_unlock(&section_mutex);
+        pthread_mutex_unlock(&filter_mutex);
         return E_FAIL;
     }
-    else
+    if(Fullness == 0)
     {
-        if(Fullness <= 0)
-        {
-            printf("\n\nm_sectionReceivedCallback: Fullness is 0\n\n");
-            if(pBuffer != NULL)
-            {
-                free(pBuffer);
-                pBuffer = NULL;
-            }
-            pthread_mutex_unlock(&section_mutex);
-            return E_FAIL;
-        }
+        /* Section of this event went with an earlier read */
+        sectionBatchStats.emptyEvents++;
+        pthread_mutex_unlock(&filter_mutex);
+        return S_OK;
+    }
+    if(Fullness > filter->fullnessHighWater)
+    {
+        filter->fullnessHighWater = Fullness;
+    }
+    if(Fullness > filter->bufferSize)
+    {
+        Fullness = filter->bufferSize;
     }
 
-    if(Fullness >= SECTION_SIZE_INFO)
+    /* Unfinished section from the previous read goes in front of new data */
+    memcpy(sectionBatchBuffer, filter->carry, filter->carryFill);
+    hr = MV_PE_StreamBufRead(hPE,
+                                             filter->hBuffer,
+                                             &sectionBatchBuffer[filter->carryFill],
+                                             Fullness);
+    sectionBatchStats.reads++;
+    filter->reads++;
+    if(hr != S_OK)
     {
-        hr = MV_PE_StreamBufRead(hPE,
-                                                 hBuffer,
-                                                 pBuffer,
-                                                 SECTION_SIZE_INFO);
-        if(hr != S_OK)
+        /* Read position is unknown after failed read, drain buffer and start over from empty */
+        sectionBatchStats.readErrors++;
+        printf("\n\nm_sectionReceivedCallback: Error in MV_PE_StreamBufRead %u bytes\n\n", Fullness);
+        if(MV_PE_StreamBufGetFullness(hPE, filter->hBuffer, &Fullness) == S_OK)
         {
-            printf("\n\nm_sectionReceivedCallback: Error in MV_PE_StreamBufRead1\n\n");
-            if(pBuffer != NULL)
-            {
-                free(pBuffer);
-                pBuffer = NULL;
-            }
-            pthread_mutex_unlock(&section_mutex);
-            return E_FAIL;
-        }
-
-       sectionSize = (uint16_t) (pBuffer[2] | ((pBuffer[1] & 0x0F) << 8));
-
-       hr = MV_PE_StreamBufRead(hPE,
-                                                    hBuffer,
-                                                    &pBuffer[3],
-                                                    sectionSize);
-       if(hr != S_OK)
-       {
-           hr = MV_PE_StreamBufGetFullness(hPE, hBuffer, &Fullness);
-           printf("\nFullnes %d\n",Fullness);
-           hr = MV_PE_StreamBufRead(hPE,
-                                                    hBuffer,
-                                                    NULL,
-                                                    Fullness);
-           hr = MV_PE_StreamBufGetFullness(hPE, hBuffer, &Fullness);
-           printf("\n\nFullnes after read %d\n\n",Fullness);
-           printf("\n\nm_sectionReceivedCallback: Error in MV_PE_StreamBufRead2 %d buf 0 %x buf 1 %x buf 2 %x\n\n",sectionSize,pBuffer[0],pBuffer[1],pBuffer[2]);
-            if(pBuffer != NULL)
+            while(Fullness > 0)
             {
-               free(pBuffer);
-               pBuffer = NULL;
+                length = (Fullness > SECTION_BATCH_SIZE_LARGE) ? SECTION_BATCH_SIZE_LARGE : Fullness;
+                if(MV_PE_StreamBufRead(hPE, filter->hBuffer, sectionBatchBuffer, length) != S_OK)
+                {
+                    break;
+                }
+                Fullness -= length;
             }
-            pthread_mutex_unlock(&section_mutex);
-            return E_FAIL;
-       }
-       
-       if(pBuffer[0]!=0x70)
-       {
-           p_writeChecksum((uint8_t*) &checksum,
-                                        pBuffer,
-                                        sectionSize + SECTION_SIZE_INFO);
         }
-        else
-        {
-            checksum = 0;
-        }
-        if(checksum)
-        {
-            printf("\n\nCheckusm problem Buffer %x %x %x %x %x \n\n",pBuffer[0],pBuffer[1],pBuffer[2],pBuffer[3],pBuffer[4]); 
-            if(pBuffer != NULL)
-            {
-               free(pBuffer);
-               pBuffer = NULL;
-            }
-       }
-       else
-       {
-            //printf("\nOK Buffer %x %x %x %x %x \n",pBuffer[0],pBuffer[1],pBuffer[2],pBuffer[3],pBuffer[4]); 
+        filter->carryFill = 0;
+        pthread_mutex_unlock(&filter_mutex);
+        return E_FAIL;
+    }
 
-            if(NULL != DemuxSectionFilterCallback)
-            {
-                DemuxSectionFilterCallback(pBuffer);
-            }
+    length = filter->carryFill + Fullness;
+    used = Section_Batch_Walk(sectionBatchBuffer, length, filter->tableID, filter->tableMask,
+                              p_sectionQueue, filter, &sectionBatchStats);
+    filter->carryFill = length - used;
+    memcpy(filter->carry, &sectionBatchBuffer[used], filter->carryFill);
 
-            if(pBuffer != NULL)
-            {
-                free(pBuffer);
-                pBuffer = NULL;
-            }
-        }
-    }
-    pthread_mutex_unlock(&section_mutex);
+    pthread_mutex_unlock(&filter_mutex);
     return S_OK;
 }
 
 /***********************************************************************
-* Function Name : 
+* Function Name : p_sectionQueue
 *
-* Description   :
+* Description   : Copies section found by batch walk to pool buffer and
+*                 queues it for the dispatcher
 *
-* Side effects  : 
+* Side effects  : Feeds stream health monitor
 *
-* Comment       : 
+* Comment       : Called by Section_Batch_Walk with filter_mutex held,
+*                 section points into sectionBatchBuffer.
 *
-* Parameters    :
+* Parameters    : user - filter the section was read for
 *
 * Returns       : 
 *
 **********************************************************************/
-void p_writeChecksum(uint8_t * const checksum, uint8_t const * block, size_t const length)
+void p_sectionQueue(const uint8_t *section, uint32_t length, int32_t crcOk, void *user)
 {
-    static crc32_table[ CRC32_MAX_COEFFICIENTS ] = {1};
+    t_DemuxFilter *filter = (t_DemuxFilter*)user;
+    UINT8 *pBuffer;
 
-    if (crc32_table[0])
+    Ts_Monitor_Section(&tsMonitor, filter->PID, section, length, crcOk);
+    if(!crcOk)
     {
-        int loopCntCoef, loopCntBit;
-
-        for (loopCntCoef = 0; loopCntCoef < CRC32_MAX_COEFFICIENTS; loopCntCoef++)
-        {
-            uint32_t coef32 = (uint32_t) loopCntCoef << 24;
-
-            for (loopCntBit = 0; loopCntBit < 8; loopCntBit++)
-                if (coef32 & 0x80000000)
-                    coef32 = ((coef32 << 1) ^ CRC32_POLYNOMIAL);
-                else
-                    coef32 <<= 1;
+        printf("\n\nCheckusm problem Buffer %x %x %x %x %x \n\n",section[0],section[1],section[2],section[3],section[4]);
+        return;
+    }
 
-            crc32_table[loopCntCoef] = coef32;
-        }
+    pBuffer = p_sectionBufferAcquire();
+    /* Queued sections hold the pool, drop oldest policy gives them up for this one */
+    while(pBuffer == NULL && Section_Dispatch_Get_Policy(&sectionDispatcher) == SECTION_OVERFLOW_DROP_OLDEST
+        && Section_Dispatch_Evict(&sectionDispatcher) == 0)
+    {
+        pBuffer = p_sectionBufferAcquire();
+    }
+    if(pBuffer == NULL)
+    {
+        /* Pool exhausted, consumers are holding every buffer */
+        Section_Dispatch_Count_Drop(&sectionDispatcher);
+        return;
     }
+    memcpy(pBuffer, section, length);
+    filter->sections++;
 
-    uint8_t const * const end = block + length;
+    /* Our reference goes with the section, dispatcher releases it after the callback */
+    Section_Dispatch_Post(&sectionDispatcher, filter->hFilter, filter->generation, pBuffer, length);
+}
 
-    uint32_t crc32 = 0xFFFFFFFF;
+/***********************************************************************
+* Function Name : p_sectionDispatch
+*
+* Description   : Hands queued section to callback of its filter
+*
+* Side effects  : 
+*
+* Comment       : Runs on dispatcher thread with section_mutex held, so
+*                 filter freed while section waited is not called and
+*                 Demux_Free_Filter waits for a callback in progress.
+*
+* Parameters    : entry - queued section
+*
+* Returns       : 0 - delivered, -1 - filter is gone
+*
+**********************************************************************/
+int32_t p_sectionDispatch(const t_SectionDispatchEntry *entry)
+{
+    t_DemuxFilter *filter;
 
-    for (; block < end; block++)
-        crc32 = (crc32 << 8) ^ crc32_table[ ((crc32 >> 24) ^ *block) & 0x000000FF ];
+    pthread_mutex_lock(&section_mutex);
+    filter = p_demuxFilterLookup(entry->filterHandle);
+    if(NULL == filter || filter->generation != entry->tag)
+    {
+        pthread_mutex_unlock(&section_mutex);
+        return -1;
+    }
+    if(NULL != filter->callback)
+    {
+        filter->callback(entry->filterHandle, entry->buffer, entry->length, filter->user);
+    }
+    else if(NULL != DemuxSectionFilterCallback)
+    {
+        DemuxSectionFilterCallback(entry->buffer);
+    }
+    pthread_mutex_unlock(&section_mutex);
+    return 0;
+}
 
-    checksum[0] = (uint8_t) (crc32 >> 24);
-    checksum[1] = (uint8_t) (crc32 >> 16);
-    checksum[2] = (uint8_t) (crc32 >> 8);
-    checksum[3] = (uint8_t) (crc32);
+/* Dispatcher drops its reference, buffer stays alive if the callback retained it */
+void p_sectionRelease(uint8_t *buffer)
+{
+    Demux_Section_Buffer_Release(buffer);
 }
 
-#if 0
 /***********************************************************************
-* Function Name : 
+* Function Name : p_sectionBufferAcquire
 *
-* Description   :
+* Description   : Takes a free buffer from the section pool
 *
-* Side effects  : 
+* Side effects  : Updates pool statistics
 *
-* Comment       : 
+* Comment       : Pool is built lazily on the first call. Returned buffer
+*                 has reference count 1, it is given back with
+*                 Demux_Section_Buffer_Release.
 *
 * Parameters    :
 *
-* Returns       : 
+* Returns       : Pointer to section data, NULL if the pool is exhausted
 *
 **********************************************************************/
-int setPrimaryFilter(void)
+uint8_t* p_sectionBufferAcquire(void)
 {
-    HRESULT hr;
-	MV_PE_SECTION_FILTER_PARAM secParam;
-    printf("\nsetPrimaryFilter\n");
-    int i = 0;
-    for(i = 0; i< 3; i++)
-    {
-       hr = MV_PE_StreamBufAllocate(hPE, MY_SECTION_BUFFER_SIZE, &hBuffer[i]);
-        if(S_OK != hr)
-        {
-            printf("%s(%d): failed to allocate section buffer!\n", __FUNCTION__, __LINE__);
-            return -1;
-        }
+    t_SectionBuffer *sectionBuffer;
+    int32_t i;
 
-        /* 'Universal' filter setup */
-
-        memset(secParam.Match,   0x00, MV_PE_MAX_FILTER_LENGTH);
-        memset(secParam.Mask,    0x00,MV_PE_MAX_FILTER_LENGTH);
-        memset(secParam.NotMask, 0x00, MV_PE_MAX_FILTER_LENGTH);
+    pthread_mutex_lock(&section_pool_mutex);
 
-        switch(i)
+    if(!sectionPoolInitDone)
+    {
+        for(i = SECTION_POOL_SIZE - 1; i >= 0; i--)
         {
-            case 0:
-            secParam.Pid = 0x11;
-            secParam.Match[0]=0x42;
-            secParam.Mask[0] = 0xff;
-            break;
-            case 1:
-            secParam.Pid = 0x14;
-            secParam.Match[0]=0x70;
-            secParam.Mask[0] = 0xff;
-            break;
-            case 2:
-            secParam.Pid = 0x00;
-            secParam.Match[0]=0x00;
-            secParam.Mask[0] = 0xff;
-            break;
+            sectionPool[i].refCount = 0;
+            sectionPool[i].next = sectionPoolFree;
+            sectionPoolFree = &sectionPool[i];
         }
+        sectionPoolInitDone = 1;
+    }
 
-        printf("\nIndex %d %d\n",i,secParam.Pid);
-        hr = MV_PE_SourceAddSectionFilter(hPE, hSource, &secParam, (HANDLE)hBuffer[i], 0, &hFilter[i]);
-        if(S_OK != hr)
-        {
-            printf("%s(%d): MV_PE_SourceAddSectionFilte!\n", __FUNCTION__, __LINE__);
-            hr = MV_PE_StreamBufRelease(hPE, hBuffer[i]);
-            return -1;
-        }
+    sectionBuffer = sectionPoolFree;
+    if(NULL == sectionBuffer)
+    {
+        sectionPoolStats.exhausted++;
+        pthread_mutex_unlock(&section_pool_mutex);
+        return NULL;
     }
-    return 0;
+    sectionPoolFree = sectionBuffer->next;
+    sectionBuffer->next = NULL;
+    sectionBuffer->refCount = 1;
+
+    sectionPoolStats.acquired++;
+    sectionPoolStats.inUse++;
+    if(sectionPoolStats.inUse > sectionPoolStats.highWater)
+    {
+        sectionPoolStats.highWater = sectionPoolStats.inUse;
+    }
+
+    pthread_mutex_unlock(&section_pool_mutex);
+    return sectionBuffer->data;
 }
-#endif
 
 /***********************************************************************
-* Function Name : 
+* Function Name : p_sectionBufferLookup
 *
-* Description   :
+* Description   : Maps section data pointer back to its pool entry
 *
 * Side effects  : 
 *
-* Comment       : 
+* Comment       : Only pointers returned by p_sectionBufferAcquire are
+*                 accepted, anything else is rejected.
 *
-* Parameters    :
+* Parameters    : buffer - section data pointer
 *
-* Returns       : 
+* Returns       : Pool entry, NULL if buffer does not belong to the pool
 *
 **********************************************************************/
-t_Error Tuner_Register_Status_Callback(Tuner_Status_Callback tunerStatusCallback){
-    if(NULL != TunerStatusCallback)
+t_SectionBuffer* p_sectionBufferLookup(uint8_t *buffer)
+{
+    uint8_t *poolStart = (uint8_t*)&sectionPool[0];
+    uint8_t *poolEnd = (uint8_t*)&sectionPool[SECTION_POOL_SIZE];
+
+    if(buffer < poolStart || buffer >= poolEnd)
     {
-        printf("%s(%d): Tuner_Register_Status_Callback failed, callback already registered!\n", __FUNCTION__, __LINE__);
-        return -1;
+        return NULL;
     }
-    TunerStatusCallback = tunerStatusCallback;
-    return 0;
+    if(((buffer - poolStart) % sizeof(t_SectionBuffer)) != 0)
+    {
+        return NULL;
+    }
+    return (t_SectionBuffer*)buffer;
 }
 
 /***********************************************************************
-* Function Name : 
+* Function Name : Demux_Section_Buffer_Retain
 *
-* Description   :
+* Description   : Borrows section buffer beyond section filter callback
 *
 * Side effects  : 
 *
 * Comment       : 
 *
-* Parameters    :
+* Parameters    : buffer - buffer passed to section filter callback
 *
-* Returns       : 
+* Returns       : NO_ERROR - no error, ERROR - error
 *
 **********************************************************************/
-t_Error Tuner_Unregister_Status_Callback(Tuner_Status_Callback tunerStatusCallback){
-    if(NULL == TunerStatusCallback)
+t_Error Demux_Section_Buffer_Retain(uint8_t *buffer)
+{
+    t_SectionBuffer *sectionBuffer = p_sectionBufferLookup(buffer);
+
+    if(NULL == sectionBuffer)
     {
-        printf("%s(%d): Tuner_Unregister_Status_Callback failed, callback already unregistered!\n", __FUNCTION__, __LINE__);
+        printf("\n%s failed, buffer is not a section buffer\n", __FUNCTION__);
         return -1;
     }
-    if(TunerStatusCallback != tunerStatusCallback)
+
+    pthread_mutex_lock(&section_pool_mutex);
+    if(sectionBuffer->refCount <= 0)
     {
-        printf("%s(%d): Tuner_Unregister_Status_Callback failed, wrong callback function!\n", __FUNCTION__, __LINE__);
+        pthread_mutex_unlock(&section_pool_mutex);
+        printf("\n%s failed, buffer already released\n", __FUNCTION__);
         return -1;
     }
-    TunerStatusCallback = NULL;
+    sectionBuffer->refCount++;
+    pthread_mutex_unlock(&section_pool_mutex);
     return 0;
 }
 
-#ifdef SATELITE
 /***********************************************************************
-* Function Name : 
+* Function Name : Demux_Section_Buffer_Release
 *
-* Description   :
+* Description   : Returns borrowed section buffer to the pool
 *
-* Side effects  : 
+* Side effects  : Updates pool statistics
 *
-* Comment       : 
+* Comment       : Buffer goes back to the pool when its last reference
+*                 is released.
 *
-* Parameters    :
+* Parameters    : buffer - previously retained section buffer
 *
-* Returns       : 
+* Returns       : NO_ERROR - no error, ERROR - error
 *
 **********************************************************************/
-void Tuner_NotificationCallback(MT_FE_MSG msg, void *p_tp_info){
-    if(msg == MtFeMsg_BSTpLocked)
+t_Error Demux_Section_Buffer_Release(uint8_t *buffer)
+{
+    t_SectionBuffer *sectionBuffer = p_sectionBufferLookup(buffer);
+
+    if(NULL == sectionBuffer)
     {
-        CIMAX_ResetPatch();
-        if(NULL != TunerStatusCallback)
-        {
-            TunerStatusCallback(STATUS_LOCKED);
-        }
-        printf("\n\nLOCKED to frequency!!!\n\n");
+        printf("\n%s failed, buffer is not a section buffer\n", __FUNCTION__);
+        return -1;
     }
-    else
+
+    pthread_mutex_lock(&section_pool_mutex);
+    if(sectionBuffer->refCount <= 0)
     {
-        if(NULL != TunerStatusCallback)
-        {
-            TunerStatusCallback(STATUS_ERROR);
-        }
-        printf("\n\nNOT locked to frequency!!!\n\n");
+        pthread_mutex_unlock(&section_pool_mutex);
+        printf("\n%s failed, buffer already released\n", __FUNCTION__);
+        return -1;
     }
-    
+    sectionBuffer->refCount--;
+    if(0 == sectionBuffer->refCount)
+    {
+        sectionBuffer->next = sectionPoolFree;
+        sectionPoolFree = sectionBuffer;
+        sectionPoolStats.inUse--;
+        sectionPoolStats.released++;
+    }
+    pthread_mutex_unlock(&section_pool_mutex);
+    return 0;
 }
 
 /***********************************************************************
-* Function Name : 
+* Function Name : Demux_Get_Section_Pool_Stats
 *
-* Description   :
+* Description   : Reads section buffer pool counters
 *
 * Side effects  : 
 *
 * Comment       : 
 *
-* Parameters    :
+* Parameters    : stats - [out] pool counters
 *
-* Returns       : 
+* Returns       : NO_ERROR - no error, ERROR - error
 *
 **********************************************************************/
-void* myTuneStatusCheckThread(void *arg)
+t_Error Demux_Get_Section_Pool_Stats(t_SectionPoolStats *stats)
 {
-    MT_FE_RET eMtErrorCode = MtFeErr_Ok;
-    MT_FE_LOCK_STATE lock_state = MtFeLockState_Locked;
-    uint32_t i = 0;
-    for(i = 0; i < 60; i++)
+    if(NULL == stats)
     {
-        eMtErrorCode = mt_fe_dmd_ds3k_get_lock_state(&lock_state);
-    
-        if (eMtErrorCode != MtFeErr_Ok) 
-        {
-            printf("\n\nGet lock state failed\n\n");
-            Tuner_NotificationCallback(MtFeMsg_BSTpUnlock, NULL);
-            return NULL;
-        }
-
-        if (lock_state == MtFeLockState_Locked) 
-        {
-            Tuner_NotificationCallback(MtFeMsg_BSTpLocked, NULL);
-            return NULL;
-        }
-        else
-        {
-            usleep(50000); //50ms
-        }
+        printf("\n%s failed, stats is NULL\n", __FUNCTION__);
+        return -1;
     }
-    Tuner_NotificationCallback(MtFeMsg_BSTpUnlock, NULL);
-    return NULL;
+
+    pthread_mutex_lock(&section_pool_mutex);
+    *stats = sectionPoolStats;
+    pthread_mutex_unlock(&section_pool_mutex);
+    return 0;
 }
-#else
+
 /***********************************************************************
-* Function Name : 
+* Function Name : Demux_Get_Stream_Health
 *
-* Description   :
+* Description   : Reads ETR 290 counters of the tuned stream
 *
 * Side effects  : 
 *
-* Comment       : 
+* Comment       : Only section indicators are counted here, CRC and
+*                 PAT table_id. Packet level ones stay 0.
 *
-* Parameters    :
+* Parameters    : report - [out] monitor counters
 *
-* Returns       : 
+* Returns       : NO_ERROR - no error, ERROR - error
 *
 **********************************************************************/
-void* myTuneStatusCheckThread(void *arg)
+t_Error Demux_Get_Stream_Health(t_TsMonitorReport *report)
 {
-    sony_dvb_result_t result = SONY_DVB_OK ;
-    
-    result = dvb_cxd2820_WaitTSLock(&cxd2820);
-
+    if(NULL == report)
+    {
+        printf("\n%s failed, report is NULL\n", __FUNCTION__);
+        return -1;
+    }
+
+    Ts_Monitor_Get_Report(&tsMonitor, report);
+    return 0;
+}
+
+/***********************************************************************
+* Function Name : Demux_Set_Section_Overflow_Policy
+*
+* Description   : Selects what is dropped when callbacks fall behind
+*
+* Side effects  : 
+*
+* Comment       : Takes effect with the next section, kept over
+*                 Player_Deinit and Player_Init.
+*
+* Parameters    : policy - drop newest or drop oldest
+*
+* Returns       : NO_ERROR - no error, ERROR - error
+*
+**********************************************************************/
+t_Error Demux_Set_Section_Overflow_Policy(t_SectionOverflowPolicy policy)
+{
+    if(policy != SECTION_OVERFLOW_DROP_NEWEST && policy != SECTION_OVERFLOW_DROP_OLDEST)
+    {
+        printf("\n%s failed, unknown policy %d\n", __FUNCTION__, policy);
+        return -1;
+    }
+
+    Section_Dispatch_Set_Policy(&sectionDispatcher, policy);
+    return 0;
+}
+
+/***********************************************************************
+* Function Name : Demux_Get_Section_Dispatch_Stats
+*
+* Description   : Reads section dispatcher counters
+*
+* Side effects  : 
+*
+* Comment       : 
+*
+* Parameters    : stats - [out] dispatcher counters
+*
+* Returns       : NO_ERROR - no error, ERROR - error
+*
+**********************************************************************/
+t_Error Demux_Get_Section_Dispatch_Stats(t_SectionDispatchStats *stats)
+{
+    if(NULL == stats)
+    {
+        printf("\n%s failed, stats is NULL\n", __FUNCTION__);
+        return -1;
+    }
+
+    Section_Dispatch_Get_Stats(&sectionDispatcher, stats);
+    return 0;
+}
+
+/***********************************************************************
+* Function Name : Demux_Get_Section_Read_Stats
+*
+* Description   : Reads section read path counters
+*
+* Side effects  : 
+*
+* Comment       : Counters are updated under filter_mutex
+*
+* Parameters    : stats - [out] read path counters
+*
+* Returns       : NO_ERROR - no error, ERROR - error
+*
+**********************************************************************/
+t_Error Demux_Get_Section_Read_Stats(t_SectionBatchStats *stats)
+{
+    if(NULL == stats)
+    {
+        printf("\n%s failed, stats is NULL\n", __FUNCTION__);
+        return -1;
+    }
+
+    pthread_mutex_lock(&filter_mutex);
+    *stats = sectionBatchStats;
+    pthread_mutex_unlock(&filter_mutex);
+    return 0;
+}
+
+/***********************************************************************
+* Function Name : 
+*
+* Description   :
+*
+* Side effects  : 
+*
+* Comment       : 
+*
+* Parameters    :
+*
+* Returns       : 
+*
+**********************************************************************/
+void p_writeChecksum(uint8_t * const checksum, uint8_t const * block, size_t const length)
+{
+    uint32_t crc32 = Crc32_Mpeg2(block, length);
+
+    checksum[0] = (uint8_t) (crc32 >> 24);
+    checksum[1] = (uint8_t) (crc32 >> 16);
+    checksum[2] = (uint8_t) (crc32 >> 8);
+    checksum[3] = (uint8_t) (crc32);
+}
+
+#if 0
+/***********************************************************************
+* Function Name : 
+*
+* Description   :
+*
+* Side effects  : 
+*
+* Comment       : 
+*
+* Parameters    :
+*
+* Returns       : 
+*
+**********************************************************************/
+int setPrimaryFilter(void)
+{
+    HRESULT hr;
+	MV_PE_SECTION_FILTER_PARAM secParam;
+    printf("\nsetPrimaryFilter\n");
+    int i = 0;
+    for(i = 0; i< 3; i++)
+    {
+       hr = MV_PE_StreamBufAllocate(hPE, MY_SECTION_BUFFER_SIZE, &hBuffer[i]);
+        if(S_OK != hr)
+        {
+            printf("%s(%d): failed to allocate section buffer!\n", __FUNCTION__, __LINE__);
+            return -1;
+        }
+
+        /* 'Universal' filter setup */
+
+        memset(secParam.Match,   0x00, MV_PE_MAX_FILTER_LENGTH);
+        memset(secParam.Mask,    0x00,MV_PE_MAX_FILTER_LENGTH);
+        memset(secParam.NotMask, 0x00, MV_PE_MAX_FILTER_LENGTH);
+
+        switch(i)
+        {
+            case 0:
+            secParam.Pid = 0x11;
+            secParam.Match[0]=0x42;
+            secParam.Mask[0] = 0xff;
+            break;
+            case 1:
+            secParam.Pid = 0x14;
+            secParam.Match[0]=0x70;
+            secParam.Mask[0] = 0xff;
+            break;
+            case 2:
+            secParam.Pid = 0x00;
+            secParam.Match[0]=0x00;
+            secParam.Mask[0] = 0xff;
+            break;
+        }
+
+        printf("\nIndex %d %d\n",i,secParam.Pid);
+        hr = MV_PE_SourceAddSectionFilter(hPE, hSource, &secParam, (HANDLE)hBuffer[i], 0, &hFilter[i]);
+        if(S_OK != hr)
+        {
+            printf("%s(%d): MV_PE_SourceAddSectionFilte!\n", __FUNCTION__, __LINE__);
+            hr = MV_PE_StreamBufRelease(hPE, hBuffer[i]);
+            return -1;
+        }
+    }
+    return 0;
+}
+#endif
+
+/***********************************************************************
+* Function Name : 
+*
+* Description   :
+*
+* Side effects  : 
+*
+* Comment       : 
+*
+* Parameters    :
+*
+* Returns       : 
+*
+**********************************************************************/
+t_Error Tuner_Register_Status_Callback(Tuner_Status_Callback tunerStatusCallback){
+    if(NULL != TunerStatusCallback)
+    {
+        printf("%s(%d): Tuner_Register_Status_Callback failed, callback already registered!\n", __FUNCTION__, __LINE__);
+        return -1;
+    }
+    TunerStatusCallback = tunerStatusCallback;
+    return 0;
+}
+
+/***********************************************************************
+* Function Name : 
+*
+* Description   :
+*
+* Side effects  : 
+*
+* Comment       : 
+*
+* Parameters    :
+*
+* Returns       : 
+*
+**********************************************************************/
+t_Error Tuner_Unregister_Status_Callback(Tuner_Status_Callback tunerStatusCallback){
+    if(NULL == TunerStatusCallback)
+    {
+        printf("%s(%d): Tuner_Unregister_Status_Callback failed, callback already unregistered!\n", __FUNCTION__, __LINE__);
+        return -1;
+    }
+    if(TunerStatusCallback != tunerStatusCallback)
+    {
+        printf("%s(%d): Tuner_Unregister_Status_Callback failed, wrong callback function!\n", __FUNCTION__, __LINE__);
+        return -1;
+    }
+    TunerStatusCallback = NULL;
+    return 0;
+}
+
+#ifdef SATELITE
+/***********************************************************************
+* Function Name : 
+*
+* Description   :
+*
+* Side effects  : 
+*
+* Comment       : 
+*
+* Parameters    :
+*
+* Returns       : 
+*
+**********************************************************************/
+void Tuner_NotificationCallback(MT_FE_MSG msg, void *p_tp_info){
+    if(msg == MtFeMsg_BSTpLocked)
+    {
+        CIMAX_ResetPatch();
+        if(NULL != TunerStatusCallback)
+        {
+            TunerStatusCallback(STATUS_LOCKED);
+        }
+        printf("\n\nLOCKED to frequency!!!\n\n");
+    }
+    else
+    {
+        if(NULL != TunerStatusCallback)
+        {
+            TunerStatusCallback(STATUS_ERROR);
+        }
+        printf("\n\nNOT locked to frequency!!!\n\n");
+    }
+    
+}
+
+/***********************************************************************
+* Function Name : 
+*
+* Description   :
+*
+* Side effects  : 
+*
+* Comment       : 
+*
+* Parameters    :
+*
+* Returns       : 
+*
+**********************************************************************/
+void* myTuneStatusCheckThread(void *arg)
+{
+    MT_FE_RET eMtErrorCode = MtFeErr_Ok;
+    MT_FE_LOCK_STATE lock_state = MtFeLockState_Locked;
+    uint32_t i = 0;
+    for(i = 0; i < 60; i++)
+    {
+        eMtErrorCode = mt_fe_dmd_ds3k_get_lock_state(&lock_state);
+    
+        if (eMtErrorCode != MtFeErr_Ok) 
+        {
+            printf("\n\nGet lock state failed\n\n");
+            Tuner_NotificationCallback(MtFeMsg_BSTpUnlock, NULL);
+            return NULL;
+        }
+
+        if (lock_state == MtFeLockState_Locked) 
+        {
+            Tuner_NotificationCallback(MtFeMsg_BSTpLocked, NULL);
+            return NULL;
+        }
+        else
+        {
+            usleep(50000); //50ms
+        }
+    }
+    Tuner_NotificationCallback(MtFeMsg_BSTpUnlock, NULL);
+    return NULL;
+}
+#else
+/***********************************************************************
+* Function Name : 
+*
+* Description   :
+*
+* Side effects  : 
+*
+* Comment       : 
+*
+* Parameters    :
+*
+* Returns       : 
+*
+**********************************************************************/
+void* myTuneStatusCheckThread(void *arg)
+{
+    sony_dvb_result_t result = SONY_DVB_OK ;
+    
+    result = dvb_cxd2820_WaitTSLock(&cxd2820);
+
     if (result != SONY_DVB_OK) 
     {
         if(NULL != TunerStatusCallback)
@@ -917,6 +1333,23 @@ t_Error Player_Init(uint32_t *playerHandle)
     MV_OSAL_Init();
     
 	MV_OSAL_Task_Sleep(1);
+
+    /* Select CRC engine before the first section arrives */
+    Crc32_Mpeg2_Init();
+    printf("\nSection CRC engine: %s\n", Crc32_Mpeg2_Engine_Name(Crc32_Mpeg2_Selected_Engine()));
+
+    /* Stream health is counted from the first section on */
+    pthread_mutex_lock(&filter_mutex);
+    Ts_Monitor_Init(&tsMonitor, 0);
+    memset(&sectionBatchStats, 0, sizeof(sectionBatchStats));
+    pthread_mutex_unlock(&filter_mutex);
+
+    /* Section callbacks run on dispatcher thread from the first filter on */
+    if(Section_Dispatch_Start(&sectionDispatcher, p_sectionDispatch, p_sectionRelease) != 0)
+    {
+        printf("Fail to start section dispatcher, exit!\n");
+        return -1;
+    }
     
     /* Initialize player */
     {
@@ -959,6 +1392,7 @@ t_Error Player_Init(uint32_t *playerHandle)
 t_Error Player_Deinit(uint32_t playerHandle)
 {
     HRESULT rc;
+    uint32_t i;
     
     if(playerHandle != hPE)
     {
@@ -976,6 +1410,27 @@ t_Error Player_Deinit(uint32_t playerHandle)
     {
         MV_PE_Stop(hPE, hSource);
 	}
+
+    pthread_mutex_lock(&section_mutex);
+    pthread_mutex_lock(&filter_mutex);
+    for(i = 0; i < MAX_FILTER_NUMBER; i++)
+    {
+        if(demuxFilters[i].hFilter)
+        {
+            p_demuxFilterRelease(&demuxFilters[i]);
+        }
+    }
+    pthread_mutex_unlock(&filter_mutex);
+    pthread_mutex_unlock(&section_mutex);
+
+    if(sectionEventRegistered)
+    {
+        MV_PE_UnRegisterEventCallBack(hPE, MV_PE_EVENT_PSI_SECTION_COMPLETE, m_sectionReceivedCallback);
+        sectionEventRegistered = 0;
+    }
+
+    /* Nothing posts any more, sections still queued belong to freed filters */
+    Section_Dispatch_Stop(&sectionDispatcher);
     	
     if(hStreamV)
     {
@@ -988,6 +1443,18 @@ t_Error Player_Deinit(uint32_t playerHandle)
         MV_PE_StreamRemove(hPE, hStreamA);
         hStreamA = 0;
 	}
+
+    pthread_mutex_lock(&prepared_mutex);
+    for(i = 0; i < PLAYER_MAX_PREPARED_STREAMS; i++)
+    {
+        if(preparedStreams[i].pAttrib)
+        {
+            MV_PE_StreamFreeAttribSet(preparedStreams[i].pAttrib);
+            memset(&preparedStreams[i], 0, sizeof(t_PreparedStream));
+        }
+    }
+    pthread_mutex_unlock(&prepared_mutex);
+    videoVisible = 0;
     
     if(hSource)
     {
@@ -995,18 +1462,6 @@ t_Error Player_Deinit(uint32_t playerHandle)
         hSource = 0;
 	}
     
-    if(hBuffer)
-    {
-        MV_PE_StreamBufRelease(hPE, hBuffer);
-        hBuffer = 0;
-    }
-    
-    if(hFilter)
-    {
-        MV_PE_SourceRemoveSectionFilter(hPE, hSource, hFilter);
-        hFilter = 0;
-    }
-    
     if(hPE)
     {
         MV_PE_Remove(hPE);
@@ -1142,82 +1597,317 @@ t_Error Player_Source_Close(uint32_t playerHandle, uint32_t sourceHandle)
 }
 
 /***********************************************************************
-* Function Name : 
+* Function Name : 
+*
+* Description   :
+*
+* Side effects  : 
+*
+* Comment       : 
+*
+* Parameters    :
+*
+* Returns       : 
+*
+**********************************************************************/
+t_Error Player_Stream_Create(uint32_t playerHandle, uint32_t sourceHandle, uint32_t PID, tStreamType streamType, uint32_t *streamHandle)
+{
+    MV_PE_STREAM_ATTRIB* pAttrib;
+    t_Error result;
+    
+    if(playerHandle != hPE)
+    {
+        printf("\n\nWrong player handle, cannot create stream...\n\n");
+        return -1;
+    }
+    
+    if(sourceHandle != hSource)
+    {
+        printf("\n\nWrong source handle, cannot create stream...\n\n");
+        return -1;
+    }
+    
+    if(0 == hPE)
+    {
+        printf("\n\nPlayer not initialized error...\n\n");
+        return -1;
+    }
+    
+    if(0 == hSource)
+    {
+        printf("\n\nSource not open error...\n\n");
+        return -1;
+    }
+    
+    if(NULL == streamHandle)
+    {
+        printf("\n%s failed, streamHandle is NULL\n", __FUNCTION__);
+        return -1;
+    }
+    
+    pAttrib = p_streamAttribAllocate(PID, streamType);
+    if(NULL == pAttrib)
+    {
+        printf("\n\nFail to allocate stream attributes!\n\n");
+        return -1;
+    }
+    result = p_streamStart(pAttrib, streamType, streamHandle);
+	MV_PE_StreamFreeAttribSet(pAttrib);	
+    return result;
+}
+
+/***********************************************************************
+* Function Name : p_streamAttribAllocate
+*
+* Description   : Allocates and fills PE attribute set of stream
+*
+* Side effects  : 
+*
+* Comment       : Freed with MV_PE_StreamFreeAttribSet
+*
+* Parameters    : PID        - audio or video PID
+*                 streamType - stream type
+*
+* Returns       : Attribute set, NULL if PE could not allocate it
+*
+**********************************************************************/
+MV_PE_STREAM_ATTRIB* p_streamAttribAllocate(uint32_t PID, tStreamType streamType)
+{
+    MV_PE_STREAM_ATTRIB* pAttrib;
+
+    pAttrib = MV_PE_StreamAllocateAttribSet(((streamType >= 39) ? MV_PE_CONTENT_STREAM_TYPE_VIDEO : MV_PE_CONTENT_STREAM_TYPE_AUDIO), 0);
+    if(NULL == pAttrib)
+    {
+        return NULL;
+    }
+	pAttrib->IDType  =  MV_PE_STREAM_ID_TYPE_PID; /* PID type */
+	pAttrib->ID      = PID; /* Video PID */
+	pAttrib->Channel = ((streamType >= 39) ? MV_PE_CHANNEL_PRIMARY_VIDEO : MV_PE_CHANNEL_PRIMARY_AUDIO); /* Primary video channel */
+	pAttrib->pVideoAttrib->Type = (streamType >= 39) ? streamType - 38 : streamType; /* Stream encode type */	
+    return pAttrib;
+}
+
+/***********************************************************************
+* Function Name : p_streamStart
+*
+* Description   : Creates PE stream from attribute set
+*
+* Side effects  : Video plane is made visible with the first video
+*                 stream of the player
+*
+* Comment       : Plane stays visible while streams are swapped, setting
+*                 it again on every zap only delays the first frame.
+*
+* Parameters    : pAttrib      - filled attribute set, caller keeps it
+*                 streamType   - stream type
+*                 streamHandle - [out] created stream
+*
+* Returns       : 0 on success, -1 on error
+*
+**********************************************************************/
+t_Error p_streamStart(MV_PE_STREAM_ATTRIB *pAttrib, tStreamType streamType, uint32_t *streamHandle)
+{
+    HRESULT rc;
+
+    /* Create stream handle */
+	rc = MV_PE_StreamCreate(hPE, hSource, pAttrib, (streamType >= 39) ? &hStreamV : &hStreamA);
+	if(rc != S_OK)
+	{
+		printf("\n\nFail to create stream!\n\n");
+        return -1;
+	}	
+    *streamHandle = (streamType >= 39) ? hStreamV : hStreamA;
+    if(streamType >= 39 && !videoVisible)
+    {
+        rc = MV_PE_VideoSetVisible(hPE, MV_PE_CHANNEL_PRIMARY_VIDEO, 1);
+        if(rc != S_OK)
+        {
+            /* Deinit and exit */
+            printf("\n\nFail to set video visible!\n\n");
+            return -1;
+        }
+        videoVisible = 1;
+    }
+    return 0;
+}
+
+/***********************************************************************
+* Function Name : Player_Stream_Prepare
+*
+* Description   : Builds attribute set of stream before it is started
+*
+* Side effects  : 
+*
+* Comment       : Zapping takes stream attributes of likely next
+*                 channels from here, no PE allocation on the zap path.
+*
+* Parameters    : playerHandle   - player handle
+*                 PID            - audio or video PID
+*                 streamType     - stream type
+*                 preparedHandle - [out] prepared attributes
+*
+* Returns       : 0 on success, -1 on error
+*
+**********************************************************************/
+t_Error Player_Stream_Prepare(uint32_t playerHandle, uint32_t PID, tStreamType streamType, uint32_t *preparedHandle)
+{
+    t_PreparedStream *prepared = NULL;
+    uint32_t i;
+
+    if(playerHandle != hPE || 0 == hPE)
+    {
+        printf("\n\nWrong player handle, cannot prepare stream...\n\n");
+        return -1;
+    }
+
+    if(NULL == preparedHandle)
+    {
+        printf("\n%s failed, preparedHandle is NULL\n", __FUNCTION__);
+        return -1;
+    }
+
+    pthread_mutex_lock(&prepared_mutex);
+    for(i = 0; i < PLAYER_MAX_PREPARED_STREAMS; i++)
+    {
+        if(NULL == preparedStreams[i].pAttrib)
+        {
+            prepared = &preparedStreams[i];
+            break;
+        }
+    }
+    if(NULL == prepared)
+    {
+        pthread_mutex_unlock(&prepared_mutex);
+        printf("\n%s failed, all %d prepared streams are in use\n", __FUNCTION__, PLAYER_MAX_PREPARED_STREAMS);
+        return -1;
+    }
+
+    prepared->pAttrib = p_streamAttribAllocate(PID, streamType);
+    if(NULL == prepared->pAttrib)
+    {
+        pthread_mutex_unlock(&prepared_mutex);
+        printf("\n\nFail to allocate stream attributes!\n\n");
+        return -1;
+    }
+    preparedGeneration++;
+    prepared->hPrepared = ((preparedGeneration & 0xFFFFFF) << 8) | (i + 1);
+    prepared->PID = PID;
+    prepared->streamType = streamType;
+    *preparedHandle = prepared->hPrepared;
+    pthread_mutex_unlock(&prepared_mutex);
+    return 0;
+}
+
+/***********************************************************************
+* Function Name : Player_Stream_Create_Prepared
+*
+* Description   : Starts stream from prepared attribute set
+*
+* Side effects  : 
+*
+* Comment       : Attribute set stays prepared for the next start
+*
+* Parameters    : playerHandle   - player handle
+*                 sourceHandle   - source handle
+*                 preparedHandle - prepared attributes
+*                 streamHandle   - [out] created stream
+*
+* Returns       : 0 on success, -1 on error
+*
+**********************************************************************/
+t_Error Player_Stream_Create_Prepared(uint32_t playerHandle, uint32_t sourceHandle, uint32_t preparedHandle, uint32_t *streamHandle)
+{
+    t_PreparedStream *prepared;
+    t_Error result;
+
+    if(playerHandle != hPE || 0 == hPE)
+    {
+        printf("\n\nWrong player handle, cannot create stream...\n\n");
+        return -1;
+    }
+
+    if(sourceHandle != hSource || 0 == hSource)
+    {
+        printf("\n\nWrong source handle, cannot create stream...\n\n");
+        return -1;
+    }
+
+    if(NULL == streamHandle)
+    {
+        printf("\n%s failed, streamHandle is NULL\n", __FUNCTION__);
+        return -1;
+    }
+
+    /* Held while PE reads the set, so it cannot be unprepared meanwhile */
+    pthread_mutex_lock(&prepared_mutex);
+    prepared = p_preparedLookup(preparedHandle);
+    if(NULL == prepared)
+    {
+        pthread_mutex_unlock(&prepared_mutex);
+        printf("\n\nWrong prepared stream handle, cannot create stream...\n\n");
+        return -1;
+    }
+    result = p_streamStart(prepared->pAttrib, prepared->streamType, streamHandle);
+    pthread_mutex_unlock(&prepared_mutex);
+    return result;
+}
+
+/***********************************************************************
+* Function Name : Player_Stream_Unprepare
 *
-* Description   :
+* Description   : Frees prepared attribute set
 *
 * Side effects  : 
 *
-* Comment       : 
+* Comment       : Stream started from it keeps running
 *
-* Parameters    :
+* Parameters    : playerHandle   - player handle
+*                 preparedHandle - prepared attributes
 *
-* Returns       : 
+* Returns       : 0 on success, -1 on error
 *
 **********************************************************************/
-t_Error Player_Stream_Create(uint32_t playerHandle, uint32_t sourceHandle, uint32_t PID, tStreamType streamType, uint32_t *streamHandle)
+t_Error Player_Stream_Unprepare(uint32_t playerHandle, uint32_t preparedHandle)
 {
-    HRESULT rc;
-    MV_PE_STREAM_ATTRIB* pAttrib;
-    
-    if(playerHandle != hPE)
-    {
-        printf("\n\nWrong player handle, cannot create stream...\n\n");
-        return -1;
-    }
-    
-    if(sourceHandle != hSource)
-    {
-        printf("\n\nWrong source handle, cannot create stream...\n\n");
-        return -1;
-    }
-    
-    if(0 == hPE)
+    t_PreparedStream *prepared;
+
+    if(playerHandle != hPE || 0 == hPE)
     {
-        printf("\n\nPlayer not initialized error...\n\n");
+        printf("\n\nWrong player handle, cannot unprepare stream...\n\n");
         return -1;
     }
-    
-    if(0 == hSource)
+
+    pthread_mutex_lock(&prepared_mutex);
+    prepared = p_preparedLookup(preparedHandle);
+    if(NULL == prepared)
     {
-        printf("\n\nSource not open error...\n\n");
+        pthread_mutex_unlock(&prepared_mutex);
+        printf("\n\nWrong prepared stream handle, cannot unprepare stream...\n\n");
         return -1;
     }
-    
-    if(NULL == streamHandle)
+    MV_PE_StreamFreeAttribSet(prepared->pAttrib);
+    memset(prepared, 0, sizeof(t_PreparedStream));
+    pthread_mutex_unlock(&prepared_mutex);
+    return 0;
+}
+
+/* Caller holds prepared_mutex */
+t_PreparedStream* p_preparedLookup(uint32_t preparedHandle)
+{
+    uint32_t i;
+
+    if(0 == preparedHandle)
     {
-        printf("\n%s failed, streamHandle is NULL\n", __FUNCTION__);
-        return -1;
+        return NULL;
     }
-    
-    pAttrib = MV_PE_StreamAllocateAttribSet(((streamType >= 39) ? MV_PE_CONTENT_STREAM_TYPE_VIDEO : MV_PE_CONTENT_STREAM_TYPE_AUDIO), 0);
-	pAttrib->IDType  =  MV_PE_STREAM_ID_TYPE_PID; /* PID type */
-	pAttrib->ID      = PID; /* Video PID */
-	pAttrib->Channel = ((streamType >= 39) ? MV_PE_CHANNEL_PRIMARY_VIDEO : MV_PE_CHANNEL_PRIMARY_AUDIO); /* Primary video channel */
-	pAttrib->pVideoAttrib->Type = (streamType >= 39) ? streamType - 38 : streamType; /* Stream encode type */	
-	
-    /* Create stream handle */
-	rc = MV_PE_StreamCreate(hPE, hSource, pAttrib, (streamType >= 39) ? &hStreamV : &hStreamA);
-	if(rc != S_OK)
-	{
-        /* Deinit and exit */
-		printf("\n\nFail to create stream!\n\n");
-        MV_PE_StreamFreeAttribSet(pAttrib);
-        return -1;
-	}	
-	MV_PE_StreamFreeAttribSet(pAttrib);	
-    *streamHandle = (streamType >= 39) ? hStreamV : hStreamA;
-    if(streamType >= 39)
+    for(i = 0; i < PLAYER_MAX_PREPARED_STREAMS; i++)
     {
-        rc = MV_PE_VideoSetVisible(hPE, MV_PE_CHANNEL_PRIMARY_VIDEO, 1);
-        if(rc != S_OK)
+        if(preparedStreams[i].pAttrib != NULL && preparedStreams[i].hPrepared == preparedHandle)
         {
-            /* Deinit and exit */
-            printf("\n\nFail to set video visible!\n\n");
-            return -1;
+            return &preparedStreams[i];
         }
     }
-    return 0;
+    return NULL;
 }
 
 /***********************************************************************
@@ -1403,20 +2093,14 @@ t_Error Player_Volume_Get(uint32_t playerHandle, uint32_t *volume)
 **********************************************************************/
 t_Error Demux_Register_Section_Filter_Callback(Demux_Section_Filter_Callback demuxSectionFilterCallback)
 {
-    HRESULT hr;
-    
     if(NULL != DemuxSectionFilterCallback )
     {
-        printf("\n\n%s(%d): failed to register callback! Callback already registered\n\n");
-        return -1;
-    }
-    hr = MV_PE_RegisterEventCallBack(hPE,MV_PE_EVENT_PSI_SECTION_COMPLETE,m_sectionReceivedCallback,NULL,NULL);
-    if(S_OK != hr)
-    {
-        printf("\n\n%s(%d): failed to register callback!\n\n", __FUNCTION__, __LINE__);
+        printf("\n\n%s(%d): failed to register callback! Callback already registered\n\n", __FUNCTION__, __LINE__);
         return -1;
     }
+    pthread_mutex_lock(&section_mutex);
     DemuxSectionFilterCallback = demuxSectionFilterCallback;
+    pthread_mutex_unlock(&section_mutex);
     return 0;
 }
 
@@ -1436,47 +2120,171 @@ t_Error Demux_Register_Section_Filter_Callback(Demux_Section_Filter_Callback dem
 **********************************************************************/
 t_Error Demux_Unregister_Section_Filter_Callback(Demux_Section_Filter_Callback demuxSectionFilterCallback)
 {
-    HRESULT hr;
-    
     if(NULL == DemuxSectionFilterCallback )
     {
-        printf("\n\n%s(%d): failed to unregister callback! Callback already unregistered\n\n");
+        printf("\n\n%s(%d): failed to unregister callback! Callback already unregistered\n\n", __FUNCTION__, __LINE__);
         return -1;
     }
     if(demuxSectionFilterCallback != DemuxSectionFilterCallback)
     {
-        printf("\n\n%s(%d): failed to unregister callback! Wrong callback function\n\n");
+        printf("\n\n%s(%d): failed to unregister callback! Wrong callback function\n\n", __FUNCTION__, __LINE__);
         return -1;
     }
-    
-    hr = MV_PE_UnRegisterEventCallBack(hPE, MV_PE_EVENT_PSI_SECTION_COMPLETE, m_sectionReceivedCallback);
-    if(S_OK != hr)
+    pthread_mutex_lock(&section_mutex);
+    DemuxSectionFilterCallback = NULL;
+    pthread_mutex_unlock(&section_mutex);
+    return 0;
+}
+
+/***********************************************************************
+* Function Name : Demux_Register_Filter_Callback
+*
+* Description   : Routes sections of one filter to its own callback
+*
+* Side effects  : 
+*
+* Comment       : Callback registered with
+*                 Demux_Register_Section_Filter_Callback still receives
+*                 sections of filters that have no callback of their own.
+*                 NULL callback removes the per filter callback.
+*
+* Parameters    : filterHandle - handle returned by Demux_Set_Filter
+*                 callback - callback function
+*                 user - context passed back to the callback
+*
+* Returns       : NO_ERROR - no error, ERROR - error
+*
+**********************************************************************/
+t_Error Demux_Register_Filter_Callback(uint32_t filterHandle, Demux_Filter_Section_Callback callback, void *user)
+{
+    t_DemuxFilter *filter;
+
+    pthread_mutex_lock(&section_mutex);
+    filter = p_demuxFilterLookup(filterHandle);
+    if(NULL == filter)
     {
-        printf("\n\n%s(%d): failed to unregister callback!\n\n", __FUNCTION__, __LINE__);
+        pthread_mutex_unlock(&section_mutex);
+        printf("\n\nWrong filter handle, cannot register callback...\n\n");
         return -1;
     }
-    DemuxSectionFilterCallback = NULL;
+    filter->callback = callback;
+    filter->user = callback ? user : NULL;
+    pthread_mutex_unlock(&section_mutex);
     return 0;
 }
 
 /***********************************************************************
-* Function Name : 
+* Function Name : p_demuxFilterLookup
 *
-* Description   :
+* Description   : Finds filter table entry by PE filter handle
 *
 * Side effects  : 
 *
-* Comment       : 
+* Comment       : Caller holds section_mutex or filter_mutex
 *
-* Parameters    :
+* Parameters    : filterHandle - PE section filter handle
+*
+* Returns       : Filter table entry, NULL if handle is unknown
+*
+**********************************************************************/
+t_DemuxFilter* p_demuxFilterLookup(uint32_t filterHandle)
+{
+    uint32_t i;
+
+    if(0 == filterHandle)
+    {
+        return NULL;
+    }
+    for(i = 0; i < MAX_FILTER_NUMBER; i++)
+    {
+        if(demuxFilters[i].hFilter == filterHandle)
+        {
+            return &demuxFilters[i];
+        }
+    }
+    return NULL;
+}
+
+/***********************************************************************
+* Function Name : p_demuxFilterRelease
+*
+* Description   : Removes PE section filter and releases its buffer
+*
+* Side effects  : Filter table entry becomes free
+*
+* Comment       : Caller holds section_mutex and filter_mutex. Buffer
+*                 use is printed, it is what size classes are tuned by.
+*
+* Parameters    : filter - used filter table entry
 *
 * Returns       : 
 *
 **********************************************************************/
+void p_demuxFilterRelease(t_DemuxFilter *filter)
+{
+    HRESULT hr;
+
+    printf("\nPID %x table %x filter: %s buffer %u bytes, high water %u, %u sections in %u reads\n",
+        filter->PID, filter->tableID, Section_Batch_Class_Name(filter->bufferClass), filter->bufferSize,
+        filter->fullnessHighWater, filter->sections, filter->reads);
+
+    hr = MV_PE_SourceRemoveSectionFilter(hPE, hSource, filter->hFilter);
+    if(S_OK != hr)
+    {
+        printf("\n\n%s(%d): failed to remove section filter!\n\n", __FUNCTION__, __LINE__);
+    }
+
+    hr = MV_PE_StreamBufRelease(hPE, filter->hBuffer);
+    if(S_OK != hr)
+    {
+        printf("\n\n%s(%d): failed to release section buffer!\n\n", __FUNCTION__, __LINE__);
+    }
+
+    memset(filter, 0, sizeof(t_DemuxFilter));
+    demuxFilterCount--;
+}
+
+/***********************************************************************
+* Function Name : Demux_Set_Filter
+*
+* Description   : Sets filter on PID and table id
+*
+* Comment       : Kept for existing users, see Demux_Set_Filter_Ex
+*
+**********************************************************************/
 t_Error Demux_Set_Filter(uint32_t playerHandle, uint32_t PID, uint32_t tableID, uint32_t *filterHandle)
+{
+    t_DemuxFilterParams params;
+
+    Demux_Filter_Params_Init(&params, PID, tableID);
+    return Demux_Set_Filter_Ex(playerHandle, &params, filterHandle);
+}
+
+/***********************************************************************
+* Function Name : Demux_Set_Filter_Ex
+*
+* Description   : Sets filter with full match, mask and not-mask depth
+*
+* Side effects  : Registers PE section event with the first filter
+*
+* Comment       : Filter bytes go to PE as they are, PE compares them
+*                 with section skipping section_length, same layout
+*                 t_DemuxFilterParams documents.
+*
+* Parameters    : playerHandle - player handle
+*                 params       - PID and filter bytes
+*                 filterHandle - created filter
+*
+* Returns       : 0 on success, -1 on error
+*
+**********************************************************************/
+t_Error Demux_Set_Filter_Ex(uint32_t playerHandle, const t_DemuxFilterParams *params, uint32_t *filterHandle)
 {
     HRESULT rc;
     MV_PE_SECTION_FILTER_PARAM secParam;
+    t_DemuxFilter *filter = NULL;
+    uint32_t bufferClass;
+    uint32_t i;
  
     if(playerHandle != hPE)
     {
@@ -1490,40 +2298,211 @@ t_Error Demux_Set_Filter(uint32_t playerHandle, uint32_t PID, uint32_t tableID,
         return -1;
     }
     
-    if(NULL == filterHandle)
+    if(NULL == filterHandle || NULL == params)
+    {
+        printf("\n%s failed, filterHandle or params is NULL\n", __FUNCTION__);
+        return -1;
+    }
+
+    if(params->depth == 0 || params->depth > DEMUX_FILTER_DEPTH)
+    {
+        printf("\n%s failed, filter depth %u not in 1..%d\n", __FUNCTION__, params->depth, DEMUX_FILTER_DEPTH);
+        return -1;
+    }
+
+    if(params->bufferClass >= SECTION_BUFFER_CLASS_COUNT)
     {
-        printf("\n%s failed, filterHandle is NULL\n", __FUNCTION__);
+        printf("\n%s failed, unknown buffer class %u\n", __FUNCTION__, params->bufferClass);
         return -1;
     }
+    bufferClass = params->bufferClass;
+    if(SECTION_BUFFER_AUTO == bufferClass)
+    {
+        bufferClass = Section_Batch_Default_Class(params->match[DEMUX_FILTER_BYTE_TABLE_ID], params->mask[DEMUX_FILTER_BYTE_TABLE_ID]);
+    }
+
+    pthread_mutex_lock(&section_mutex);
+    pthread_mutex_lock(&filter_mutex);
+
+    for(i = 0; i < MAX_FILTER_NUMBER; i++)
+    {
+        if(0 == demuxFilters[i].hFilter)
+        {
+            filter = &demuxFilters[i];
+            break;
+        }
+    }
+    if(NULL == filter)
+    {
+        pthread_mutex_unlock(&filter_mutex);
+        pthread_mutex_unlock(&section_mutex);
+        printf("\n\n%s(%d): all %d section filters are in use!\n\n", __FUNCTION__, __LINE__, MAX_FILTER_NUMBER);
+        return -1;
+    }
+
+    /* PE reports every section filter through one event, register it with the first filter */
+    if(!sectionEventRegistered)
+    {
+        rc = MV_PE_RegisterEventCallBack(hPE,MV_PE_EVENT_PSI_SECTION_COMPLETE,m_sectionReceivedCallback,NULL,NULL);
+        if(S_OK != rc)
+        {
+            pthread_mutex_unlock(&filter_mutex);
+            pthread_mutex_unlock(&section_mutex);
+            printf("\n\n%s(%d): failed to register callback!\n\n", __FUNCTION__, __LINE__);
+            return -1;
+        }
+        sectionEventRegistered = 1;
+    }
     
     /* Allocate PE resources */
-    rc = MV_PE_StreamBufAllocate(hPE, MY_SECTION_BUFFER_SIZE, &hBuffer);
+    rc = MV_PE_StreamBufAllocate(hPE, Section_Batch_Class_Size(bufferClass), &filter->hBuffer);
     if(S_OK != rc)
     {
+        filter->hBuffer = 0;
+        pthread_mutex_unlock(&filter_mutex);
+        pthread_mutex_unlock(&section_mutex);
         printf("\n\n%s(%d): failed to allocate section buffer!\n\n", __FUNCTION__, __LINE__);
         return -1;
     }
 
-    secParam.Pid = PID;
+    secParam.Pid = params->PID;
     
-    /* 'Universal' filter setup */
     memset(secParam.Match,   0x00, MV_PE_MAX_FILTER_LENGTH);
-    memset(secParam.Mask,    0x00,MV_PE_MAX_FILTER_LENGTH);
+    memset(secParam.Mask,    0x00, MV_PE_MAX_FILTER_LENGTH);
     memset(secParam.NotMask, 0x00, MV_PE_MAX_FILTER_LENGTH);
 
-    secParam.Match[0]=tableID;
-    secParam.Mask[0]=0xff;
+    memcpy(secParam.Match,   params->match,   params->depth);
+    memcpy(secParam.Mask,    params->mask,    params->depth);
+    memcpy(secParam.NotMask, params->notMask, params->depth);
 
-    printf("\nPID %x secParam.Match[0] %x secParam.Mask[0] %x\n",secParam.Pid,secParam.Match[0],secParam.Mask[0]);
-    rc = MV_PE_SourceAddSectionFilter(hPE, hSource, &secParam, (HANDLE)hBuffer, 0, &hFilter);
+    rc = MV_PE_SourceAddSectionFilter(hPE, hSource, &secParam, (HANDLE)filter->hBuffer, 0, &filter->hFilter);
     
     if(S_OK != rc)
     {
         printf("%s(%d): failed to add section filter!\n", __FUNCTION__, __LINE__);
-        MV_PE_StreamBufRelease(hPE, hBuffer);
+        MV_PE_StreamBufRelease(hPE, filter->hBuffer);
+        memset(filter, 0, sizeof(t_DemuxFilter));
+        pthread_mutex_unlock(&filter_mutex);
+        pthread_mutex_unlock(&section_mutex);
+        return -1;
+    }
+    filter->PID = params->PID;
+    filter->tableID = params->match[DEMUX_FILTER_BYTE_TABLE_ID];
+    filter->tableMask = params->mask[DEMUX_FILTER_BYTE_TABLE_ID];
+    filter->carryFill = 0;
+    filter->bufferClass = bufferClass;
+    filter->bufferSize = Section_Batch_Class_Size(bufferClass);
+    filter->fullnessHighWater = 0;
+    filter->reads = 0;
+    filter->sections = 0;
+    filter->callback = NULL;
+    filter->user = NULL;
+    filter->generation = ++filterGeneration;
+    demuxFilterCount++;
+    *filterHandle = filter->hFilter;
+
+    pthread_mutex_unlock(&filter_mutex);
+    pthread_mutex_unlock(&section_mutex);
+    return 0;
+}
+
+/***********************************************************************
+* Function Name : Demux_Filter_Params_Init
+*
+**********************************************************************/
+void Demux_Filter_Params_Init(t_DemuxFilterParams *params, uint32_t PID, uint32_t tableID)
+{
+    memset(params, 0, sizeof(t_DemuxFilterParams));
+    params->PID = PID;
+    params->depth = DEMUX_FILTER_BYTE_TABLE_ID + 1;
+    params->match[DEMUX_FILTER_BYTE_TABLE_ID] = tableID;
+    params->mask[DEMUX_FILTER_BYTE_TABLE_ID] = 0xff;
+}
+
+/***********************************************************************
+* Function Name : Demux_Filter_Params_Extension
+*
+**********************************************************************/
+void Demux_Filter_Params_Extension(t_DemuxFilterParams *params, uint16_t tableIdExtension)
+{
+    params->match[DEMUX_FILTER_BYTE_EXTENSION] = tableIdExtension >> 8;
+    params->mask[DEMUX_FILTER_BYTE_EXTENSION] = 0xff;
+    params->match[DEMUX_FILTER_BYTE_EXTENSION + 1] = tableIdExtension & 0xff;
+    params->mask[DEMUX_FILTER_BYTE_EXTENSION + 1] = 0xff;
+    if(params->depth < DEMUX_FILTER_BYTE_EXTENSION + 2)
+    {
+        params->depth = DEMUX_FILTER_BYTE_EXTENSION + 2;
+    }
+}
+
+/***********************************************************************
+* Function Name : Demux_Filter_Params_Version_Changed
+*
+* Comment       : current_next_indicator must be 1 (positive match),
+*                 version_number bits are under notMask.
+*
+**********************************************************************/
+void Demux_Filter_Params_Version_Changed(t_DemuxFilterParams *params, uint8_t version)
+{
+    params->match[DEMUX_FILTER_BYTE_VERSION] = ((version & 0x1f) << 1) | 0x01;
+    params->mask[DEMUX_FILTER_BYTE_VERSION] = 0x3f;
+    params->notMask[DEMUX_FILTER_BYTE_VERSION] = 0x3e;
+    if(params->depth < DEMUX_FILTER_BYTE_VERSION + 1)
+    {
+        params->depth = DEMUX_FILTER_BYTE_VERSION + 1;
+    }
+}
+
+/***********************************************************************
+* Function Name : Demux_Filter_Params_Buffer
+*
+**********************************************************************/
+void Demux_Filter_Params_Buffer(t_DemuxFilterParams *params, t_SectionBufferClass bufferClass)
+{
+    params->bufferClass = bufferClass;
+}
+
+/***********************************************************************
+* Function Name : Demux_Get_Filter_Stats
+*
+* Description   : Reads buffer use counters of one filter
+*
+* Side effects  : 
+*
+* Comment       : Counters are updated under filter_mutex
+*
+* Parameters    : filterHandle - filter
+*                 stats        - [out] filter counters
+*
+* Returns       : 0 on success, -1 on error
+*
+**********************************************************************/
+t_Error Demux_Get_Filter_Stats(uint32_t filterHandle, t_DemuxFilterStats *stats)
+{
+    t_DemuxFilter *filter;
+
+    if(NULL == stats)
+    {
+        printf("\n%s failed, stats is NULL\n", __FUNCTION__);
+        return -1;
+    }
+
+    pthread_mutex_lock(&filter_mutex);
+    filter = p_demuxFilterLookup(filterHandle);
+    if(NULL == filter)
+    {
+        pthread_mutex_unlock(&filter_mutex);
+        printf("\n%s failed, wrong filter handle\n", __FUNCTION__);
         return -1;
     }
-    *filterHandle = hFilter;
+    stats->PID = filter->PID;
+    stats->tableID = filter->tableID;
+    stats->bufferClass = filter->bufferClass;
+    stats->bufferSize = filter->bufferSize;
+    stats->fullnessHighWater = filter->fullnessHighWater;
+    stats->reads = filter->reads;
+    stats->sections = filter->sections;
+    pthread_mutex_unlock(&filter_mutex);
     return 0;
 }
 
@@ -1543,7 +2522,7 @@ t_Error Demux_Set_Filter(uint32_t playerHandle, uint32_t PID, uint32_t tableID,
 **********************************************************************/
 t_Error Demux_Free_Filter(uint32_t playerHandle, uint32_t filterHandle)
 {
-    HRESULT hr;
+    t_DemuxFilter *filter;
     
     if(playerHandle != hPE)
     {
@@ -1551,38 +2530,27 @@ t_Error Demux_Free_Filter(uint32_t playerHandle, uint32_t filterHandle)
         return -1;
     }
     
-    if(filterHandle != hFilter)
-    {
-        printf("\n\nWrong filter handle, cannot free filter...\n\n");
-        return -1;
-    }
-    
     if(0 == hPE)
     {
         printf("\n\nPlayer not initialized error...\n\n");
         return -1;
     }
-    
-    if(0 == hFilter)
+
+    /* Waits for callback in progress, queued sections of filter become stale */
+    pthread_mutex_lock(&section_mutex);
+    pthread_mutex_lock(&filter_mutex);
+    filter = p_demuxFilterLookup(filterHandle);
+    if(NULL == filter)
     {
-        printf("\n\nFilter not set error...\n\n");
+        pthread_mutex_unlock(&filter_mutex);
+        pthread_mutex_unlock(&section_mutex);
+        printf("\n\nWrong filter handle, cannot free filter...\n\n");
         return -1;
     }
     
-    hr = MV_PE_SourceRemoveSectionFilter(hPE, hSource, hFilter);
-    if(S_OK != hr)
-    {
-        printf("\n\n%s(%d): failed to remove section filter!\n\n", __FUNCTION__, __LINE__);
-
-    }
-
-    hr = MV_PE_StreamBufRelease(hPE, hBuffer);
-    if(S_OK != hr)
-    {
-        printf("\n\n%s(%d): failed to release section buffer!\n\n", __FUNCTION__, __LINE__);
-    }
-    hBuffer = 0;
-    hFilter = 0;
+    p_demuxFilterRelease(filter);
+    pthread_mutex_unlock(&filter_mutex);
+    pthread_mutex_unlock(&section_mutex);
     return 0;
 }
 
@@ -12,6 +12,31 @@
 #define TDPAPI_H_
 
 #include <stdint.h>
+#include "ts_monitor.h"
+#include "section_dispatch.h"
+#include "section_batch.h"
+
+/**
+ * @brief Number of section filters that can be active at the same time
+ */
+#define DEMUX_MAX_FILTERS   (7)
+
+/**
+ * @brief Number of stream attribute sets that can be prepared at the same time
+ */
+#define PLAYER_MAX_PREPARED_STREAMS   (8)
+
+/**
+ * @brief Number of section bytes a filter can compare
+ *
+ * Filter byte 0 is table_id, filter bytes 1.. are section bytes from
+ * table_id_extension on. Demux skips section_length.
+ */
+#define DEMUX_FILTER_DEPTH              (8)
+#define DEMUX_FILTER_BYTE_TABLE_ID      (0)
+#define DEMUX_FILTER_BYTE_EXTENSION     (1)     /* two bytes, high byte first */
+#define DEMUX_FILTER_BYTE_VERSION       (3)     /* version_number and current_next_indicator */
+#define DEMUX_FILTER_BYTE_SECTION       (4)     /* section_number */
 
 /**
  * @brief Error codes
@@ -38,9 +63,68 @@ typedef int32_t(*Tuner_Status_Callback)(t_LockStatus status);
 
 /**
  * @brief Demux section filter callback
+ *
+ * Section callbacks run one at a time on the section dispatcher thread,
+ * never on the demux event context. Sections queue while a callback runs,
+ * t_SectionOverflowPolicy decides what is dropped once the queue or the
+ * section pool is full.
  */
 typedef int32_t(*Demux_Section_Filter_Callback)(uint8_t *buffer);
 
+/**
+ * @brief Per filter section callback
+ *
+ * filterHandle - filter the section arrived on
+ * buffer       - complete section, table_id first
+ * length       - section length in bytes, including table_id, section_length and CRC_32
+ * user         - context given at registration
+ */
+typedef int32_t(*Demux_Filter_Section_Callback)(uint32_t filterHandle, uint8_t *buffer, uint32_t length, void *user);
+
+/**
+ * @brief Section filter parameters
+ *
+ * Only bits set in mask are compared. Section passes when every compared
+ * bit outside notMask equals match and, if notMask has any bit set, at
+ * least one compared bit inside notMask differs from match.
+ */
+typedef struct t_DemuxFilterParams
+{
+    uint32_t PID;
+    uint32_t depth;                         /* used bytes of match, mask and notMask */
+    uint8_t match[DEMUX_FILTER_DEPTH];
+    uint8_t mask[DEMUX_FILTER_DEPTH];
+    uint8_t notMask[DEMUX_FILTER_DEPTH];
+    uint32_t bufferClass;                   /* t_SectionBufferClass of filter's section buffer */
+}t_DemuxFilterParams;
+
+/**
+ * @brief Section filter counters, for tuning buffer size classes
+ */
+typedef struct t_DemuxFilterStats
+{
+    uint32_t PID;
+    uint32_t tableID;
+    uint32_t bufferClass;                   /* t_SectionBufferClass, never SECTION_BUFFER_AUTO */
+    uint32_t bufferSize;                    /* bytes */
+    uint32_t fullnessHighWater;             /* most bytes waiting in buffer when it was read */
+    uint32_t reads;
+    uint32_t sections;
+}t_DemuxFilterStats;
+
+/**
+ * @brief Section buffer pool counters
+ */
+typedef struct t_SectionPoolStats
+{
+    uint32_t poolSize;      /* number of buffers in the pool */
+    uint32_t inUse;         /* buffers currently owned by demux or application */
+    uint32_t highWater;     /* maximum inUse value seen */
+    uint32_t acquired;      /* total buffers taken from the pool */
+    uint32_t released;      /* total buffers returned to the pool */
+    uint32_t exhausted;     /* sections dropped because the pool was empty */
+}t_SectionPoolStats;
+
 /**
  * @brief Polarization
  */
@@ -223,6 +307,9 @@ t_Error Tuner_Deinit();
 
 /****************************************************************************
 * @brief    Set filter to demux
+*
+* @note     Up to DEMUX_MAX_FILTERS filters can be active at the same time,
+*           each one with its own section buffer.
 * 
 * @param    [in] palyerHandle - handle of initialized player instance
 * @param    [in] PID - PID
@@ -235,6 +322,66 @@ t_Error Tuner_Deinit();
 *****************************************************************************/
 t_Error Demux_Set_Filter(uint32_t playerHandle, uint32_t PID, uint32_t tableID, uint32_t *filterHandle);
 
+/****************************************************************************
+* @brief    Set filter to demux with full match, mask and not-mask depth
+*
+* @note     Sections that do not pass are dropped by demux hardware, they
+*           never reach section callback.
+* 
+* @param    [in] palyerHandle - handle of initialized player instance
+* @param    [in] params - PID and filter bytes, see t_DemuxFilterParams
+* @param    [out] filterHandle - handle of created filter
+*
+* @return   NO_ERROR - no error
+* @return   ERROR - error
+*
+*****************************************************************************/
+t_Error Demux_Set_Filter_Ex(uint32_t playerHandle, const t_DemuxFilterParams *params, uint32_t *filterHandle);
+
+/****************************************************************************
+* @brief    Initialize filter parameters to match PID and table id only
+*
+* @param    [out] params - filter parameters
+* @param    [in] PID - PID
+* @param    [in] tableID - table id
+*
+*****************************************************************************/
+void Demux_Filter_Params_Init(t_DemuxFilterParams *params, uint32_t PID, uint32_t tableID);
+
+/****************************************************************************
+* @brief    Match table_id_extension (program_number, service_id, ...)
+*
+* @param    [in, out] params - filter parameters
+* @param    [in] tableIdExtension - table_id_extension
+*
+*****************************************************************************/
+void Demux_Filter_Params_Extension(t_DemuxFilterParams *params, uint16_t tableIdExtension);
+
+/****************************************************************************
+* @brief    Pass only current sections with version other than given one
+*
+* @note     Filter wakes application only when table version changes.
+*
+* @param    [in, out] params - filter parameters
+* @param    [in] version - version_number already known
+*
+*****************************************************************************/
+void Demux_Filter_Params_Version_Changed(t_DemuxFilterParams *params, uint8_t version);
+
+/****************************************************************************
+* @brief    Choose section buffer size class of filter
+*
+* @note     Demux_Filter_Params_Init leaves SECTION_BUFFER_AUTO, buffer
+*           is then sized by table_id (Section_Batch_Default_Class).
+*           Filter whose fullnessHighWater gets close to its bufferSize
+*           needs a bigger class.
+*
+* @param    [in, out] params - filter parameters
+* @param    [in] bufferClass - size class
+*
+*****************************************************************************/
+void Demux_Filter_Params_Buffer(t_DemuxFilterParams *params, t_SectionBufferClass bufferClass);
+
 /****************************************************************************
 * @brief    Free demux filter
 * 
@@ -269,6 +416,131 @@ t_Error Demux_Register_Section_Filter_Callback(Demux_Section_Filter_Callback dem
 *****************************************************************************/
 t_Error Demux_Unregister_Section_Filter_Callback(Demux_Section_Filter_Callback demuxSectionFilterCallback);
 
+/****************************************************************************
+* @brief    Register callback for sections of one filter
+*
+* @note     Sections of a filter with its own callback are passed straight
+*           to it together with the user context, they do not reach the
+*           callback registered with Demux_Register_Section_Filter_Callback.
+*           Filter must not be freed from inside a section callback.
+* 
+* @param    [in] filterHandle - handle of created filter
+* @param    [in] callback - callback function, NULL to remove it
+* @param    [in] user - context passed back to the callback
+*
+* @return   NO_ERROR - no error
+* @return   ERROR - error
+*
+*****************************************************************************/
+t_Error Demux_Register_Filter_Callback(uint32_t filterHandle, Demux_Filter_Section_Callback callback, void *user);
+
+/****************************************************************************
+* @brief    Keep section buffer after section filter callback returns
+*
+* @note     Buffer passed to section filter callback is owned by demux and is
+*           reused as soon as the callback returns. Callback may retain it to
+*           keep using it later, every retain must be paired with
+*           Demux_Section_Buffer_Release.
+* 
+* @param    [in] buffer - buffer received in section filter callback
+*
+* @return   NO_ERROR - no error
+* @return   ERROR - error
+*
+*****************************************************************************/
+t_Error Demux_Section_Buffer_Retain(uint8_t *buffer);
+
+/****************************************************************************
+* @brief    Release previously retained section buffer
+* 
+* @param    [in] buffer - buffer retained with Demux_Section_Buffer_Retain
+*
+* @return   NO_ERROR - no error
+* @return   ERROR - error
+*
+*****************************************************************************/
+t_Error Demux_Section_Buffer_Release(uint8_t *buffer);
+
+/****************************************************************************
+* @brief    Get section buffer pool counters
+* 
+* @param    [out] stats - pool counters, including in use high-water mark
+*
+* @return   NO_ERROR - no error
+* @return   ERROR - error
+*
+*****************************************************************************/
+t_Error Demux_Get_Section_Pool_Stats(t_SectionPoolStats *stats);
+
+/****************************************************************************
+* @brief    Get ETR 290 priority 1 and 2 stream health counters
+* 
+* @param    [out] report - totals and last minute of every indicator
+*
+* @return   NO_ERROR - no error
+* @return   ERROR - error
+*
+* @note     Lock free, can be polled from any thread. Section filter demux
+*           sees sections only, so it counts CRC and PAT table errors and
+*           leaves report->packetLevel 0, packet level indicators and
+*           repetition need packet demux (file backed libtdp).
+*
+*****************************************************************************/
+t_Error Demux_Get_Stream_Health(t_TsMonitorReport *report);
+
+/****************************************************************************
+* @brief    Choose which section is dropped when callbacks fall behind
+* 
+* @param    [in] policy - SECTION_OVERFLOW_DROP_NEWEST (default) keeps
+*                         queued sections, SECTION_OVERFLOW_DROP_OLDEST
+*                         evicts them for incoming ones
+*
+* @return   NO_ERROR - no error
+* @return   ERROR - error
+*
+*****************************************************************************/
+t_Error Demux_Set_Section_Overflow_Policy(t_SectionOverflowPolicy policy);
+
+/****************************************************************************
+* @brief    Get section dispatcher counters
+* 
+* @param    [out] stats - queued, dispatched and dropped sections, queue
+*                         high-water mark, worst queue wait and callback time
+*
+* @return   NO_ERROR - no error
+* @return   ERROR - error
+*
+*****************************************************************************/
+t_Error Demux_Get_Section_Dispatch_Stats(t_SectionDispatchStats *stats);
+
+/****************************************************************************
+* @brief    Get section read path counters
+* 
+* @param    [out] stats - demux events, buffer reads, sections per read,
+*                         resyncs on corrupt section length, read errors
+*
+* @return   NO_ERROR - no error
+* @return   ERROR - error
+*
+* @note     Several sections are taken with one read, events finding
+*           their section already taken count as emptyEvents.
+*
+*****************************************************************************/
+t_Error Demux_Get_Section_Read_Stats(t_SectionBatchStats *stats);
+
+/****************************************************************************
+* @brief    Get counters of one section filter
+* 
+* @param    [in] filterHandle - handle of created filter
+* @param    [out] stats - buffer class and size, fullness high-water mark,
+*                         reads and sections
+*
+* @return   NO_ERROR - no error
+* @return   ERROR - error
+*
+*****************************************************************************/
+t_Error Demux_Get_Filter_Stats(uint32_t filterHandle, t_DemuxFilterStats *stats);
+
 /****************************************************************************
 * @brief    Initialize player
 * 
@@ -343,6 +615,49 @@ t_Error Player_Stream_Create(uint32_t playerHandle, uint32_t sourceHandle, uint3
 *****************************************************************************/
 t_Error Player_Stream_Remove(uint32_t playerHandle, uint32_t sourceHandle, uint32_t streamHandle);
 
+/****************************************************************************
+* @brief    Build stream attributes ahead of stream start
+* 
+* @param    [in] playerHandle - handle of previously initialized player
+* @param    [in] PID - audio or video PID
+* @param    [in] streamType - stream type
+* @param    [out] preparedHandle - handle for Player_Stream_Create_Prepared
+*
+* @return   NO_ERROR - no error
+* @return   ERROR - error, also when PLAYER_MAX_PREPARED_STREAMS are prepared
+*
+* @note     Prepared attributes stay until Player_Stream_Unprepare or
+*           Player_Deinit, stream can be started from them many times.
+*
+*****************************************************************************/
+t_Error Player_Stream_Prepare(uint32_t playerHandle, uint32_t PID, tStreamType streamType, uint32_t *preparedHandle);
+
+/****************************************************************************
+* @brief    Create stream from prepared attributes
+* 
+* @param    [in] playerHandle - handle of previously initialized player
+* @param    [in] sourceHandle - handle of prevoiusly opened source
+* @param    [in] preparedHandle - handle from Player_Stream_Prepare
+* @param    [out] streamHandle - handle of created stream
+*
+* @return   NO_ERROR - no error
+* @return   ERROR - error
+*
+*****************************************************************************/
+t_Error Player_Stream_Create_Prepared(uint32_t playerHandle, uint32_t sourceHandle, uint32_t preparedHandle, uint32_t *streamHandle);
+
+/****************************************************************************
+* @brief    Free prepared stream attributes
+* 
+* @param    [in] playerHandle - handle of previously initialized player
+* @param    [in] preparedHandle - handle from Player_Stream_Prepare
+*
+* @return   NO_ERROR - no error
+* @return   ERROR - error
+*
+*****************************************************************************/
+t_Error Player_Stream_Unprepare(uint32_t playerHandle, uint32_t preparedHandle);
+
 /****************************************************************************
 * @brief    Set volume
 * 
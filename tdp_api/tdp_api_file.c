@@ -0,0 +1,1747 @@
+/********************************************************
+*
+* FILE NAME: $URL$  tdp_api_file.c
+*            $Date$
+*            $Rev$
+*
+* DESCRIPTION
+*
+* File backed stand-in of tdp_api for host runs. Same
+* tdp_api.h surface as tdp_api.c, built as its own libtdp
+* (make libtdp_file), so the application runs unmodified
+* on any Linux host. Recorded transport stream takes the
+* place of tuner, section filters reassemble sections from
+* TS packets (ts_demux.c) and player calls are logged with
+* timestamps.
+*
+* Environment:
+*   TDP_FILE_TS       capture to play, "%u" in the name is
+*                     replaced with tune frequency in MHz,
+*                     frequency without capture never locks
+*   TDP_FILE_BITRATE  replay rate in bit/s until first PCR
+*                     and for captures without PCR, 0 replays
+*                     as fast as callbacks take sections
+*                     (default 24000000)
+*   TDP_FILE_SPEED    replay speed-up, 4 plays 4 times faster
+*                     than broadcast (default 1)
+*   TDP_FILE_PCR_PID  PID whose PCR paces replay (default:
+*                     PID of started stream if it carries PCR,
+*                     first PCR PID before that)
+*   TDP_FILE_LOCK_MS  time from tune to lock callback
+*                     (default 200)
+*   TDP_FILE_LOOP     0 stops at end of capture, anything
+*                     else plays it again (default 1)
+*
+* Section filters behave like PE ones: up to
+* DEMUX_MAX_FILTERS, match/mask/notMask over table_id and
+* bytes from table_id_extension on, CRC checked for all but
+* TDT, sections copied to 16 buffer pool and queued for
+* the section dispatcher, whose thread runs callbacks with
+* section mutex held. Reader never waits for a callback.
+*
+* Stream health (ts_monitor.c) sees every packet, PAT and
+* the PMTs it lists are reassembled for it whether or not
+* a filter asks for them.
+*
+*********************************************************/
+/********************************************************/
+/*                 Includes                             */
+/********************************************************/
+#include "tdp_api.h"
+#include "crc32_mpeg2.h"
+#include "ts_demux.h"
+#include "ts_pacer.h"
+#include "ts_monitor.h"
+#include "section_batch.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <pthread.h>
+
+/********************************************************/
+/*                 Defines                              */
+/********************************************************/
+#define MY_READING_BUFF_SIZE    (TS_PACKET_SIZE*32)
+#define MY_SECTION_MAX_SIZE     (4096+3)
+#define SECTION_SIZE_INFO       3
+#define MAX_FILTER_NUMBER       DEMUX_MAX_FILTERS
+#define SECTION_POOL_SIZE       16
+#define MAX_PLAYER_STREAMS      8
+#define PLAYER_HANDLE           0x7D0
+#define SOURCE_HANDLE           0x5C0
+#define STREAM_HANDLE_BASE      0x100
+#define PREPARED_HANDLE_BASE    0x80
+#define DEFAULT_BITRATE         24000000
+#define DEFAULT_LOCK_MS         200
+#define MAX_PATH_LENGTH         512
+
+/********************************************************/
+/*                 Typedefs                             */
+/********************************************************/
+typedef struct t_SectionBuffer
+{
+    uint8_t data[MY_SECTION_MAX_SIZE];
+    int32_t refCount;
+    struct t_SectionBuffer *next;
+}t_SectionBuffer;
+
+typedef struct t_DemuxFilter
+{
+    uint32_t hFilter;                           /* 0 if entry is free */
+    t_DemuxFilterParams params;
+    Demux_Filter_Section_Callback callback;     /* per filter callback, NULL uses global one */
+    void *user;
+    uint32_t delivered;
+    uint32_t crcErrors;
+    uint32_t bufferSize;                        /* PE buffer the filter would get, params hold its class */
+    uint32_t feedBytes;                         /* matching bytes in current demux feed */
+    uint32_t fullnessHighWater;                 /* most matching bytes in one feed, PE buffer fill per event */
+    uint32_t reads;                             /* feeds with matching sections */
+}t_DemuxFilter;
+
+typedef struct t_PlayerStream
+{
+    uint32_t hStream;                           /* 0 if entry is free */
+    uint32_t PID;
+    tStreamType streamType;
+    double createdAt;
+}t_PlayerStream;
+
+typedef struct t_PreparedStream
+{
+    uint32_t hPrepared;                         /* 0 if entry is free */
+    uint32_t PID;
+    tStreamType streamType;
+    uint32_t starts;                            /* streams created from it */
+}t_PreparedStream;
+
+/********************************************************/
+/*                 Local File Variables                 */
+/********************************************************/
+/* section_mutex serializes section callbacks, demux_mutex guards reader path, filter table changes hold both */
+static pthread_mutex_t section_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t demux_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t section_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t reader_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t reader_condition = PTHREAD_COND_INITIALIZER;
+static pthread_t reader_thread;
+
+static uint32_t hPE = 0;
+static uint32_t hSource = 0;
+static uint32_t volumeLevel = 0;
+static uint32_t filterGeneration = 0;
+static t_DemuxFilter demuxFilters[MAX_FILTER_NUMBER];
+static t_PlayerStream playerStreams[MAX_PLAYER_STREAMS];
+static uint32_t streamGeneration = 0;
+static t_PreparedStream preparedStreams[PLAYER_MAX_PREPARED_STREAMS];
+static uint32_t preparedGeneration = 0;
+
+static Tuner_Status_Callback TunerStatusCallback = NULL;
+static Demux_Section_Filter_Callback DemuxSectionFilterCallback = NULL;
+
+static t_SectionBuffer sectionPool[SECTION_POOL_SIZE];
+static t_SectionBuffer *sectionPoolFree = NULL;
+static uint32_t sectionPoolInitDone = 0;
+static t_SectionPoolStats sectionPoolStats = {SECTION_POOL_SIZE, 0, 0, 0, 0, 0};
+
+/* Reader state, tune requests are handed over under reader_mutex */
+static uint32_t readerStarted = 0;
+static uint32_t readerExit = 0;
+static uint32_t tuneGeneration = 0;
+static uint32_t tuneFrequencyMHz = 0;
+static uint32_t tunerLocked = 0;
+static t_TsDemux tsDemux;                   /* used under demux_mutex */
+static uint32_t tsDemuxInitDone = 0;
+static t_TsMonitor tsMonitor;               /* fed under demux_mutex, read lock free */
+static uint32_t monitorSyncLosses = 0;      /* demux sync losses already reported */
+static uint32_t monitorRateMeasured = 0;    /* monitor runs at PCR measured rate of capture */
+static t_SectionDispatcher sectionDispatcher;
+static t_SectionBatchStats readStats;       /* capture reads and demux feeds, under demux_mutex */
+
+static char capturePath[MAX_PATH_LENGTH];
+static uint32_t replayBitrate = DEFAULT_BITRATE;
+static uint32_t lockDelayMs = DEFAULT_LOCK_MS;
+static uint32_t replayLoop = 1;
+static double replaySpeed = 1.0;
+static uint32_t replayPcrPid = TS_PACER_PID_AUTO;
+
+/* Pacer belongs to reader thread, clock PID requests come under reader_mutex */
+static t_TsPacer tsPacer;
+static uint32_t pacerFollowPid = TS_PACER_PID_AUTO;
+
+static double startTime = 0;
+
+/********************************************************/
+/*                 Local Functions Declarations         */
+/********************************************************/
+static double p_now(void);
+static void p_log(const char *format, ...);
+static void p_readConfig(void);
+static void* p_readerThread(void *arg);
+static void p_pacerLog(void);
+static FILE* p_openCapture(uint32_t frequencyMHz);
+static void p_tsDemuxInit(void);
+static void p_monitorPacket(const uint8_t *packet, void *user);
+static void p_monitorFeed(const uint8_t *data, size_t length);
+static void p_monitorPmtWatch(void);
+static void p_monitorRetune(void);
+static void p_monitorLog(void);
+static void p_sectionReceived(uint32_t PID, const uint8_t *section, uint32_t length, void *user);
+static void p_pidRelease(uint32_t PID);
+static void p_sectionDeliver(t_DemuxFilter *filter, const uint8_t *section, uint32_t length, int32_t crcOk);
+static int32_t p_filterMatch(const t_DemuxFilterParams *params, const uint8_t *section, uint32_t length);
+static t_DemuxFilter* p_demuxFilterLookup(uint32_t filterHandle);
+static void p_filterLog(const t_DemuxFilter *filter);
+static uint8_t* p_sectionBufferAcquire(void);
+static t_SectionBuffer* p_sectionBufferLookup(uint8_t *buffer);
+static int32_t p_sectionDispatch(const t_SectionDispatchEntry *entry);
+static void p_sectionRelease(uint8_t *buffer);
+static t_Error p_tunerLock(uint32_t frequencyMHz);
+static t_Error p_streamCreate(uint32_t PID, tStreamType streamType, const char *origin, uint32_t *streamHandle);
+static t_PreparedStream* p_preparedLookup(uint32_t preparedHandle);
+
+/********************************************************/
+/*                 Functions Definitions                */
+/********************************************************/
+
+static double p_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Log line with seconds since library was first used */
+static void p_log(const char *format, ...)
+{
+    va_list args;
+
+    if(startTime == 0)
+    {
+        startTime = p_now();
+    }
+    printf("[tdp file %9.3f] ", p_now() - startTime);
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+    printf("\n");
+}
+
+static void p_readConfig(void)
+{
+    const char *value;
+
+    value = getenv("TDP_FILE_TS");
+    capturePath[0] = '\0';
+    if(NULL != value)
+    {
+        strncpy(capturePath, value, MAX_PATH_LENGTH - 1);
+        capturePath[MAX_PATH_LENGTH - 1] = '\0';
+    }
+    value = getenv("TDP_FILE_BITRATE");
+    replayBitrate = (NULL != value) ? (uint32_t)strtoul(value, NULL, 10) : DEFAULT_BITRATE;
+    value = getenv("TDP_FILE_LOCK_MS");
+    lockDelayMs = (NULL != value) ? (uint32_t)strtoul(value, NULL, 10) : DEFAULT_LOCK_MS;
+    value = getenv("TDP_FILE_SPEED");
+    replaySpeed = (NULL != value) ? strtod(value, NULL) : 1.0;
+    replaySpeed = (replaySpeed > 0) ? replaySpeed : 1.0;
+    value = getenv("TDP_FILE_PCR_PID");
+    replayPcrPid = (NULL != value) ? (uint32_t)strtoul(value, NULL, 0) : TS_PACER_PID_AUTO;
+    value = getenv("TDP_FILE_LOOP");
+    replayLoop = (NULL != value) ? (strtoul(value, NULL, 10) != 0) : 1;
+}
+
+/***********************************************************************
+* Function Name : Tuner_Init
+*
+* Description   : Reads replay settings and starts reader thread
+*
+**********************************************************************/
+t_Error Tuner_Init()
+{
+    if(startTime == 0)
+    {
+        startTime = p_now();
+    }
+    p_readConfig();
+    Crc32_Mpeg2_Init();
+    pthread_mutex_lock(&demux_mutex);
+    p_tsDemuxInit();
+    pthread_mutex_unlock(&demux_mutex);
+
+    if(capturePath[0] == '\0')
+    {
+        printf("\n%s failed, TDP_FILE_TS names no capture\n", __FUNCTION__);
+        return -1;
+    }
+
+    pthread_mutex_lock(&reader_mutex);
+    if(!readerStarted)
+    {
+        Ts_Pacer_Init(&tsPacer, replayPcrPid, replaySpeed);
+        pacerFollowPid = TS_PACER_PID_AUTO;
+        readerExit = 0;
+        if(pthread_create(&reader_thread, NULL, p_readerThread, NULL) != 0)
+        {
+            pthread_mutex_unlock(&reader_mutex);
+            printf("\n%s failed, cannot start reader thread\n", __FUNCTION__);
+            return -1;
+        }
+        readerStarted = 1;
+    }
+    pthread_mutex_unlock(&reader_mutex);
+
+    p_log("Tuner_Init: capture %s, %s x%.1f, lock in %u ms", capturePath,
+        replayBitrate ? "PCR paced" : "unpaced", replaySpeed, lockDelayMs);
+    return 0;
+}
+
+/* Hand tune request to reader thread, lock or no lock is reported by its callback */
+static t_Error p_tunerLock(uint32_t frequencyMHz)
+{
+    pthread_mutex_lock(&reader_mutex);
+    if(!readerStarted)
+    {
+        pthread_mutex_unlock(&reader_mutex);
+        printf("\n%s failed, tuner not initialized\n", __FUNCTION__);
+        return -1;
+    }
+    tuneFrequencyMHz = frequencyMHz;
+    tuneGeneration++;
+    pthread_cond_signal(&reader_condition);
+    pthread_mutex_unlock(&reader_mutex);
+
+    p_log("Tuner_Lock_To_Frequency: %u MHz", frequencyMHz);
+    return 0;
+}
+
+#ifdef SATELITE
+/***********************************************************************
+* Function Name : Tuner_Lock_To_Frequency
+*
+* Comment       : Frequency in kHz
+*
+**********************************************************************/
+t_Error Tuner_Lock_To_Frequency(uint32_t tuneFrequency, t_Polarization polarization, t_Band band, uint32_t symbolRate)
+{
+    return p_tunerLock(tuneFrequency / 1000);
+}
+#else
+/***********************************************************************
+* Function Name : Tuner_Lock_To_Frequency
+*
+* Comment       : Frequency in Hz, as tdp_api.c passes it to demodulator
+*
+**********************************************************************/
+t_Error Tuner_Lock_To_Frequency(uint32_t tuneFrequency, uint32_t bandwidth, t_Module modul)
+{
+    return p_tunerLock(tuneFrequency / 1000000);
+}
+#endif
+
+/***********************************************************************
+* Function Name : Tuner_Deinit
+*
+* Description   : Stops reader thread and closes capture
+*
+**********************************************************************/
+t_Error Tuner_Deinit()
+{
+    uint32_t i;
+
+    pthread_mutex_lock(&reader_mutex);
+    if(!readerStarted)
+    {
+        pthread_mutex_unlock(&reader_mutex);
+        return 0;
+    }
+    readerExit = 1;
+    pthread_cond_signal(&reader_condition);
+    pthread_mutex_unlock(&reader_mutex);
+
+    pthread_join(reader_thread, NULL);
+    readerStarted = 0;
+    tunerLocked = 0;
+
+    p_pacerLog();
+    p_monitorLog();
+    p_log("Tuner_Deinit: %llu packets, %u sync losses, %u transport errors, %s sync scan",
+        (unsigned long long)tsDemux.stats.packets, tsDemux.stats.syncLosses, tsDemux.stats.errorPackets,
+        Ts_Sync_Engine_Name(tsDemux.engine));
+    for(i = 0; i < MAX_FILTER_NUMBER; i++)
+    {
+        if(demuxFilters[i].hFilter)
+        {
+            p_log("  filter %x PID %u: %u sections, %u CC discontinuities on PID, %u CRC errors", demuxFilters[i].hFilter,
+                demuxFilters[i].params.PID, demuxFilters[i].delivered, tsDemux.pids[demuxFilters[i].params.PID].ccErrors,
+                demuxFilters[i].crcErrors);
+            p_filterLog(&demuxFilters[i]);
+        }
+    }
+    return 0;
+}
+
+t_Error Tuner_Register_Status_Callback(Tuner_Status_Callback tunerStatusCallback)
+{
+    if(NULL != TunerStatusCallback)
+    {
+        printf("%s(%d): Tuner_Register_Status_Callback failed, callback already registered!\n", __FUNCTION__, __LINE__);
+        return -1;
+    }
+    TunerStatusCallback = tunerStatusCallback;
+    return 0;
+}
+
+t_Error Tuner_Unregister_Status_Callback(Tuner_Status_Callback tunerStatusCallback)
+{
+    if(NULL == TunerStatusCallback)
+    {
+        printf("%s(%d): Tuner_Unregister_Status_Callback failed, callback already unregistered!\n", __FUNCTION__, __LINE__);
+        return -1;
+    }
+    if(TunerStatusCallback != tunerStatusCallback)
+    {
+        printf("%s(%d): Tuner_Unregister_Status_Callback failed, wrong callback function!\n", __FUNCTION__, __LINE__);
+        return -1;
+    }
+    TunerStatusCallback = NULL;
+    return 0;
+}
+
+/***********************************************************************
+* Function Name : Tuner_Get_Signal_Quality
+*
+* Comment       : Capture is perfect signal, no capture is no lock
+*
+**********************************************************************/
+t_Error Tuner_Get_Signal_Quality(uint8_t *signalQuality)
+{
+    if(NULL == signalQuality)
+    {
+        printf("\n%s failed, signalQuality is NULL\n", __FUNCTION__);
+        return -1;
+    }
+    if(!tunerLocked)
+    {
+        printf("\nDVBT NOT LOCKED\n");
+        return -1;
+    }
+    *signalQuality = 100;
+    return 0;
+}
+
+/* Replay clock and scheduler report */
+static void p_pacerLog(void)
+{
+    const t_TsPacerStats *stats = &tsPacer.stats;
+
+    if(!replayBitrate || 0 == tsPacer.bytes)
+    {
+        return;
+    }
+    if(0 == stats->pcrCount)
+    {
+        p_log("replay paced by bitrate, no PCR on clock PID");
+        return;
+    }
+    p_log("replay clock PID %u: %u PCRs, interval max %.1f ms, jitter mean %.3f max %.3f ms, %.2f Mbit/s, %u rebases",
+        tsPacer.pcrPid, stats->pcrCount, stats->pcrIntervalMax,
+        stats->pcrJitterCount ? stats->pcrJitterSum / stats->pcrJitterCount : 0.0, stats->pcrJitterMax,
+        stats->bitrate / 1e6, stats->rebases);
+    p_log("replay scheduler: %u wake-ups, late mean %.3f max %.3f ms, %u more than 1 ms late",
+        stats->waits, stats->waits ? stats->latenessSum / stats->waits : 0.0, stats->latenessMax, stats->lateOverMs);
+}
+
+/* Open capture of frequency, NULL when there is none */
+static FILE* p_openCapture(uint32_t frequencyMHz)
+{
+    char path[MAX_PATH_LENGTH + 16];
+    const char *marker = strstr(capturePath, "%u");
+
+    if(NULL != marker)
+    {
+        snprintf(path, sizeof(path), "%.*s%u%s", (int)(marker - capturePath), capturePath, frequencyMHz, marker + 2);
+    }
+    else
+    {
+        snprintf(path, sizeof(path), "%s", capturePath);
+    }
+    return fopen(path, "rb");
+}
+
+/***********************************************************************
+* Function Name : p_readerThread
+*
+* Description   : Plays capture of tuned frequency into section filters
+*
+* Comment       : Switches capture when tune request comes, reports
+*                 lock after TDP_FILE_LOCK_MS and paces packets to
+*                 TDP_FILE_BITRATE. Tuner callback runs here, like
+*                 tune check thread of tdp_api.c.
+*
+**********************************************************************/
+static void* p_readerThread(void *arg)
+{
+    static uint8_t chunk[MY_READING_BUFF_SIZE];
+    FILE *file = NULL;
+    uint32_t seenGeneration = 0;
+    uint32_t lockPending = 0;
+    double lockAt = 0;
+    double paceStart = 0;
+    uint64_t paceBytes = 0;
+
+    for(;;)
+    {
+        uint32_t frequencyMHz;
+        uint32_t generation;
+        uint32_t followPid;
+        size_t offset;
+        size_t got;
+        uint32_t sections;
+        uint32_t i;
+
+        pthread_mutex_lock(&reader_mutex);
+        if(readerExit)
+        {
+            pthread_mutex_unlock(&reader_mutex);
+            break;
+        }
+        generation = tuneGeneration;
+        frequencyMHz = tuneFrequencyMHz;
+        followPid = pacerFollowPid;
+        /* Nothing to play, sleep until tune request */
+        if(generation == seenGeneration && !lockPending && (NULL == file || !tunerLocked))
+        {
+            pthread_cond_wait(&reader_condition, &reader_mutex);
+            pthread_mutex_unlock(&reader_mutex);
+            continue;
+        }
+        pthread_mutex_unlock(&reader_mutex);
+
+        if(Ts_Pacer_Follow_Pid(&tsPacer, followPid))
+        {
+            p_log("replay clock is PCR of PID %u", followPid);
+        }
+
+        if(generation != seenGeneration)
+        {
+            /* Retune, sections of old multiplex must not end up in filters */
+            seenGeneration = generation;
+            tunerLocked = 0;
+            if(NULL != file)
+            {
+                fclose(file);
+            }
+            file = p_openCapture(frequencyMHz);
+            Ts_Pacer_Rebase(&tsPacer);
+            pthread_mutex_lock(&demux_mutex);
+            Ts_Demux_Discontinuity(&tsDemux);
+            p_monitorRetune();
+            pthread_mutex_unlock(&demux_mutex);
+            lockPending = 1;
+            lockAt = p_now() + lockDelayMs / 1000.0;
+            continue;
+        }
+
+        if(lockPending)
+        {
+            double wait = lockAt - p_now();
+            if(wait > 0)
+            {
+                struct timespec ts;
+                ts.tv_sec = (time_t)wait;
+                ts.tv_nsec = (long)((wait - ts.tv_sec) * 1e9);
+                nanosleep(&ts, NULL);
+                continue;
+            }
+            lockPending = 0;
+            tunerLocked = (NULL != file);
+            p_log("tuner %s at %u MHz", tunerLocked ? "LOCKED" : "no signal", frequencyMHz);
+            if(NULL != TunerStatusCallback)
+            {
+                TunerStatusCallback(tunerLocked ? STATUS_LOCKED : STATUS_ERROR);
+            }
+            paceStart = p_now();
+            paceBytes = 0;
+            continue;
+        }
+
+        got = fread(chunk, 1, MY_READING_BUFF_SIZE, file);
+        if(got == 0)
+        {
+            p_pacerLog();
+            if(!replayLoop)
+            {
+                p_log("end of capture");
+                tunerLocked = 0;
+                continue;
+            }
+            /* Loop point is discontinuity on every PID */
+            rewind(file);
+            Ts_Pacer_Rebase(&tsPacer);
+            paceStart = p_now();
+            paceBytes = 0;
+            pthread_mutex_lock(&demux_mutex);
+            Ts_Demux_Discontinuity(&tsDemux);
+            Ts_Monitor_Discontinuity(&tsMonitor, 0);
+            pthread_mutex_unlock(&demux_mutex);
+            continue;
+        }
+
+        /* Parts up to clock PCR wait for their PCR, bitrate paces capture before first PCR */
+        offset = 0;
+        while(offset < got)
+        {
+            size_t part = got - offset;
+            double deadline = 0;
+
+            if(replayBitrate)
+            {
+                part = Ts_Pacer_Scan(&tsPacer, &chunk[offset], got - offset, &deadline);
+                if(deadline > 0)
+                {
+                    Ts_Pacer_Wait(&tsPacer, deadline);
+                }
+                else if(!Ts_Pacer_Has_Clock(&tsPacer))
+                {
+                    paceBytes += part;
+                    deadline = paceStart + paceBytes * 8.0 / (replayBitrate * replaySpeed);
+                    if(deadline > p_now() + 0.001)
+                    {
+                        Ts_Pacer_Wait(&tsPacer, deadline);
+                    }
+                }
+            }
+
+            /* Split packets and sync losses are handled by demux */
+            pthread_mutex_lock(&demux_mutex);
+            if(!monitorRateMeasured && tsPacer.timelinePcrs > TS_PACER_JITTER_SETTLE && tsPacer.stats.bitrate > 0)
+            {
+                /* Monitor times repetition by bytes, once per capture so PCR errors do not bend its clock */
+                Ts_Monitor_Set_Bitrate(&tsMonitor, (uint32_t)tsPacer.stats.bitrate);
+                monitorRateMeasured = 1;
+            }
+            sections = tsDemux.stats.sections;
+            for(i = 0; i < MAX_FILTER_NUMBER; i++)
+            {
+                demuxFilters[i].feedBytes = 0;
+            }
+            p_monitorFeed(&chunk[offset], part);
+            readStats.events++;
+            if(0 == offset)
+            {
+                readStats.reads++;
+            }
+            if(tsDemux.stats.sections - sections > readStats.batchMax)
+            {
+                readStats.batchMax = tsDemux.stats.sections - sections;
+            }
+            pthread_mutex_unlock(&demux_mutex);
+            offset += part;
+        }
+    }
+
+    if(NULL != file)
+    {
+        fclose(file);
+    }
+    return NULL;
+}
+
+/* Caller holds demux_mutex */
+static void p_tsDemuxInit(void)
+{
+    if(!tsDemuxInitDone)
+    {
+        Ts_Demux_Init(&tsDemux);
+        Ts_Monitor_Init(&tsMonitor, replayBitrate ? replayBitrate : DEFAULT_BITRATE);
+        monitorSyncLosses = 0;
+        Ts_Demux_Set_Tap(&tsDemux, p_monitorPacket, &tsMonitor);
+        Ts_Demux_Set_Section_Handler(&tsDemux, 0, p_sectionReceived, NULL);
+        tsDemuxInitDone = 1;
+    }
+}
+
+static void p_monitorPacket(const uint8_t *packet, void *user)
+{
+    Ts_Monitor_Packet((t_TsMonitor*)user, packet);
+}
+
+/* Demux block and report sync losses it found, caller holds demux_mutex */
+static void p_monitorFeed(const uint8_t *data, size_t length)
+{
+    Ts_Demux_Feed(&tsDemux, data, length);
+    Ts_Monitor_Sync_Loss(&tsMonitor, tsDemux.stats.syncLosses - monitorSyncLosses);
+    monitorSyncLosses = tsDemux.stats.syncLosses;
+}
+
+/* Reassemble PMTs listed in PAT for the monitor, caller holds demux_mutex */
+static void p_monitorPmtWatch(void)
+{
+    uint32_t i;
+
+    for(i = 0; i < tsMonitor.pmtCount; i++)
+    {
+        uint32_t PID = tsMonitor.pmt[i].PID;
+
+        if(NULL == tsDemux.pids[PID].sectionHandler &&
+            Ts_Demux_Set_Section_Handler(&tsDemux, PID, p_sectionReceived, NULL) != 0)
+        {
+            p_log("PMT PID %u not monitored, no free assembler", PID);
+        }
+    }
+}
+
+/* New multiplex, PMT PIDs of the old one stop being reassembled, caller holds demux_mutex */
+static void p_monitorRetune(void)
+{
+    uint32_t PIDs[TS_MONITOR_MAX_PMT_PIDS];
+    uint32_t count = tsMonitor.pmtCount;
+    uint32_t i;
+
+    for(i = 0; i < count; i++)
+    {
+        PIDs[i] = tsMonitor.pmt[i].PID;
+    }
+    Ts_Monitor_Discontinuity(&tsMonitor, 1);
+    monitorRateMeasured = 0;
+    for(i = 0; i < count; i++)
+    {
+        p_pidRelease(PIDs[i]);
+    }
+}
+
+/* Stream health report */
+static void p_monitorLog(void)
+{
+    t_TsMonitorReport report;
+    uint32_t i;
+
+    Ts_Monitor_Get_Report(&tsMonitor, &report);
+    p_log("stream health: PAT interval max %u ms, PMT interval max %u ms on %u PIDs, PCR interval max %u ms on %u PIDs",
+        report.patIntervalMax, report.pmtIntervalMax, report.pmtPids, report.pcrIntervalMax, report.pcrPids);
+    for(i = 0; i < TS_MONITOR_INDICATOR_COUNT; i++)
+    {
+        p_log("  %-24s %u total, %u last %u s", Ts_Monitor_Indicator_Name(i), report.total[i], report.window[i],
+            TS_MONITOR_WINDOW_SECONDS);
+    }
+    if(report.worstCcErrors)
+    {
+        p_log("  most continuity errors on PID %u: %u", report.worstCcPid, report.worstCcErrors);
+    }
+}
+
+/* Stop reassembly of PID when its last filter is gone, caller holds demux_mutex */
+static void p_pidRelease(uint32_t PID)
+{
+    uint32_t i;
+
+    /* Monitor keeps PAT and PMTs coming */
+    if(PID == 0 || Ts_Monitor_Is_Pmt_Pid(&tsMonitor, PID))
+    {
+        return;
+    }
+
+    for(i = 0; i < MAX_FILTER_NUMBER; i++)
+    {
+        if(demuxFilters[i].hFilter && demuxFilters[i].params.PID == PID)
+        {
+            return;
+        }
+    }
+    Ts_Demux_Set_Section_Handler(&tsDemux, PID, NULL, NULL);
+}
+
+/***********************************************************************
+* Function Name : p_sectionReceived
+*
+* Description   : Shows section reassembled by demux to the monitor,
+*                 then offers it to every filter of its PID
+*
+* Comment       : Called by Ts_Demux_Feed with demux_mutex held.
+*                 CRC is checked once per section, TDT has none.
+*
+**********************************************************************/
+static void p_sectionReceived(uint32_t PID, const uint8_t *section, uint32_t length, void *user)
+{
+    int32_t crcOk = (section[0] == 0x70 || Crc32_Mpeg2(section, length) == 0);
+    uint32_t i;
+
+    Ts_Monitor_Section(&tsMonitor, PID, section, length, crcOk);
+    if(PID == 0 && crcOk)
+    {
+        p_monitorPmtWatch();
+    }
+
+    for(i = 0; i < MAX_FILTER_NUMBER; i++)
+    {
+        if(demuxFilters[i].hFilter && demuxFilters[i].params.PID == PID)
+        {
+            p_sectionDeliver(&demuxFilters[i], section, length, crcOk);
+        }
+    }
+}
+
+/***********************************************************************
+* Function Name : p_filterMatch
+*
+* Description   : Compares section with filter bytes the way PE does
+*
+* Comment       : Filter byte 0 is table_id, byte n is section byte
+*                 n + 2, section_length is skipped.
+*
+* Returns       : 1 when section passes
+*
+**********************************************************************/
+static int32_t p_filterMatch(const t_DemuxFilterParams *params, const uint8_t *section, uint32_t length)
+{
+    int32_t haveNot = 0;
+    int32_t notDiffers = 0;
+    uint32_t i;
+
+    for(i = 0; i < params->depth; i++)
+    {
+        uint32_t index = (i == 0) ? 0 : i + 2;
+        uint8_t differ;
+
+        if(index >= length)
+        {
+            return 0;
+        }
+        differ = (section[index] ^ params->match[i]) & params->mask[i];
+        if(differ & ~params->notMask[i])
+        {
+            return 0;
+        }
+        if(params->mask[i] & params->notMask[i])
+        {
+            haveNot = 1;
+            if(differ & params->notMask[i])
+            {
+                notDiffers = 1;
+            }
+        }
+    }
+    return !haveNot || notDiffers;
+}
+
+/***********************************************************************
+* Function Name : p_sectionDeliver
+*
+* Description   : Copies matching section to pool buffer and queues it
+*                 for the dispatcher
+*
+* Comment       : Caller holds demux_mutex, same as
+*                 m_sectionReceivedCallback of tdp_api.c holds
+*                 filter_mutex
+*
+**********************************************************************/
+static void p_sectionDeliver(t_DemuxFilter *filter, const uint8_t *section, uint32_t length, int32_t crcOk)
+{
+    uint8_t *pBuffer;
+
+    if(!p_filterMatch(&filter->params, section, length))
+    {
+        return;
+    }
+    /* PE buffer takes sections before CRC check, count them all */
+    if(0 == filter->feedBytes)
+    {
+        filter->reads++;
+    }
+    filter->feedBytes += length;
+    if(filter->feedBytes > filter->fullnessHighWater)
+    {
+        filter->fullnessHighWater = filter->feedBytes;
+    }
+    if(!crcOk)
+    {
+        filter->crcErrors++;
+        return;
+    }
+
+    pBuffer = p_sectionBufferAcquire();
+    /* Queued sections hold the pool, drop oldest policy gives them up for this one */
+    while(NULL == pBuffer && Section_Dispatch_Get_Policy(&sectionDispatcher) == SECTION_OVERFLOW_DROP_OLDEST
+        && Section_Dispatch_Evict(&sectionDispatcher) == 0)
+    {
+        pBuffer = p_sectionBufferAcquire();
+    }
+    if(NULL == pBuffer)
+    {
+        Section_Dispatch_Count_Drop(&sectionDispatcher);
+        return;
+    }
+    memcpy(pBuffer, section, length);
+    filter->delivered++;
+
+    /* Our reference goes with the section, handle carries generation already */
+    Section_Dispatch_Post(&sectionDispatcher, filter->hFilter, 0, pBuffer, length);
+}
+
+/***********************************************************************
+* Function Name : p_sectionDispatch
+*
+* Description   : Hands queued section to callback of its filter
+*
+* Comment       : Runs on dispatcher thread with section_mutex held,
+*                 section of filter freed meanwhile is not delivered
+*
+**********************************************************************/
+static int32_t p_sectionDispatch(const t_SectionDispatchEntry *entry)
+{
+    t_DemuxFilter *filter;
+
+    pthread_mutex_lock(&section_mutex);
+    filter = p_demuxFilterLookup(entry->filterHandle);
+    if(NULL == filter)
+    {
+        pthread_mutex_unlock(&section_mutex);
+        return -1;
+    }
+    if(NULL != filter->callback)
+    {
+        filter->callback(entry->filterHandle, entry->buffer, entry->length, filter->user);
+    }
+    else if(NULL != DemuxSectionFilterCallback)
+    {
+        DemuxSectionFilterCallback(entry->buffer);
+    }
+    pthread_mutex_unlock(&section_mutex);
+    return 0;
+}
+
+/* Dispatcher drops its reference, buffer stays alive if the callback retained it */
+static void p_sectionRelease(uint8_t *buffer)
+{
+    Demux_Section_Buffer_Release(buffer);
+}
+
+/***********************************************************************
+* Function Name : p_sectionBufferAcquire
+*
+* Description   : Takes a free buffer from the section pool
+*
+* Returns       : Pointer to section data, NULL if the pool is exhausted
+*
+**********************************************************************/
+static uint8_t* p_sectionBufferAcquire(void)
+{
+    t_SectionBuffer *sectionBuffer;
+    int32_t i;
+
+    pthread_mutex_lock(&section_pool_mutex);
+
+    if(!sectionPoolInitDone)
+    {
+        for(i = SECTION_POOL_SIZE - 1; i >= 0; i--)
+        {
+            sectionPool[i].refCount = 0;
+            sectionPool[i].next = sectionPoolFree;
+            sectionPoolFree = &sectionPool[i];
+        }
+        sectionPoolInitDone = 1;
+    }
+
+    sectionBuffer = sectionPoolFree;
+    if(NULL == sectionBuffer)
+    {
+        sectionPoolStats.exhausted++;
+        pthread_mutex_unlock(&section_pool_mutex);
+        return NULL;
+    }
+    sectionPoolFree = sectionBuffer->next;
+    sectionBuffer->next = NULL;
+    sectionBuffer->refCount = 1;
+
+    sectionPoolStats.acquired++;
+    sectionPoolStats.inUse++;
+    if(sectionPoolStats.inUse > sectionPoolStats.highWater)
+    {
+        sectionPoolStats.highWater = sectionPoolStats.inUse;
+    }
+
+    pthread_mutex_unlock(&section_pool_mutex);
+    return sectionBuffer->data;
+}
+
+static t_SectionBuffer* p_sectionBufferLookup(uint8_t *buffer)
+{
+    uint8_t *poolStart = (uint8_t*)&sectionPool[0];
+    uint8_t *poolEnd = (uint8_t*)&sectionPool[SECTION_POOL_SIZE];
+
+    if(buffer < poolStart || buffer >= poolEnd)
+    {
+        return NULL;
+    }
+    if(((buffer - poolStart) % sizeof(t_SectionBuffer)) != 0)
+    {
+        return NULL;
+    }
+    return (t_SectionBuffer*)buffer;
+}
+
+t_Error Demux_Section_Buffer_Retain(uint8_t *buffer)
+{
+    t_SectionBuffer *sectionBuffer = p_sectionBufferLookup(buffer);
+
+    if(NULL == sectionBuffer)
+    {
+        printf("\n%s failed, buffer is not a section buffer\n", __FUNCTION__);
+        return -1;
+    }
+
+    pthread_mutex_lock(&section_pool_mutex);
+    if(sectionBuffer->refCount <= 0)
+    {
+        pthread_mutex_unlock(&section_pool_mutex);
+        printf("\n%s failed, buffer already released\n", __FUNCTION__);
+        return -1;
+    }
+    sectionBuffer->refCount++;
+    pthread_mutex_unlock(&section_pool_mutex);
+    return 0;
+}
+
+t_Error Demux_Section_Buffer_Release(uint8_t *buffer)
+{
+    t_SectionBuffer *sectionBuffer = p_sectionBufferLookup(buffer);
+
+    if(NULL == sectionBuffer)
+    {
+        printf("\n%s failed, buffer is not a section buffer\n", __FUNCTION__);
+        return -1;
+    }
+
+    pthread_mutex_lock(&section_pool_mutex);
+    if(sectionBuffer->refCount <= 0)
+    {
+        pthread_mutex_unlock(&section_pool_mutex);
+        printf("\n%s failed, buffer already released\n", __FUNCTION__);
+        return -1;
+    }
+    sectionBuffer->refCount--;
+    if(0 == sectionBuffer->refCount)
+    {
+        sectionBuffer->next = sectionPoolFree;
+        sectionPoolFree = sectionBuffer;
+        sectionPoolStats.inUse--;
+        sectionPoolStats.released++;
+    }
+    pthread_mutex_unlock(&section_pool_mutex);
+    return 0;
+}
+
+t_Error Demux_Get_Section_Pool_Stats(t_SectionPoolStats *stats)
+{
+    if(NULL == stats)
+    {
+        printf("\n%s failed, stats is NULL\n", __FUNCTION__);
+        return -1;
+    }
+
+    pthread_mutex_lock(&section_pool_mutex);
+    *stats = sectionPoolStats;
+    pthread_mutex_unlock(&section_pool_mutex);
+    return 0;
+}
+
+t_Error Demux_Set_Section_Overflow_Policy(t_SectionOverflowPolicy policy)
+{
+    if(policy != SECTION_OVERFLOW_DROP_NEWEST && policy != SECTION_OVERFLOW_DROP_OLDEST)
+    {
+        printf("\n%s failed, unknown policy %d\n", __FUNCTION__, policy);
+        return -1;
+    }
+    Section_Dispatch_Set_Policy(&sectionDispatcher, policy);
+    return 0;
+}
+
+t_Error Demux_Get_Section_Dispatch_Stats(t_SectionDispatchStats *stats)
+{
+    if(NULL == stats)
+    {
+        printf("\n%s failed, stats is NULL\n", __FUNCTION__);
+        return -1;
+    }
+    Section_Dispatch_Get_Stats(&sectionDispatcher, stats);
+    return 0;
+}
+
+/***********************************************************************
+* Function Name : Demux_Get_Section_Read_Stats
+*
+* Comment       : Events are demux feeds, reads are capture reads,
+*                 resyncs are packet sync losses
+*
+**********************************************************************/
+t_Error Demux_Get_Section_Read_Stats(t_SectionBatchStats *stats)
+{
+    if(NULL == stats)
+    {
+        printf("\n%s failed, stats is NULL\n", __FUNCTION__);
+        return -1;
+    }
+
+    pthread_mutex_lock(&demux_mutex);
+    *stats = readStats;
+    stats->sections = tsDemux.stats.sections;
+    stats->resyncs = tsDemux.stats.syncLosses;
+    stats->skippedBytes = (uint32_t)tsDemux.stats.skippedBytes;
+    pthread_mutex_unlock(&demux_mutex);
+    return 0;
+}
+
+/***********************************************************************
+* Function Name : Demux_Get_Stream_Health
+*
+* Comment       : Packet level, every indicator is measured
+*
+**********************************************************************/
+t_Error Demux_Get_Stream_Health(t_TsMonitorReport *report)
+{
+    if(NULL == report)
+    {
+        printf("\n%s failed, report is NULL\n", __FUNCTION__);
+        return -1;
+    }
+
+    Ts_Monitor_Get_Report(&tsMonitor, report);
+    return 0;
+}
+
+t_Error Demux_Register_Section_Filter_Callback(Demux_Section_Filter_Callback demuxSectionFilterCallback)
+{
+    if(NULL != DemuxSectionFilterCallback )
+    {
+        printf("\n\n%s(%d): failed to register callback! Callback already registered\n\n", __FUNCTION__, __LINE__);
+        return -1;
+    }
+    pthread_mutex_lock(&section_mutex);
+    DemuxSectionFilterCallback = demuxSectionFilterCallback;
+    pthread_mutex_unlock(&section_mutex);
+    return 0;
+}
+
+t_Error Demux_Unregister_Section_Filter_Callback(Demux_Section_Filter_Callback demuxSectionFilterCallback)
+{
+    if(NULL == DemuxSectionFilterCallback )
+    {
+        printf("\n\n%s(%d): failed to unregister callback! Callback already unregistered\n\n", __FUNCTION__, __LINE__);
+        return -1;
+    }
+    if(demuxSectionFilterCallback != DemuxSectionFilterCallback)
+    {
+        printf("\n\n%s(%d): failed to unregister callback! Wrong callback function\n\n", __FUNCTION__, __LINE__);
+        return -1;
+    }
+    pthread_mutex_lock(&section_mutex);
+    DemuxSectionFilterCallback = NULL;
+    pthread_mutex_unlock(&section_mutex);
+    return 0;
+}
+
+t_Error Demux_Register_Filter_Callback(uint32_t filterHandle, Demux_Filter_Section_Callback callback, void *user)
+{
+    t_DemuxFilter *filter;
+
+    pthread_mutex_lock(&section_mutex);
+    filter = p_demuxFilterLookup(filterHandle);
+    if(NULL == filter)
+    {
+        pthread_mutex_unlock(&section_mutex);
+        printf("\n\nWrong filter handle, cannot register callback...\n\n");
+        return -1;
+    }
+    filter->callback = callback;
+    filter->user = callback ? user : NULL;
+    pthread_mutex_unlock(&section_mutex);
+    return 0;
+}
+
+/* Caller holds section_mutex or demux_mutex */
+static t_DemuxFilter* p_demuxFilterLookup(uint32_t filterHandle)
+{
+    uint32_t i;
+
+    if(0 == filterHandle)
+    {
+        return NULL;
+    }
+    for(i = 0; i < MAX_FILTER_NUMBER; i++)
+    {
+        if(demuxFilters[i].hFilter == filterHandle)
+        {
+            return &demuxFilters[i];
+        }
+    }
+    return NULL;
+}
+
+t_Error Demux_Set_Filter(uint32_t playerHandle, uint32_t PID, uint32_t tableID, uint32_t *filterHandle)
+{
+    t_DemuxFilterParams params;
+
+    Demux_Filter_Params_Init(&params, PID, tableID);
+    return Demux_Set_Filter_Ex(playerHandle, &params, filterHandle);
+}
+
+/***********************************************************************
+* Function Name : Demux_Set_Filter_Ex
+*
+* Description   : Sets filter with full match, mask and not-mask depth
+*
+* Comment       : Handle carries slot and generation, so handle of
+*                 freed filter never reaches the filter reusing its slot
+*
+**********************************************************************/
+t_Error Demux_Set_Filter_Ex(uint32_t playerHandle, const t_DemuxFilterParams *params, uint32_t *filterHandle)
+{
+    t_DemuxFilter *filter = NULL;
+    uint32_t bufferClass;
+    uint32_t i;
+
+    if(playerHandle != hPE)
+    {
+        printf("\n\nWrong player handle, cannot set filter...\n\n");
+        return -1;
+    }
+    if(0 == hPE)
+    {
+        printf("\n\nPlayer not initialized set filter...\n\n");
+        return -1;
+    }
+    if(NULL == filterHandle || NULL == params)
+    {
+        printf("\n%s failed, filterHandle or params is NULL\n", __FUNCTION__);
+        return -1;
+    }
+    if(params->depth == 0 || params->depth > DEMUX_FILTER_DEPTH)
+    {
+        printf("\n%s failed, filter depth %u not in 1..%d\n", __FUNCTION__, params->depth, DEMUX_FILTER_DEPTH);
+        return -1;
+    }
+    if(params->bufferClass >= SECTION_BUFFER_CLASS_COUNT)
+    {
+        printf("\n%s failed, unknown buffer class %u\n", __FUNCTION__, params->bufferClass);
+        return -1;
+    }
+    bufferClass = params->bufferClass;
+    if(SECTION_BUFFER_AUTO == bufferClass)
+    {
+        bufferClass = Section_Batch_Default_Class(params->match[DEMUX_FILTER_BYTE_TABLE_ID], params->mask[DEMUX_FILTER_BYTE_TABLE_ID]);
+    }
+
+    pthread_mutex_lock(&section_mutex);
+    pthread_mutex_lock(&demux_mutex);
+    for(i = 0; i < MAX_FILTER_NUMBER; i++)
+    {
+        if(0 == demuxFilters[i].hFilter)
+        {
+            filter = &demuxFilters[i];
+            break;
+        }
+    }
+    if(NULL == filter)
+    {
+        pthread_mutex_unlock(&demux_mutex);
+        pthread_mutex_unlock(&section_mutex);
+        printf("\n\n%s(%d): all %d section filters are in use!\n\n", __FUNCTION__, __LINE__, MAX_FILTER_NUMBER);
+        return -1;
+    }
+
+    /* PID gets one reassembly, however many filters it has */
+    p_tsDemuxInit();
+    if(Ts_Demux_Set_Section_Handler(&tsDemux, params->PID, p_sectionReceived, NULL) != 0)
+    {
+        pthread_mutex_unlock(&demux_mutex);
+        pthread_mutex_unlock(&section_mutex);
+        printf("\n%s failed, PID %u cannot be demultiplexed\n", __FUNCTION__, params->PID);
+        return -1;
+    }
+
+    memset(filter, 0, sizeof(t_DemuxFilter));
+    filter->params = *params;
+    filter->params.bufferClass = bufferClass;
+    filter->bufferSize = Section_Batch_Class_Size(bufferClass);
+    filterGeneration++;
+    filter->hFilter = ((filterGeneration & 0xFFFFFF) << 8) | (i + 1);
+    *filterHandle = filter->hFilter;
+    pthread_mutex_unlock(&demux_mutex);
+    pthread_mutex_unlock(&section_mutex);
+    return 0;
+}
+
+void Demux_Filter_Params_Init(t_DemuxFilterParams *params, uint32_t PID, uint32_t tableID)
+{
+    memset(params, 0, sizeof(t_DemuxFilterParams));
+    params->PID = PID;
+    params->depth = DEMUX_FILTER_BYTE_TABLE_ID + 1;
+    params->match[DEMUX_FILTER_BYTE_TABLE_ID] = tableID;
+    params->mask[DEMUX_FILTER_BYTE_TABLE_ID] = 0xff;
+}
+
+void Demux_Filter_Params_Extension(t_DemuxFilterParams *params, uint16_t tableIdExtension)
+{
+    params->match[DEMUX_FILTER_BYTE_EXTENSION] = tableIdExtension >> 8;
+    params->mask[DEMUX_FILTER_BYTE_EXTENSION] = 0xff;
+    params->match[DEMUX_FILTER_BYTE_EXTENSION + 1] = tableIdExtension & 0xff;
+    params->mask[DEMUX_FILTER_BYTE_EXTENSION + 1] = 0xff;
+    if(params->depth < DEMUX_FILTER_BYTE_EXTENSION + 2)
+    {
+        params->depth = DEMUX_FILTER_BYTE_EXTENSION + 2;
+    }
+}
+
+void Demux_Filter_Params_Version_Changed(t_DemuxFilterParams *params, uint8_t version)
+{
+    params->match[DEMUX_FILTER_BYTE_VERSION] = ((version & 0x1f) << 1) | 0x01;
+    params->mask[DEMUX_FILTER_BYTE_VERSION] = 0x3f;
+    params->notMask[DEMUX_FILTER_BYTE_VERSION] = 0x3e;
+    if(params->depth < DEMUX_FILTER_BYTE_VERSION + 1)
+    {
+        params->depth = DEMUX_FILTER_BYTE_VERSION + 1;
+    }
+}
+
+void Demux_Filter_Params_Buffer(t_DemuxFilterParams *params, t_SectionBufferClass bufferClass)
+{
+    params->bufferClass = bufferClass;
+}
+
+/***********************************************************************
+* Function Name : Demux_Get_Filter_Stats
+*
+* Comment       : Fullness is what PE buffer would hold if the whole
+*                 demux feed arrived between two section events
+*
+**********************************************************************/
+t_Error Demux_Get_Filter_Stats(uint32_t filterHandle, t_DemuxFilterStats *stats)
+{
+    t_DemuxFilter *filter;
+
+    if(NULL == stats)
+    {
+        printf("\n%s failed, stats is NULL\n", __FUNCTION__);
+        return -1;
+    }
+
+    pthread_mutex_lock(&demux_mutex);
+    filter = p_demuxFilterLookup(filterHandle);
+    if(NULL == filter)
+    {
+        pthread_mutex_unlock(&demux_mutex);
+        printf("\n%s failed, wrong filter handle\n", __FUNCTION__);
+        return -1;
+    }
+    stats->PID = filter->params.PID;
+    stats->tableID = filter->params.match[DEMUX_FILTER_BYTE_TABLE_ID];
+    stats->bufferClass = filter->params.bufferClass;
+    stats->bufferSize = filter->bufferSize;
+    stats->fullnessHighWater = filter->fullnessHighWater;
+    stats->reads = filter->reads;
+    stats->sections = filter->delivered;
+    pthread_mutex_unlock(&demux_mutex);
+    return 0;
+}
+
+/* Buffer use of filter, what size classes are tuned by */
+static void p_filterLog(const t_DemuxFilter *filter)
+{
+    p_log("  filter %x PID %u table %x: %s buffer %u bytes, high water %u in %u reads", filter->hFilter,
+        filter->params.PID, filter->params.match[DEMUX_FILTER_BYTE_TABLE_ID],
+        Section_Batch_Class_Name(filter->params.bufferClass), filter->bufferSize, filter->fullnessHighWater, filter->reads);
+}
+
+t_Error Demux_Free_Filter(uint32_t playerHandle, uint32_t filterHandle)
+{
+    t_DemuxFilter *filter;
+    uint32_t PID;
+
+    if(playerHandle != hPE)
+    {
+        printf("\n\nWrong player handle, cannot free filter...\n\n");
+        return -1;
+    }
+    if(0 == hPE)
+    {
+        printf("\n\nPlayer not initialized error...\n\n");
+        return -1;
+    }
+
+    pthread_mutex_lock(&section_mutex);
+    pthread_mutex_lock(&demux_mutex);
+    filter = p_demuxFilterLookup(filterHandle);
+    if(NULL == filter)
+    {
+        pthread_mutex_unlock(&demux_mutex);
+        pthread_mutex_unlock(&section_mutex);
+        printf("\n\nWrong filter handle, cannot free filter...\n\n");
+        return -1;
+    }
+    PID = filter->params.PID;
+    p_filterLog(filter);
+    memset(filter, 0, sizeof(t_DemuxFilter));
+    p_pidRelease(PID);
+    pthread_mutex_unlock(&demux_mutex);
+    pthread_mutex_unlock(&section_mutex);
+    return 0;
+}
+
+t_Error Player_Init(uint32_t *playerHandle)
+{
+    if(NULL == playerHandle)
+    {
+        printf("\n%s failed, playerHandle is NULL\n", __FUNCTION__);
+        return -1;
+    }
+    Crc32_Mpeg2_Init();
+    printf("\nSection CRC engine: %s\n", Crc32_Mpeg2_Engine_Name(Crc32_Mpeg2_Selected_Engine()));
+
+    if(Section_Dispatch_Start(&sectionDispatcher, p_sectionDispatch, p_sectionRelease) != 0)
+    {
+        printf("\n%s failed, section dispatcher not started\n", __FUNCTION__);
+        return -1;
+    }
+
+    hPE = PLAYER_HANDLE;
+    *playerHandle = hPE;
+    p_log("Player_Init");
+    return 0;
+}
+
+/***********************************************************************
+* Function Name : Player_Deinit
+*
+* Description   : Frees every filter left, as PE teardown does
+*
+**********************************************************************/
+t_Error Player_Deinit(uint32_t playerHandle)
+{
+    t_SectionDispatchStats dispatchStats;
+    uint32_t i;
+
+    if(playerHandle != hPE || 0 == hPE)
+    {
+        printf("\n\nWrong player handle, cannot deinit player...\n\n");
+        return -1;
+    }
+
+    pthread_mutex_lock(&section_mutex);
+    pthread_mutex_lock(&demux_mutex);
+    for(i = 0; i < MAX_FILTER_NUMBER; i++)
+    {
+        uint32_t PID = demuxFilters[i].params.PID;
+
+        if(demuxFilters[i].hFilter)
+        {
+            memset(&demuxFilters[i], 0, sizeof(t_DemuxFilter));
+            p_pidRelease(PID);
+        }
+    }
+    pthread_mutex_unlock(&demux_mutex);
+    pthread_mutex_unlock(&section_mutex);
+
+    for(i = 0; i < PLAYER_MAX_PREPARED_STREAMS; i++)
+    {
+        if(preparedStreams[i].hPrepared)
+        {
+            p_log("Player_Deinit: prepared PID %u dropped after %u starts", preparedStreams[i].PID, preparedStreams[i].starts);
+            memset(&preparedStreams[i], 0, sizeof(t_PreparedStream));
+        }
+    }
+
+    Section_Dispatch_Stop(&sectionDispatcher);
+    Section_Dispatch_Get_Stats(&sectionDispatcher, &dispatchStats);
+
+    p_log("Player_Deinit: %u sections through pool, high water %u of %u, %u exhausted", sectionPoolStats.acquired,
+        sectionPoolStats.highWater, sectionPoolStats.poolSize, sectionPoolStats.exhausted);
+    p_log("  dispatcher: %u posted, %u dispatched, %u stale, dropped %u newest %u oldest, queue high water %u, "
+        "wait max %u us, callback max %u us", dispatchStats.posted, dispatchStats.dispatched, dispatchStats.stale,
+        dispatchStats.droppedNewest, dispatchStats.droppedOldest, dispatchStats.queueHighWater,
+        dispatchStats.latencyMaxUs, dispatchStats.callbackMaxUs);
+    hPE = 0;
+    return 0;
+}
+
+t_Error Player_Source_Open(uint32_t playerHandle, uint32_t *sourceHandle)
+{
+    if(playerHandle != hPE || 0 == hPE)
+    {
+        printf("\n\nWrong player handle, cannot open source...\n\n");
+        return -1;
+    }
+    if(NULL == sourceHandle)
+    {
+        printf("\n%s failed, sourceHandle is NULL\n", __FUNCTION__);
+        return -1;
+    }
+    hSource = SOURCE_HANDLE;
+    *sourceHandle = hSource;
+    p_log("Player_Source_Open");
+    return 0;
+}
+
+t_Error Player_Source_Close(uint32_t playerHandle, uint32_t sourceHandle)
+{
+    uint32_t i;
+
+    if(playerHandle != hPE || 0 == hPE)
+    {
+        printf("\n\nWrong player handle, cannot close source...\n\n");
+        return -1;
+    }
+    if(sourceHandle != hSource || 0 == hSource)
+    {
+        printf("\n\nWrong source handle, cannot close source...\n\n");
+        return -1;
+    }
+    /* Streams go with their source */
+    for(i = 0; i < MAX_PLAYER_STREAMS; i++)
+    {
+        if(playerStreams[i].hStream)
+        {
+            p_log("Player_Source_Close: stream PID %u closed", playerStreams[i].PID);
+            playerStreams[i].hStream = 0;
+        }
+    }
+    hSource = 0;
+    p_log("Player_Source_Close");
+    return 0;
+}
+
+t_Error Player_Stream_Create(uint32_t playerHandle, uint32_t sourceHandle, uint32_t PID, tStreamType streamType, uint32_t *streamHandle)
+{
+    if(playerHandle != hPE || 0 == hPE)
+    {
+        printf("\n\nWrong player handle, cannot create stream...\n\n");
+        return -1;
+    }
+    if(sourceHandle != hSource || 0 == hSource)
+    {
+        printf("\n\nWrong source handle, cannot create stream...\n\n");
+        return -1;
+    }
+    if(NULL == streamHandle)
+    {
+        printf("\n%s failed, streamHandle is NULL\n", __FUNCTION__);
+        return -1;
+    }
+    return p_streamCreate(PID, streamType, "Player_Stream_Create", streamHandle);
+}
+
+/***********************************************************************
+* Function Name : p_streamCreate
+*
+* Description   : Logs stream start with PID, type and whether capture
+*                 carries the PID
+*
+**********************************************************************/
+static t_Error p_streamCreate(uint32_t PID, tStreamType streamType, const char *origin, uint32_t *streamHandle)
+{
+    t_PlayerStream *stream = NULL;
+    uint32_t i;
+
+    for(i = 0; i < MAX_PLAYER_STREAMS; i++)
+    {
+        if(0 == playerStreams[i].hStream)
+        {
+            stream = &playerStreams[i];
+            break;
+        }
+    }
+    if(NULL == stream || PID >= TS_PID_COUNT)
+    {
+        printf("\n\nFail to create stream!\n\n");
+        return -1;
+    }
+
+    streamGeneration++;
+    stream->hStream = STREAM_HANDLE_BASE + ((streamGeneration & 0xFFFFFF) << 4) + i;
+    stream->PID = PID;
+    stream->streamType = streamType;
+    stream->createdAt = p_now();
+    *streamHandle = stream->hStream;
+
+    /* Program clock usually travels with video, replay follows it when it does */
+    if(streamType >= VIDEO_TYPE_H264)
+    {
+        pthread_mutex_lock(&reader_mutex);
+        pacerFollowPid = PID;
+        pthread_mutex_unlock(&reader_mutex);
+    }
+
+    p_log("%s: %s PID %u type %d handle %x, %u packets of PID played so far", origin,
+        (streamType >= VIDEO_TYPE_H264) ? "video" : "audio", PID, streamType, stream->hStream, tsDemux.pids[PID].packets);
+    return 0;
+}
+
+/***********************************************************************
+* Function Name : Player_Stream_Prepare
+*
+* Description   : Keeps PID and type for a later start, PE attribute
+*                 set has no cost in replay
+*
+**********************************************************************/
+t_Error Player_Stream_Prepare(uint32_t playerHandle, uint32_t PID, tStreamType streamType, uint32_t *preparedHandle)
+{
+    t_PreparedStream *prepared = NULL;
+    uint32_t i;
+
+    if(playerHandle != hPE || 0 == hPE)
+    {
+        printf("\n\nWrong player handle, cannot prepare stream...\n\n");
+        return -1;
+    }
+    if(NULL == preparedHandle)
+    {
+        printf("\n%s failed, preparedHandle is NULL\n", __FUNCTION__);
+        return -1;
+    }
+    for(i = 0; i < PLAYER_MAX_PREPARED_STREAMS; i++)
+    {
+        if(0 == preparedStreams[i].hPrepared)
+        {
+            prepared = &preparedStreams[i];
+            break;
+        }
+    }
+    if(NULL == prepared || PID >= TS_PID_COUNT)
+    {
+        printf("\n%s failed, no free prepared stream or wrong PID %u\n", __FUNCTION__, PID);
+        return -1;
+    }
+
+    preparedGeneration++;
+    prepared->hPrepared = PREPARED_HANDLE_BASE + ((preparedGeneration & 0xFFFFFF) << 4) + i;
+    prepared->PID = PID;
+    prepared->streamType = streamType;
+    prepared->starts = 0;
+    *preparedHandle = prepared->hPrepared;
+    p_log("Player_Stream_Prepare: %s PID %u type %d handle %x",
+        (streamType >= VIDEO_TYPE_H264) ? "video" : "audio", PID, streamType, prepared->hPrepared);
+    return 0;
+}
+
+t_Error Player_Stream_Create_Prepared(uint32_t playerHandle, uint32_t sourceHandle, uint32_t preparedHandle, uint32_t *streamHandle)
+{
+    t_PreparedStream *prepared;
+
+    if(playerHandle != hPE || 0 == hPE)
+    {
+        printf("\n\nWrong player handle, cannot create stream...\n\n");
+        return -1;
+    }
+    if(sourceHandle != hSource || 0 == hSource)
+    {
+        printf("\n\nWrong source handle, cannot create stream...\n\n");
+        return -1;
+    }
+    if(NULL == streamHandle)
+    {
+        printf("\n%s failed, streamHandle is NULL\n", __FUNCTION__);
+        return -1;
+    }
+    prepared = p_preparedLookup(preparedHandle);
+    if(NULL == prepared)
+    {
+        printf("\n\nWrong prepared stream handle, cannot create stream...\n\n");
+        return -1;
+    }
+    prepared->starts++;
+    return p_streamCreate(prepared->PID, prepared->streamType, "Player_Stream_Create_Prepared", streamHandle);
+}
+
+t_Error Player_Stream_Unprepare(uint32_t playerHandle, uint32_t preparedHandle)
+{
+    t_PreparedStream *prepared;
+
+    if(playerHandle != hPE || 0 == hPE)
+    {
+        printf("\n\nWrong player handle, cannot unprepare stream...\n\n");
+        return -1;
+    }
+    prepared = p_preparedLookup(preparedHandle);
+    if(NULL == prepared)
+    {
+        printf("\n\nWrong prepared stream handle, cannot unprepare stream...\n\n");
+        return -1;
+    }
+    p_log("Player_Stream_Unprepare: PID %u handle %x after %u starts", prepared->PID, preparedHandle, prepared->starts);
+    memset(prepared, 0, sizeof(t_PreparedStream));
+    return 0;
+}
+
+static t_PreparedStream* p_preparedLookup(uint32_t preparedHandle)
+{
+    uint32_t i;
+
+    for(i = 0; i < PLAYER_MAX_PREPARED_STREAMS; i++)
+    {
+        if(0 != preparedHandle && preparedStreams[i].hPrepared == preparedHandle)
+        {
+            return &preparedStreams[i];
+        }
+    }
+    return NULL;
+}
+
+t_Error Player_Stream_Remove(uint32_t playerHandle, uint32_t sourceHandle, uint32_t streamHandle)
+{
+    uint32_t i;
+
+    if(playerHandle != hPE || 0 == hPE)
+    {
+        printf("\n\nWrong player handle, cannot remove stream...\n\n");
+        return -1;
+    }
+    if(sourceHandle != hSource || 0 == hSource)
+    {
+        printf("\n\nWrong source handle, cannot remove stream...\n\n");
+        return -1;
+    }
+    for(i = 0; i < MAX_PLAYER_STREAMS; i++)
+    {
+        if(0 != streamHandle && playerStreams[i].hStream == streamHandle)
+        {
+            p_log("Player_Stream_Remove: %s PID %u handle %x after %.0f ms",
+                (playerStreams[i].streamType >= VIDEO_TYPE_H264) ? "video" : "audio", playerStreams[i].PID,
+                streamHandle, (p_now() - playerStreams[i].createdAt) * 1000);
+            playerStreams[i].hStream = 0;
+            return 0;
+        }
+    }
+    printf("\n\nFail to remove stream %x!\n\n", streamHandle);
+    return -1;
+}
+
+t_Error Player_Volume_Set(uint32_t playerHandle, uint32_t volume)
+{
+    if(playerHandle != hPE || 0 == hPE)
+    {
+        printf("\n\nWrong player handle, cannot set volume...\n\n");
+        return -1;
+    }
+    volumeLevel = volume;
+    p_log("Player_Volume_Set: %u", volume);
+    return 0;
+}
+
+t_Error Player_Volume_Get(uint32_t playerHandle, uint32_t *volume)
+{
+    if(playerHandle != hPE || 0 == hPE)
+    {
+        printf("\n\nWrong player handle, cannot get volume...\n\n");
+        return -1;
+    }
+    if(NULL == volume)
+    {
+        printf("\n%s failed, volume is NULL\n", __FUNCTION__);
+        return -1;
+    }
+    *volume = volumeLevel;
+    return 0;
+}
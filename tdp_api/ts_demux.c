@@ -0,0 +1,636 @@
+/********************************************************
+*
+* FILE NAME: $URL$  ts_demux.c
+*            $Date$
+*            $Rev$
+*
+* DESCRIPTION
+*
+* Software transport stream demultiplexer. Packets in sync
+* are routed with one PID table lookup each, sync scan runs
+* only after sync is lost and checks 16 candidate offsets
+* per step with SSE2 or NEON, memchr scan is the fallback
+* (ARMv5 board has no NEON). Candidate is taken when the
+* byte one packet later is sync byte too.
+*
+*********************************************************/
+/********************************************************/
+/*                 Includes                             */
+/********************************************************/
+#include "ts_demux.h"
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define TS_DEMUX_NEON
+#include <arm_neon.h>
+#if !defined(__aarch64__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+#endif
+
+/********************************************************/
+/*                 Defines                              */
+/********************************************************/
+#define TS_VECTOR_SIZE          16
+#define SECTION_SIZE_INFO       3
+#define SYNC_TEST_SIZE          (TS_PACKET_SIZE*4)
+
+/********************************************************/
+/*                 Typedefs                             */
+/********************************************************/
+typedef size_t (*t_TsSyncFunction)(const uint8_t *data, size_t length);
+
+/********************************************************/
+/*                 Local File Variables                 */
+/********************************************************/
+static pthread_once_t tsSyncInitOnce = PTHREAD_ONCE_INIT;
+static t_TsSyncEngine tsSyncSelectedEngine = TS_SYNC_ENGINE_SCALAR;
+static int32_t tsSyncEngineAvailable[TS_SYNC_ENGINE_COUNT];
+
+static const char *tsSyncEngineNames[TS_SYNC_ENGINE_COUNT] =
+{
+    "scalar",
+    "sse2",
+    "neon"
+};
+
+/********************************************************/
+/*                 Local Functions Declarations         */
+/********************************************************/
+static void p_tsSyncSelect(void);
+static size_t p_tsSyncScalar(const uint8_t *data, size_t length);
+#if defined(__SSE2__)
+static size_t p_tsSyncSse2(const uint8_t *data, size_t length);
+#endif
+#if defined(TS_DEMUX_NEON)
+static size_t p_tsSyncNeon(const uint8_t *data, size_t length);
+#endif
+static void p_tsRoute(t_TsDemux *demux, const uint8_t *packet);
+static void p_tsSectionPacket(t_TsDemux *demux, t_TsPidEntry *entry, uint32_t PID, const uint8_t *packet);
+static uint32_t p_tsSectionAppend(t_TsDemux *demux, t_TsPidEntry *entry, uint32_t PID, const uint8_t *data, uint32_t length);
+static void p_tsAssemblerReset(t_TsSectionAssembler *assembler);
+
+static const t_TsSyncFunction tsSyncFunctions[TS_SYNC_ENGINE_COUNT] =
+{
+    p_tsSyncScalar,
+#if defined(__SSE2__)
+    p_tsSyncSse2,
+#else
+    NULL,
+#endif
+#if defined(TS_DEMUX_NEON)
+    p_tsSyncNeon
+#else
+    NULL
+#endif
+};
+
+/********************************************************/
+/*                 Functions Definitions                */
+/********************************************************/
+
+/***********************************************************************
+* Function Name : p_tsSyncScalar
+*
+* Description   : memchr for sync byte, confirm one packet later
+*
+**********************************************************************/
+static size_t p_tsSyncScalar(const uint8_t *data, size_t length)
+{
+    size_t i = 0;
+
+    while (i < length)
+    {
+        const uint8_t *found = memchr(&data[i], TS_SYNC_BYTE, length - i);
+
+        if (NULL == found)
+        {
+            return length;
+        }
+        i = found - data;
+        if (i + TS_PACKET_SIZE >= length || data[i + TS_PACKET_SIZE] == TS_SYNC_BYTE)
+        {
+            return i;
+        }
+        i++;
+    }
+    return length;
+}
+
+#if defined(__SSE2__)
+/***********************************************************************
+* Function Name : p_tsSyncSse2
+*
+* Description   : Compares 16 offsets and their offsets one packet
+*                 later per step, scalar scan takes the tail
+*
+**********************************************************************/
+static size_t p_tsSyncSse2(const uint8_t *data, size_t length)
+{
+    const __m128i sync = _mm_set1_epi8(TS_SYNC_BYTE);
+    size_t i = 0;
+
+    for (; i + TS_VECTOR_SIZE + TS_PACKET_SIZE <= length; i += TS_VECTOR_SIZE)
+    {
+        __m128i here = _mm_loadu_si128((const __m128i*)&data[i]);
+        __m128i next = _mm_loadu_si128((const __m128i*)&data[i + TS_PACKET_SIZE]);
+        int32_t mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(here, sync), _mm_cmpeq_epi8(next, sync)));
+
+        if (mask)
+        {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    return i + p_tsSyncScalar(&data[i], length - i);
+}
+#endif
+
+#if defined(TS_DEMUX_NEON)
+/***********************************************************************
+* Function Name : p_tsSyncNeon
+*
+* Description   : Same as SSE2 engine, 16 byte mask is narrowed to
+*                 4 bits per lane to find the first hit
+*
+**********************************************************************/
+static size_t p_tsSyncNeon(const uint8_t *data, size_t length)
+{
+    const uint8x16_t sync = vdupq_n_u8(TS_SYNC_BYTE);
+    size_t i = 0;
+
+    for (; i + TS_VECTOR_SIZE + TS_PACKET_SIZE <= length; i += TS_VECTOR_SIZE)
+    {
+        uint8x16_t here = vceqq_u8(vld1q_u8(&data[i]), sync);
+        uint8x16_t next = vceqq_u8(vld1q_u8(&data[i + TS_PACKET_SIZE]), sync);
+        uint8x8_t narrow = vshrn_n_u16(vreinterpretq_u16_u8(vandq_u8(here, next)), 4);
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(narrow), 0);
+
+        if (mask)
+        {
+            return i + (__builtin_ctzll(mask) >> 2);
+        }
+    }
+    return i + p_tsSyncScalar(&data[i], length - i);
+}
+#endif
+
+/***********************************************************************
+* Function Name : p_tsSyncSelect
+*
+* Description   : Probes engines and selects the last one that gives
+*                 the scalar answer on every offset of test buffer
+*
+**********************************************************************/
+static void p_tsSyncSelect(void)
+{
+    uint8_t test[SYNC_TEST_SIZE];
+    uint32_t seed = 1;
+    int32_t engine;
+    size_t i;
+
+    /* Many lone sync bytes, sync pairs at a few places */
+    for (i = 0; i < SYNC_TEST_SIZE; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        test[i] = ((seed >> 16) & 0x07) ? (uint8_t)(seed >> 8) : TS_SYNC_BYTE;
+    }
+    for (i = 0; i < SYNC_TEST_SIZE; i++)
+    {
+        if (test[i] == TS_SYNC_BYTE && i + TS_PACKET_SIZE < SYNC_TEST_SIZE)
+        {
+            test[i + TS_PACKET_SIZE] ^= (test[i + TS_PACKET_SIZE] == TS_SYNC_BYTE) ? 0x01 : 0x00;
+        }
+    }
+    test[77] = test[77 + TS_PACKET_SIZE] = TS_SYNC_BYTE;
+    test[301] = test[301 + TS_PACKET_SIZE] = TS_SYNC_BYTE;
+
+    tsSyncEngineAvailable[TS_SYNC_ENGINE_SCALAR] = 1;
+    tsSyncEngineAvailable[TS_SYNC_ENGINE_SSE2] = 1;
+    tsSyncEngineAvailable[TS_SYNC_ENGINE_NEON] = 1;
+#if defined(TS_DEMUX_NEON) && !defined(__aarch64__)
+    tsSyncEngineAvailable[TS_SYNC_ENGINE_NEON] = (getauxval(AT_HWCAP) & HWCAP_NEON) ? 1 : 0;
+#endif
+
+    tsSyncSelectedEngine = TS_SYNC_ENGINE_SCALAR;
+    for (engine = 0; engine < TS_SYNC_ENGINE_COUNT; engine++)
+    {
+        if (!tsSyncEngineAvailable[engine] || NULL == tsSyncFunctions[engine])
+        {
+            tsSyncEngineAvailable[engine] = 0;
+            continue;
+        }
+        for (i = 0; i < SYNC_TEST_SIZE; i++)
+        {
+            if (tsSyncFunctions[engine](&test[i], SYNC_TEST_SIZE - i) != p_tsSyncScalar(&test[i], SYNC_TEST_SIZE - i))
+            {
+                break;
+            }
+        }
+        if (i != SYNC_TEST_SIZE)
+        {
+            printf("\n%s: %s engine failed self test, disabled\n", __FUNCTION__, tsSyncEngineNames[engine]);
+            tsSyncEngineAvailable[engine] = 0;
+            continue;
+        }
+        tsSyncSelectedEngine = (t_TsSyncEngine)engine;
+    }
+}
+
+/***********************************************************************
+* Function Name : Ts_Sync_Find
+*
+**********************************************************************/
+size_t Ts_Sync_Find(t_TsSyncEngine engine, const uint8_t *data, size_t length)
+{
+    pthread_once(&tsSyncInitOnce, p_tsSyncSelect);
+
+    if (engine >= TS_SYNC_ENGINE_COUNT || !tsSyncEngineAvailable[engine])
+    {
+        engine = TS_SYNC_ENGINE_SCALAR;
+    }
+    return tsSyncFunctions[engine](data, length);
+}
+
+/***********************************************************************
+* Function Name : Ts_Sync_Engine_Available
+*
+**********************************************************************/
+int32_t Ts_Sync_Engine_Available(t_TsSyncEngine engine)
+{
+    pthread_once(&tsSyncInitOnce, p_tsSyncSelect);
+
+    if (engine >= TS_SYNC_ENGINE_COUNT)
+    {
+        return 0;
+    }
+    return tsSyncEngineAvailable[engine];
+}
+
+/***********************************************************************
+* Function Name : Ts_Sync_Engine_Name
+*
+**********************************************************************/
+const char* Ts_Sync_Engine_Name(t_TsSyncEngine engine)
+{
+    if (engine >= TS_SYNC_ENGINE_COUNT)
+    {
+        return "unknown";
+    }
+    return tsSyncEngineNames[engine];
+}
+
+static void p_tsAssemblerReset(t_TsSectionAssembler *assembler)
+{
+    assembler->fill = 0;
+    assembler->total = 0;
+    assembler->lastCC = -1;
+}
+
+/***********************************************************************
+* Function Name : Ts_Demux_Init
+*
+**********************************************************************/
+void Ts_Demux_Init(t_TsDemux *demux)
+{
+    uint32_t i;
+
+    pthread_once(&tsSyncInitOnce, p_tsSyncSelect);
+
+    memset(demux, 0, sizeof(t_TsDemux));
+    for (i = 0; i < TS_PID_COUNT; i++)
+    {
+        demux->pids[i].assembler = -1;
+    }
+    demux->engine = tsSyncSelectedEngine;
+}
+
+/***********************************************************************
+* Function Name : Ts_Demux_Set_Packet_Handler
+*
+**********************************************************************/
+int32_t Ts_Demux_Set_Packet_Handler(t_TsDemux *demux, uint32_t PID, Ts_Packet_Handler handler, void *user)
+{
+    if (PID >= TS_PID_COUNT)
+    {
+        printf("\n%s failed, PID %u out of range\n", __FUNCTION__, PID);
+        return -1;
+    }
+    demux->pids[PID].packetHandler = handler;
+    demux->pids[PID].packetUser = handler ? user : NULL;
+    return 0;
+}
+
+/***********************************************************************
+* Function Name : Ts_Demux_Set_Tap
+*
+**********************************************************************/
+void Ts_Demux_Set_Tap(t_TsDemux *demux, Ts_Packet_Handler handler, void *user)
+{
+    demux->tapHandler = handler;
+    demux->tapUser = handler ? user : NULL;
+}
+
+/***********************************************************************
+* Function Name : Ts_Demux_Set_Section_Handler
+*
+* Description   : Gives PID an assembler from the pool, or returns it
+*
+**********************************************************************/
+int32_t Ts_Demux_Set_Section_Handler(t_TsDemux *demux, uint32_t PID, Ts_Section_Handler handler, void *user)
+{
+    t_TsPidEntry *entry;
+    int32_t i;
+
+    if (PID >= TS_PID_COUNT)
+    {
+        printf("\n%s failed, PID %u out of range\n", __FUNCTION__, PID);
+        return -1;
+    }
+    entry = &demux->pids[PID];
+
+    if (NULL == handler)
+    {
+        if (entry->assembler >= 0)
+        {
+            demux->assemblerUsed[entry->assembler] = 0;
+        }
+        entry->assembler = -1;
+        entry->sectionHandler = NULL;
+        entry->sectionUser = NULL;
+        return 0;
+    }
+
+    if (entry->assembler < 0)
+    {
+        for (i = 0; i < TS_DEMUX_MAX_SECTION_PIDS; i++)
+        {
+            if (!demux->assemblerUsed[i])
+            {
+                break;
+            }
+        }
+        if (i == TS_DEMUX_MAX_SECTION_PIDS)
+        {
+            printf("\n%s failed, all %d section assemblers are in use\n", __FUNCTION__, TS_DEMUX_MAX_SECTION_PIDS);
+            return -1;
+        }
+        demux->assemblerUsed[i] = 1;
+        p_tsAssemblerReset(&demux->assemblers[i]);
+        entry->assembler = i;
+    }
+    entry->sectionHandler = handler;
+    entry->sectionUser = user;
+    return 0;
+}
+
+/***********************************************************************
+* Function Name : Ts_Demux_Discontinuity
+*
+**********************************************************************/
+void Ts_Demux_Discontinuity(t_TsDemux *demux)
+{
+    uint32_t i;
+
+    demux->carryFill = 0;
+    for (i = 0; i < TS_DEMUX_MAX_SECTION_PIDS; i++)
+    {
+        p_tsAssemblerReset(&demux->assemblers[i]);
+    }
+}
+
+/***********************************************************************
+* Function Name : Ts_Demux_Feed
+*
+* Description   : Routes packets of block, keeps split packet for next
+*                 block and searches sync again when it is lost
+*
+**********************************************************************/
+uint32_t Ts_Demux_Feed(t_TsDemux *demux, const uint8_t *data, size_t length)
+{
+    uint32_t routed = 0;
+
+    demux->stats.bytes += length;
+
+    /* Finish packet split by previous block */
+    if (demux->carryFill)
+    {
+        size_t take = TS_PACKET_SIZE - demux->carryFill;
+
+        take = (take < length) ? take : length;
+        memcpy(&demux->carry[demux->carryFill], data, take);
+        demux->carryFill += take;
+        data += take;
+        length -= take;
+        if (demux->carryFill < TS_PACKET_SIZE)
+        {
+            return 0;
+        }
+        demux->carryFill = 0;
+        p_tsRoute(demux, demux->carry);
+        routed++;
+    }
+
+    while (length > 0)
+    {
+        if (data[0] != TS_SYNC_BYTE)
+        {
+            size_t skip = Ts_Sync_Find(demux->engine, data, length);
+
+            demux->stats.syncLosses++;
+            demux->stats.skippedBytes += skip;
+            data += skip;
+            length -= skip;
+            continue;
+        }
+        if (length < TS_PACKET_SIZE)
+        {
+            memcpy(demux->carry, data, length);
+            demux->carryFill = length;
+            break;
+        }
+        p_tsRoute(demux, data);
+        routed++;
+        data += TS_PACKET_SIZE;
+        length -= TS_PACKET_SIZE;
+    }
+    return routed;
+}
+
+/* One table lookup, PIDs nobody asked for end here */
+static void p_tsRoute(t_TsDemux *demux, const uint8_t *packet)
+{
+    uint32_t PID = ((packet[1] & 0x1F) << 8) | packet[2];
+    t_TsPidEntry *entry = &demux->pids[PID];
+
+    entry->packets++;
+    demux->stats.packets++;
+    if (packet[1] & 0x80)
+    {
+        demux->stats.errorPackets++;
+    }
+
+    if (NULL != demux->tapHandler)
+    {
+        demux->tapHandler(packet, demux->tapUser);
+    }
+    if (NULL != entry->packetHandler)
+    {
+        entry->packetHandler(packet, entry->packetUser);
+    }
+    if (NULL != entry->sectionHandler)
+    {
+        p_tsSectionPacket(demux, entry, PID, packet);
+    }
+}
+
+/***********************************************************************
+* Function Name : p_tsSectionPacket
+*
+* Description   : Reassembles sections of PID from packet payload
+*
+* Comment       : Continuity gap or transport error drops the partial
+*                 section. Packet starting sections can finish one
+*                 section and carry several more, 0xFF after a section
+*                 is stuffing.
+*
+**********************************************************************/
+static void p_tsSectionPacket(t_TsDemux *demux, t_TsPidEntry *entry, uint32_t PID, const uint8_t *packet)
+{
+    t_TsSectionAssembler *assembler = &demux->assemblers[entry->assembler];
+    uint32_t adaptation = (packet[3] >> 4) & 0x03;
+    int32_t cc = packet[3] & 0x0F;
+    uint32_t offset = 4;
+    const uint8_t *data;
+    uint32_t length;
+
+    if (packet[1] & 0x80)
+    {
+        assembler->fill = 0;
+        assembler->total = 0;
+        return;
+    }
+    if (!(adaptation & 0x01))
+    {
+        return;
+    }
+    if (adaptation == 0x03)
+    {
+        offset += 1 + packet[4];
+        if (offset >= TS_PACKET_SIZE)
+        {
+            return;
+        }
+    }
+
+    if (assembler->lastCC >= 0)
+    {
+        if (cc == assembler->lastCC)
+        {
+            /* Duplicate packet */
+            return;
+        }
+        if (cc != ((assembler->lastCC + 1) & 0x0F))
+        {
+            entry->ccErrors++;
+            assembler->fill = 0;
+            assembler->total = 0;
+        }
+    }
+    assembler->lastCC = cc;
+
+    data = &packet[offset];
+    length = TS_PACKET_SIZE - offset;
+
+    if (!(packet[1] & 0x40))
+    {
+        if (assembler->fill > 0)
+        {
+            p_tsSectionAppend(demux, entry, PID, data, length);
+        }
+        return;
+    }
+
+    /* pointer_field, bytes before it end the section in progress */
+    {
+        uint32_t pointer = data[0];
+
+        data++;
+        length--;
+        if (pointer > length)
+        {
+            assembler->fill = 0;
+            assembler->total = 0;
+            return;
+        }
+        if (assembler->fill > 0)
+        {
+            p_tsSectionAppend(demux, entry, PID, data, pointer);
+        }
+        assembler->fill = 0;
+        assembler->total = 0;
+        data += pointer;
+        length -= pointer;
+    }
+
+    while (length > 0 && data[0] != 0xFF)
+    {
+        uint32_t used = p_tsSectionAppend(demux, entry, PID, data, length);
+
+        /* Handler may have stopped reassembly of this PID */
+        if (NULL == entry->sectionHandler || entry->assembler < 0)
+        {
+            return;
+        }
+        data += used;
+        length -= used;
+        if (assembler->fill > 0)
+        {
+            /* Section goes on in next packet */
+            break;
+        }
+    }
+}
+
+/* Take bytes of section in progress, returns number of bytes used */
+static uint32_t p_tsSectionAppend(t_TsDemux *demux, t_TsPidEntry *entry, uint32_t PID, const uint8_t *data, uint32_t length)
+{
+    t_TsSectionAssembler *assembler = &demux->assemblers[entry->assembler];
+    uint32_t used = 0;
+    uint32_t take;
+
+    if (assembler->total == 0)
+    {
+        take = SECTION_SIZE_INFO - assembler->fill;
+        take = (take < length) ? take : length;
+        memcpy(&assembler->section[assembler->fill], data, take);
+        assembler->fill += take;
+        used += take;
+        if (assembler->fill < SECTION_SIZE_INFO)
+        {
+            return used;
+        }
+        assembler->total = SECTION_SIZE_INFO + (((assembler->section[1] & 0x0F) << 8) | assembler->section[2]);
+    }
+
+    take = assembler->total - assembler->fill;
+    take = (take < length - used) ? take : length - used;
+    memcpy(&assembler->section[assembler->fill], &data[used], take);
+    assembler->fill += take;
+    used += take;
+
+    if (assembler->fill == assembler->total)
+    {
+        assembler->fill = 0;
+        assembler->total = 0;
+        demux->stats.sections++;
+        entry->sectionHandler(PID, assembler->section, SECTION_SIZE_INFO + (((assembler->section[1] & 0x0F) << 8) | assembler->section[2]),
+            entry->sectionUser);
+    }
+    return used;
+}
@@ -0,0 +1,181 @@
+/**
+ * @file ts_demux.h
+ *
+ * @brief Software transport stream demultiplexer
+ *
+ * Takes transport stream in blocks of any size, finds packet sync with
+ * vectorized scanning, routes 188 byte packets through flat PID table to
+ * per PID handlers and reassembles PSI sections of PIDs that ask for it.
+ * Front-end for host side tooling built around tdp_api.h, such as the
+ * file backed libtdp.
+ */
+
+#ifndef TS_DEMUX_H_
+#define TS_DEMUX_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define TS_PACKET_SIZE              188
+#define TS_SYNC_BYTE                0x47
+#define TS_PID_COUNT                8192
+#define TS_NULL_PID                 0x1FFF
+#define TS_SECTION_MAX_SIZE         (4096+3)
+#define TS_DEMUX_MAX_SECTION_PIDS   48      /* PIDs reassembling sections at the same time, filters and monitored PMTs */
+
+/**
+ * @brief Sync scan engine identifiers
+ */
+typedef enum t_TsSyncEngine
+{
+    TS_SYNC_ENGINE_SCALAR = 0,  /* memchr and confirm, reference */
+    TS_SYNC_ENGINE_SSE2   = 1,  /* 16 candidates per step, x86 */
+    TS_SYNC_ENGINE_NEON   = 2,  /* 16 candidates per step, ARM */
+    TS_SYNC_ENGINE_COUNT  = 3
+}t_TsSyncEngine;
+
+/**
+ * @brief Called for every packet of PID, including packets with transport_error_indicator
+ */
+typedef void (*Ts_Packet_Handler)(const uint8_t *packet, void *user);
+
+/**
+ * @brief Called for every complete section of PID, section is valid only during the call
+ */
+typedef void (*Ts_Section_Handler)(uint32_t PID, const uint8_t *section, uint32_t length, void *user);
+
+/**
+ * @brief Section in progress on one PID
+ */
+typedef struct t_TsSectionAssembler
+{
+    uint8_t section[TS_SECTION_MAX_SIZE];
+    uint32_t fill;                      /* bytes collected, 0 when idle */
+    uint32_t total;                     /* whole section size, 0 until header is in */
+    int32_t lastCC;                     /* -1 before first packet */
+}t_TsSectionAssembler;
+
+/**
+ * @brief Routing table entry, 0 handlers means PID is skipped after counting
+ */
+typedef struct t_TsPidEntry
+{
+    Ts_Packet_Handler packetHandler;
+    void *packetUser;
+    Ts_Section_Handler sectionHandler;
+    void *sectionUser;
+    int32_t assembler;                  /* index into assembler pool, -1 if none */
+    uint32_t packets;
+    uint32_t ccErrors;                  /* continuity gaps seen by section reassembly */
+}t_TsPidEntry;
+
+/**
+ * @brief Demux counters
+ */
+typedef struct t_TsDemuxStats
+{
+    uint64_t bytes;                     /* bytes fed */
+    uint64_t packets;                   /* packets routed */
+    uint32_t syncLosses;                /* times packet sync was searched for again */
+    uint64_t skippedBytes;              /* bytes dropped while searching */
+    uint32_t errorPackets;              /* packets with transport_error_indicator */
+    uint32_t sections;                  /* sections handed to section handlers */
+}t_TsDemuxStats;
+
+/**
+ * @brief Demux instance, big enough to be kept static rather than on stack
+ */
+typedef struct t_TsDemux
+{
+    t_TsPidEntry pids[TS_PID_COUNT];
+    t_TsSectionAssembler assemblers[TS_DEMUX_MAX_SECTION_PIDS];
+    uint32_t assemblerUsed[TS_DEMUX_MAX_SECTION_PIDS];
+    uint8_t carry[TS_PACKET_SIZE];      /* packet split between two feeds */
+    uint32_t carryFill;
+    Ts_Packet_Handler tapHandler;       /* sees every packet before routing */
+    void *tapUser;
+    t_TsSyncEngine engine;
+    t_TsDemuxStats stats;
+}t_TsDemux;
+
+/****************************************************************************
+* @brief    Clear routing table and counters, select the fastest sync engine
+*
+*****************************************************************************/
+void Ts_Demux_Init(t_TsDemux *demux);
+
+/****************************************************************************
+* @brief    Route every packet of PID to handler
+*
+* @param    [in] handler - NULL stops routing packets of PID
+*
+* @return   0 - no error, -1 - PID out of range
+*
+*****************************************************************************/
+int32_t Ts_Demux_Set_Packet_Handler(t_TsDemux *demux, uint32_t PID, Ts_Packet_Handler handler, void *user);
+
+/****************************************************************************
+* @brief    Show every packet to handler before it is routed, for monitoring
+*
+* @param    [in] handler - NULL removes the tap
+*
+*****************************************************************************/
+void Ts_Demux_Set_Tap(t_TsDemux *demux, Ts_Packet_Handler handler, void *user);
+
+/****************************************************************************
+* @brief    Reassemble sections of PID and hand them to handler
+*
+* @param    [in] handler - NULL stops reassembly and frees its assembler
+*
+* @return   0 - no error, -1 - PID out of range or all assemblers in use
+*
+* @note     Sections are not checked, match and CRC are up to the handler.
+*           Packets with transport_error_indicator and continuity gaps drop
+*           the section in progress, duplicate packets are skipped.
+*
+*****************************************************************************/
+int32_t Ts_Demux_Set_Section_Handler(t_TsDemux *demux, uint32_t PID, Ts_Section_Handler handler, void *user);
+
+/****************************************************************************
+* @brief    Demultiplex block of stream
+*
+* @param    [in] data - stream bytes, packets may be split between blocks
+* @param    [in] length - block length in bytes
+*
+* @return   Number of packets routed
+*
+*****************************************************************************/
+uint32_t Ts_Demux_Feed(t_TsDemux *demux, const uint8_t *data, size_t length);
+
+/****************************************************************************
+* @brief    Forget split packet and sections in progress, stream jumped
+*
+* @note     Routing table and counters stay.
+*
+*****************************************************************************/
+void Ts_Demux_Discontinuity(t_TsDemux *demux);
+
+/****************************************************************************
+* @brief    Find packet sync with specific engine
+*
+* @return   Offset of the first 0x47 followed by another one a packet later
+*           (or by end of data), length if there is none
+*
+*****************************************************************************/
+size_t Ts_Sync_Find(t_TsSyncEngine engine, const uint8_t *data, size_t length);
+
+/****************************************************************************
+* @brief    Check whether engine can run on this CPU
+*
+* @return   1 - available, 0 - not available
+*
+*****************************************************************************/
+int32_t Ts_Sync_Engine_Available(t_TsSyncEngine engine);
+
+/****************************************************************************
+* @brief    Get printable engine name
+*
+*****************************************************************************/
+const char* Ts_Sync_Engine_Name(t_TsSyncEngine engine);
+
+#endif //TS_DEMUX_H_
@@ -0,0 +1,323 @@
+/********************************************************
+*
+* FILE NAME: $URL$  ts_demux_bench.c
+*            $Date$
+*            $Rev$
+*
+* DESCRIPTION
+*
+* Host side micro-benchmark for ts_demux. Cross-validates
+* every sync engine against the scalar one on every offset,
+* prints sync scan MB/s per engine on stream without sync
+* and demux throughput on synthetic multiplex in sync and
+* with sync losses. Optional argument is a recorded TS,
+* it is demultiplexed and its PIDs are listed.
+*
+* Usage: ts_demux_bench [capture.ts]
+*
+*********************************************************/
+/********************************************************/
+/*                 Includes                             */
+/********************************************************/
+#include "ts_demux.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/********************************************************/
+/*                 Defines                              */
+/********************************************************/
+#define BENCH_TOTAL_BYTES   (256*1024*1024)
+#define BENCH_PACKETS       (BENCH_TOTAL_BYTES / TS_PACKET_SIZE)
+#define BENCH_BLOCK_SIZE    (TS_PACKET_SIZE*348)        /* odd sized reads split packets */
+#define VALIDATE_SIZE       (64*1024)
+#define BENCH_PID_COUNT     24
+#define CAPTURE_BLOCK_SIZE  (1024*1024)
+
+/********************************************************/
+/*                 Local File Variables                 */
+/********************************************************/
+static uint32_t sectionCount = 0;
+static uint32_t sectionBytes = 0;
+static uint32_t packetCount = 0;
+
+/********************************************************/
+/*                 Local Functions Declarations         */
+/********************************************************/
+static double nowSeconds(void);
+static void onSection(uint32_t PID, const uint8_t *section, uint32_t length, void *user);
+static void onPacket(const uint8_t *packet, void *user);
+static void buildMultiplex(uint8_t *stream, size_t packets);
+static int32_t crossValidate(void);
+static void benchSyncScan(void);
+static void benchDemux(const uint8_t *stream, size_t length, const char *name);
+static int32_t listCapture(const char *fileName);
+
+/********************************************************/
+/*                 Functions Definitions                */
+/********************************************************/
+
+static double nowSeconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void onSection(uint32_t PID, const uint8_t *section, uint32_t length, void *user)
+{
+    sectionCount++;
+    sectionBytes += length;
+}
+
+static void onPacket(const uint8_t *packet, void *user)
+{
+    packetCount++;
+}
+
+/* Multiplex of video, audio and PSI PIDs, PSI packets carry 3 short sections each */
+static void buildMultiplex(uint8_t *stream, size_t packets)
+{
+    static const uint16_t pids[BENCH_PID_COUNT] =
+    {
+        0x0000, 0x0010, 0x0011, 0x0012, 0x0014, 0x0100, 0x0101, 0x0102,
+        0x0200, 0x0201, 0x0202, 0x0300, 0x0301, 0x0302, 0x0400, 0x0401,
+        0x0402, 0x0500, 0x0501, 0x0502, 0x1FFF, 0x1FFF, 0x0101, 0x0201
+    };
+    uint8_t cc[TS_PID_COUNT];
+    size_t n;
+
+    memset(cc, 0, sizeof(cc));
+    srand(1);
+    for (n = 0; n < packets; n++)
+    {
+        uint8_t *packet = &stream[n * TS_PACKET_SIZE];
+        uint16_t PID = pids[rand() % BENCH_PID_COUNT];
+        int32_t psi = PID < 0x20;
+
+        packet[0] = TS_SYNC_BYTE;
+        packet[1] = (psi ? 0x40 : 0x00) | (PID >> 8);
+        packet[2] = PID & 0xFF;
+        packet[3] = 0x10 | cc[PID];
+        cc[PID] = (cc[PID] + 1) & 0x0F;
+        memset(&packet[4], (uint8_t)n, TS_PACKET_SIZE - 4);
+        if (psi)
+        {
+            uint32_t s;
+
+            packet[4] = 0;
+            for (s = 0; s < 3; s++)
+            {
+                uint8_t *section = &packet[5 + s * 50];
+
+                section[0] = 0x42;
+                section[1] = 0xB0;
+                section[2] = 47;
+            }
+            memset(&packet[5 + 150], 0xFF, TS_PACKET_SIZE - 5 - 150);
+        }
+    }
+}
+
+/* Every engine must give scalar answer at every start offset */
+static int32_t crossValidate(void)
+{
+    uint8_t *data = malloc(VALIDATE_SIZE);
+    int32_t errors = 0;
+    int32_t engine;
+    size_t i;
+
+    if (NULL == data)
+    {
+        return 1;
+    }
+    for (i = 0; i < VALIDATE_SIZE; i++)
+    {
+        data[i] = (rand() % 5) ? (uint8_t)rand() : TS_SYNC_BYTE;
+    }
+    for (engine = 1; engine < TS_SYNC_ENGINE_COUNT; engine++)
+    {
+        if (!Ts_Sync_Engine_Available(engine))
+        {
+            continue;
+        }
+        for (i = 0; i < VALIDATE_SIZE; i++)
+        {
+            size_t expected = Ts_Sync_Find(TS_SYNC_ENGINE_SCALAR, &data[i], VALIDATE_SIZE - i);
+
+            if (Ts_Sync_Find(engine, &data[i], VALIDATE_SIZE - i) != expected)
+            {
+                printf("MISMATCH %s offset %u\n", Ts_Sync_Engine_Name(engine), (unsigned)i);
+                errors++;
+                break;
+            }
+        }
+    }
+    free(data);
+    return errors;
+}
+
+/* Scan stream with lone sync bytes only, the worst case after sync loss */
+static void benchSyncScan(void)
+{
+    uint8_t *data = malloc(BENCH_TOTAL_BYTES / 8);
+    size_t length = BENCH_TOTAL_BYTES / 8;
+    int32_t engine;
+    size_t i;
+
+    if (NULL == data)
+    {
+        return;
+    }
+    for (i = 0; i < length; i++)
+    {
+        data[i] = (i % 97) ? (uint8_t)(i * 7 + 1) : TS_SYNC_BYTE;
+        if (data[i] == TS_SYNC_BYTE && (i % 97))
+        {
+            data[i] = 0;
+        }
+    }
+
+    printf("\n%-14s%12s\n", "sync scan", "MB/s");
+    for (engine = 0; engine < TS_SYNC_ENGINE_COUNT; engine++)
+    {
+        volatile size_t sink = 0;
+        double start, elapsed;
+        int32_t round;
+
+        if (!Ts_Sync_Engine_Available(engine))
+        {
+            continue;
+        }
+        start = nowSeconds();
+        for (round = 0; round < 8; round++)
+        {
+            sink += Ts_Sync_Find(engine, data, length);
+        }
+        elapsed = nowSeconds() - start;
+        printf("%-14s%12.1f\n", Ts_Sync_Engine_Name(engine), 8.0 * length / (elapsed * 1024.0 * 1024.0));
+    }
+    free(data);
+}
+
+/* Feed stream in odd sized blocks with PSI PIDs reassembled and one PID routed raw */
+static void benchDemux(const uint8_t *stream, size_t length, const char *name)
+{
+    static t_TsDemux demux;
+    double start, elapsed;
+    size_t position;
+
+    Ts_Demux_Init(&demux);
+    Ts_Demux_Set_Section_Handler(&demux, 0x0000, onSection, NULL);
+    Ts_Demux_Set_Section_Handler(&demux, 0x0011, onSection, NULL);
+    Ts_Demux_Set_Section_Handler(&demux, 0x0012, onSection, NULL);
+    Ts_Demux_Set_Packet_Handler(&demux, 0x0101, onPacket, NULL);
+    sectionCount = 0;
+    sectionBytes = 0;
+    packetCount = 0;
+
+    start = nowSeconds();
+    for (position = 0; position < length; position += BENCH_BLOCK_SIZE + 1)
+    {
+        size_t block = length - position;
+
+        block = (block < BENCH_BLOCK_SIZE + 1) ? block : BENCH_BLOCK_SIZE + 1;
+        Ts_Demux_Feed(&demux, &stream[position], block);
+    }
+    elapsed = nowSeconds() - start;
+
+    printf("%-22s%10.1f MB/s %8.2f GB/min  %llu packets, %u sections, %u routed, %u sync losses\n", name,
+        length / (elapsed * 1024.0 * 1024.0), length * 60.0 / (elapsed * 1024.0 * 1024.0 * 1024.0),
+        (unsigned long long)demux.stats.packets, sectionCount, packetCount, demux.stats.syncLosses);
+}
+
+/* Demultiplex recorded TS and list PIDs with packet and CC error counts */
+static int32_t listCapture(const char *fileName)
+{
+    static t_TsDemux demux;
+    uint8_t *block;
+    FILE *file;
+    size_t got;
+    uint32_t PID;
+    double start, elapsed;
+
+    file = fopen(fileName, "rb");
+    block = malloc(CAPTURE_BLOCK_SIZE);
+    if (NULL == file || NULL == block)
+    {
+        printf("Cannot open %s\n", fileName);
+        free(block);
+        if (NULL != file)
+        {
+            fclose(file);
+        }
+        return 1;
+    }
+
+    Ts_Demux_Init(&demux);
+    /* PSI PIDs are reassembled, so their continuity is checked */
+    for (PID = 0; PID < 0x20; PID++)
+    {
+        Ts_Demux_Set_Section_Handler(&demux, PID, onSection, NULL);
+    }
+    sectionCount = 0;
+
+    start = nowSeconds();
+    while ((got = fread(block, 1, CAPTURE_BLOCK_SIZE, file)) > 0)
+    {
+        Ts_Demux_Feed(&demux, block, got);
+    }
+    elapsed = nowSeconds() - start;
+    fclose(file);
+    free(block);
+
+    printf("\n%s: %llu bytes in %.3f s, %llu packets, %u sections, %u sync losses (%llu bytes skipped), %u transport errors\n",
+        fileName, (unsigned long long)demux.stats.bytes, elapsed, (unsigned long long)demux.stats.packets, sectionCount,
+        demux.stats.syncLosses, (unsigned long long)demux.stats.skippedBytes, demux.stats.errorPackets);
+    for (PID = 0; PID < TS_PID_COUNT; PID++)
+    {
+        if (demux.pids[PID].packets)
+        {
+            printf("  PID %4u (0x%04x) %10u packets %6u CC errors\n", PID, PID, demux.pids[PID].packets, demux.pids[PID].ccErrors);
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    uint8_t *stream;
+    int32_t errors;
+    size_t n;
+
+    stream = malloc((size_t)BENCH_PACKETS * TS_PACKET_SIZE);
+    if (NULL == stream)
+    {
+        return 1;
+    }
+
+    errors = crossValidate();
+    printf("Cross-validation against scalar sync scan: %s\n", errors ? "FAILED" : "OK");
+
+    benchSyncScan();
+
+    printf("\n");
+    buildMultiplex(stream, BENCH_PACKETS);
+    benchDemux(stream, (size_t)BENCH_PACKETS * TS_PACKET_SIZE, "in sync");
+
+    /* Break sync every 1000 packets */
+    for (n = 500; n < BENCH_PACKETS; n += 1000)
+    {
+        stream[n * TS_PACKET_SIZE] = 0x00;
+    }
+    benchDemux(stream, (size_t)BENCH_PACKETS * TS_PACKET_SIZE, "sync lost every 1000");
+
+    if (argc > 1)
+    {
+        errors += listCapture(argv[1]);
+    }
+
+    free(stream);
+    return errors ? 1 : 0;
+}
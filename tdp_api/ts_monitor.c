@@ -0,0 +1,557 @@
+/********************************************************
+*
+* FILE NAME: $URL$  ts_monitor.c
+*            $Date$
+*            $Rev$
+*
+* DESCRIPTION
+*
+* ETR 290 priority 1 and 2 stream health monitor. Time is
+* stream time: replay advances it by packet at the stream
+* bitrate, live demux uses CLOCK_MONOTONIC. Single writer,
+* readers see counters through relaxed atomic loads.
+*
+*********************************************************/
+/********************************************************/
+/*                 Includes                             */
+/********************************************************/
+#include "ts_monitor.h"
+#include <string.h>
+#include <time.h>
+
+/********************************************************/
+/*                 Defines                              */
+/********************************************************/
+#define MONITOR_LOAD(field)             __atomic_load_n(&(field), __ATOMIC_RELAXED)
+#define MONITOR_STORE(field, value)     __atomic_store_n(&(field), (value), __ATOMIC_RELAXED)
+
+#define PCR_WRAP                        ((uint64_t)300 << 33)
+#define PCR_TICKS_PER_MS                27000
+#define OVERDUE_CHECK_PACKETS           1024    /* power of 2 */
+#define NO_SECOND                       0xFFFFFFFF
+
+/********************************************************/
+/*                 Local File Variables                 */
+/********************************************************/
+static const char *tsMonitorIndicatorNames[TS_MONITOR_INDICATOR_COUNT] =
+{
+    "TS_sync_loss",
+    "PAT_error",
+    "Continuity_count_error",
+    "PMT_error",
+    "Transport_error",
+    "CRC_error",
+    "PCR_repetition_error",
+    "PCR_discontinuity_error"
+};
+
+/********************************************************/
+/*                 Local Functions Declarations         */
+/********************************************************/
+static uint64_t p_tsMonitorNow(t_TsMonitor *monitor);
+static uint64_t p_tsMonitorWallUs(void);
+static void p_tsMonitorCount(t_TsMonitor *monitor, t_TsMonitorIndicator indicator, uint32_t count);
+static void p_tsMonitorArrival(t_TsMonitor *monitor, t_TsMonitorTimer *timer, uint64_t now, uint32_t limitMs, t_TsMonitorIndicator indicator);
+static void p_tsMonitorOverdue(t_TsMonitor *monitor, uint64_t now);
+static void p_tsMonitorPcr(t_TsMonitor *monitor, uint32_t PID, const uint8_t *packet, uint32_t discontinuity);
+static void p_tsMonitorPat(t_TsMonitor *monitor, const uint8_t *section, uint32_t length, uint64_t now);
+static void p_tsMonitorTimerReset(t_TsMonitorTimer *timer, uint64_t now);
+
+/********************************************************/
+/*                 Functions Definitions                */
+/********************************************************/
+
+static uint64_t p_tsMonitorWallUs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* Stream time in us */
+static uint64_t p_tsMonitorNow(t_TsMonitor *monitor)
+{
+    if (monitor->bitrate)
+    {
+        return (uint64_t)monitor->clockUs;
+    }
+    return p_tsMonitorWallUs() - monitor->wallStart;
+}
+
+static void p_tsMonitorTimerReset(t_TsMonitorTimer *timer, uint64_t now)
+{
+    timer->seen = 0;
+    timer->overdue = 0;
+    timer->last = now;
+}
+
+/***********************************************************************
+* Function Name : Ts_Monitor_Init
+*
+**********************************************************************/
+void Ts_Monitor_Init(t_TsMonitor *monitor, uint32_t bitrate)
+{
+    uint32_t i, j;
+
+    memset(monitor, 0, sizeof(t_TsMonitor));
+    memset(monitor->lastCC, 0xFF, sizeof(monitor->lastCC));
+    for (i = 0; i < TS_MONITOR_INDICATOR_COUNT; i++)
+    {
+        for (j = 0; j < TS_MONITOR_WINDOW_SECONDS; j++)
+        {
+            monitor->window[i].second[j] = NO_SECOND;
+        }
+    }
+    monitor->wallStart = p_tsMonitorWallUs();
+    Ts_Monitor_Set_Bitrate(monitor, bitrate);
+    p_tsMonitorTimerReset(&monitor->pat, 0);
+}
+
+/***********************************************************************
+* Function Name : Ts_Monitor_Set_Bitrate
+*
+* Comment       : Clock advances per packet, so new rate does not move
+*                 time already passed
+*
+**********************************************************************/
+void Ts_Monitor_Set_Bitrate(t_TsMonitor *monitor, uint32_t bitrate)
+{
+    if (0 == monitor->bitrate && bitrate)
+    {
+        monitor->clockUs = (double)p_tsMonitorNow(monitor);
+    }
+    monitor->usPerPacket = bitrate ? TS_PACKET_SIZE * 8 * 1e6 / bitrate : 0;
+    MONITOR_STORE(monitor->bitrate, bitrate);
+}
+
+/* Add errors to total and to bucket of current second */
+static void p_tsMonitorCount(t_TsMonitor *monitor, t_TsMonitorIndicator indicator, uint32_t count)
+{
+    t_TsMonitorWindow *window = &monitor->window[indicator];
+    uint32_t second = (uint32_t)(p_tsMonitorNow(monitor) / 1000000);
+    uint32_t bucket = second % TS_MONITOR_WINDOW_SECONDS;
+
+    if (window->second[bucket] != second)
+    {
+        MONITOR_STORE(window->count[bucket], 0);
+        MONITOR_STORE(window->second[bucket], second);
+    }
+    MONITOR_STORE(window->count[bucket], window->count[bucket] + count);
+    MONITOR_STORE(monitor->total[indicator], monitor->total[indicator] + count);
+    MONITOR_STORE(monitor->currentSecond, second);
+}
+
+/* Table arrived, late arrival counts unless its gap was already counted */
+static void p_tsMonitorArrival(t_TsMonitor *monitor, t_TsMonitorTimer *timer, uint64_t now, uint32_t limitMs, t_TsMonitorIndicator indicator)
+{
+    uint32_t interval = (uint32_t)((now - timer->last) / 1000);
+
+    if (timer->seen)
+    {
+        if (interval > timer->intervalMax)
+        {
+            MONITOR_STORE(timer->intervalMax, interval);
+        }
+    }
+    if (interval > limitMs && !timer->overdue)
+    {
+        p_tsMonitorCount(monitor, indicator, 1);
+    }
+    timer->seen = 1;
+    timer->overdue = 0;
+    timer->last = now;
+}
+
+/* Tables that stay away are counted once per gap, before they come back */
+static void p_tsMonitorOverdue(t_TsMonitor *monitor, uint64_t now)
+{
+    uint32_t i;
+
+    if (!monitor->pat.overdue && now - monitor->pat.last > (uint64_t)TS_MONITOR_PAT_LIMIT_MS * 1000)
+    {
+        monitor->pat.overdue = 1;
+        p_tsMonitorCount(monitor, TS_MONITOR_PAT_ERROR, 1);
+    }
+    for (i = 0; i < monitor->pmtCount; i++)
+    {
+        t_TsMonitorTimer *timer = &monitor->pmt[i];
+
+        if (!timer->overdue && now - timer->last > (uint64_t)TS_MONITOR_PMT_LIMIT_MS * 1000)
+        {
+            timer->overdue = 1;
+            p_tsMonitorCount(monitor, TS_MONITOR_PMT_ERROR, 1);
+        }
+    }
+    MONITOR_STORE(monitor->currentSecond, (uint32_t)(now / 1000000));
+}
+
+/***********************************************************************
+* Function Name : p_tsMonitorPcr
+*
+* Description   : PCR repetition and discontinuity of one PID
+*
+* Comment       : PCR advance is compared with stream time between
+*                 the two packets, jump over 100 ms either way without
+*                 discontinuity_indicator is an error
+*
+**********************************************************************/
+static void p_tsMonitorPcr(t_TsMonitor *monitor, uint32_t PID, const uint8_t *packet, uint32_t discontinuity)
+{
+    t_TsMonitorTimer *timer = NULL;
+    uint64_t now = p_tsMonitorNow(monitor);
+    uint64_t base;
+    uint64_t pcr;
+    uint32_t i;
+
+    for (i = 0; i < monitor->pcrCount; i++)
+    {
+        if (monitor->pcr[i].PID == PID)
+        {
+            timer = &monitor->pcr[i];
+            break;
+        }
+    }
+    if (NULL == timer)
+    {
+        if (monitor->pcrCount == TS_MONITOR_MAX_PCR_PIDS)
+        {
+            return;
+        }
+        timer = &monitor->pcr[monitor->pcrCount];
+        memset(timer, 0, sizeof(t_TsMonitorTimer));
+        timer->PID = PID;
+        MONITOR_STORE(monitor->pcrCount, monitor->pcrCount + 1);
+    }
+
+    base = ((uint64_t)packet[6] << 25) | ((uint64_t)packet[7] << 17) | ((uint64_t)packet[8] << 9) |
+        ((uint64_t)packet[9] << 1) | (packet[10] >> 7);
+    pcr = base * 300 + (((packet[10] & 0x01) << 8) | packet[11]);
+
+    if (timer->seen && !discontinuity)
+    {
+        uint32_t interval = (uint32_t)((now - timer->last) / 1000);
+        uint64_t advance = (pcr + PCR_WRAP - timer->pcr) % PCR_WRAP;
+        int64_t jump = (int64_t)(advance / PCR_TICKS_PER_MS) - (int64_t)interval;
+
+        if (interval > timer->intervalMax)
+        {
+            MONITOR_STORE(timer->intervalMax, interval);
+        }
+        if (interval > TS_MONITOR_PCR_LIMIT_MS)
+        {
+            p_tsMonitorCount(monitor, TS_MONITOR_PCR_REPETITION, 1);
+        }
+        if (advance > PCR_WRAP / 2 || jump > TS_MONITOR_PCR_JUMP_MS || jump < -TS_MONITOR_PCR_JUMP_MS)
+        {
+            p_tsMonitorCount(monitor, TS_MONITOR_PCR_DISCONTINUITY, 1);
+        }
+    }
+    timer->seen = 1;
+    timer->last = now;
+    timer->pcr = pcr;
+}
+
+/***********************************************************************
+* Function Name : Ts_Monitor_Packet
+*
+* Description   : Transport error, continuity, PID 0 scrambling and PCR
+*
+* Comment       : Continuity follows ETR 290 1.4: packets without
+*                 payload keep the counter, one repeated packet is
+*                 allowed, discontinuity_indicator restarts the count
+*
+**********************************************************************/
+void Ts_Monitor_Packet(t_TsMonitor *monitor, const uint8_t *packet)
+{
+    uint32_t PID = ((packet[1] & 0x1F) << 8) | packet[2];
+    uint32_t adaptation = (packet[3] >> 4) & 0x03;
+    int32_t cc = packet[3] & 0x0F;
+    uint32_t discontinuity = 0;
+    int32_t lastCC;
+
+    monitor->packets++;
+    monitor->clockUs += monitor->usPerPacket;
+    if (!monitor->packetLevel)
+    {
+        MONITOR_STORE(monitor->packetLevel, 1);
+    }
+    if ((monitor->packets & (OVERDUE_CHECK_PACKETS - 1)) == 0)
+    {
+        p_tsMonitorOverdue(monitor, p_tsMonitorNow(monitor));
+    }
+
+    /* Header of errored packet cannot be trusted */
+    if (packet[1] & 0x80)
+    {
+        p_tsMonitorCount(monitor, TS_MONITOR_TRANSPORT_ERROR, 1);
+        return;
+    }
+    if (PID == TS_NULL_PID)
+    {
+        return;
+    }
+
+    if ((adaptation & 0x02) && packet[4] > 0)
+    {
+        discontinuity = (packet[5] & 0x80) ? 1 : 0;
+    }
+
+    lastCC = monitor->lastCC[PID];
+    if (lastCC >= 0 && !discontinuity)
+    {
+        int32_t error;
+
+        if (adaptation & 0x01)
+        {
+            if (cc == lastCC)
+            {
+                error = monitor->ccRepeated[PID];
+                monitor->ccRepeated[PID] = 1;
+            }
+            else
+            {
+                error = (cc != ((lastCC + 1) & 0x0F));
+                monitor->ccRepeated[PID] = 0;
+            }
+        }
+        else
+        {
+            error = (cc != lastCC);
+        }
+        if (error)
+        {
+            MONITOR_STORE(monitor->pidCcErrors[PID], monitor->pidCcErrors[PID] + 1);
+            p_tsMonitorCount(monitor, TS_MONITOR_CC_ERROR, 1);
+        }
+    }
+    monitor->lastCC[PID] = (int8_t)cc;
+
+    if (PID == 0 && (packet[3] & 0xC0))
+    {
+        p_tsMonitorCount(monitor, TS_MONITOR_PAT_ERROR, 1);
+    }
+    if ((adaptation & 0x02) && packet[4] >= 7 && (packet[5] & 0x10))
+    {
+        p_tsMonitorPcr(monitor, PID, packet, discontinuity);
+    }
+}
+
+/***********************************************************************
+* Function Name : Ts_Monitor_Sync_Loss
+*
+**********************************************************************/
+void Ts_Monitor_Sync_Loss(t_TsMonitor *monitor, uint32_t count)
+{
+    if (count)
+    {
+        p_tsMonitorCount(monitor, TS_MONITOR_SYNC_LOSS, count);
+    }
+}
+
+/* PMT PIDs of programs in PAT join the watch list */
+static void p_tsMonitorPat(t_TsMonitor *monitor, const uint8_t *section, uint32_t length, uint64_t now)
+{
+    uint32_t end = 3 + (((section[1] & 0x0F) << 8) | section[2]) - 4;
+    uint32_t position;
+
+    if (end > length || length < 12)
+    {
+        return;
+    }
+    for (position = 8; position + 4 <= end; position += 4)
+    {
+        uint32_t programNumber = (section[position] << 8) | section[position + 1];
+        uint32_t PID = ((section[position + 2] & 0x1F) << 8) | section[position + 3];
+        t_TsMonitorTimer *timer;
+
+        if (0 == programNumber || Ts_Monitor_Is_Pmt_Pid(monitor, PID))
+        {
+            continue;
+        }
+        if (monitor->pmtCount == TS_MONITOR_MAX_PMT_PIDS)
+        {
+            return;
+        }
+        timer = &monitor->pmt[monitor->pmtCount];
+        memset(timer, 0, sizeof(t_TsMonitorTimer));
+        timer->PID = PID;
+        p_tsMonitorTimerReset(timer, now);
+        MONITOR_STORE(monitor->pmtCount, monitor->pmtCount + 1);
+    }
+}
+
+/***********************************************************************
+* Function Name : Ts_Monitor_Section
+*
+**********************************************************************/
+void Ts_Monitor_Section(t_TsMonitor *monitor, uint32_t PID, const uint8_t *section, uint32_t length, int32_t crcOk)
+{
+    uint64_t now = p_tsMonitorNow(monitor);
+    uint32_t i;
+
+    if (!crcOk)
+    {
+        p_tsMonitorCount(monitor, TS_MONITOR_CRC_ERROR, 1);
+        return;
+    }
+    if (length < 3)
+    {
+        return;
+    }
+
+    if (PID == 0)
+    {
+        if (section[0] != 0x00)
+        {
+            p_tsMonitorCount(monitor, TS_MONITOR_PAT_ERROR, 1);
+            return;
+        }
+        p_tsMonitorPat(monitor, section, length, now);
+        if (monitor->packetLevel)
+        {
+            p_tsMonitorArrival(monitor, &monitor->pat, now, TS_MONITOR_PAT_LIMIT_MS, TS_MONITOR_PAT_ERROR);
+        }
+        return;
+    }
+
+    if (section[0] != 0x02 || !monitor->packetLevel)
+    {
+        return;
+    }
+    for (i = 0; i < monitor->pmtCount; i++)
+    {
+        if (monitor->pmt[i].PID == PID)
+        {
+            p_tsMonitorArrival(monitor, &monitor->pmt[i], now, TS_MONITOR_PMT_LIMIT_MS, TS_MONITOR_PMT_ERROR);
+            return;
+        }
+    }
+}
+
+/***********************************************************************
+* Function Name : Ts_Monitor_Discontinuity
+*
+**********************************************************************/
+void Ts_Monitor_Discontinuity(t_TsMonitor *monitor, int32_t retune)
+{
+    uint64_t now = p_tsMonitorNow(monitor);
+    uint32_t i;
+
+    if (retune)
+    {
+        MONITOR_STORE(monitor->pmtCount, 0);
+        MONITOR_STORE(monitor->pcrCount, 0);
+    }
+    memset(monitor->lastCC, 0xFF, sizeof(monitor->lastCC));
+    memset(monitor->ccRepeated, 0, sizeof(monitor->ccRepeated));
+    p_tsMonitorTimerReset(&monitor->pat, now);
+    for (i = 0; i < monitor->pmtCount; i++)
+    {
+        p_tsMonitorTimerReset(&monitor->pmt[i], now);
+    }
+    for (i = 0; i < monitor->pcrCount; i++)
+    {
+        monitor->pcr[i].seen = 0;
+    }
+}
+
+/***********************************************************************
+* Function Name : Ts_Monitor_Is_Pmt_Pid
+*
+**********************************************************************/
+int32_t Ts_Monitor_Is_Pmt_Pid(const t_TsMonitor *monitor, uint32_t PID)
+{
+    uint32_t count = MONITOR_LOAD(monitor->pmtCount);
+    uint32_t i;
+
+    for (i = 0; i < count; i++)
+    {
+        if (monitor->pmt[i].PID == PID)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/***********************************************************************
+* Function Name : Ts_Monitor_Get_Report
+*
+* Comment       : Window sums buckets of the last
+*                 TS_MONITOR_WINDOW_SECONDS stream seconds
+*
+**********************************************************************/
+void Ts_Monitor_Get_Report(const t_TsMonitor *monitor, t_TsMonitorReport *report)
+{
+    uint32_t second;
+    uint32_t count;
+    uint32_t i, j;
+
+    memset(report, 0, sizeof(t_TsMonitorReport));
+
+    if (MONITOR_LOAD(monitor->bitrate))
+    {
+        second = MONITOR_LOAD(monitor->currentSecond);
+    }
+    else
+    {
+        second = (uint32_t)((p_tsMonitorWallUs() - monitor->wallStart) / 1000000);
+    }
+
+    for (i = 0; i < TS_MONITOR_INDICATOR_COUNT; i++)
+    {
+        report->total[i] = MONITOR_LOAD(monitor->total[i]);
+        for (j = 0; j < TS_MONITOR_WINDOW_SECONDS; j++)
+        {
+            uint32_t bucketSecond = MONITOR_LOAD(monitor->window[i].second[j]);
+
+            if (bucketSecond != NO_SECOND && bucketSecond <= second && second - bucketSecond < TS_MONITOR_WINDOW_SECONDS)
+            {
+                report->window[i] += MONITOR_LOAD(monitor->window[i].count[j]);
+            }
+        }
+    }
+
+    report->packetLevel = MONITOR_LOAD(monitor->packetLevel);
+    report->patIntervalMax = MONITOR_LOAD(monitor->pat.intervalMax);
+
+    count = MONITOR_LOAD(monitor->pmtCount);
+    report->pmtPids = count;
+    for (i = 0; i < count; i++)
+    {
+        uint32_t interval = MONITOR_LOAD(monitor->pmt[i].intervalMax);
+        report->pmtIntervalMax = (interval > report->pmtIntervalMax) ? interval : report->pmtIntervalMax;
+    }
+
+    count = MONITOR_LOAD(monitor->pcrCount);
+    report->pcrPids = count;
+    for (i = 0; i < count; i++)
+    {
+        uint32_t interval = MONITOR_LOAD(monitor->pcr[i].intervalMax);
+        report->pcrIntervalMax = (interval > report->pcrIntervalMax) ? interval : report->pcrIntervalMax;
+    }
+
+    for (i = 0; i < TS_PID_COUNT; i++)
+    {
+        uint32_t errors = MONITOR_LOAD(monitor->pidCcErrors[i]);
+
+        if (errors > report->worstCcErrors)
+        {
+            report->worstCcErrors = errors;
+            report->worstCcPid = i;
+        }
+    }
+}
+
+/***********************************************************************
+* Function Name : Ts_Monitor_Indicator_Name
+*
+**********************************************************************/
+const char* Ts_Monitor_Indicator_Name(t_TsMonitorIndicator indicator)
+{
+    if (indicator >= TS_MONITOR_INDICATOR_COUNT)
+    {
+        return "unknown";
+    }
+    return tsMonitorIndicatorNames[indicator];
+}
@@ -0,0 +1,177 @@
+/**
+ * @file ts_monitor.h
+ *
+ * @brief ETR 290 priority 1 and 2 stream health monitor
+ *
+ * Counts broadcast side stream errors: sync loss, continuity errors per
+ * PID, PAT and PMT repetition over 0.5 s, transport errors, CRC errors
+ * and PCR repetition and discontinuity. Each indicator has a total and
+ * a rolling window of one second buckets.
+ *
+ * One thread feeds the monitor (demux thread, under its section mutex),
+ * any thread may read the report at the same time. Counters are 32 bit
+ * and written with relaxed atomic stores, so the packet path takes no
+ * lock and costs a PID table lookup and a few compares per packet.
+ */
+
+#ifndef TS_MONITOR_H_
+#define TS_MONITOR_H_
+
+#include <stdint.h>
+#include "ts_demux.h"
+
+#define TS_MONITOR_WINDOW_SECONDS       60
+#define TS_MONITOR_MAX_PMT_PIDS         32
+#define TS_MONITOR_MAX_PCR_PIDS         16
+#define TS_MONITOR_PAT_LIMIT_MS         500
+#define TS_MONITOR_PMT_LIMIT_MS         500
+#define TS_MONITOR_PCR_LIMIT_MS         40
+#define TS_MONITOR_PCR_JUMP_MS          100
+
+/**
+ * @brief Indicators, ETR 290 numbering in comments
+ */
+typedef enum t_TsMonitorIndicator
+{
+    TS_MONITOR_SYNC_LOSS        = 0,    /* 1.1, 1.2 sync lost or sync byte corrupted */
+    TS_MONITOR_PAT_ERROR        = 1,    /* 1.3 no PAT for 0.5 s, other table_id or scrambled on PID 0 */
+    TS_MONITOR_CC_ERROR         = 2,    /* 1.4 continuity counter gap or repeated more than once */
+    TS_MONITOR_PMT_ERROR        = 3,    /* 1.5 no PMT for 0.5 s on PMT PID from PAT */
+    TS_MONITOR_TRANSPORT_ERROR  = 4,    /* 2.1 transport_error_indicator set */
+    TS_MONITOR_CRC_ERROR        = 5,    /* 2.2 section CRC_32 wrong */
+    TS_MONITOR_PCR_REPETITION   = 6,    /* 2.3a more than 40 ms between PCRs of PID */
+    TS_MONITOR_PCR_DISCONTINUITY= 7,    /* 2.3b PCR jump without discontinuity_indicator */
+    TS_MONITOR_INDICATOR_COUNT  = 8
+}t_TsMonitorIndicator;
+
+/**
+ * @brief Rolling window of one indicator
+ */
+typedef struct t_TsMonitorWindow
+{
+    uint32_t second[TS_MONITOR_WINDOW_SECONDS]; /* stream second the bucket counts */
+    uint32_t count[TS_MONITOR_WINDOW_SECONDS];
+}t_TsMonitorWindow;
+
+/**
+ * @brief Repetition timer of PAT, one PMT PID or one PCR PID
+ */
+typedef struct t_TsMonitorTimer
+{
+    uint32_t PID;
+    uint32_t seen;                      /* 0 until first arrival */
+    uint32_t overdue;                   /* current gap already counted as error */
+    uint64_t last;                      /* stream time of last arrival, us */
+    uint64_t pcr;                       /* PCR timers: last PCR, 27 MHz */
+    uint32_t intervalMax;               /* ms */
+}t_TsMonitorTimer;
+
+/**
+ * @brief Monitor state, keep it static, per PID tables make it big
+ */
+typedef struct t_TsMonitor
+{
+    uint32_t total[TS_MONITOR_INDICATOR_COUNT];
+    t_TsMonitorWindow window[TS_MONITOR_INDICATOR_COUNT];
+    uint32_t pidCcErrors[TS_PID_COUNT];
+    int8_t lastCC[TS_PID_COUNT];        /* -1 unknown */
+    uint8_t ccRepeated[TS_PID_COUNT];
+    t_TsMonitorTimer pat;
+    t_TsMonitorTimer pmt[TS_MONITOR_MAX_PMT_PIDS];
+    uint32_t pmtCount;
+    t_TsMonitorTimer pcr[TS_MONITOR_MAX_PCR_PIDS];
+    uint32_t pcrCount;
+    uint32_t bitrate;                   /* bit/s of byte clock, 0 uses wall clock */
+    double usPerPacket;
+    double clockUs;                     /* byte clock, advanced per packet */
+    uint64_t packets;
+    uint64_t wallStart;                 /* us */
+    uint32_t currentSecond;             /* stream second of last update, for readers */
+    uint32_t packetLevel;               /* 1 once packets are fed */
+}t_TsMonitor;
+
+/**
+ * @brief Snapshot for readers
+ */
+typedef struct t_TsMonitorReport
+{
+    uint32_t total[TS_MONITOR_INDICATOR_COUNT];
+    uint32_t window[TS_MONITOR_INDICATOR_COUNT];    /* last TS_MONITOR_WINDOW_SECONDS */
+    uint32_t packetLevel;               /* 0 - fed by sections only, packet indicators and repetition not measured */
+    uint32_t patIntervalMax;            /* ms */
+    uint32_t pmtIntervalMax;            /* ms, worst PMT PID */
+    uint32_t pcrIntervalMax;            /* ms, worst PCR PID */
+    uint32_t pmtPids;
+    uint32_t pcrPids;
+    uint32_t worstCcPid;
+    uint32_t worstCcErrors;
+}t_TsMonitorReport;
+
+/****************************************************************************
+* @brief    Reset monitor
+*
+* @param    [in] bitrate - stream rate for byte clock (replay), 0 times
+*                          events with CLOCK_MONOTONIC (live demux)
+*
+*****************************************************************************/
+void Ts_Monitor_Init(t_TsMonitor *monitor, uint32_t bitrate);
+
+/****************************************************************************
+* @brief    Change byte clock rate, for example once it is measured
+*
+*****************************************************************************/
+void Ts_Monitor_Set_Bitrate(t_TsMonitor *monitor, uint32_t bitrate);
+
+/****************************************************************************
+* @brief    Check one packet: transport error, continuity, PCR, PID 0
+*
+*****************************************************************************/
+void Ts_Monitor_Packet(t_TsMonitor *monitor, const uint8_t *packet);
+
+/****************************************************************************
+* @brief    Count sync losses found by demux
+*
+*****************************************************************************/
+void Ts_Monitor_Sync_Loss(t_TsMonitor *monitor, uint32_t count);
+
+/****************************************************************************
+* @brief    Check one section: CRC, PAT and PMT arrival
+*
+* @param    [in] crcOk - 0 if section failed CRC check
+*
+* @note     PAT sections give the PMT PIDs to watch. Repetition is timed
+*           only when packets are fed too, section filters that pass only
+*           new versions would make every table look late.
+*
+*****************************************************************************/
+void Ts_Monitor_Section(t_TsMonitor *monitor, uint32_t PID, const uint8_t *section, uint32_t length, int32_t crcOk);
+
+/****************************************************************************
+* @brief    Stream jumped (retune, replay loop), timers and continuity restart
+*
+* @param    [in] retune - 1 forgets PMT and PCR PIDs of the old multiplex
+*
+*****************************************************************************/
+void Ts_Monitor_Discontinuity(t_TsMonitor *monitor, int32_t retune);
+
+/****************************************************************************
+* @brief    Check whether PID carries PMT according to PAT
+*
+* @return   1 - PMT PID, 0 - not
+*
+*****************************************************************************/
+int32_t Ts_Monitor_Is_Pmt_Pid(const t_TsMonitor *monitor, uint32_t PID);
+
+/****************************************************************************
+* @brief    Read counters, safe while monitor is fed from other thread
+*
+*****************************************************************************/
+void Ts_Monitor_Get_Report(const t_TsMonitor *monitor, t_TsMonitorReport *report);
+
+/****************************************************************************
+* @brief    Get printable indicator name
+*
+*****************************************************************************/
+const char* Ts_Monitor_Indicator_Name(t_TsMonitorIndicator indicator);
+
+#endif //TS_MONITOR_H_
@@ -0,0 +1,276 @@
+/********************************************************
+*
+* FILE NAME: $URL$  ts_pacer.c
+*            $Date$
+*            $Rev$
+*
+* DESCRIPTION
+*
+* PCR paced replay scheduler. First clock PCR of a timeline
+* is anchored to the time it is scanned, every later one is
+* due at anchor + PCR delta / speed. Sleeps are absolute
+* (clock_nanosleep TIMER_ABSTIME), so oversleeping one part
+* is not added to the next. Parts are released at their
+* PCR, so packets come in bursts of one PCR interval.
+*
+*********************************************************/
+/********************************************************/
+/*                 Includes                             */
+/********************************************************/
+#include "ts_pacer.h"
+#include "ts_demux.h"
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+
+/********************************************************/
+/*                 Defines                              */
+/********************************************************/
+#define PCR_WRAP                ((uint64_t)300 << 33)   /* 33 bit base times 300 */
+#define LATE_LIMIT_MS           1.0
+
+/********************************************************/
+/*                 Local Functions Declarations         */
+/********************************************************/
+static int32_t p_tsPacerReadPcr(const uint8_t *packet, uint64_t *pcr, uint32_t *discontinuity);
+static double p_tsPacerPcr(t_TsPacer *pacer, uint64_t pcr, uint32_t discontinuity, uint64_t byte);
+
+/********************************************************/
+/*                 Functions Definitions                */
+/********************************************************/
+
+double Ts_Pacer_Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/***********************************************************************
+* Function Name : Ts_Pacer_Init
+*
+**********************************************************************/
+void Ts_Pacer_Init(t_TsPacer *pacer, uint32_t pcrPid, double speed)
+{
+    memset(pacer, 0, sizeof(t_TsPacer));
+    pacer->pcrPid = (pcrPid < TS_PID_COUNT) ? pcrPid : TS_PACER_PID_AUTO;
+    pacer->fixedPid = (pcrPid < TS_PID_COUNT);
+    pacer->speed = (speed > 0) ? speed : 1.0;
+}
+
+/***********************************************************************
+* Function Name : Ts_Pacer_Follow_Pid
+*
+**********************************************************************/
+int32_t Ts_Pacer_Follow_Pid(t_TsPacer *pacer, uint32_t PID)
+{
+    if (pacer->fixedPid || PID >= TS_PID_COUNT || PID == pacer->pcrPid)
+    {
+        return 0;
+    }
+    if (!(pacer->pcrSeen[PID >> 3] & (1 << (PID & 0x07))))
+    {
+        return 0;
+    }
+    pacer->pcrPid = PID;
+    Ts_Pacer_Rebase(pacer);
+    return 1;
+}
+
+/***********************************************************************
+* Function Name : Ts_Pacer_Rebase
+*
+**********************************************************************/
+void Ts_Pacer_Rebase(t_TsPacer *pacer)
+{
+    if (pacer->haveBase)
+    {
+        pacer->stats.rebases++;
+    }
+    pacer->haveBase = 0;
+    pacer->timelinePcrs = 0;
+}
+
+int32_t Ts_Pacer_Has_Clock(const t_TsPacer *pacer)
+{
+    return pacer->haveBase;
+}
+
+/* PCR from adaptation field, returns 0 when packet has none */
+static int32_t p_tsPacerReadPcr(const uint8_t *packet, uint64_t *pcr, uint32_t *discontinuity)
+{
+    uint64_t base;
+
+    if (!(packet[3] & 0x20) || packet[4] < 7 || !(packet[5] & 0x10))
+    {
+        return 0;
+    }
+    base = ((uint64_t)packet[6] << 25) | ((uint64_t)packet[7] << 17) | ((uint64_t)packet[8] << 9) |
+        ((uint64_t)packet[9] << 1) | (packet[10] >> 7);
+    *pcr = base * 300 + (((packet[10] & 0x01) << 8) | packet[11]);
+    *discontinuity = (packet[5] & 0x80) ? 1 : 0;
+    return 1;
+}
+
+/***********************************************************************
+* Function Name : p_tsPacerPcr
+*
+* Description   : Places clock PCR on the timeline and updates PCR
+*                 interval, jitter and bitrate
+*
+* Comment       : Jitter is PCR time against time the PCR byte
+*                 position would have at the rate measured up to the
+*                 previous PCR, i.e. deviation from constant rate
+*                 arrival.
+*
+* Returns       : Deadline of the PCR packet
+*
+**********************************************************************/
+static double p_tsPacerPcr(t_TsPacer *pacer, uint64_t pcr, uint32_t discontinuity, uint64_t byte)
+{
+    t_TsPacerStats *stats = &pacer->stats;
+    uint64_t delta = 0;
+    double elapsed;
+
+    if (pacer->haveBase)
+    {
+        delta = (pcr + PCR_WRAP - pacer->lastPcr) % PCR_WRAP;
+        if (discontinuity || delta > (uint64_t)TS_PACER_PCR_HZ / 1000 * TS_PACER_MAX_PCR_GAP_MS)
+        {
+            Ts_Pacer_Rebase(pacer);
+        }
+    }
+
+    if (!pacer->haveBase)
+    {
+        pacer->haveBase = 1;
+        pacer->basePcr = pcr;
+        pacer->baseByte = byte;
+        pacer->baseTime = Ts_Pacer_Now();
+        pacer->lastPcr = pcr;
+        pacer->lastByte = byte;
+        pacer->timelinePcrs = 1;
+        stats->pcrCount++;
+        return pacer->baseTime;
+    }
+
+    stats->pcrCount++;
+    pacer->timelinePcrs++;
+
+    /* Repetition interval */
+    elapsed = (double)delta * 1000 / TS_PACER_PCR_HZ;
+    if (elapsed > stats->pcrIntervalMax)
+    {
+        stats->pcrIntervalMax = elapsed;
+    }
+
+    /* Arrival at constant rate of the timeline so far */
+    {
+        double sinceBase = (double)((pcr + PCR_WRAP - pacer->basePcr) % PCR_WRAP) * 1000 / TS_PACER_PCR_HZ;
+        double lastSinceBase = (double)((pacer->lastPcr + PCR_WRAP - pacer->basePcr) % PCR_WRAP) * 1000 / TS_PACER_PCR_HZ;
+
+        if (pacer->timelinePcrs > TS_PACER_JITTER_SETTLE && lastSinceBase > 0)
+        {
+            double bytesPerMs = (pacer->lastByte - pacer->baseByte) / lastSinceBase;
+            double jitter = sinceBase - (byte - pacer->baseByte) / bytesPerMs;
+
+            jitter = (jitter < 0) ? -jitter : jitter;
+            stats->pcrJitterSum += jitter;
+            stats->pcrJitterCount++;
+            if (jitter > stats->pcrJitterMax)
+            {
+                stats->pcrJitterMax = jitter;
+            }
+        }
+        if (sinceBase > 0)
+        {
+            stats->bitrate = (byte - pacer->baseByte) * 8.0 * 1000 / sinceBase;
+        }
+
+        pacer->lastPcr = pcr;
+        pacer->lastByte = byte;
+        return pacer->baseTime + sinceBase / 1000 / pacer->speed;
+    }
+}
+
+/***********************************************************************
+* Function Name : Ts_Pacer_Scan
+*
+* Description   : Walks packets up to next clock PCR
+*
+* Comment       : Packet split between two calls is not looked at,
+*                 which only happens after sync loss in the capture.
+*
+**********************************************************************/
+size_t Ts_Pacer_Scan(t_TsPacer *pacer, const uint8_t *data, size_t length, double *deadline)
+{
+    size_t position = 0;
+
+    *deadline = 0;
+    while (position + TS_PACKET_SIZE <= length)
+    {
+        const uint8_t *packet = &data[position];
+        uint32_t PID;
+        uint64_t pcr;
+        uint32_t discontinuity;
+
+        if (packet[0] != TS_SYNC_BYTE)
+        {
+            position += Ts_Sync_Find(TS_SYNC_ENGINE_SCALAR, packet, length - position);
+            continue;
+        }
+        position += TS_PACKET_SIZE;
+
+        if (!p_tsPacerReadPcr(packet, &pcr, &discontinuity))
+        {
+            continue;
+        }
+        PID = ((packet[1] & 0x1F) << 8) | packet[2];
+        pacer->pcrSeen[PID >> 3] |= 1 << (PID & 0x07);
+        if (pacer->pcrPid == TS_PACER_PID_AUTO)
+        {
+            pacer->pcrPid = PID;
+        }
+        if (PID != pacer->pcrPid)
+        {
+            continue;
+        }
+
+        *deadline = p_tsPacerPcr(pacer, pcr, discontinuity, pacer->bytes + position - TS_PACKET_SIZE);
+        pacer->bytes += position;
+        return position;
+    }
+
+    position = length;
+    pacer->bytes += position;
+    return position;
+}
+
+/***********************************************************************
+* Function Name : Ts_Pacer_Wait
+*
+**********************************************************************/
+void Ts_Pacer_Wait(t_TsPacer *pacer, double deadline)
+{
+    struct timespec ts;
+    double lateness;
+
+    ts.tv_sec = (time_t)deadline;
+    ts.tv_nsec = (long)((deadline - ts.tv_sec) * 1e9);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+    {
+    }
+
+    /* Positive even when deadline had passed before the call */
+    lateness = (Ts_Pacer_Now() - deadline) * 1000;
+    pacer->stats.waits++;
+    pacer->stats.latenessSum += lateness;
+    if (lateness > pacer->stats.latenessMax)
+    {
+        pacer->stats.latenessMax = lateness;
+    }
+    if (lateness > LATE_LIMIT_MS)
+    {
+        pacer->stats.lateOverMs++;
+    }
+}
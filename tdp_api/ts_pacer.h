@@ -0,0 +1,117 @@
+/**
+ * @file ts_pacer.h
+ *
+ * @brief PCR paced replay scheduler
+ *
+ * Splits replayed transport stream at PCR packets of the clock PID and
+ * gives every part an absolute deadline from its PCR, so packets and
+ * sections come at broadcast pace (or N times faster). Measures PCR
+ * interval and jitter of the capture and lateness of its own wake-ups.
+ */
+
+#ifndef TS_PACER_H_
+#define TS_PACER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define TS_PACER_PID_AUTO           0xFFFF  /* clock is the first PID carrying PCR */
+#define TS_PACER_PCR_HZ             27000000
+#define TS_PACER_MAX_PCR_GAP_MS     1000    /* longer gap or backward step starts new timeline */
+#define TS_PACER_JITTER_SETTLE      10      /* PCRs before jitter is measured */
+
+/**
+ * @brief Pacer counters, times in milliseconds
+ */
+typedef struct t_TsPacerStats
+{
+    uint32_t pcrCount;
+    uint32_t rebases;                   /* timeline restarts: discontinuity, loop, clock change */
+    double pcrIntervalMax;
+    double pcrJitterMax;                /* PCR against constant rate arrival, absolute value */
+    double pcrJitterSum;
+    uint32_t pcrJitterCount;
+    uint32_t waits;
+    double latenessMax;                 /* wake-up after deadline */
+    double latenessSum;
+    uint32_t lateOverMs;                /* wake-ups more than 1 ms late */
+    double bitrate;                     /* bit/s over the current timeline */
+}t_TsPacerStats;
+
+/**
+ * @brief Pacer state
+ */
+typedef struct t_TsPacer
+{
+    uint32_t pcrPid;                    /* clock PID, TS_PACER_PID_AUTO until first PCR */
+    uint32_t fixedPid;                  /* 1 - clock PID was given and is never changed */
+    double speed;
+    uint8_t pcrSeen[8192 / 8];          /* PIDs that carried PCR */
+    uint64_t bytes;                     /* bytes scanned */
+    uint32_t haveBase;
+    uint64_t basePcr;
+    uint64_t baseByte;
+    double baseTime;
+    uint64_t lastPcr;
+    uint64_t lastByte;
+    uint32_t timelinePcrs;
+    t_TsPacerStats stats;
+}t_TsPacer;
+
+/****************************************************************************
+* @brief    Reset pacer and its counters
+*
+* @param    [in] pcrPid - clock PID, TS_PACER_PID_AUTO to take the first one
+* @param    [in] speed - replay speed, 1 is broadcast pace
+*
+*****************************************************************************/
+void Ts_Pacer_Init(t_TsPacer *pacer, uint32_t pcrPid, double speed);
+
+/****************************************************************************
+* @brief    Take PCR of PID as clock, if PID carried PCR so far
+*
+* @return   1 - clock changed, 0 - not changed (no PCR on PID or fixed clock)
+*
+*****************************************************************************/
+int32_t Ts_Pacer_Follow_Pid(t_TsPacer *pacer, uint32_t PID);
+
+/****************************************************************************
+* @brief    Find part of stream up to next PCR packet of clock PID
+*
+* @param    [in] data - stream bytes, starting at packet boundary
+* @param    [in] length - bytes available
+* @param    [out] deadline - CLOCK_MONOTONIC seconds when part is due,
+*                            0 if part carries no clock PCR
+*
+* @return   Part length, including the PCR packet
+*
+*****************************************************************************/
+size_t Ts_Pacer_Scan(t_TsPacer *pacer, const uint8_t *data, size_t length, double *deadline);
+
+/****************************************************************************
+* @brief    Sleep until absolute deadline and record lateness
+*
+*****************************************************************************/
+void Ts_Pacer_Wait(t_TsPacer *pacer, double deadline);
+
+/****************************************************************************
+* @brief    Start new timeline at next PCR, stream jumped
+*
+*****************************************************************************/
+void Ts_Pacer_Rebase(t_TsPacer *pacer);
+
+/****************************************************************************
+* @brief    Check whether pacer runs on PCR timeline
+*
+* @return   1 - parts get deadlines, 0 - no clock PCR seen since rebase
+*
+*****************************************************************************/
+int32_t Ts_Pacer_Has_Clock(const t_TsPacer *pacer);
+
+/****************************************************************************
+* @brief    Current CLOCK_MONOTONIC time in seconds
+*
+*****************************************************************************/
+double Ts_Pacer_Now(void);
+
+#endif //TS_PACER_H_